@@ -14,6 +14,15 @@ extern "C" {
 void App_Init(void);
 void App_Main(void);
 
+/**
+ * @brief  Post a walking velocity command (mm/s, mm/s, deg/s; all 0 = stop)
+ * @note   Safe from any context (UART/ESP RX ISR); picked up next control tick
+ */
+void App_WalkCommand(float vx, float vy, float yawRate);
+
+/** ESP link UART (USART2) interrupt — called from USART2_IRQHandler */
+void App_LinkIrq(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,9 +30,24 @@ void App_Main(void);
 #ifdef __cplusplus
 /* C++ only declarations go here */
 
+#include "loop_monitor.hpp"
+
 namespace App {
     void init();
     void run();
+
+    /* Optional work split out of run(): called after each tick in the
+     * superloop build, from low-priority tasks in the RTOS build */
+    void linkService();                 // shell commands, ESP status, jitter drain
+    void logService();                  // periodic estimator log
+    void displayService(bool stress);   // LCD status (stress: full redraws)
+    bool audioService(bool stress);     // audio cues (stress: continuous tone)
+    bool deferredBootStep();            // assets, audio, SD, splash; false when done
+    bool sdService();                   // SD scheduler (log, "sd ..." jobs); true if it blocked
+    bool flashService(bool idle);       // QSPI async completions, "flash rewrite"; true if it blocked
+
+    /** Jitter of the last 1 s window (drained by linkService) */
+    const LoopMonitor::Jitter &jitter();
 }
 
 #endif /* __cplusplus */
@@ -0,0 +1,108 @@
+/**
+ * @file app_rtos.hpp
+ * @brief Optional FreeRTOS task architecture (PNOID_RTOS_ENABLE = 1)
+ *
+ * Tasks (priority high → low):
+ *   control   App::run(), blocked on a task notification from the IMU
+ *             data-ready EXTI — preempts everything below on each sample
+ *   link      App::linkService(): shell commands, ESP status, jitter drain
+ *   audio     App::audioService(): cues from the control loop (SPSC queue)
+ *   display   App::displayService(): LCD status from the status mailbox
+ *   log       deferred boot (flash, audio, SD), then App::logService()
+ *
+ * Control → others only through lock-free structures (CmdMailbox latest
+ * value, SpscQueue, LoopMonitor ring); nothing the control task touches
+ * takes a mutex. All stacks and TCBs are static (allocation-free mode)
+ * and registered with mem_guard for watermarks.
+ *
+ * FreeRTOSConfig.h requirements:
+ *   configSUPPORT_STATIC_ALLOCATION   1
+ *   configUSE_TICK_HOOK               1   (feeds the µs timebase)
+ *   configUSE_NEWLIB_REENTRANT        1
+ *   INCLUDE_uxTaskGetStackHighWaterMark 1
+ *   configMAX_SYSCALL_INTERRUPT_PRIORITY at or above the IMU EXTI (5)
+ * and STM32_THREAD_SAFE_STRATEGY = 4 for newlib locking.
+ *
+ * Wake-up jitter: "rtos load on" makes the display task redraw the full
+ * screen and the audio task play a continuous tone; "rtos" then reports
+ * the control task's wake latency (EXTI stamp → task running).
+ */
+
+#ifndef APP_RTOS_HPP_
+#define APP_RTOS_HPP_
+
+#include "main.h"
+
+#if PNOID_RTOS_ENABLE
+
+#include <cstdint>
+
+/* ============== Task configuration ============== */
+
+/* Priorities (configMAX_PRIORITIES must exceed the control priority) */
+#ifndef PNOID_TASK_CONTROL_PRIO
+#define PNOID_TASK_CONTROL_PRIO   6
+#endif
+#ifndef PNOID_TASK_LINK_PRIO
+#define PNOID_TASK_LINK_PRIO      4
+#endif
+#ifndef PNOID_TASK_AUDIO_PRIO
+#define PNOID_TASK_AUDIO_PRIO     3
+#endif
+#ifndef PNOID_TASK_DISPLAY_PRIO
+#define PNOID_TASK_DISPLAY_PRIO   2
+#endif
+#ifndef PNOID_TASK_LOG_PRIO
+#define PNOID_TASK_LOG_PRIO       1
+#endif
+
+/* Stack sizes in words (LOG* macros need ~300 bytes each) */
+#ifndef PNOID_TASK_CONTROL_STACK
+#define PNOID_TASK_CONTROL_STACK  2048
+#endif
+#ifndef PNOID_TASK_LINK_STACK
+#define PNOID_TASK_LINK_STACK     768
+#endif
+#ifndef PNOID_TASK_AUDIO_STACK
+#define PNOID_TASK_AUDIO_STACK    512
+#endif
+#ifndef PNOID_TASK_DISPLAY_STACK
+#define PNOID_TASK_DISPLAY_STACK  512
+#endif
+#ifndef PNOID_TASK_LOG_STACK
+#define PNOID_TASK_LOG_STACK      1024
+#endif
+
+/* Service periods (ms) */
+#ifndef PNOID_LINK_PERIOD_MS
+#define PNOID_LINK_PERIOD_MS      10
+#endif
+#ifndef PNOID_DISPLAY_PERIOD_MS
+#define PNOID_DISPLAY_PERIOD_MS   100
+#endif
+#ifndef PNOID_LOG_PERIOD_MS
+#define PNOID_LOG_PERIOD_MS       50
+#endif
+
+namespace AppRtos {
+
+/** Create all tasks and start the scheduler — does not return */
+void start();
+
+/** Control task: block until the next IMU sample or `timeoutMs` */
+void waitSample(uint32_t timeoutMs);
+
+/** IMU data-ready EXTI: wake the control task */
+void notifyControlFromIsr();
+
+/** Display / audio stress load on or off */
+void setStress(bool on);
+
+/** Log task stacks, stress state and control wake-up jitter */
+void report();
+
+} // namespace AppRtos
+
+#endif /* PNOID_RTOS_ENABLE */
+
+#endif /* APP_RTOS_HPP_ */
@@ -47,6 +47,46 @@ extern "C" {
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
 
+/* D-cache: 0 = turn it back off after boot (before/after benchmarking) */
+#ifndef PNOID_DCACHE_ENABLE
+#define PNOID_DCACHE_ENABLE  1
+#endif
+
+/* DMA buffer placement: .dma_buffer in D2 SRAM1 (linker script), which
+ * MPU_Config() maps non-cacheable — no cache maintenance needed.
+ * Buffers outside it must use BSP::cacheClean()/cacheInvalidate(). */
+#define PNOID_DMA_BUFFER      __attribute__((section(".dma_buffer"), aligned(32)))
+#define PNOID_DMA_REGION_BASE 0x30000000UL
+#define PNOID_DMA_REGION_SIZE (128UL * 1024UL)
+
+/* Allocation-free mode (mem_guard.h): heap use after App::init()
+ *   1 = trap (breakpoint / Error_Handler), 0 = count violations only */
+#ifndef PNOID_ALLOC_FREE
+#define PNOID_ALLOC_FREE  1
+#endif
+
+/* Optional RTOS build (app_rtos.hpp): FreeRTOS with static allocation,
+ * control task woken by the IMU EXTI. Needs the FreeRTOS middleware and
+ * STM32_THREAD_SAFE_STRATEGY=4. 0 = superloop in App::run() */
+#ifndef PNOID_RTOS_ENABLE
+#define PNOID_RTOS_ENABLE  0
+#endif
+
+/* TCM placement: 0 = leave everything in FLASH / RAM_D1 (benchmarking)
+ *   PNOID_FAST_CODE  function runs from ITCM (copied at startup)
+ *   PNOID_FAST_DATA  object lives in DTCM — never a DMA buffer */
+#ifndef PNOID_TCM_ENABLE
+#define PNOID_TCM_ENABLE  1
+#endif
+
+#if PNOID_TCM_ENABLE
+#define PNOID_FAST_CODE  __attribute__((section(".itcm_text")))
+#define PNOID_FAST_DATA  __attribute__((section(".dtcm_data")))
+#else
+#define PNOID_FAST_CODE
+#define PNOID_FAST_DATA
+#endif
+
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
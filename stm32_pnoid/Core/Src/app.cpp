@@ -9,26 +9,53 @@ extern "C" {
 
 #include "app.hpp"
 #include "debug_log.h"
+#include "trace.h"
 #include "bsp.hpp"
 #include "w25qxx.hpp"
+#include "asset_pack.hpp"
+#include "asset_cache.hpp"
+#include "kv_store.hpp"
 #include "lcd.hpp"
 #include "sdcard.hpp"
+#include "fatfs.h"
 #include "i2s_io.hpp"
 #include "audio_out.hpp"
 #include "pca9685.hpp"
 #include "icm20948.hpp"
 #include "humanoid.hpp"
+#include "pose_blender.hpp"
+#include "fall_detector.hpp"
+#include "leg_ik.hpp"
+#include "push_recovery.hpp"
+#include "walk_controller.hpp"
+#include "cmd_mailbox.hpp"
+#include "loop_monitor.hpp"
+#include "fast_math.hpp"
+#include "mem_guard.h"
+#include "timebase.h"
+#include "spsc_queue.hpp"
+#include "sd_sched.hpp"
+#include "sd_shell.hpp"
+#include "flash_shell.hpp"
+#include "asset_shell.hpp"
+#if PNOID_RTOS_ENABLE
+#include "app_rtos.hpp"
+#endif
+#include <cstdlib>
+#include <cstring>
 // #include "camera.hpp"   // Uncomment when camera is connected
 
 /* ============== External HAL handles from main.c ============== */
 
 extern QSPI_HandleTypeDef hqspi;
+extern MDMA_HandleTypeDef hmdma_assets;
 extern SPI_HandleTypeDef  hspi2;
 extern SD_HandleTypeDef   hsd1;
 extern DCMI_HandleTypeDef hdcmi;
 extern I2C_HandleTypeDef  hi2c1;
 extern I2C_HandleTypeDef  hi2c2;
 extern I2S_HandleTypeDef  hi2s1;
+extern UART_HandleTypeDef huart2;   // ESP command/control link
 
 /* ============== Driver instances ============== */
 
@@ -38,79 +65,790 @@ static LCD     lcd(hspi2,
                    LCD_D_C_GPIO_Port, LCD_D_C_Pin,
                    LCD_BLK_GPIO_Port, LCD_BLK_Pin);
 static SDCard   sd(hsd1);
+static SDScheduler sdSched;                // chủ duy nhất của thẻ SD (sdService)
 static I2SIO    i2s(hi2s1);
 static AudioOut audioOut(i2s);
+static SDShell   sdShell(sd, sdSched, audioOut);   // lệnh "sd ..." (bench, play, rec)
 static PCA9685  servo1(hi2c1, 0x41);   // PCA9685 #1 (A0 soldered)
 static PCA9685  servo2(hi2c1, 0x42);   // PCA9685 #2 (A1 soldered)
 static ICM20948 imu(hi2c1, 0x68);      // ICM-20948 IMU
 static Humanoid robot(servo1, servo2); // Humanoid: left=PCA#1, right=PCA#2
+/* Control state: DTCM (zero wait state, PNOID_FAST_DATA) */
+PNOID_FAST_DATA static PoseBlender    blender;        // smooth transitions between poses
+PNOID_FAST_DATA static FallDetector   fallDetector;   // latched fall detection per IMU sample
+PNOID_FAST_DATA static LegIK          legIK;          // analytic leg IK/FK (Docs §4)
+PNOID_FAST_DATA static PushRecovery   recovery;       // capture-point reflex step
+PNOID_FAST_DATA static WalkController walker;         // walking state machine + footstep planner
+PNOID_FAST_DATA static CmdMailbox<WalkCommand> walkMailbox;   // UART / ESP → control loop
+PNOID_FAST_DATA static LoopMonitor    loopMon;        // deadline / jitter supervisor
+
+/* Control → optional work (log, display, ESP, audio): không lock, không block */
+struct ControlStatus {
+    float    roll, pitch;          // deg, estimated
+    float    corrRoll, corrPitch;  // deg, stabilizer output
+    float    ax, ay, az;           // g
+    uint32_t ms;
+};
+struct AudioCue {
+    uint16_t freqHz;
+    uint16_t durationMs;
+};
+static CmdMailbox<ControlStatus> statusMailbox;   // latest value, nhiều reader (peek)
+static SpscQueue<AudioCue, 8>    audioQueue;      // control → audio task
+static LoopMonitor::Jitter       lastJitter;      // drain mỗi 1 s (link service)
+static volatile bool             traceTick = false;  // TRACE mỗi tick ("trace on")
+
+/*
+ * QSPI flash map: asset pack (scripts/asset_pack.py) ở đầu chip, KV store
+ * (calibration / tuning) 64 KB ngay sau, 64 KB cuối là vùng test
+ * "flash rewrite", không chứa dữ liệu
+ */
+static constexpr uint32_t ASSET_PACK_ADDR = 0;
+static constexpr uint32_t ASSET_PACK_SIZE = 6 * 1024 * 1024;
+static constexpr uint32_t KV_ADDR         = ASSET_PACK_ADDR + ASSET_PACK_SIZE;
+static constexpr uint32_t KV_SECTORS      = 16;
+static AssetPack assets(flash, ASSET_PACK_ADDR, ASSET_PACK_SIZE);
+static KvStore   params(flash, KV_ADDR, KV_SECTORS);
+
+/*
+ * Prefetch cache cho consumer đọc ngẫu nhiên (mix, sprite): MDMA chép
+ * từng line 4 KB từ QSPI mapped vào AXI SRAM (.bss), LRU; "asset cache"
+ */
+alignas(32) static uint8_t cacheLines[16 * AssetCache::LINE_SIZE];
+static AssetCache assetCache(flash, hmdma_assets, cacheLines, sizeof(cacheLines));
+static AssetShell assetShell(flash, assets, assetCache, sdSched, lcd, audioOut);   // lệnh "asset ..."
+
+/*
+ * Tham số chỉnh được lúc chạy ("kv set"), mặc định = giá trị đã hiệu chỉnh.
+ * Control loop chỉ đọc; link task ghi từng float (atomic trên M7).
+ */
+struct Tuning {
+    float rollOffset  = -7.0f;    // IMU bias khi đứng thẳng
+    float pitchOffset = -6.0f;
+    float kpPitch     = 2.0f;     // tăng phản ứng nhanh
+    float kdPitch     = 0.15f;    // tăng damping chống overshoot
+    float kpRoll      = 2.0f;
+    float kdRoll      = 0.15f;
+};
+PNOID_FAST_DATA static Tuning tuning;
+
+/* Key KV → field; "trim.L0".."trim.L5", "trim.R0".., "trim.T0".."trim.T1" là int16 */
+static const struct {
+    const char *key;
+    float Tuning::*field;
+} TUNING_KEYS[] = {
+    { "imu.roll",      &Tuning::rollOffset  },
+    { "imu.pitch",     &Tuning::pitchOffset },
+    { "gain.kp_pitch", &Tuning::kpPitch     },
+    { "gain.kd_pitch", &Tuning::kdPitch     },
+    { "gain.kp_roll",  &Tuning::kpRoll      },
+    { "gain.kd_roll",  &Tuning::kdRoll      },
+};
+
+static FlashShell        flashShell(flash, loopMon);   // lệnh "flash ..."
 // static Camera  cam(hdcmi, hi2c2);   // Uncomment when camera connected
 
 /* ============== IMU Data-Ready Flag (set by EXTI) ============== */
 
-static volatile bool imuDataReady = false;
+PNOID_FAST_DATA static volatile bool     imuDataReady    = false;
+PNOID_FAST_DATA static volatile uint32_t imuSampleCycles = 0;   // DWT stamp of last data-ready edge
+PNOID_FAST_DATA static volatile uint64_t imuSampleUs     = 0;   // µs stamp of the same edge
 
 /* ============== Application ============== */
 
 static const char *TAG = "APP";
 
+/* ============== Loop supervision ============== */
+
+/* Optional work (periodic log, ESP status) tắt khi loop trễ deadline */
+static volatile bool optionalWorkOff = false;
+
+static void onDegrade(bool degraded)
+{
+    optionalWorkOff = degraded;
+    LOGW(TAG, "Control loop %s", degraded ? "missed deadline, optional work off"
+                                          : "back on time, optional work on");
+}
+
+/** "$LOOP,<csv>\r\n" to the ESP — interrupt driven, skipped if still busy */
+static void espSendStatus()
+{
+    static char buf[96];
+    if (huart2.gState != HAL_UART_STATE_READY) return;
+    int n = snprintf(buf, sizeof(buf), "$LOOP,");
+    n += loopMon.summaryCsv(buf + n, sizeof(buf) - n);
+    if (n > (int)sizeof(buf) - 3) n = sizeof(buf) - 3;
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    HAL_UART_Transmit_IT(&huart2, (uint8_t *)buf, n);
+}
+
+/* ============== Boot timeline ============== */
+
+/*
+ * Boot theo stage, mỗi stage ghi mốc TIME_Micros() (µs từ reset):
+ *   core     BSP, system info
+ *   reset    bắt đầu reset IMU + LCD (chờ chồng lên nhau)
+ *   flash    QSPI + KV calibration (trim, IMU bias, gain) trước home pose
+ *   servo    PCA9685 → robot giữ home pose sớm nhất có thể
+ *   probe    chỉ dò các địa chỉ I2C đã biết
+ *   imu/lcd  hoàn tất init sau thời gian reset
+ *   comm     UART command, ESP status
+ *   loop     tick điều khiển đầu tiên
+ *   stance   blend xong bent-knee stance
+ *   assets/audio/sd/splash  deferred — RTOS: log task; superloop: cuối
+ *                           App::init(), trước loop (không block lúc đứng)
+ */
+struct BootStage {
+    const char *name;
+    uint32_t    us;
+};
+static constexpr uint8_t BOOT_MAX_STAGES = 16;
+static BootStage bootStages[BOOT_MAX_STAGES];
+static uint8_t   bootStageCount = 0;
+static bool      lcdReady       = false;
+static bool      audioReady     = false;
+static bool      flashReady     = false;
+
+static void bootMark(const char *name)
+{
+    if (bootStageCount < BOOT_MAX_STAGES)
+        bootStages[bootStageCount++] = { name, (uint32_t)TIME_Micros() };
+}
+
+static void bootReport()
+{
+    uint32_t prev = 0;
+    for (uint8_t i = 0; i < bootStageCount; i++) {
+        LOGI(TAG, "BOOT %-7s %5lu.%03lu ms (+%lu us)",
+             bootStages[i].name, bootStages[i].us / 1000, bootStages[i].us % 1000,
+             bootStages[i].us - prev);
+        prev = bootStages[i].us;
+    }
+}
+
+/* Known I2C1 devices — probe these only (full scan was >1 s worst case) */
+static const struct {
+    uint8_t     addr;
+    const char *name;
+} I2C1_DEVICES[] = {
+    { 0x41, "PCA9685 #1" },
+    { 0x42, "PCA9685 #2" },
+    { 0x68, "ICM-20948" },
+};
+
+static void probeI2C()
+{
+    for (const auto &d : I2C1_DEVICES) {
+        if (HAL_I2C_IsDeviceReady(&hi2c1, d.addr << 1, 2, 2) != HAL_OK)
+            LOGW(TAG, "I2C1 0x%02X (%s) not responding", d.addr, d.name);
+    }
+}
+
+static void paramsLoad();
+
 namespace App {
 
-void init() {
-    BSP::init();
-    BSP::printSystemInfo();
+/*
+ * Deferred stage: không cần để giữ thăng bằng. RTOS: log task chạy liền,
+ * song song với control loop. Superloop: chạy hết trong App::init(), trước
+ * khi stabilizer bắt đầu — các bước block (audio, SD init + f_mount tới vài
+ * trăm ms) không được nằm trong loop thăng bằng; mỗi bước một mốc boot.
+ * @retval false khi đã xong hết
+ */
+bool deferredBootStep()
+{
+    static uint8_t step = 0;
+
+    switch (step++) {
+    case 0:
+        /* Flash + KV đã init trong App::init(); ở đây chỉ asset pack + cache */
+        if (flashReady) {
+            AssetPack::Status ast = assets.mount();
+            if (ast == AssetPack::Status::OK) {
+                LOGI(TAG, "Asset pack: %lu assets, %lu KB", assets.count(), assets.size() / 1024);
+            } else {
+                LOGW(TAG, "No asset pack (%d)", (int)ast);
+            }
+            if (assetCache.init(MDMA_Channel0) != AssetCache::Status::OK)
+                LOGW(TAG, "Asset cache: MDMA init failed");
+        }
+        bootMark("assets");
+        return true;
 
-    /* Init SD Card — nếu có thì mount và bật SD logging */
-    if (sd.init() == SDCard::Status::OK) {
-        LOGI(TAG, "SD Card mounted");
+    case 1:
+        if (audioOut.init() != AudioOut::Status::OK) {
+            LOGE(TAG, "Audio init failed!");
+        } else {
+            audioReady = true;
+        }
+        bootMark("audio");
+        return true;
+
+    case 2:
+        /* SD mount — nếu có thì bật SD logging */
+        if (sd.init() == SDCard::Status::OK) {
+            LOGI(TAG, "SD Card mounted");
 #if LOG_SD_ENABLE
-        if (LOG_SD_Init() == 0) {
-            LOGI(TAG, "SD logging enabled");
+            if (LOG_SD_Init() == 0) {
+                LOGI(TAG, "SD logging enabled");
+            }
+#endif
+        } else {
+            LOGW(TAG, "SD Card not available, UART log only");
+        }
+        bootMark("sd");
+        return true;
+
+    case 3:
+        if (lcdReady) {
+            /* Benchmark: so sánh PNOID_DCACHE_ENABLE 0/1 (loop: lệnh "loop") */
+            uint32_t c0 = DWT->CYCCNT;
+            lcd.fillScreen(LCD::BLACK);
+            LOGI(TAG, "LCD fill %lu us (D-cache %s)",
+                 (DWT->CYCCNT - c0) / (SystemCoreClock / 1000000),
+                 (SCB->CCR & SCB_CCR_DC_Msk) ? "on" : "off");
+            lcd.drawString(20, 100, "PNOID Ready!", LCD::GREEN, LCD::BLACK);
         }
+        bootMark("splash");
+#if PNOID_RTOS_ENABLE
+        bootReport();           // superloop: lúc stance (có cả loop / stance)
 #endif
-    } else {
-        LOGW(TAG, "SD Card not available, UART log only");
+        return false;
+
+    default:
+        return false;
     }
+}
 
-    /* Init QSPI Flash */
-    if (flash.init() != W25Qxx::Status::OK) {
-        LOGE(TAG, "W25Qxx init failed!");
+/* ============== Optional work services ==============
+ * Superloop: gọi từ App::run() sau mỗi tick.
+ * RTOS: mỗi service chạy trong task ưu tiên thấp riêng (app_rtos.cpp).
+ */
+
+/** Shell commands + ESP status / jitter mỗi 1 s */
+void linkService()
+{
+    static uint32_t lastStatus = 0;
+    static uint32_t lastDrain  = 0;
+
+    LOG_CMD_Poll();
+
+    /* Ring ~230 ms ở ~1.1 kHz: gom sample mỗi 100 ms, báo jitter mỗi 1 s */
+    uint32_t now = (uint32_t)(TIME_Micros() / 1000);
+    if ((now - lastDrain) >= LoopMonitor::DRAIN_MS) {
+        loopMon.drain();
+        lastDrain = now;
+    }
+    if ((now - lastStatus) >= 1000) {
+        lastJitter = loopMon.drainJitter();
+        if (!optionalWorkOff) {
+            espSendStatus();
+            LOGD(TAG, "loop period %lu us, jitter rms %lu us, wake %lu/%lu/%lu us "
+                      "(mean/rms/max, %u samples)",
+                 lastJitter.meanUs, lastJitter.rmsUs, lastJitter.wakeMeanUs,
+                 lastJitter.wakeRmsUs, lastJitter.wakeMaxUs, lastJitter.count);
+        }
+        lastStatus = now;
+    }
+}
+
+#if LOG_SD_ENABLE
+/** Log flush / sync như một job của scheduler (lớp Log, ưu tiên thấp nhất) */
+static bool logFlushJob(void *)
+{
+    LOG_SD_Service();
+    return true;
+}
+#endif
+
+/**
+ * Chủ của thẻ SD: mọi truy cập (log, stream, audio read-ahead) đi qua
+ * sdSched, kể cả lệnh "sd ..." / "asset ..." (job trên hàng đợi, xem
+ * sd_shell.hpp, asset_shell.hpp).
+ * @retval true nếu đã block (có I/O)
+ */
+bool sdService()
+{
+#if LOG_SD_ENABLE
+    static SDScheduler::Request logReq;
+    if (!logReq.queued && LOG_SD_Due()) {
+        logReq.op         = SDScheduler::Op::Job;
+        logReq.stream     = SDScheduler::Stream::Log;
+        logReq.job        = logFlushJob;
+        logReq.deadlineUs = TIME_Micros() + 1000000u;
+        sdSched.submit(logReq);
     }
+#endif
+    sdShell.service();
+    return sdSched.run(0) > 0;
+}
+
+/**
+ * QSPI flash: completion callback của async engine, asset pack writer,
+ * prefetch cache, "flash rewrite" / "asset cache bench". Gọi mỗi pass;
+ * idle = được phép block (đứng yên / log task).
+ * @retval true nếu đã block
+ */
+bool flashService(bool idle)
+{
+    flash.service();
+    assets.service();
+    if (flashReady) params.service();
+    if (assetCache.isReady()) assetCache.service();
+    if (assetShell.service(idle)) return true;
+    return flashShell.service(idle);
+}
+
+/** Trạng thái estimator mỗi 500 ms (optional — bỏ khi loop trễ) */
+void logService()
+{
+    static uint32_t lastLog = 0;
 
-    /* Init Audio (I2S + PCM5102 DAC) */
-    if (audioOut.init() != AudioOut::Status::OK) {
-        LOGE(TAG, "Audio init failed!");
+    /* Binary trace → console "#T" lines (decode: scripts/trace_decode.py) */
+    TRACE_Pump(8);
+
+    ControlStatus st;
+    if (optionalWorkOff || !statusMailbox.peek(st)) return;
+    if ((st.ms - lastLog) < 500) return;
+
+    LOGI(TAG, "R=%d P=%d cr=%d cp=%d ax=%d ay=%d az=%d",
+         (int)st.roll, (int)st.pitch,
+         (int)st.corrRoll, (int)st.corrPitch,
+         (int)(st.ax * 100), (int)(st.ay * 100), (int)(st.az * 100));
+    lastLog = st.ms;
+}
+
+/**
+ * Roll / pitch lên LCD
+ * @param stress  vẽ lại toàn màn hình liên tục (đo jitter khi tải nặng)
+ */
+void displayService(bool stress)
+{
+    if (!lcdReady) return;
+
+    if (assetShell.displayService()) return;
+
+    if (stress) {
+        static uint16_t color = 0;
+        color += 0x0841;
+        lcd.fillScreen(color);
+        return;
     }
 
-    /* Init LCD */
-    if (lcd.init() != LCD::Status::OK) {
-        LOGE(TAG, "LCD init failed!");
+    ControlStatus st;
+    if (!statusMailbox.peek(st)) return;
+    char line[24];
+    snprintf(line, sizeof(line), "R%4d P%4d", (int)st.roll, (int)st.pitch);
+    lcd.drawString(20, 130, line, LCD::WHITE, LCD::BLACK);
+}
+
+/**
+ * Phát audio cue từ control loop (fall, step)
+ * @param stress  phát tone liên tục khi hàng đợi rỗng
+ * @retval true nếu đã phát (block trong lúc phát)
+ */
+bool audioService(bool stress)
+{
+    if (!audioReady) return false;
+
+    AudioCue cue;
+    if (audioQueue.pop(cue)) {
+        audioOut.playTone(cue.freqHz, cue.durationMs);
+        return true;
+    }
+    if (assetShell.audioService()) return true;
+    if (sdShell.audioService()) return true;
+    if (stress) {
+        audioOut.playTone(440, 100);
+        return true;
+    }
+    return false;
+}
+
+const LoopMonitor::Jitter &jitter()
+{
+    return lastJitter;
+}
+
+} // namespace App
+
+/* ============== Math benchmark ============== */
+
+/** Cycles per call: libm vs FastMath (lệnh "math") */
+static void benchMath()
+{
+    const int N = 256;
+    volatile float sink;
+    float acc = 0.0f;
+    uint32_t c[7];
+
+    c[0] = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) acc += sinf(i * 0.0123f);
+    c[1] = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) acc += FastMath::sin(i * 0.0123f);
+    c[2] = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) acc += atan2f(i * 0.01f - 1.0f, 0.7f);
+    c[3] = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) acc += FastMath::atan2(i * 0.01f - 1.0f, 0.7f);
+    c[4] = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) acc += 1.0f / sqrtf(i * 0.1f + 0.5f);
+    c[5] = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) acc += FastMath::rsqrt(i * 0.1f + 0.5f);
+    c[6] = DWT->CYCCNT;
+    sink = acc;
+    (void)sink;
+
+    LOGI(TAG, "MATH cycles/call libm/fast: sin %lu/%lu atan2 %lu/%lu rsqrt %lu/%lu",
+         (c[1] - c[0]) / N, (c[2] - c[1]) / N, (c[3] - c[2]) / N,
+         (c[4] - c[3]) / N, (c[5] - c[4]) / N, (c[6] - c[5]) / N);
+}
+
+/** Cycles per LOG call (lệnh "log bench") — DMA ring, không chờ UART */
+static void benchLog()
+{
+    const int N = 16;
+    uint32_t total = 0, worst = 0;
+
+    for (int i = 0; i < N; i++) {
+        uint32_t c0 = DWT->CYCCNT;
+        LOGD(TAG, "bench %d roll=%d pitch=%d", i, -12, 34);
+        uint32_t c = DWT->CYCCNT - c0;
+        total += c;
+        if (c > worst) worst = c;
+    }
+
+    /* Cùng dòng đó nếu gửi blocking: ~len·10 bit / baud */
+    LOG_TX_Stats_t st;
+    LOG_TX_GetStats(&st);
+    uint32_t lineBytes = st.lines ? st.bytes / st.lines : 0;
+    LOGI(TAG, "LOG %lu cycles/call avg, %lu max (%lu us); blocking would be ~%lu us",
+         total / N, worst, worst / TIME_CyclesPerUs(),
+         (uint32_t)((uint64_t)lineBytes * 10u * 1000000u / st.baud));
+}
+
+/** Cycles per TRACE call vs LOG (lệnh "trace bench") */
+static void benchTrace()
+{
+    const int N = 32;
+    uint32_t c0 = DWT->CYCCNT;
+    for (int i = 0; i < N; i++) {
+        TRACE("bench %d roll=%f pitch=%f", i, -1.5f, 3.25f);
+    }
+    uint32_t c = (DWT->CYCCNT - c0) / N;
+    LOGI(TAG, "TRACE %lu cycles/call (%lu ns)", c, c * 1000u / TIME_CyclesPerUs());
+}
+
+/** Trace ring usage / drops (lệnh "trace") */
+static void traceReport()
+{
+    TRACE_Stats_t st;
+    TRACE_GetStats(&st);
+    LOGI(TAG, "TRACE tick %s, %lu records, %lu dropped, ring %lu/%u words (peak %lu)",
+         traceTick ? "on" : "off", st.records, st.drops, st.used,
+         TRACE_RING_WORDS, st.peak);
+}
+
+/** Ring usage / drops (lệnh "log") */
+static void logReport()
+{
+    LOG_TX_Stats_t st;
+    LOG_TX_GetStats(&st);
+    LOGI(TAG, "LOG %lu lines %lu B, %lu dropped, ring %lu/%lu B (peak %lu), %lu baud",
+         st.lines, st.bytes, st.drops, st.used, st.size, st.peak, st.baud);
+#if LOG_SD_ENABLE
+    LOG_SD_Stats_t sd;
+    LOG_SD_GetStats(&sd);
+    LOGI(TAG, "SD log %lu B written, %lu B dropped, %lu B buffered, %lu errors; "
+              "flush %lu us (max %lu, %lu writes), sync max %lu us (%lu)",
+         sd.written, sd.droppedBytes, sd.buffered, sd.errors,
+         sd.lastFlushUs, sd.maxFlushUs, sd.flushes, sd.maxSyncUs, sd.syncs);
+#endif
+}
+
+/* ============== Debug UART commands ============== */
+
+/* ---------- KV params: calibration / tuning ------------------------------ */
+
+/** "trim.L3" → chân trái khớp 3; false nếu không phải key trim */
+static bool trimJoint(const char *key, char &side, int &joint)
+{
+    if (strlen(key) != 7 || strncmp(key, "trim.", 5) != 0) return false;
+    side  = key[5];
+    joint = key[6] - '0';
+    if (side == 'L' || side == 'R') return joint >= 0 && joint < Leg::NUM_JOINTS;
+    if (side == 'T')                return joint >= 0 && joint < Torso::NUM_JOINTS;
+    return false;
+}
+
+/**
+ * Áp một giá trị KV vào tuning / trim khớp. Trim: control loop gửi lại
+ * khớp ở setPose kế tiếp (isStale), không ghi I2C từ task khác.
+ * @retval false nếu key lạ hoặc sai kiểu
+ */
+static bool applyParam(const char *key, const void *value, uint32_t len)
+{
+    char side;
+    int  joint;
+    if (trimJoint(key, side, joint)) {
+        if (len != sizeof(int16_t)) return false;
+        int16_t off;
+        memcpy(&off, value, sizeof(off));
+        if (side == 'L')      robot.leftLeg.setOffset((Leg::Joint)joint, off);
+        else if (side == 'R') robot.rightLeg.setOffset((Leg::Joint)joint, off);
+        else                  robot.torso.setOffset((Torso::Joint)joint, off);
+        return true;
+    }
+    for (const auto &t : TUNING_KEYS) {
+        if (strcmp(key, t.key) == 0) {
+            if (len != sizeof(float)) return false;
+            memcpy(&(tuning.*t.field), value, sizeof(float));
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Đọc index KV lúc boot và áp mọi giá trị đã lưu */
+static void paramsLoad()
+{
+    uint32_t c0 = DWT->CYCCNT;
+    KvStore::Status st = params.load();
+    uint32_t us = (DWT->CYCCNT - c0) / (SystemCoreClock / 1000000);
+
+    if (st != KvStore::Status::OK) {
+        LOGW(TAG, "KV load failed (%d), using defaults", (int)st);
+        return;
+    }
+    uint32_t applied = 0;
+    for (uint32_t i = 0; i < KvStore::MAX_KEYS; i++) {
+        const char *key;
+        const uint8_t *value;
+        uint32_t len;
+        if (params.at(i, key, value, len) && applyParam(key, value, len)) applied++;
+    }
+    const KvStore::LoadStats &ls = params.loadStats();
+    LOGI(TAG, "KV: %lu keys (%lu applied), %lu B scanned, %lu bad, load %lu us",
+         ls.keys, applied, ls.bytes, ls.bad, us);
+}
+
+/** "kv ls": giá trị + thống kê load / ghi; float in dạng x.yyy (nano printf) */
+static void paramsList()
+{
+    for (uint32_t i = 0; i < KvStore::MAX_KEYS; i++) {
+        const char *key;
+        const uint8_t *value;
+        uint32_t len;
+        if (!params.at(i, key, value, len)) continue;
+
+        char side;
+        int  joint;
+        if (trimJoint(key, side, joint) && len == sizeof(int16_t)) {
+            int16_t v;
+            memcpy(&v, value, sizeof(v));
+            LOGI(TAG, "  %-15s %d", key, (int)v);
+        } else if (len == sizeof(float)) {
+            float v;
+            memcpy(&v, value, sizeof(v));
+            int32_t milli = (int32_t)(v * 1000.0f + (v < 0 ? -0.5f : 0.5f));
+            uint32_t a = (uint32_t)(milli < 0 ? -milli : milli);
+            LOGI(TAG, "  %-15s %s%lu.%03lu", key, milli < 0 ? "-" : "", a / 1000, a % 1000);
+        } else {
+            LOGI(TAG, "  %-15s (%lu B)", key, len);
+        }
+    }
+
+    const KvStore::LoadStats  &ls = params.loadStats();
+    const KvStore::WriteStats &ws = params.writeStats();
+    LOGI(TAG, "KV %lu keys%s; boot: %lu records, %lu bad, %lu B in %lu sectors, seq %lu",
+         params.count(), params.busy() ? " (writing)" : "",
+         ls.records, ls.bad, ls.bytes, ls.sectors, ls.seq);
+    LOGI(TAG, "KV writes: %lu records in %lu batches, %lu sectors opened, %lu copied, %lu errors",
+         ws.records, ws.batches, ws.opened, ws.copied, ws.errors);
+}
+
+/** "kv set <key> <value>": trim = int16 (độ), còn lại float; áp ngay */
+static void paramsSet(const char *args)
+{
+    char key[KvStore::MAX_KEY + 1];
+    const char *sp = strchr(args, ' ');
+    uint32_t n = sp ? (uint32_t)(sp - args) : 0;
+    if (n == 0 || n > KvStore::MAX_KEY) {
+        LOGW(TAG, "Usage: kv set <key> <value>");
+        return;
+    }
+    memcpy(key, args, n);
+    key[n] = '\0';
+
+    char side;
+    int  joint;
+    KvStore::Status st;
+    if (trimJoint(key, side, joint)) {
+        int16_t v = (int16_t)strtol(sp + 1, nullptr, 10);
+        applyParam(key, &v, sizeof(v));
+        st = params.set(key, v);
     } else {
-        lcd.fillScreen(LCD::BLACK);
-        lcd.drawString(20, 100, "PNOID Ready!", LCD::GREEN, LCD::BLACK);
+        float v = strtof(sp + 1, nullptr);
+        if (!applyParam(key, &v, sizeof(v))) LOGW(TAG, "KV %s: stored, not a tuning key", key);
+        st = params.set(key, v);
     }
+    if (st != KvStore::Status::OK) LOGW(TAG, "KV set %s failed (%d)", key, (int)st);
+}
 
-    /* Scan I2C1 */
-    LOGI(TAG, "Scanning I2C1...");
-    for (uint8_t a = 0x08; a < 0x78; a++) {
-        if (HAL_I2C_IsDeviceReady(&hi2c1, a << 1, 1, 10) == HAL_OK)
-            LOGI(TAG, "  0x%02X found", a);
+/**
+ * "walk <vx> <vy> <yaw>"  mm/s, mm/s, deg/s
+ * "stop"
+ * "loop"                  control loop timing summary
+ * "mem"                   heap / stack watermarks
+ * "boot"                  boot timeline
+ * "math"                  libm vs FastMath cycle counts
+ * "log [bench]"           log ring usage / drops, cycles per LOG call
+ * "trace [on|off|bench]"  binary trace mỗi control tick, cycles per TRACE call
+ * "rtos [load on|off]"    task stacks + control wake jitter, display/audio stress
+ * "sd ..."                bench / seek / sched / play / rec (sd_shell.hpp)
+ * "flash ..."             rewrite [sync] / xip (flash_shell.hpp)
+ * "asset ..."             ls / install / bench / show / play / cache [bench]
+ *                         (asset_shell.hpp)
+ * "kv ls"                 tham số đã lưu (trim, IMU offset, gain) + load / wear stats
+ * "kv set <key> <value>"  áp ngay + lưu; trim.L0-5 / R0-5 / T0-1 (độ), imu.roll,
+ *                         imu.pitch, gain.kp_pitch / kd_pitch / kp_roll / kd_roll
+ * "kv del <key>"          xoá, mặc định biên dịch có hiệu lực lại sau reboot
+ */
+static void onCommand(const char *cmd)
+{
+    if (strncmp(cmd, "walk", 4) == 0) {
+        char *p = (char *)cmd + 4;
+        long vx  = strtol(p, &p, 10);
+        long vy  = strtol(p, &p, 10);
+        long yaw = strtol(p, &p, 10);
+        App_WalkCommand((float)vx, (float)vy, (float)yaw);
+    } else if (strcmp(cmd, "stop") == 0) {
+        App_WalkCommand(0.0f, 0.0f, 0.0f);
+    } else if (strcmp(cmd, "mem") == 0) {
+        MEM_Report();
+    } else if (strcmp(cmd, "boot") == 0) {
+        bootReport();
+    } else if (strcmp(cmd, "math") == 0) {
+        benchMath();
+    } else if (strcmp(cmd, "log bench") == 0) {
+        benchLog();
+    } else if (strcmp(cmd, "log") == 0) {
+        logReport();
+    } else if (strncmp(cmd, "trace", 5) == 0) {
+        if (strcmp(cmd + 5, " on") == 0)       traceTick = true;
+        else if (strcmp(cmd + 5, " off") == 0) traceTick = false;
+        else if (strcmp(cmd + 5, " bench") == 0) benchTrace();
+        traceReport();
+    } else if (strncmp(cmd, "rtos", 4) == 0) {
+#if PNOID_RTOS_ENABLE
+        if (strcmp(cmd + 4, " load on") == 0)       AppRtos::setStress(true);
+        else if (strcmp(cmd + 4, " load off") == 0) AppRtos::setStress(false);
+        AppRtos::report();
+#else
+        LOGW(TAG, "Superloop build (PNOID_RTOS_ENABLE=0)");
+#endif
+    } else if (strncmp(cmd, "sd ", 3) == 0) {
+        if (!sdShell.command(cmd + 3)) LOGW(TAG, "Unknown command: %s", cmd);
+    } else if (strncmp(cmd, "flash ", 6) == 0) {
+        if (!flashReady)                         LOGW(TAG, "Flash not ready");
+        else if (!flashShell.command(cmd + 6))   LOGW(TAG, "Unknown command: %s", cmd);
+    } else if (strncmp(cmd, "asset ", 6) == 0) {
+        if (!flashReady)                         LOGW(TAG, "Flash not ready");
+        else if (!assetShell.command(cmd + 6))   LOGW(TAG, "Unknown command: %s", cmd);
+    } else if (strncmp(cmd, "kv ", 3) == 0) {
+        if (!flashReady) {
+            LOGW(TAG, "Flash not ready");
+        } else if (strcmp(cmd + 3, "ls") == 0) {
+            paramsList();
+        } else if (strncmp(cmd + 3, "set ", 4) == 0) {
+            paramsSet(cmd + 7);
+        } else if (strncmp(cmd + 3, "del ", 4) == 0) {
+            KvStore::Status st = params.remove(cmd + 7);
+            if (st != KvStore::Status::OK) LOGW(TAG, "KV del %s failed (%d)", cmd + 7, (int)st);
+        } else {
+            LOGW(TAG, "Unknown command: %s", cmd);
+        }
+    } else if (strcmp(cmd, "loop") == 0) {
+        char buf[256];
+        loopMon.summary(buf, sizeof(buf));
+        LOGI(TAG, "LOOP %s", buf);
+    } else {
+        LOGW(TAG, "Unknown command: %s", cmd);
+    }
+}
+
+namespace App {
+
+void init() {
+    MEM_Init();          // tô stack trước khi nó sâu xuống
+    BSP::init();
+    BSP::printSystemInfo();
+    bootMark("core");
+
+    /* Stage 1: kick off the slow resets, wait for them in parallel */
+    ICM20948::Status imuSt = imu.beginInit();
+    lcd.beginInit();
+    bootMark("reset");
+
+    /*
+     * Stage 2: calibration (IMU bias, gain, trim khớp) từ KV trên QSPI,
+     * trước home pose và stance: không đổi giữa lúc đang giữ thăng bằng.
+     * flash.init ~35 ms HAL_Delay, chồng lên lúc IMU/LCD reset; load < 0.3 ms
+     */
+    robot.configure();
+    if (flash.init() != W25Qxx::Status::OK) {
+        LOGE(TAG, "W25Qxx init failed!");
+    } else {
+        flashReady = true;
+        flash.enableMemoryMapped();     // XIP mặc định, ghi qua async engine
+        paramsLoad();
     }
+    bootMark("flash");
 
-    /* Init Humanoid (PCA9685 x2 + joint config) */
+    /* Stage 3: servos — PCA9685 + home pose với trim đã load */
     if (robot.init() != Humanoid::Status::OK) {
         LOGE(TAG, "Humanoid init failed!");
     }
+    bootMark("servo");
+
+    probeI2C();
+    bootMark("probe");
 
-    /* Init ICM-20948 IMU */
-    if (imu.init() != ICM20948::Status::OK) {
+    /* Stage 4: finish IMU (100 ms reset), then LCD (150 ms) */
+    if (imuSt == ICM20948::Status::OK) imuSt = imu.finishInit();
+    if (imuSt != ICM20948::Status::OK) {
         LOGE(TAG, "ICM-20948 init failed!");
     }
+    bootMark("imu");
+
+    if (lcd.finishInit() != LCD::Status::OK) {
+        LOGE(TAG, "LCD init failed!");
+    } else {
+        lcdReady = true;
+    }
+    bootMark("lcd");
+
+    /* Debug UART command input (walk / stop / loop) */
+    LOG_CMD_RegisterCallback(onCommand);
+    LOG_CMD_Init();
+    bootMark("comm");
+
+#if PNOID_RTOS_ENABLE
+    LOGI(TAG, "Control path ready at %lu ms (assets/audio/SD deferred)",
+         (uint32_t)(TIME_Micros() / 1000));
+#else
+    /* Superloop: bước deferred block, chạy ở đây khi robot còn ở home pose */
+    while (deferredBootStep()) {}
+    LOGI(TAG, "Control path ready at %lu ms", (uint32_t)(TIME_Micros() / 1000));
+#endif
 
-    LOGI(TAG, "All peripherals initialized");
+    /* Allocation-free: từ đây mọi malloc/new là lỗi (PNOID_ALLOC_FREE) */
+    MEM_HeapLock();
+    MEM_Report();
 }
 
-void run() {
+/* Control loop chạy từ ITCM (PNOID_FAST_CODE) */
+PNOID_FAST_CODE void run() {
     /*
      * Bent-knee stance + IMU stabilizer
      *
@@ -130,69 +868,135 @@ void run() {
     const int16_t BASE_ANK_P = 10;   // bù mũi chân nhẹ
     const int16_t BASE_HIP_R = 5;    // rạng chân vừa
 
-    /* IMU offset (bias khi đứng thẳng) */
-    const float ROLL_OFFSET  = -7.0f;
-    const float PITCH_OFFSET = -6.0f;
-
-    /* ── Stabilizer gains ── */
-    const float Kp_pitch = 2.0f;   // tăng phản ứng nhanh
-    const float Kd_pitch = 0.15f;  // tăng damping chống overshoot
-    const float Kp_roll  = 2.0f;
-    const float Kd_roll  = 0.15f;
+    /* IMU offset + stabilizer gains: tuning (KV store, "kv set") */
 
     /* ankle nhận 60% correction, hip 40% */
     const float ANKLE_SHARE = 0.6f;
     const float HIP_SHARE   = 0.4f;
 
-    /* Complementary filter */
-    const float ALPHA = 0.98f;     // gyro trust (0.98 = tau ≈ 1s)
+    /* Complementary filter: hằng số thời gian cố định, alpha tính theo dt
+     * (0.98/mẫu chỉ cho tau ≈ 1 s ở ~50 Hz; ở 1.1 kHz còn ~45 ms và accel
+     * — gần như mù khi robot đổ — kéo góc ước lượng xuống) */
+    const float FILTER_TAU = 1.0f; // s, gyro trust
     float est_roll  = 0.0f;
     float est_pitch = 0.0f;
 
     /* Correction limits */
     const float CORR_MAX = 25.0f;  // deg (tăng để bù kịp khi nghiêng lớn)
 
-    uint32_t lastTick = HAL_GetTick();
-    uint32_t lastLog  = 0;
+    /* ── Fall reflex ──
+     * false: nhảy ngay sang tư thế bảo vệ (gập gối, hạ trọng tâm)
+     * true : thả servo (PCA9685 sleep) — robot đổ mềm */
+    const bool FALL_RELEASE_SERVOS = false;
+    const int16_t FALL_KNEE  = 60;
+    const int16_t FALL_HIP_P = 30;
+    const int16_t FALL_ANK_P = 30;
+
+    /* dt = khoảng thời gian thật giữa hai mẫu IMU (stamp µs trong EXTI) */
+    const float DT_MIN = 0.0002f;   // s, sàn an toàn (IMU ~1.1 kHz → ~0.9 ms)
+    const float DT_MAX = 0.05f;     // s, sau khi block (deferred boot, reinit)
+    uint64_t lastSampleUs = TIME_Micros();
 
-    /* Set base pose */
-    LOGI(TAG, "Setting bent-knee stance...");
-    robot.torso.setJoint(Torso::Yaw,  0);
-    robot.torso.setJoint(Torso::Roll, 0);
+    /* Thời gian chuyển tư thế (quintic, không giật) */
+    const uint32_t STANCE_BLEND_MS = 1500;
 
-    /* Left: HipRoll dương = rạng ra ngoài (direction=+1 trong config)
+    /* Base pose
+     * Left: HipRoll dương = rạng ra ngoài (direction=+1 trong config)
      * Right: HipRoll dương = rạng ra ngoài (direction=-1 lo mirror) */
-    auto setBasePose = [&](Leg &leg) {
-        leg.setJoint(Leg::HipYaw,     0);
-        leg.setJoint(Leg::HipRoll,    BASE_HIP_R);
-        leg.setJoint(Leg::HipPitch,   BASE_HIP_P);
-        leg.setJoint(Leg::KneePitch,  BASE_KNEE);
-        leg.setJoint(Leg::AnklePitch, BASE_ANK_P);
-        leg.setJoint(Leg::AnkleRoll,  0);
+    Pose basePose;
+    auto setBasePose = [&](int16_t *leg) {
+        leg[Leg::HipYaw]     = 0;
+        leg[Leg::HipRoll]    = BASE_HIP_R;
+        leg[Leg::HipPitch]   = BASE_HIP_P;
+        leg[Leg::KneePitch]  = BASE_KNEE;
+        leg[Leg::AnklePitch] = BASE_ANK_P;
+        leg[Leg::AnkleRoll]  = 0;
     };
-    setBasePose(robot.leftLeg);
-    setBasePose(robot.rightLeg);
+    setBasePose(basePose.leftLeg);
+    setBasePose(basePose.rightLeg);
 
-    HAL_Delay(500);  // đợi servo về vị trí
+    /* Protective pose — tính sẵn, phản ứng khi ngã chỉ cần gửi servo */
+    Pose fallPose = basePose;
+    auto setFallPose = [&](int16_t *leg) {
+        leg[Leg::HipPitch]   = FALL_HIP_P;
+        leg[Leg::KneePitch]  = FALL_KNEE;
+        leg[Leg::AnklePitch] = FALL_ANK_P;
+    };
+    setFallPose(fallPose.leftLeg);
+    setFallPose(fallPose.rightLeg);
+    fallPose.torso[Torso::Roll] = 0;
+
+    /* Blend từ tư thế hiện tại (home) sang bent-knee, không block:
+     * stabilizer chạy song song, correction cộng lên base đang blend */
+    LOGI(TAG, "Blending to bent-knee stance (%lu ms)...", STANCE_BLEND_MS);
+    blender.reset(robot.getPose());
+    blender.moveTo(basePose, STANCE_BLEND_MS);
 
     /* Init filter từ accel hiện tại */
-    if (imu.read() == ICM20948::Status::OK) {
-        auto a = imu.getAccel();
-        est_roll  = atan2f(a.y, a.z) * 57.2958f;
-        est_pitch = atan2f(-a.x, sqrtf(a.y * a.y + a.z * a.z)) * 57.2958f;
-    }
+    auto initFilter = [&]() {
+        if (imu.read() == ICM20948::Status::OK) {
+            auto a = imu.getAccel();
+            est_roll  = FastMath::atan2(a.y, a.z) * 57.2958f;
+            est_pitch = FastMath::atan2(-a.x, FastMath::sqrt(a.y * a.y + a.z * a.z)) * 57.2958f;
+        }
+    };
+    initFilter();
+
+    /* Push recovery: support polygon lấy từ FK của base pose */
+    recovery.configure(PushRecovery::Config(), legIK);
+    recovery.setStance(basePose);
+
+    /* Walking: footstep planner + IK quanh cùng base pose */
+    walker.configure(WalkController::Config(), FootstepPlanner::Config(), legIK);
+    walker.setStance(basePose);
+
+    /* Deadline monitor: quá hạn → tắt log / ESP status cho tới khi ổn lại */
+    loopMon.configure(LoopMonitor::Config(), onDegrade);
 
-    LOGI(TAG, "Stabilizer running (Kp_p=%.1f Kp_r=%.1f)",
-         (double)Kp_pitch, (double)Kp_roll);
+    /* Không dùng %f: printf số thực của newlib-nano cấp phát heap */
+    LOGI(TAG, "Stabilizer running (Kp_p=%d.%d Kp_r=%d.%d)",
+         (int)tuning.kpPitch, (int)(tuning.kpPitch * 10) % 10,
+         (int)tuning.kpRoll,  (int)(tuning.kpRoll * 10) % 10);
 
     /* ── Main control loop ── */
     bool intWorking = false;
+    uint32_t fallLatencyMaxUs = 0;
+    uint32_t stepLatencyMaxUs = 0;
+    uint32_t walkCyclesMax    = 0;     // CPU cost of walker.update()
+    uint32_t walkJitterMaxUs  = 0;     // |step period − T|
+    uint32_t lastStepCycles   = 0;
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    bool stanceReached = false;
+    bootMark("loop");
     while (1) {
+        uint32_t sampleCycles;
+        uint64_t sampleUs;
+
+#if !PNOID_RTOS_ENABLE
+        /* Shell + ESP status (RTOS: link task) */
+        linkService();
+#endif
+
+        /* Lệnh từ UART / ESP — mailbox không block loop */
+        WalkCommand wc;
+        if (walkMailbox.fetch(wc)) {
+            walker.setCommand(wc);
+            LOGI(TAG, "Walk cmd vx=%d vy=%d yaw=%d",
+                 (int)wc.vx, (int)wc.vy, (int)wc.yawRate);
+        }
+
         /* Wait for IMU data-ready interrupt, fallback to 50Hz polling */
         if (!imuDataReady) {
-            uint32_t elapsed = HAL_GetTick() - lastTick;
-            if (elapsed < 20) {            // 50ms timeout → fallback polling
-                HAL_Delay(1);
+            if (TIME_Micros() - lastSampleUs < 20000) {   // 20 ms timeout → fallback polling
+#if PNOID_RTOS_ENABLE
+                AppRtos::waitSample(20);   // EXTI notify đánh thức control task
+#else
+                /* Tắt IRQ rồi kiểm tra lại: EXTI đến giữa lần check và WFI
+                 * vẫn để pending → WFI thoát ngay, không ngủ mất 1 chu kỳ */
+                __disable_irq();
+                if (!imuDataReady) __WFI();  // EXTI (data-ready) hoặc SysTick đánh thức
+                __enable_irq();
+#endif
                 continue;
             }
             /* INT not firing — fallback to polling */
@@ -203,23 +1007,53 @@ void run() {
                     warnOnce = true;
                 }
             }
+            sampleUs = TIME_Stamp(&sampleCycles);
         } else {
+            /* Stamp 64-bit: đọc trong critical section, EXTI có thể ghi đè */
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
             imuDataReady = false;
+            sampleCycles = imuSampleCycles;
+            sampleUs     = imuSampleUs;
+            __set_PRIMASK(primask);
             if (!intWorking) {
                 intWorking = true;
                 LOGI(TAG, "INT pin active — interrupt-driven mode");
             }
         }
 
-        uint32_t now = HAL_GetTick();
-        float dt = (now - lastTick) * 0.001f;
-        if (dt < 0.001f) dt = 0.001f;  // safety clamp
-        lastTick = now;
+        /* Đã ngã: giữ phản xạ bảo vệ, nhấn K1 để đứng lại */
+        if (fallDetector.isFallen()) {
+            if (BSP::buttonPressed(BSP::Button::K1)) {
+                if (FALL_RELEASE_SERVOS) {
+                    servo1.wake();
+                    servo2.wake();
+                }
+                initFilter();
+                fallDetector.clear();
+                blender.reset(robot.getPose());
+                blender.moveTo(basePose, STANCE_BLEND_MS);
+                LOGI(TAG, "Fall cleared, blending back to stance");
+            }
+            lastSampleUs = sampleUs;
+            continue;
+        }
+
+        uint32_t now = (uint32_t)(sampleUs / 1000);   // ms, cho log / status định kỳ
+        float dt = (float)(int32_t)(sampleUs - lastSampleUs) * 1e-6f;
+        if (dt < DT_MIN || dt > DT_MAX) {   // safety clamp
+            dt = (dt < DT_MIN) ? DT_MIN : DT_MAX;
+            loopMon.noteMiss(LoopMonitor::Miss::DtClamp);
+        }
+        lastSampleUs = sampleUs;
+
+        loopMon.beginTick(sampleCycles);
 
         BSP::ledToggle();
 
         /* 1. Đọc IMU */
         if (imu.read() != ICM20948::Status::OK) {
+            loopMon.noteMiss(LoopMonitor::Miss::ImuRead);
             static uint32_t failCnt = 0;
             if (++failCnt > 50) {
                 LOGW(TAG, "IMU read failed %lu times, reinit", failCnt);
@@ -235,6 +1069,7 @@ void run() {
         /* Skip nếu accel toàn 0 (IMU lockup) */
         float accelMag = accel.x*accel.x + accel.y*accel.y + accel.z*accel.z;
         if (accelMag < 0.1f) {
+            loopMon.noteMiss(LoopMonitor::Miss::ImuZero);
             static uint32_t zeroCnt = 0;
             if (++zeroCnt > 50) {
                 LOGW(TAG, "IMU data all zeros, reinit");
@@ -248,20 +1083,55 @@ void run() {
          *    Sensor readings behave as Z-up (despite PCB label)
          *    Standard formulas apply directly
          */
-        float accel_roll  = atan2f(accel.y, accel.z) * 57.2958f;
-        float accel_pitch = atan2f(-accel.x,
-                            sqrtf(accel.y * accel.y + accel.z * accel.z)) * 57.2958f;
+        float accel_roll  = FastMath::atan2(accel.y, accel.z) * 57.2958f;
+        float accel_pitch = FastMath::atan2(-accel.x,
+                            FastMath::sqrt(accel.y * accel.y + accel.z * accel.z)) * 57.2958f;
+
+        const float alpha = FILTER_TAU / (FILTER_TAU + dt);
+        est_roll  = alpha * (est_roll  + gyro.x * dt) + (1.0f - alpha) * accel_roll;
+        est_pitch = alpha * (est_pitch + gyro.y * dt) + (1.0f - alpha) * accel_pitch;
+
+        float roll_err   = est_roll  - tuning.rollOffset;
+        float pitch_err  = est_pitch - tuning.pitchOffset;
+
+        /* 3. Fall detection — trước stabilizer, phản ứng ngay trong tick này
+         *    (stabilizer không được đẩy thêm CORR_MAX khi robot đã đổ) */
+        if (fallDetector.update(roll_err, pitch_err, gyro.x, gyro.y, FastMath::sqrt(accelMag))) {
+            if (FALL_RELEASE_SERVOS) {
+                servo1.sleep();
+                servo2.sleep();
+            } else {
+                robot.setPose(fallPose);
+            }
+            loopMon.endTick();
+            audioQueue.push({ 880, 300 });     // audio task (RTOS build)
+            walker.abort();
+            walker.setCommand(WalkCommand());   // đứng lại sau khi K1
+
+            /* Latency: IMU sample (EXTI edge) → servo command xong */
+            uint32_t latencyUs = (DWT->CYCCNT - sampleCycles) / cyclesPerUs;
+            if (latencyUs > fallLatencyMaxUs) fallLatencyMaxUs = latencyUs;
+
+            LOGW(TAG, "FALL (%s) tilt=%d rate=%d -> %s, latency=%lu us (max %lu)",
+                 FallDetector::reasonName(fallDetector.reason()),
+                 (int)fallDetector.lastTilt(), (int)fallDetector.lastTiltRate(),
+                 FALL_RELEASE_SERVOS ? "servos released" : "protective pose",
+                 latencyUs, fallLatencyMaxUs);
+            continue;
+        }
 
-        est_roll  = ALPHA * (est_roll  + gyro.x * dt) + (1.0f - ALPHA) * accel_roll;
-        est_pitch = ALPHA * (est_pitch + gyro.y * dt) + (1.0f - ALPHA) * accel_pitch;
+        /* 3b. Capture point — ξ ra ngoài support polygon thì bước chân bắt lại */
+        /* (khi đang đi, ξ dịch chuyển có chủ đích — bỏ qua) */
+        PushRecovery::Event stepEvt = PushRecovery::Event::None;
+        if (!walker.isWalking())
+            stepEvt = recovery.update(roll_err, pitch_err, gyro.x, gyro.y, dt);
+        bool swingLeft = recovery.swingSide() == LegIK::Side::Left;
 
-        /* 3. Tính correction (target = 0°, bù IMU offset)
+        /* 4. Tính correction (target = 0°, bù IMU offset)
          *    error dương → cần giảm angle, error âm → cần tăng angle
          *    nên corr = -Kp * error */
-        float roll_err   = est_roll  - ROLL_OFFSET;
-        float pitch_err  = est_pitch - PITCH_OFFSET;
-        float corr_pitch = -Kp_pitch * (pitch_err) - Kd_pitch * (gyro.y);
-        float corr_roll  = -Kp_roll  * (roll_err)  - Kd_roll  * (gyro.x);
+        float corr_pitch = -tuning.kpPitch * (pitch_err) - tuning.kdPitch * (gyro.y);
+        float corr_roll  = -tuning.kpRoll  * (roll_err)  - tuning.kdRoll  * (gyro.x);
 
         /* Clamp */
         if (corr_pitch >  CORR_MAX) corr_pitch =  CORR_MAX;
@@ -269,39 +1139,128 @@ void run() {
         if (corr_roll  >  CORR_MAX) corr_roll  =  CORR_MAX;
         if (corr_roll  < -CORR_MAX) corr_roll  = -CORR_MAX;
 
-        /* 4. Phân bổ vào khớp */
+        /* 5. Phân bổ vào khớp */
         int16_t ankle_pitch_corr = (int16_t)(corr_pitch * ANKLE_SHARE);
         int16_t hip_pitch_corr   = (int16_t)(corr_pitch * HIP_SHARE);
         int16_t ankle_roll_corr  = (int16_t)(corr_roll  * ANKLE_SHARE);
         int16_t hip_roll_corr    = (int16_t)(corr_roll  * HIP_SHARE);
 
-        /* 5. Gửi servo = base + correction
+        /* 6. Gửi servo = base (đang blend) + correction
          *    Nghiêng sau → pitch tăng (X sensor hướng sau)
          *    → corr dương → cần TĂNG ankle (mũi lên) + TĂNG hip (đùi trước) */
-        /* Chân trái */
-        robot.leftLeg.setJoint(Leg::AnklePitch, BASE_ANK_P + ankle_pitch_corr);
-        robot.leftLeg.setJoint(Leg::HipPitch,   BASE_HIP_P + hip_pitch_corr);
-        robot.leftLeg.setJoint(Leg::AnkleRoll,  ankle_roll_corr);
-        robot.leftLeg.setJoint(Leg::HipRoll,    BASE_HIP_R + hip_roll_corr);
-
-        /* Chân phải */
-        robot.rightLeg.setJoint(Leg::AnklePitch, BASE_ANK_P + ankle_pitch_corr);
-        robot.rightLeg.setJoint(Leg::HipPitch,   BASE_HIP_P + hip_pitch_corr);
-        robot.rightLeg.setJoint(Leg::AnkleRoll,  ankle_roll_corr);
-        robot.rightLeg.setJoint(Leg::HipRoll,    BASE_HIP_R + hip_roll_corr);
+        Pose cmd;
+        bool startWalk = !walker.command().isZero() && !blender.isBlending()
+                       && !recovery.isActive();
+        if (walker.isWalking() || startWalk) {
+            /* Đi bộ: pose từ walker (IK), balance correction vẫn cộng lên */
+            uint32_t c0 = DWT->CYCCNT;
+            WalkController::Event walkEvt = walker.update(dt, cmd);
+            uint32_t cycles = DWT->CYCCNT - c0;
+            if (cycles > walkCyclesMax) walkCyclesMax = cycles;
+
+            if (walkEvt == WalkController::Event::StepStarted) {
+                /* Step timing jitter đo bằng DWT giữa hai lần đổi chân */
+                uint32_t nowCycles = DWT->CYCCNT;
+                if (walker.stepCount() > 1) {
+                    int32_t periodUs = (int32_t)((nowCycles - lastStepCycles) / cyclesPerUs);
+                    int32_t jitterUs = periodUs
+                                     - (int32_t)(FootstepPlanner::Config().stepTimeS * 1e6f);
+                    if (jitterUs < 0) jitterUs = -jitterUs;
+                    if ((uint32_t)jitterUs > walkJitterMaxUs) walkJitterMaxUs = jitterUs;
+                }
+                lastStepCycles = nowCycles;
+
+                const Footstep &f = walker.currentStep();
+                if (!optionalWorkOff) {
+                    LOGD(TAG, "WALK %s #%lu %s dx=%d dy=%d dyaw=%d jitter max=%lu us cpu max=%lu us",
+                         WalkController::stateName(walker.state()), walker.stepCount(),
+                         f.side == LegIK::Side::Left ? "L" : "R",
+                         (int)f.dx, (int)f.dy, (int)f.dyaw,
+                         walkJitterMaxUs, walkCyclesMax / cyclesPerUs);
+                }
+            } else if (walkEvt == WalkController::Event::Stopped) {
+                LOGI(TAG, "Walk stopped after %lu steps", walker.stepCount());
+            }
+        } else {
+            cmd = blender.update(dt);
+        }
+
+        auto addCorrection = [&](int16_t *leg) {
+            leg[Leg::AnklePitch] += ankle_pitch_corr;
+            leg[Leg::HipPitch]   += hip_pitch_corr;
+            leg[Leg::AnkleRoll]  += ankle_roll_corr;
+            leg[Leg::HipRoll]    += hip_roll_corr;
+        };
+        /* Đang bước: chân swing đi theo IK, chỉ chân trụ nhận correction */
+        if (recovery.isActive() || stepEvt == PushRecovery::Event::StepFinished)
+            recovery.applySwing(cmd);
+        if (!recovery.isActive() || !swingLeft)  addCorrection(cmd.leftLeg);   // Chân trái
+        if (!recovery.isActive() || swingLeft)   addCorrection(cmd.rightLeg);  // Chân phải
 
         /* Torso bù ngược roll */
-        robot.torso.setJoint(Torso::Roll, (int16_t)(-corr_roll * 0.3f));
-
-        /* 6. Log mỗi 500ms */
-        if ((now - lastLog) >= 500) {
-            LOGI(TAG, "R=%d P=%d cr=%d cp=%d ax=%d ay=%d az=%d",
-                 (int)est_roll, (int)est_pitch,
-                 (int)corr_roll, (int)corr_pitch,
-                 (int)(accel.x * 100), (int)(accel.y * 100),
-                 (int)(accel.z * 100));
-            lastLog = now;
+        cmd.torso[Torso::Roll] += (int16_t)(-corr_roll * 0.3f);
+
+        robot.setPose(cmd);
+        loopMon.endTick();   // phần sau là optional work
+
+        if (stepEvt == PushRecovery::Event::StepStarted) {
+            /* Latency: IMU sample → lệnh bước đầu tiên đã gửi servo */
+            uint32_t latencyUs = (DWT->CYCCNT - sampleCycles) / cyclesPerUs;
+            if (latencyUs > stepLatencyMaxUs) stepLatencyMaxUs = latencyUs;
+            audioQueue.push({ 1320, 80 });
+
+            const auto &cp = recovery.capturePoint();
+            const auto &st = recovery.stepOffset();
+            LOGW(TAG, "STEP %s cp=(%d,%d) out=%d step=(%d,%d) mm, latency=%lu us (max %lu)",
+                 swingLeft ? "L" : "R", (int)cp.x, (int)cp.y, (int)recovery.excess(),
+                 (int)st.x, (int)st.y, latencyUs, stepLatencyMaxUs);
+        } else if (stepEvt == PushRecovery::Event::StepFinished) {
+            /* Chân đã chạm đất ở vị trí mới → blend về base pose */
+            Pose landed = blender.pose();
+            recovery.applySwing(landed);
+            blender.reset(landed);
+            blender.moveTo(basePose, STANCE_BLEND_MS);
+            LOGI(TAG, "Step done, blending back to stance");
+        }
+
+        /* 7. Trạng thái cho log / display / ESP — latest value, không block */
+        const ControlStatus status = { est_roll, est_pitch, corr_roll, corr_pitch,
+                                       accel.x, accel.y, accel.z, now };
+        statusMailbox.post(status);
+        sdShell.record(&status, sizeof(status));    // "sd rec": copy vào ring, không block
+        if (traceTick) {
+            TRACE("tick dt=%f roll=%f pitch=%f corr=%f,%f",
+                  dt, est_roll, est_pitch, corr_roll, corr_pitch);
+        }
+
+        if (!stanceReached && !blender.isBlending()) {
+            stanceReached = true;
+            bootMark("stance");
+#if !PNOID_RTOS_ENABLE
+            bootReport();
+#endif
+        }
+
+#if !PNOID_RTOS_ENABLE
+        /* 8. Log 500 ms (RTOS: log task) */
+        logService();
+
+        /* 9. SD scheduler (log write-behind, streams, "sd bench"): block
+         *     vài ms — chỉ khi đứng yên; lúc đi bộ buffer log đầy thì drop
+         *     (đếm, lệnh "log") */
+        if (stanceReached && !walker.isWalking() && !recovery.isActive()
+                && sdService()) {
+            loopMon.resync();
+            lastSampleUs = TIME_Micros();
+        }
+
+        /* 10. QSPI flash: erase / program chạy trong IRQ, ở đây chỉ
+         *     callback; "flash rewrite sync" block — chỉ khi đứng yên */
+        if (flashService(stanceReached && !walker.isWalking() && !recovery.isActive())) {
+            loopMon.resync();
+            lastSampleUs = TIME_Micros();
         }
+#endif
     }
 }
 
@@ -316,12 +1275,34 @@ void App_Init(void) {
 }
 
 void App_Main(void) {
+#if PNOID_RTOS_ENABLE
+    AppRtos::start();      // control task chạy App::run(), không return
+#else
     App::run();
+#endif
+}
+
+PNOID_FAST_CODE void App_WalkCommand(float vx, float vy, float yawRate) {
+    WalkCommand c;
+    c.vx      = vx;
+    c.vy      = vy;
+    c.yawRate = yawRate;
+    walkMailbox.post(c);
 }
 
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+void App_LinkIrq(void) {
+    HAL_UART_IRQHandler(&huart2);
+}
+
+PNOID_FAST_CODE void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
     if (GPIO_Pin == BNO_INT_Pin) {
-        imuDataReady = true;
+        uint32_t cycles;
+        imuSampleUs     = TIME_Stamp(&cycles);
+        imuSampleCycles = cycles;
+        imuDataReady    = true;
+#if PNOID_RTOS_ENABLE
+        AppRtos::notifyControlFromIsr();
+#endif
     }
 }
 
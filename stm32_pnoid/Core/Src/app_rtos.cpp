@@ -0,0 +1,244 @@
+/**
+ * @file app_rtos.cpp
+ * @brief Optional FreeRTOS task architecture — see app_rtos.hpp
+ */
+
+#include "app_rtos.hpp"
+
+#if PNOID_RTOS_ENABLE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "app.hpp"
+#include "debug_log.h"
+#include "fatfs.h"
+#include "mem_guard.h"
+#include "timebase.h"
+
+#if !configSUPPORT_STATIC_ALLOCATION
+#error "PNOID RTOS build needs configSUPPORT_STATIC_ALLOCATION = 1"
+#endif
+#if !configUSE_TICK_HOOK
+#error "PNOID RTOS build needs configUSE_TICK_HOOK = 1 (µs timebase)"
+#endif
+#if !defined(STM32_THREAD_SAFE_STRATEGY) || (STM32_THREAD_SAFE_STRATEGY < 4)
+#error "PNOID RTOS build needs STM32_THREAD_SAFE_STRATEGY = 4 (FreeRTOS newlib locks)"
+#endif
+#if PNOID_TASK_CONTROL_PRIO >= configMAX_PRIORITIES
+#error "PNOID_TASK_CONTROL_PRIO must be below configMAX_PRIORITIES"
+#endif
+
+static const char *TAG = "RTOS";
+
+/* ============== Task storage (static, no heap) ============== */
+
+struct TaskSlot {
+    const char   *name;
+    TaskHandle_t  handle;
+    StaticTask_t  tcb;
+};
+
+/* Control stack in DTCM next to the control state */
+PNOID_FAST_DATA static StackType_t controlStack[PNOID_TASK_CONTROL_STACK];
+static StackType_t linkStack[PNOID_TASK_LINK_STACK];
+static StackType_t audioStack[PNOID_TASK_AUDIO_STACK];
+static StackType_t displayStack[PNOID_TASK_DISPLAY_STACK];
+static StackType_t logStack[PNOID_TASK_LOG_STACK];
+
+enum TaskId { T_CONTROL = 0, T_LINK, T_AUDIO, T_DISPLAY, T_LOG, T_COUNT };
+static TaskSlot tasks[T_COUNT];
+
+static volatile bool stress = false;
+
+/* ============== Tasks ============== */
+
+static void controlTask(void *)
+{
+    App::run();     // never returns
+}
+
+static void linkTask(void *)
+{
+    TickType_t last = xTaskGetTickCount();
+    for (;;) {
+        App::linkService();
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(PNOID_LINK_PERIOD_MS));
+    }
+}
+
+static void audioTask(void *)
+{
+    for (;;) {
+        if (!App::audioService(stress))
+            vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+static void displayTask(void *)
+{
+    for (;;) {
+        App::displayService(stress);
+        /* Stress: back-to-back redraws, one tick gap so the log task runs */
+        vTaskDelay(stress ? 1 : pdMS_TO_TICKS(PNOID_DISPLAY_PERIOD_MS));
+    }
+}
+
+static void logTask(void *)
+{
+    /* Flash, audio, SD mount in parallel with balancing — preempted by
+     * the control task on every sample, so no deadline impact */
+    while (App::deferredBootStep()) {}
+
+    for (;;) {
+        App::logService();
+        App::sdService();           // SD scheduler, blocks only this task
+        App::flashService(true);    // QSPI erase / program runs in its IRQ
+        vTaskDelay(pdMS_TO_TICKS(PNOID_LOG_PERIOD_MS));
+    }
+}
+
+/* ============== Public API ============== */
+
+namespace AppRtos {
+
+static void create(TaskId id, const char *name, TaskFunction_t fn,
+                   StackType_t *stack, uint32_t words, UBaseType_t prio)
+{
+    /* Paint before the task exists — FreeRTOS writes its first frame on top */
+    MEM_StackRegister(name, stack, words * sizeof(StackType_t));
+
+    TaskSlot &t = tasks[id];
+    t.name   = name;
+    t.handle = xTaskCreateStatic(fn, name, words, nullptr, prio, stack, &t.tcb);
+}
+
+void start()
+{
+    create(T_CONTROL, "control", controlTask, controlStack,
+           PNOID_TASK_CONTROL_STACK, PNOID_TASK_CONTROL_PRIO);
+    create(T_LINK,    "link",    linkTask,    linkStack,
+           PNOID_TASK_LINK_STACK,    PNOID_TASK_LINK_PRIO);
+    create(T_AUDIO,   "audio",   audioTask,   audioStack,
+           PNOID_TASK_AUDIO_STACK,   PNOID_TASK_AUDIO_PRIO);
+    create(T_DISPLAY, "display", displayTask, displayStack,
+           PNOID_TASK_DISPLAY_STACK, PNOID_TASK_DISPLAY_PRIO);
+    create(T_LOG,     "log",     logTask,     logStack,
+           PNOID_TASK_LOG_STACK,     PNOID_TASK_LOG_PRIO);
+
+    LOGI(TAG, "Starting scheduler (control prio %d)", PNOID_TASK_CONTROL_PRIO);
+    vTaskStartScheduler();
+
+    /* Only reached if the idle task could not be created */
+    LOGE(TAG, "Scheduler failed to start");
+    Error_Handler();
+}
+
+PNOID_FAST_CODE void waitSample(uint32_t timeoutMs)
+{
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+}
+
+PNOID_FAST_CODE void notifyControlFromIsr()
+{
+    TaskHandle_t h = tasks[T_CONTROL].handle;
+    if (h == nullptr || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) return;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(h, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void setStress(bool on)
+{
+    stress = on;
+    LOGI(TAG, "Display/audio stress %s", on ? "on" : "off");
+}
+
+void report()
+{
+    const LoopMonitor::Jitter &j = App::jitter();
+    LOGI(TAG, "control wake %lu/%lu/%lu us (mean/rms/max), period %lu us rms %lu us, "
+              "%u samples, stress %s",
+         j.wakeMeanUs, j.wakeRmsUs, j.wakeMaxUs, j.meanUs, j.rmsUs, j.count,
+         stress ? "on" : "off");
+
+    for (const TaskSlot &t : tasks) {
+        if (t.handle == nullptr) continue;
+        LOGI(TAG, "  %-8s prio %lu, stack free min %lu B", t.name,
+             (uint32_t)uxTaskPriorityGet(t.handle),
+             (uint32_t)uxTaskGetStackHighWaterMark(t.handle) * sizeof(StackType_t));
+    }
+}
+
+} // namespace AppRtos
+
+/* ============== FreeRTOS hooks ============== */
+
+extern "C" {
+
+static StaticTask_t idleTcb;
+static StackType_t  idleStack[configMINIMAL_STACK_SIZE];
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                   uint32_t *words)
+{
+    *tcb   = &idleTcb;
+    *stack = idleStack;
+    *words = configMINIMAL_STACK_SIZE;
+}
+
+#if configUSE_TIMERS
+static StaticTask_t timerTcb;
+static StackType_t  timerStack[configTIMER_TASK_STACK_DEPTH];
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                    uint32_t *words)
+{
+    *tcb   = &timerTcb;
+    *stack = timerStack;
+    *words = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
+/* SysTick belongs to FreeRTOS: keep the µs clock ahead of CYCCNT wrap */
+void vApplicationTickHook(void)
+{
+    TIME_Tick();
+}
+
+/* SD block I/O (sd_diskio.c): block the calling task for the IDMA transfer
+ * instead of WFI, so everything but the caller keeps running. The 1-tick
+ * timeout re-checks the state if a notification is ever missed. */
+static TaskHandle_t volatile sdWaiter = nullptr;
+
+void SD_WaitHook(volatile uint8_t *state)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) return;   /* boot: poll */
+
+    sdWaiter = xTaskGetCurrentTaskHandle();
+    if (*state == 0) ulTaskNotifyTake(pdTRUE, 1);
+    sdWaiter = nullptr;
+}
+
+void SD_DoneHook(void)
+{
+    TaskHandle_t h = sdWaiter;
+    if (h == nullptr) return;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(h, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+#if configCHECK_FOR_STACK_OVERFLOW
+void vApplicationStackOverflowHook(TaskHandle_t, char *name)
+{
+    (void)name;
+    Error_Handler();
+}
+#endif
+
+} // extern "C"
+
+#endif /* PNOID_RTOS_ENABLE */
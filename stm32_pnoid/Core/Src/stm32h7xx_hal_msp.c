@@ -610,6 +610,10 @@ void HAL_QSPI_MspInit(QSPI_HandleTypeDef* hqspi)
     HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
     /* USER CODE BEGIN QUADSPI_MspInit 1 */
+    /* W25Qxx async engine (w25qxx_async.cpp): command / status-match
+       completion, same level as the SD IDMA completion */
+    HAL_NVIC_SetPriority(QUADSPI_IRQn, 7, 0);
+    HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
 
     /* USER CODE END QUADSPI_MspInit 1 */
 
@@ -648,6 +652,7 @@ void HAL_QSPI_MspDeInit(QSPI_HandleTypeDef* hqspi)
     HAL_GPIO_DeInit(GPIOD, GPIO_PIN_11|GPIO_PIN_12|GPIO_PIN_13);
 
     /* USER CODE BEGIN QUADSPI_MspDeInit 1 */
+    HAL_NVIC_DisableIRQ(QUADSPI_IRQn);
 
     /* USER CODE END QUADSPI_MspDeInit 1 */
   }
@@ -703,7 +708,10 @@ void HAL_SD_MspInit(SD_HandleTypeDef* hsd)
     HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
 
     /* USER CODE BEGIN SDMMC1_MspInit 1 */
-
+    /* IDMA completion for FatFs block I/O (sd_diskio.c) — below the
+       control-path interrupts, within the FreeRTOS syscall range */
+    HAL_NVIC_SetPriority(SDMMC1_IRQn, 7, 0);
+    HAL_NVIC_EnableIRQ(SDMMC1_IRQn);
     /* USER CODE END SDMMC1_MspInit 1 */
 
   }
@@ -740,7 +748,7 @@ void HAL_SD_MspDeInit(SD_HandleTypeDef* hsd)
     HAL_GPIO_DeInit(GPIOD, GPIO_PIN_2);
 
     /* USER CODE BEGIN SDMMC1_MspDeInit 1 */
-
+    HAL_NVIC_DisableIRQ(SDMMC1_IRQn);
     /* USER CODE END SDMMC1_MspDeInit 1 */
   }
 
@@ -1071,6 +1079,9 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
     /* USER CODE BEGIN USART2_MspInit 1 */
+    /* ESP status channel (App::espSendStatus, TX interrupt) */
+    HAL_NVIC_SetPriority(USART2_IRQn, 7, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
 
     /* USER CODE END USART2_MspInit 1 */
   }
@@ -1118,6 +1129,7 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_2|GPIO_PIN_3);
 
     /* USER CODE BEGIN USART2_MspDeInit 1 */
+    HAL_NVIC_DisableIRQ(USART2_IRQn);
 
     /* USER CODE END USART2_MspDeInit 1 */
   }
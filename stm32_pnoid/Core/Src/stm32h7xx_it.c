@@ -22,6 +22,8 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "timebase.h"
+#include "app.hpp"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -46,6 +48,9 @@
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
+/* Run the tick and IMU data-ready handlers from ITCM */
+PNOID_FAST_CODE void SysTick_Handler(void);
+PNOID_FAST_CODE void EXTI9_5_IRQHandler(void);
 
 /* USER CODE END PFP */
 
@@ -194,6 +199,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  TIME_Tick();    /* keep the 64-bit µs clock ahead of CYCCNT wrap */
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -333,4 +339,39 @@ void SPI4_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles SDMMC1 global interrupt (IDMA block I/O, sd_diskio.c).
+  */
+void SDMMC1_IRQHandler(void)
+{
+  extern SD_HandleTypeDef hsd1;
+  HAL_SD_IRQHandler(&hsd1);
+}
+
+/**
+  * @brief This function handles QUADSPI global interrupt (W25Qxx async erase / program).
+  */
+void QUADSPI_IRQHandler(void)
+{
+  extern QSPI_HandleTypeDef hqspi;
+  HAL_QSPI_IRQHandler(&hqspi);
+}
+
+/**
+  * @brief This function handles MDMA global interrupt (QSPI asset prefetch, asset_cache.cpp).
+  */
+void MDMA_IRQHandler(void)
+{
+  extern MDMA_HandleTypeDef hmdma_assets;
+  HAL_MDMA_IRQHandler(&hmdma_assets);
+}
+
+/**
+  * @brief This function handles USART2 global interrupt (ESP link, App_LinkIrq in app.cpp).
+  */
+void USART2_IRQHandler(void)
+{
+  App_LinkIrq();
+}
+
 /* USER CODE END 1 */
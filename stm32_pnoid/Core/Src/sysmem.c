@@ -23,6 +23,7 @@
 /* Includes */
 #include <errno.h>
 #include <stdint.h>
+#include "mem_guard.h"
 
 /**
  * Pointer to the current high watermark of the heap usage
@@ -35,15 +36,15 @@ static uint8_t *__sbrk_heap_end = NULL;
  *
  * @verbatim
  * ############################################################################
- * #  .data  #  .bss  #       newlib heap       #          MSP stack          #
- * #         #        #                         # Reserved by _Min_Stack_Size #
+ * #  .data  #  .bss  #       newlib heap                                      #
  * ############################################################################
- * ^-- RAM start      ^-- _end                             _estack, RAM end --^
+ * ^-- RAM_D1 start   ^-- _end                          _heap_limit, RAM end --^
  * @endverbatim
  *
  * This implementation starts allocating at the '_end' linker symbol
- * The '_Min_Stack_Size' linker symbol reserves a memory for the MSP stack
- * The implementation considers '_estack' linker symbol to be RAM end
+ * and stops at the '_heap_limit' linker symbol. With the FLASH linker
+ * script the MSP stack is at the top of DTCM; with the RAM script heap and
+ * stack share DTCM and '_heap_limit' is '_estack - _Min_Stack_Size'.
  * NOTE: If the MSP stack, at any point during execution, grows larger than the
  * reserved size, please increase the '_Min_Stack_Size'.
  *
@@ -53,10 +54,10 @@ static uint8_t *__sbrk_heap_end = NULL;
 void *_sbrk(ptrdiff_t incr)
 {
   extern uint8_t _end; /* Symbol defined in the linker script */
-  extern uint8_t _estack; /* Symbol defined in the linker script */
-  extern uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
-  const uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size;
-  const uint8_t *max_heap = (uint8_t *)stack_limit;
+  extern uint8_t _heap_limit; /* Symbol defined in the linker script */
+  /* The MSP stack may live in another RAM (DTCM), so the heap limit is
+   * given by the linker script rather than derived from _estack */
+  const uint8_t *max_heap = &_heap_limit;
   uint8_t *prev_heap_end;
 
   /* Initialize heap end at first call */
@@ -65,6 +66,14 @@ void *_sbrk(ptrdiff_t incr)
     __sbrk_heap_end = &_end;
   }
 
+  /* Allocation-free mode: no heap growth after App::init() */
+  if (incr > 0 && MEM_HeapLocked())
+  {
+    MEM_HeapViolation();
+    errno = ENOMEM;
+    return (void *)-1;
+  }
+
   /* Protect heap from growing into the reserved MSP stack */
   if (__sbrk_heap_end + incr > max_heap)
   {
@@ -43,6 +43,13 @@ defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
 .word  _ebss
+/* ITCM / DTCM sections and their load addresses. defined in linker script */
+.word  _siitcm
+.word  _sitcm
+.word  _eitcm
+.word  _sidtcm
+.word  _sdtcm
+.word  _edtcm
 /* stack used for SystemInit_ExtMemCtl; always internal RAM used */
 
 /**
@@ -95,6 +102,40 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
 
+/* Copy hot code into ITCM (PNOID_FAST_CODE) */
+  ldr r0, =_sitcm
+  ldr r1, =_eitcm
+  ldr r2, =_siitcm
+  movs r3, #0
+  b LoopCopyItcm
+
+CopyItcm:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyItcm:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyItcm
+
+/* Copy hot state into DTCM (PNOID_FAST_DATA) */
+  ldr r0, =_sdtcm
+  ldr r1, =_edtcm
+  ldr r2, =_sidtcm
+  movs r3, #0
+  b LoopCopyDtcm
+
+CopyDtcm:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyDtcm:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyDtcm
+
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/
@@ -231,6 +231,7 @@ void __retarget_lock_release_recursive(_LOCK_T lock)
 
 /* Includes ------------------------------------------------------------------*/
 #include <reent.h>
+#include "mem_guard.h"
 
 /* Private variables ---------------------------------------------------------*/
 /** Mutex used in __malloc_lock and __malloc_unlock */
@@ -253,6 +254,11 @@ static LockingData_t __lock___tz_mutex = LOCKING_DATA_INIT;
 void __malloc_lock(struct _reent *reent)
 {
   STM32_LOCK_UNUSED(reent);
+  /* Allocation-free mode: every malloc/free/realloc passes through here */
+  if (MEM_HeapLocked())
+  {
+    MEM_HeapViolation();
+  }
   stm32_lock_acquire(&__lock___malloc_recursive_mutex);
 }
 
@@ -273,6 +279,10 @@ void __malloc_unlock(struct _reent *reent)
   */
 void __malloc_lock()
 {
+  if (MEM_HeapLocked())
+  {
+    MEM_HeapViolation();
+  }
   stm32_lock_acquire(&__lock___malloc_recursive_mutex);
 }
 
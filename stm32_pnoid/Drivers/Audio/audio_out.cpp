@@ -125,6 +125,28 @@ AudioOut::Status AudioOut::silence(uint32_t durationMs)
     return Status::OK;
 }
 
+AudioOut::Status AudioOut::playStream(FillFn fill, void *ctx)
+{
+    if (fill == nullptr) return Status::ErrParam;
+
+    int16_t *frames = reinterpret_cast<int16_t *>(buf_);
+    uint32_t n;
+    while ((n = fill(ctx, frames, kBufSamples)) > 0) {
+        if (n > kBufSamples) n = kBufSamples;
+        if (volume_ < 100) {
+            for (uint32_t i = 0; i < n * 2; i++) applyVolume(&frames[i]);
+        }
+
+        I2SIO::Status st = i2s_.transmit(buf_, n * 2, HAL_MAX_DELAY);
+        if (st != I2SIO::Status::OK) {
+            LOGE(TAG, "playStream transmit failed");
+            return Status::ErrInit;
+        }
+    }
+
+    return Status::OK;
+}
+
 AudioOut::Status AudioOut::stop()
 {
     I2SIO::Status st = i2s_.stop();
@@ -24,6 +24,14 @@ public:
 
     Status playTone(uint32_t freqHz, uint32_t durationMs, uint8_t volume = 80);
     Status silence(uint32_t durationMs);
+
+    /**
+     * @brief  Play 16 kHz stereo PCM produced on the fly (decoder, SD)
+     * @param  fill  Writes up to `frames` L/R frames to dst, returns how
+     *               many; 0 ends playback. Called once per DMA chunk.
+     */
+    using FillFn = uint32_t (*)(void *ctx, int16_t *dst, uint32_t frames);
+    Status playStream(FillFn fill, void *ctx);
     Status stop();
 
     void   setVolume(uint8_t vol);
@@ -4,6 +4,7 @@
  */
 
 #include "i2s_io.hpp"
+#include "main.h"
 #include "debug_log.h"
 #include <cstring>
 
@@ -11,8 +12,9 @@ static const char *TAG = "I2S";
 
 /* ---------- Static buffers ----------------------------------------------- */
 
-uint16_t I2SIO::silenceBuf_[I2SIO::kBufSize];
-uint16_t I2SIO::discardBuf_[I2SIO::kBufSize];
+/* Non-cacheable D2 SRAM: safe as DMA source/target with the D-cache on */
+PNOID_DMA_BUFFER uint16_t I2SIO::silenceBuf_[I2SIO::kBufSize];
+PNOID_DMA_BUFFER uint16_t I2SIO::discardBuf_[I2SIO::kBufSize];
 
 /* ---------- Singleton pointer for HAL callbacks -------------------------- */
 
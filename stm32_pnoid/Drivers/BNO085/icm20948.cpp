@@ -4,6 +4,7 @@
  */
 
 #include "icm20948.hpp"
+#include "fast_math.hpp"
 #include "debug_log.h"
 
 static const char *TAG = "ICM20948";
@@ -62,6 +63,13 @@ ICM20948::Status ICM20948::magWrite(uint8_t reg, uint8_t val)
 /* ============== Init ============== */
 
 ICM20948::Status ICM20948::init()
+{
+    Status st = beginInit();
+    if (st != Status::OK) return st;
+    return finishInit();
+}
+
+ICM20948::Status ICM20948::beginInit()
 {
     Status st;
 
@@ -75,7 +83,16 @@ ICM20948::Status ICM20948::init()
     /* Device reset */
     st = writeReg(B0_PWR_MGMT_1, 0x80);
     if (st != Status::OK) return Status::ErrInit;
-    HAL_Delay(100);
+    resetTick_ = HAL_GetTick();
+    return Status::OK;
+}
+
+ICM20948::Status ICM20948::finishInit()
+{
+    Status st;
+
+    /* Remaining reset time, if the caller did not use it up */
+    while ((HAL_GetTick() - resetTick_) < 100) {}
 
     /* Wake up, auto-select clock */
     st = writeReg(B0_PWR_MGMT_1, 0x01);
@@ -197,16 +214,16 @@ ICM20948::Euler ICM20948::getEuler() const
 {
     Euler e;
     /* Roll/Pitch from accelerometer */
-    e.roll  = atan2f(accel_.y, accel_.z) * (180.0f / 3.14159265f);
-    e.pitch = atan2f(-accel_.x, sqrtf(accel_.y * accel_.y + accel_.z * accel_.z))
+    e.roll  = FastMath::atan2(accel_.y, accel_.z) * (180.0f / 3.14159265f);
+    e.pitch = FastMath::atan2(-accel_.x, FastMath::sqrt(accel_.y * accel_.y + accel_.z * accel_.z))
               * (180.0f / 3.14159265f);
     /* Yaw from magnetometer (tilt-compensated) */
-    float cr = cosf(e.roll * 3.14159265f / 180.0f);
-    float sr = sinf(e.roll * 3.14159265f / 180.0f);
-    float cp = cosf(e.pitch * 3.14159265f / 180.0f);
-    float sp = sinf(e.pitch * 3.14159265f / 180.0f);
+    float cr = FastMath::cos(e.roll * 3.14159265f / 180.0f);
+    float sr = FastMath::sin(e.roll * 3.14159265f / 180.0f);
+    float cp = FastMath::cos(e.pitch * 3.14159265f / 180.0f);
+    float sp = FastMath::sin(e.pitch * 3.14159265f / 180.0f);
     float mx = mag_.x * cp + mag_.y * sp * sr + mag_.z * sp * cr;
     float my = mag_.y * cr - mag_.z * sr;
-    e.yaw = atan2f(-my, mx) * (180.0f / 3.14159265f);
+    e.yaw = FastMath::atan2(-my, mx) * (180.0f / 3.14159265f);
     return e;
 }
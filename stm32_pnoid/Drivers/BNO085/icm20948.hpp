@@ -37,6 +37,14 @@ public:
     /** Reset, verify WHO_AM_I, configure accel/gyro/mag */
     Status init();
 
+    /*
+     * Split init for staged boot: beginInit() issues the device reset and
+     * returns; finishInit() waits out the rest of the 100 ms reset time and
+     * configures the sensor. init() == beginInit() + finishInit().
+     */
+    Status beginInit();
+    Status finishInit();
+
     /** Read all 9 axes (call from main loop) */
     Status read();
 
@@ -63,6 +71,8 @@ private:
     float accelSens_ = 16384.0f;  // +/-2g
     float gyroSens_  = 131.0f;    // +/-250 dps
 
+    uint32_t resetTick_ = 0;      // HAL tick of the device reset
+
     static constexpr uint32_t I2C_TIMEOUT = 100;
 
     /* Bank switching */
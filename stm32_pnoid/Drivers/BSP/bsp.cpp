@@ -6,16 +6,23 @@
 #include "bsp.hpp"
 #include "main.h"
 #include "debug_log.h"
+#include "timebase.h"
 
 static const char *TAG = "BSP";
 
+/* Section bounds from the linker script */
+extern "C" {
+extern uint8_t _sitcm[], _eitcm[];
+extern uint8_t _sdtcm[], _edtcm[];
+extern uint8_t _sdma_buffer[], _edma_buffer[];
+}
+
 /* ---------- Init --------------------------------------------------------- */
 
 void BSP::init()
 {
-    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
-    DWT->CYCCNT = 0;
-    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    TIME_Init();    // DWT cycle counter + 64-bit µs clock
+    LOG_TX_Init();  // DMA console — first LOG line after this
 
     ledOff();
     LOGI(TAG, "Init OK");
@@ -59,6 +66,36 @@ void BSP::delayUs(uint32_t us)
     while ((DWT->CYCCNT - start) < cycles) {}
 }
 
+/* ---------- D-cache ------------------------------------------------------ */
+
+bool BSP::isCacheable(const void *addr)
+{
+    if ((SCB->CCR & SCB_CCR_DC_Msk) == 0) return false;
+
+    uint32_t a = reinterpret_cast<uint32_t>(addr);
+    if (a < 0x00010000UL) return false;                    // ITCM
+    if (a >= 0x20000000UL && a < 0x20020000UL) return false;   // DTCM
+    if (a >= PNOID_DMA_REGION_BASE &&
+        a <  PNOID_DMA_REGION_BASE + PNOID_DMA_REGION_SIZE) return false;
+    return true;
+}
+
+void BSP::cacheClean(const void *addr, size_t len)
+{
+    if (len == 0 || !isCacheable(addr)) return;
+    uint32_t start = reinterpret_cast<uint32_t>(addr) & ~31UL;
+    uint32_t end   = reinterpret_cast<uint32_t>(addr) + len;
+    SCB_CleanDCache_by_Addr(reinterpret_cast<uint32_t *>(start), (int32_t)(end - start));
+}
+
+void BSP::cacheInvalidate(void *addr, size_t len)
+{
+    if (len == 0 || !isCacheable(addr)) return;
+    uint32_t start = reinterpret_cast<uint32_t>(addr) & ~31UL;
+    uint32_t end   = reinterpret_cast<uint32_t>(addr) + len;
+    SCB_InvalidateDCache_by_Addr(reinterpret_cast<uint32_t *>(start), (int32_t)(end - start));
+}
+
 /* ---------- Camera GPIO -------------------------------------------------- */
 
 void BSP::camPowerDown(bool enable)
@@ -92,5 +129,11 @@ void BSP::printSystemInfo()
     LOGI(TAG, "HCLK   : %lu MHz", HAL_RCC_GetHCLKFreq() / 1000000);
     LOGI(TAG, "APB1   : %lu MHz", HAL_RCC_GetPCLK1Freq() / 1000000);
     LOGI(TAG, "APB2   : %lu MHz", HAL_RCC_GetPCLK2Freq() / 1000000);
+    LOGI(TAG, "Cache  : I=%s D=%s",
+         (SCB->CCR & SCB_CCR_IC_Msk) ? "on" : "off",
+         (SCB->CCR & SCB_CCR_DC_Msk) ? "on" : "off");
+    LOGI(TAG, "ITCM   : %lu B code, DTCM: %lu B data, DMA: %lu B",
+         (uint32_t)(_eitcm - _sitcm), (uint32_t)(_edtcm - _sdtcm),
+         (uint32_t)(_edma_buffer - _sdma_buffer));
     LOGI(TAG, "===================================");
 }
@@ -7,13 +7,14 @@
 
 #include "stm32h7xx_hal.h"
 #include <cstdint>
+#include <cstddef>
 
 class BSP {
 public:
     enum class Button { K1 = 0, K2 };
 
     /**
-     * @brief  Initialize BSP (DWT cycle counter, default GPIO states)
+     * @brief  Initialize BSP (DWT timebase, default GPIO states)
      */
     static void init();
 
@@ -29,6 +30,18 @@ public:
     /* Microsecond delay via DWT */
     static void delayUs(uint32_t us);
 
+    /*
+     * D-cache maintenance for DMA buffers outside .dma_buffer
+     *   cacheClean       before a DMA reads memory the CPU wrote (TX)
+     *   cacheInvalidate  before and after a DMA writes memory (RX)
+     * Ranges are widened to 32-byte cache lines — RX buffers should be
+     * 32-byte aligned and sized so neighbours aren't discarded.
+     * No-ops when the D-cache is off or the buffer is non-cacheable.
+     */
+    static void cacheClean(const void *addr, size_t len);
+    static void cacheInvalidate(void *addr, size_t len);
+    static bool isCacheable(const void *addr);
+
     /* Camera GPIO helpers */
     static void camPowerDown(bool enable);
     static void camReset(bool active);
@@ -0,0 +1,67 @@
+/**
+ * @file    timebase.c
+ * @brief   64-bit microsecond clock implementation
+ */
+
+#include "timebase.h"
+#include "main.h"
+
+/* ---------- Internal state ----------------------------------------------- */
+
+static uint32_t          cyclesPerUs = 1;
+static uint32_t          lastCycles  = 0;   /* CYCCNT at the previous update  */
+static uint32_t          remCycles   = 0;   /* cycles not yet a whole µs      */
+static volatile uint64_t micros      = 0;
+
+/* ---------- Public API ---------------------------------------------------- */
+
+void TIME_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    cyclesPerUs = SystemCoreClock / 1000000;
+    if (cyclesPerUs == 0) cyclesPerUs = 1;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    lastCycles = DWT->CYCCNT;
+    remCycles  = 0;
+    micros     = (uint64_t)HAL_GetTick() * 1000u;   /* same origin as HAL tick */
+    __set_PRIMASK(primask);
+}
+
+PNOID_FAST_CODE uint64_t TIME_Stamp(uint32_t *cycles)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now = DWT->CYCCNT;
+    /* remCycles < cyclesPerUs, so this cannot overflow while the gap
+     * between calls stays below 2^32 cycles (SysTick guarantees it) */
+    uint32_t acc = (now - lastCycles) + remCycles;
+    lastCycles   = now;
+    remCycles    = acc % cyclesPerUs;
+    uint64_t us  = micros + acc / cyclesPerUs;
+    micros       = us;
+
+    __set_PRIMASK(primask);
+
+    if (cycles) *cycles = now;
+    return us;
+}
+
+uint64_t TIME_Micros(void)
+{
+    return TIME_Stamp(NULL);
+}
+
+void TIME_Tick(void)
+{
+    (void)TIME_Stamp(NULL);
+}
+
+uint32_t TIME_CyclesPerUs(void)
+{
+    return cyclesPerUs;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file    timebase.h
+ * @brief   64-bit monotonic microsecond clock on the DWT cycle counter
+ *
+ * The 32-bit DWT->CYCCNT wraps every 2^32 / SystemCoreClock (8.9 s at
+ * 480 MHz). TIME_Micros() folds the cycles elapsed since its last call
+ * into a 64-bit microsecond count, so it only has to be called more often
+ * than that — SysTick calls TIME_Tick() every millisecond.
+ *
+ * One clock for everything: IMU sample stamps, estimator dt, profiling,
+ * log timestamps. Callable from any context (short PRIMASK section).
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Enable the DWT cycle counter and start the clock
+ * @note   Call once after SystemClock_Config (BSP::init)
+ */
+void TIME_Init(void);
+
+/** Microseconds since reset (starts from HAL_GetTick() at TIME_Init) */
+uint64_t TIME_Micros(void);
+
+/**
+ * @brief  Microseconds + the raw cycle count they were taken from
+ * @param  cycles  DWT->CYCCNT at the stamp (for cycle-level deltas)
+ */
+uint64_t TIME_Stamp(uint32_t *cycles);
+
+/** Keep the wrap extension fresh — call from SysTick_Handler */
+void TIME_Tick(void);
+
+/** CPU cycles per microsecond (SystemCoreClock / 1 MHz) */
+uint32_t TIME_CyclesPerUs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H_ */
@@ -6,6 +6,7 @@
 #include "camera.hpp"
 #include "ov2640_regs.h"
 #include "main.h"
+#include "bsp.hpp"
 #include "debug_log.h"
 
 static const char *TAG = "CAM";
@@ -139,6 +140,11 @@ Camera::Status Camera::captureSnapshot(uint32_t *buf, uint32_t size)
     if (buf == nullptr || size == 0) return Status::ErrParam;
 
     frameReady_ = false;
+    frameBuf_   = buf;
+    frameSize_  = size;
+
+    /* Drop cached lines so no eviction overwrites the DMA data */
+    BSP::cacheInvalidate(buf, size * sizeof(uint32_t));
 
     if (HAL_DCMI_Start_DMA(&hdcmi_, DCMI_MODE_SNAPSHOT, reinterpret_cast<uint32_t>(buf), size) != HAL_OK)
         return Status::ErrDCMI;
@@ -160,6 +166,10 @@ Camera::Status Camera::startContinuous(uint32_t *buf, uint32_t size)
     if (buf == nullptr || size == 0) return Status::ErrParam;
 
     frameReady_ = false;
+    frameBuf_   = buf;
+    frameSize_  = size;
+
+    BSP::cacheInvalidate(buf, size * sizeof(uint32_t));
 
     if (HAL_DCMI_Start_DMA(&hdcmi_, DCMI_MODE_CONTINUOUS, reinterpret_cast<uint32_t>(buf), size) != HAL_OK)
         return Status::ErrDCMI;
@@ -176,6 +186,8 @@ Camera::Status Camera::stopContinuous()
 
 void Camera::frameEventHandler()
 {
+    /* Frame written by DMA behind the cache: make the CPU see it */
+    BSP::cacheInvalidate(frameBuf_, frameSize_ * sizeof(uint32_t));
     frameReady_ = true;
     if (callback_) callback_();
 }
@@ -7,7 +7,6 @@
 
 #include "stm32h7xx_hal.h"
 #include <cstdint>
-#include <functional>
 
 class Camera {
 public:
@@ -26,7 +25,7 @@ public:
         ErrParam,
     };
 
-    using FrameCallback = std::function<void()>;
+    using FrameCallback = void (*)(void);   // plain pointer: no heap, ISR safe
 
     /**
      * @brief  Construct with DCMI and I2C handles
@@ -44,7 +43,8 @@ public:
 
     /**
      * @brief  Capture a single frame via DMA
-     * @param  buf   Buffer for frame data
+     * @param  buf   Buffer for frame data (32-byte aligned; PNOID_DMA_BUFFER
+     *               or cacheable RAM — the driver invalidates it)
      * @param  size  Buffer size in 32-bit words
      */
     Status captureSnapshot(uint32_t *buf, uint32_t size);
@@ -69,7 +69,9 @@ private:
     I2C_HandleTypeDef  &hi2c_;
 
     volatile bool frameReady_ = false;
-    FrameCallback callback_;
+    FrameCallback callback_ = nullptr;
+    uint32_t *frameBuf_  = nullptr;   // current DMA target (cache invalidate)
+    uint32_t  frameSize_ = 0;         // words
     Format currentFormat_ = Format::Rgb565;
 
     /* SCCB (I2C) helpers */
@@ -0,0 +1,97 @@
+/**
+ * @file    cmd_mailbox.hpp
+ * @brief   Latest-value mailbox between ISRs / comm handlers and the control loop
+ *
+ * Writers (UART RX handler, ESP link, ...) post() a complete command; the
+ * control loop fetch()es the newest one once per tick. Older unread values
+ * are overwritten — the loop only ever cares about the latest command.
+ *
+ *   post()   Short critical section (PRIMASK), safe from any ISR or thread,
+ *            serializes concurrent writers.
+ *   fetch()  Lock-free seqlock read, never blocks the loop: if a writer
+ *            interrupts the copy, the read is retried.
+ *   peek()   Same read without "new value" tracking — any number of
+ *            readers (display, log, ...) can sample the latest value.
+ *
+ * T must be trivially copyable and small (a few words).
+ */
+
+#pragma once
+
+#include "stm32h7xx.h"
+#include <cstdint>
+#include <type_traits>
+
+template <typename T>
+class CmdMailbox {
+    static_assert(std::is_trivially_copyable<T>::value, "CmdMailbox needs a POD type");
+
+public:
+    CmdMailbox() = default;
+
+    /** Publish a new value (any context) */
+    void post(const T &value)
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        seq_ = seq_ + 1;            // odd: write in progress
+        __DMB();
+        data_ = value;
+        __DMB();
+        seq_ = seq_ + 1;            // even: stable
+        __set_PRIMASK(primask);
+    }
+
+    /**
+     * @brief  Copy the newest value if one arrived since the last fetch
+     * @retval true if `out` was updated
+     */
+    bool fetch(T &out)
+    {
+        for (uint8_t tries = 0; tries < MAX_RETRIES; tries++) {
+            uint32_t s0 = seq_;
+            if (s0 == lastSeq_) return false;   // nothing new
+            if (s0 & 1u) continue;              // writer active
+            __DMB();
+            T copy = data_;
+            __DMB();
+            if (seq_ == s0) {
+                out      = copy;
+                lastSeq_ = s0;
+                return true;
+            }
+        }
+        return false;   // keep the old value, try again next tick
+    }
+
+    /**
+     * @brief  Copy the latest value regardless of whether it was seen before
+     * @retval false if nothing was posted yet or a writer kept interfering
+     */
+    bool peek(T &out) const
+    {
+        for (uint8_t tries = 0; tries < MAX_RETRIES; tries++) {
+            uint32_t s0 = seq_;
+            if (s0 == 0) return false;
+            if (s0 & 1u) continue;
+            __DMB();
+            T copy = data_;
+            __DMB();
+            if (seq_ == s0) {
+                out = copy;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Number of posts so far */
+    uint32_t count() const { return seq_ >> 1; }
+
+private:
+    static constexpr uint8_t MAX_RETRIES = 4;
+
+    volatile uint32_t seq_ = 0;
+    T                 data_{};    // ordered by __DMB (also a compiler barrier)
+    uint32_t          lastSeq_ = 0;   // reader side only
+};
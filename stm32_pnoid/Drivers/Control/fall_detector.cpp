@@ -0,0 +1,64 @@
+/**
+ * @file    fall_detector.cpp
+ * @brief   Fall detector implementation
+ */
+
+#include "fall_detector.hpp"
+#include "fast_math.hpp"
+#include "main.h"     // PNOID_FAST_CODE
+#include <cmath>
+
+PNOID_FAST_CODE bool FallDetector::update(float rollDeg, float pitchDeg,
+                          float rollRateDps, float pitchRateDps, float accelMagG)
+{
+    if (fallen_) return false;
+
+    /* Tilt magnitude and its growth rate along the tilt direction:
+     * d|t|/dt = (r*dr + p*dp) / |t| */
+    float tilt2 = rollDeg * rollDeg + pitchDeg * pitchDeg;
+    float tilt  = FastMath::sqrt(tilt2);
+    float rate  = (tilt > 1e-3f)
+                ? (rollDeg * rollRateDps + pitchDeg * pitchRateDps) / tilt
+                : 0.0f;
+    tilt_     = tilt;
+    tiltRate_ = rate;
+
+    Reason r = Reason::None;
+    if (tilt > cfg_.tiltMaxDeg)
+        r = Reason::Tilt;
+    else if (tilt > cfg_.tiltWarnDeg && rate > cfg_.tiltRateMaxDps)
+        r = Reason::TiltRate;
+    else if (accelMagG < cfg_.freeFallG)
+        r = Reason::FreeFall;
+
+    if (r == Reason::None) {
+        count_   = 0;
+        pending_ = Reason::None;
+        return false;
+    }
+
+    if (pending_ == Reason::None) pending_ = r;
+    if (++count_ < cfg_.debounce) return false;
+
+    fallen_ = true;
+    reason_ = pending_;
+    return true;
+}
+
+void FallDetector::clear()
+{
+    fallen_   = false;
+    reason_   = Reason::None;
+    pending_  = Reason::None;
+    count_    = 0;
+}
+
+const char* FallDetector::reasonName(Reason r)
+{
+    switch (r) {
+        case Reason::Tilt:     return "tilt";
+        case Reason::TiltRate: return "tilt-rate";
+        case Reason::FreeFall: return "free-fall";
+        default:               return "none";
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * @file    fall_detector.hpp
+ * @brief   Per-sample fall detection from tilt, tilt rate and accel magnitude
+ * @note    Pure math, no HAL access — call once per IMU sample at the top of
+ *          the control tick, before the stabilizer computes corrections.
+ *
+ * Triggers (any one, held for `debounce` consecutive samples):
+ *   Tilt      |tilt| > tiltMaxDeg
+ *   TiltRate  |tilt| > tiltWarnDeg  and  d|tilt|/dt > tiltRateMaxDps
+ *   FreeFall  |accel| < freeFallG
+ *
+ * The detector latches: once fallen it stays fallen until clear().
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class FallDetector {
+public:
+    enum class Reason : uint8_t {
+        None = 0,
+        Tilt,
+        TiltRate,
+        FreeFall,
+    };
+
+    struct Config {
+        float   tiltMaxDeg     = 40.0f;   // hard limit, past recovery
+        float   tiltWarnDeg    = 20.0f;   // rate check only above this
+        float   tiltRateMaxDps = 120.0f;  // outward tilt speed (deg/s)
+        float   freeFallG      = 0.5f;    // |a| below this = not supported
+        uint8_t debounce       = 2;       // consecutive samples to confirm
+    };
+
+    FallDetector() = default;
+
+    void configure(const Config &cfg) { cfg_ = cfg; }
+    const Config& config() const { return cfg_; }
+
+    /**
+     * @brief  Feed one IMU sample
+     * @param  rollDeg, pitchDeg          Tilt relative to upright stance (deg)
+     * @param  rollRateDps, pitchRateDps  Gyro rates on the same axes (deg/s)
+     * @param  accelMagG                  |accel| in g
+     * @retval true on the sample where the fall is confirmed (edge, once)
+     */
+    bool update(float rollDeg, float pitchDeg,
+                float rollRateDps, float pitchRateDps, float accelMagG);
+
+    bool   isFallen() const { return fallen_; }
+    Reason reason()   const { return reason_; }
+
+    /** Tilt magnitude and outward rate at the last sample (deg, deg/s) */
+    float lastTilt() const { return tilt_; }
+    float lastTiltRate() const { return tiltRate_; }
+
+    /** Re-arm after the robot has been set upright again */
+    void clear();
+
+    static const char* reasonName(Reason r);
+
+private:
+    Config  cfg_;
+    bool    fallen_  = false;
+    Reason  reason_  = Reason::None;
+    Reason  pending_ = Reason::None;
+    uint8_t count_   = 0;
+    float   tilt_     = 0.0f;
+    float   tiltRate_ = 0.0f;
+};
@@ -0,0 +1,37 @@
+/**
+ * @file    fast_math.cpp
+ * @brief   Compile-time generated sine table for FastMath
+ */
+
+#include "fast_math.hpp"
+#include "main.h"     // PNOID_FAST_DATA
+
+namespace {
+
+/* Double-precision Taylor sine for constexpr evaluation, |x| <= π/2 */
+constexpr double taylorSin(double x)
+{
+    double term = x, sum = x;
+    for (int n = 1; n < 20; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum  += term;
+    }
+    return sum;
+}
+
+constexpr FastMath::SinTable makeSinTable()
+{
+    FastMath::SinTable t{};
+    for (int k = 0; k <= FastMath::SIN_QUARTER; k++) {
+        t.v[k] = (float)taylorSin(3.14159265358979323846 / 2.0 * k / FastMath::SIN_QUARTER);
+    }
+    return t;
+}
+
+} // namespace
+
+/* constexpr-initialized: no startup code, copied to DTCM with .dtcm_data */
+PNOID_FAST_DATA constexpr FastMath::SinTable FastMath::SIN_TABLE = makeSinTable();
+
+static_assert(FastMath::SIN_TABLE.v[0] == 0.0f, "sine table start");
+static_assert(FastMath::SIN_TABLE.v[FastMath::SIN_QUARTER] == 1.0f, "sine table end");
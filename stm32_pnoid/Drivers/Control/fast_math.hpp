@@ -0,0 +1,189 @@
+/**
+ * @file    fast_math.hpp
+ * @brief   Fast approximate float math for the control path
+ *
+ * Drop-in replacements for the libm calls in the loop, estimators and
+ * kinematics. All are branch-light, never touch errno and inline into the
+ * caller (ITCM when the caller is PNOID_FAST_CODE).
+ *
+ *   function        method                              max error
+ *   sin/cos/sincos  quarter-wave table (257) + lerp      5e-6 abs   |x| <= 2π
+ *                                                        1e-5 abs   |x| <= 100 rad
+ *   atan            odd minimax polynomial, degree 11    2e-6 rad
+ *   atan2           atan + quadrant fix-up               2e-6 rad
+ *   acos / asin     A&S 4.4.46 polynomial · sqrt         1e-6 rad
+ *   rsqrt           bit trick + 2 Newton steps           5e-6 rel   x > 0
+ *   sqrt            VSQRT instruction (exact, no errno)  0.5 ulp
+ *
+ * Bounds measured against double-precision libm over the domain (sin/cos
+ * lose accuracy with |x| as the float phase loses fraction bits — wrap
+ * long-running phases into [−π, π] or [0, 2π)).
+ * The sine table is generated at compile time (constexpr) and lives in
+ * DTCM (PNOID_FAST_DATA, fast_math.cpp).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace FastMath {
+
+constexpr float PI      = 3.14159265358979f;
+constexpr float HALF_PI = 1.57079632679490f;
+constexpr float TWO_PI  = 6.28318530717959f;
+constexpr float RAD2DEG = 57.2957795130823f;
+constexpr float DEG2RAD = 0.0174532925199433f;
+
+/* Documented bounds (see table above) */
+constexpr float SIN_MAX_ERR   = 5e-6f;
+constexpr float ATAN_MAX_ERR  = 2e-6f;
+constexpr float ACOS_MAX_ERR  = 1e-6f;
+constexpr float RSQRT_REL_ERR = 5e-6f;
+
+/* ============== Sine table ============== */
+
+/** Samples per quarter wave; sin(k·π/2/N), k = 0..N */
+constexpr int SIN_SHIFT   = 8;
+constexpr int SIN_QUARTER = 1 << SIN_SHIFT;
+
+struct SinTable {
+    float v[SIN_QUARTER + 1];
+};
+
+/** Quarter-wave sine table (fast_math.cpp, DTCM) */
+extern const SinTable SIN_TABLE;
+
+namespace detail {
+
+/** Sample of the quarter table at phase index i (0..4N), fraction f */
+inline float quarterLerp(int32_t i, float f)
+{
+    const float *t = SIN_TABLE.v;
+    int32_t q = (i >> SIN_SHIFT) & 3;                 // quadrant
+    int32_t k = i & (SIN_QUARTER - 1);
+    float   v;
+    if (q & 1) v = t[SIN_QUARTER - k] + f * (t[SIN_QUARTER - k - 1] - t[SIN_QUARTER - k]);
+    else       v = t[k] + f * (t[k + 1] - t[k]);
+    return (q & 2) ? -v : v;
+}
+
+/** Angle → phase index (4N per turn) + fraction */
+inline int32_t phase(float x, float &frac)
+{
+    constexpr float SCALE = (4.0f * SIN_QUARTER) / TWO_PI;
+    float   u = x * SCALE;
+    int32_t i = (int32_t)u;
+    if (u < (float)i) i--;                    // floor for negatives
+    frac = u - (float)i;
+    return i;
+}
+
+} // namespace detail
+
+/* ============== Trigonometry ============== */
+
+inline float sin(float x)
+{
+    float f;
+    int32_t i = detail::phase(x, f);
+    return detail::quarterLerp(i, f);
+}
+
+inline float cos(float x)
+{
+    float f;
+    int32_t i = detail::phase(x, f);
+    return detail::quarterLerp(i + SIN_QUARTER, f);
+}
+
+/** sin and cos of the same angle for the price of one phase reduction */
+inline void sincos(float x, float &s, float &c)
+{
+    float f;
+    int32_t i = detail::phase(x, f);
+    s = detail::quarterLerp(i, f);
+    c = detail::quarterLerp(i + SIN_QUARTER, f);
+}
+
+/** atan(x), any x */
+inline float atan(float x)
+{
+    /* Reduce to |z| <= 1: atan(x) = ±π/2 − atan(1/x) */
+    float ax  = x < 0.0f ? -x : x;
+    bool  inv = ax > 1.0f;
+    float z   = inv ? 1.0f / ax : ax;
+    float z2  = z * z;
+    float p   = z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f
+              + z2 * (-0.11643287f + z2 * (0.05265332f + z2 * -0.01172120f)))));
+    if (inv) p = HALF_PI - p;
+    return x < 0.0f ? -p : p;
+}
+
+/** atan2(y, x) in (−π, π]; atan2(0, 0) = 0 */
+inline float atan2(float y, float x)
+{
+    float ax = x < 0.0f ? -x : x;
+    float ay = y < 0.0f ? -y : y;
+    if (ax == 0.0f && ay == 0.0f) return 0.0f;
+
+    /* atan of the smaller/larger ratio stays in the accurate |z| <= 1 range */
+    float a = (ay <= ax) ? atan(ay / ax) : HALF_PI - atan(ax / ay);
+    if (x < 0.0f) a = PI - a;
+    return y < 0.0f ? -a : a;
+}
+
+/** acos(x), x clamped to [−1, 1] */
+inline float acos(float x)
+{
+    if (x >  1.0f) x =  1.0f;
+    if (x < -1.0f) x = -1.0f;
+    float ax = x < 0.0f ? -x : x;
+    float p  = 1.5707963050f + ax * (-0.2145988016f + ax * (0.0889789874f
+             + ax * (-0.0501743046f + ax * (0.0308918810f + ax * (-0.0170881256f
+             + ax * (0.0066700901f + ax * -0.0012624911f))))));
+    float r  = __builtin_sqrtf(1.0f - ax) * p;
+    return x < 0.0f ? PI - r : r;
+}
+
+/** asin(x), x clamped to [−1, 1] */
+inline float asin(float x)
+{
+    return HALF_PI - acos(x);
+}
+
+/* ============== Roots ============== */
+
+/** 1/sqrt(x), x > 0 */
+inline float rsqrt(float x)
+{
+    uint32_t i;
+    std::memcpy(&i, &x, sizeof(i));
+    i = 0x5F375A86u - (i >> 1);
+    float y;
+    std::memcpy(&y, &i, sizeof(y));
+    float h = 0.5f * x;
+    y = y * (1.5f - h * y * y);
+    y = y * (1.5f - h * y * y);
+    return y;
+}
+
+/** sqrt(x), x >= 0 — single VSQRT, skips libm's errno path */
+inline float sqrt(float x)
+{
+    return __builtin_sqrtf(x);
+}
+
+/** sqrt(x² + y²) */
+inline float hypot(float x, float y)
+{
+    return __builtin_sqrtf(x * x + y * y);
+}
+
+/* ============== Degree helpers ============== */
+
+inline float atan2Deg(float y, float x) { return atan2(y, x) * RAD2DEG; }
+inline float sinDeg(float deg)          { return sin(deg * DEG2RAD); }
+inline float cosDeg(float deg)          { return cos(deg * DEG2RAD); }
+
+} // namespace FastMath
@@ -0,0 +1,79 @@
+/**
+ * @file    footstep_planner.cpp
+ * @brief   Footstep planner implementation
+ */
+
+#include "footstep_planner.hpp"
+
+static inline float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/** Move `v` towards `target` by at most `step` */
+static inline float approach(float v, float target, float step)
+{
+    return clampf(target, v - step, v + step);
+}
+
+static inline LegIK::Side other(LegIK::Side s)
+{
+    return (s == LegIK::Side::Left) ? LegIK::Side::Right : LegIK::Side::Left;
+}
+
+void FootstepPlanner::reset(LegIK::Side firstSwing)
+{
+    head_      = 0;
+    last_      = Footstep();
+    last_.side = other(firstSwing);
+    lastRamp_  = Ramp();
+    nextSide_  = firstSwing;
+    for (uint8_t i = 0; i < QUEUE_LEN; i++) {
+        q_[i]    = Footstep();
+        ramp_[i] = Ramp();
+    }
+}
+
+void FootstepPlanner::replan(const WalkCommand &cmd)
+{
+    const float T = cfg_.stepTimeS;
+    float tx   = clampf(cmd.vx * T,      -cfg_.maxStepX,   cfg_.maxStepX);
+    float ty   = clampf(cmd.vy * T,      -cfg_.maxStepY,   cfg_.maxStepY);
+    float tyaw = clampf(cmd.yawRate * T, -cfg_.maxStepYaw, cfg_.maxStepYaw);
+
+    /* Ramp from the step in progress towards the new target */
+    Ramp r = lastRamp_;
+    LegIK::Side side = nextSide_;
+
+    for (uint8_t i = 0; i < QUEUE_LEN; i++) {
+        uint8_t k = (head_ + i) % QUEUE_LEN;
+
+        r.x   = approach(r.x,   tx,   cfg_.maxDeltaX);
+        r.y   = approach(r.y,   ty,   cfg_.maxDeltaY);
+        r.yaw = approach(r.yaw, tyaw, cfg_.maxDeltaYaw);
+        ramp_[k] = r;
+
+        /* Forward progress uses both legs; sideways and turning motion is
+         * carried by the leading leg, the other one closes */
+        bool left    = (side == LegIK::Side::Left);
+        bool leadY   = left ? (r.y   > 0.0f) : (r.y   < 0.0f);
+        bool leadYaw = left ? (r.yaw > 0.0f) : (r.yaw < 0.0f);
+
+        Footstep &f = q_[k];
+        f.side = side;
+        f.dx   = r.x;
+        f.dy   = leadY   ? r.y   : 0.0f;
+        f.dyaw = leadYaw ? r.yaw : 0.0f;
+
+        side = other(side);
+    }
+}
+
+Footstep FootstepPlanner::pop()
+{
+    last_     = q_[head_];
+    lastRamp_ = ramp_[head_];
+    head_     = (head_ + 1) % QUEUE_LEN;
+    nextSide_ = other(last_.side);
+    return last_;
+}
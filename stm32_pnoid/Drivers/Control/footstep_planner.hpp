@@ -0,0 +1,93 @@
+/**
+ * @file    footstep_planner.hpp
+ * @brief   Velocity command → rolling queue of footsteps
+ *
+ * A footstep is the displacement of the swing foot over one step, in the
+ * pelvis frame (X forward, Y left, yaw CCW). For a body velocity (vx, vy, ωz)
+ * and step period T each step covers
+ *
+ *   dx = vx·T,  dy = vy·T,  dyaw = ωz·T
+ *
+ * clamped per step and rate-limited between consecutive steps so a sudden
+ * command never produces a lurch. Sideways and turning steps are only taken
+ * when the swing leg leads in that direction (left leg for +Y / CCW), the
+ * other leg closes with a zero step — feet never cross.
+ *
+ * The queue is a fixed ring of QUEUE_LEN steps with no allocation. It is
+ * rolling: replan() rewrites every queued step from the latest command, so
+ * the horizon always reflects the newest velocity while the step in
+ * progress (already popped) is never changed.
+ */
+
+#pragma once
+
+#include "leg_ik.hpp"
+#include <cstdint>
+
+/** Body velocity command (mm/s, mm/s, deg/s) */
+struct WalkCommand {
+    float vx      = 0.0f;
+    float vy      = 0.0f;
+    float yawRate = 0.0f;
+
+    bool isZero() const { return vx == 0.0f && vy == 0.0f && yawRate == 0.0f; }
+};
+
+struct Footstep {
+    LegIK::Side side = LegIK::Side::Left;   // swing leg
+    float dx   = 0.0f;                      // mm
+    float dy   = 0.0f;                      // mm
+    float dyaw = 0.0f;                      // deg
+
+    bool isZero() const { return dx == 0.0f && dy == 0.0f && dyaw == 0.0f; }
+};
+
+class FootstepPlanner {
+public:
+    static constexpr uint8_t QUEUE_LEN = 4;
+
+    struct Config {
+        float stepTimeS  = 0.40f;   // T
+        float maxStepX   = 25.0f;   // mm per step
+        float maxStepY   = 15.0f;   // mm per step
+        float maxStepYaw = 12.0f;   // deg per step
+        float maxDeltaX  = 10.0f;   // change between consecutive steps
+        float maxDeltaY  = 8.0f;
+        float maxDeltaYaw = 6.0f;
+    };
+
+    FootstepPlanner() = default;
+
+    void configure(const Config &cfg) { cfg_ = cfg; }
+    const Config& config() const { return cfg_; }
+
+    /** Drop all queued steps; next swing leg and last step become neutral */
+    void reset(LegIK::Side firstSwing = LegIK::Side::Left);
+
+    /** Rebuild the queue from a command (steps not yet started only) */
+    void replan(const WalkCommand &cmd);
+
+    /** Take the next step; replan() must have filled the queue */
+    Footstep pop();
+
+    const Footstep& peek(uint8_t i = 0) const { return q_[(head_ + i) % QUEUE_LEN]; }
+
+    /** The step currently being executed (last popped) */
+    const Footstep& current() const { return last_; }
+
+private:
+    /* Rate-limited step targets before the leading-leg rule zeroes dy/dyaw
+     * on closing steps — the limiter runs on these so it isn't reset every
+     * other step */
+    struct Ramp {
+        float x = 0.0f, y = 0.0f, yaw = 0.0f;
+    };
+
+    Config   cfg_;
+    Footstep q_[QUEUE_LEN];
+    Ramp     ramp_[QUEUE_LEN];
+    uint8_t  head_ = 0;
+    Footstep last_;                         // committed, in progress
+    Ramp     lastRamp_;
+    LegIK::Side nextSide_ = LegIK::Side::Left;
+};
@@ -0,0 +1,182 @@
+/**
+ * @file    loop_monitor.cpp
+ * @brief   Control loop deadline / jitter supervisor implementation
+ */
+
+#include "loop_monitor.hpp"
+#include "main.h"     // PNOID_FAST_CODE
+#include <cstdio>
+#include <cmath>
+
+/* ============== Setup ============== */
+
+void LoopMonitor::configure(const Config &cfg, DegradeHook hook)
+{
+    cfg_         = cfg;
+    hook_        = hook;
+    cyclesPerUs_ = SystemCoreClock / 1000000;
+    if (cyclesPerUs_ == 0) cyclesPerUs_ = 1;
+}
+
+/* ============== Per tick ============== */
+
+PNOID_FAST_CODE void LoopMonitor::beginTick(uint32_t stampCycles)
+{
+    if (havePrev_) prevStamp_ = stamp_;
+    stamp_  = stampCycles;
+    wakeUs_ = (DWT->CYCCNT - stampCycles) / cyclesPerUs_;
+    inTick_ = true;
+}
+
+PNOID_FAST_CODE void LoopMonitor::endTick()
+{
+    if (!inTick_) return;
+    inTick_ = false;
+
+    uint32_t now = DWT->CYCCNT;
+    Sample s;
+    s.computeUs = (now - stamp_) / cyclesPerUs_;
+    s.periodUs  = havePrev_ ? (stamp_ - prevStamp_) / cyclesPerUs_ : 0;
+    s.wakeUs    = wakeUs_;
+    s.slackUs   = (int32_t)cfg_.deadlineUs - (int32_t)s.computeUs;
+    havePrev_   = true;
+    last_       = s;
+    ticks_++;
+
+    bool overrun = false;
+    if (s.periodUs > cfg_.deadlineUs)  { periodOverruns_++;  overrun = true; }
+    if (s.computeUs > cfg_.deadlineUs) { computeOverruns_++; overrun = true; }
+
+    /* Degrade on the first miss, recover after a clean streak */
+    if (overrun) {
+        cleanTicks_ = 0;
+        if (!degraded_) {
+            degraded_ = true;
+            if (hook_) hook_(true);
+        }
+    } else if (degraded_ && ++cleanTicks_ >= cfg_.recoverTicks) {
+        degraded_ = false;
+        if (hook_) hook_(false);
+    }
+
+    /* Worst cases (the first tick has no period) */
+    if (s.periodUs > 0) {
+        accumulate(curWindow_, s);
+        accumulate(allTime_, s);
+        if (++windowCount_ >= cfg_.windowTicks) {
+            lastWindow_  = curWindow_;
+            curWindow_   = Stats();
+            windowCount_ = 0;
+        }
+    }
+
+    push(s);
+}
+
+/* ============== Ring ============== */
+
+PNOID_FAST_CODE void LoopMonitor::push(const Sample &s)
+{
+    uint16_t h    = head_;
+    uint16_t next = (h + 1) & (RING_LEN - 1);
+    if (next == tail_) {
+        ringDrops_++;
+        return;
+    }
+    ring_[h] = s;
+    __DMB();            // sample visible before the index
+    head_ = next;
+}
+
+bool LoopMonitor::pop(Sample &out)
+{
+    uint16_t t = tail_;
+    if (t == head_) return false;
+    __DMB();
+    out = ring_[t];
+    __DMB();            // done reading before releasing the slot
+    tail_ = (t + 1) & (RING_LEN - 1);
+    return true;
+}
+
+void LoopMonitor::drain()
+{
+    Sample s;
+    while (pop(s)) {
+        if (s.periodUs == 0) continue;
+        if (jCount_ == 0) jRef_ = (float)s.periodUs;
+        float d = (float)s.periodUs - jRef_;
+        jSum_    += d;
+        jSumSq_  += d * d;
+        jWSum_   += (float)s.wakeUs;
+        jWSumSq_ += (float)s.wakeUs * (float)s.wakeUs;
+        if (s.wakeUs > jWakeMax_) jWakeMax_ = s.wakeUs;
+        jCount_++;
+    }
+}
+
+LoopMonitor::Jitter LoopMonitor::drainJitter()
+{
+    drain();
+
+    Jitter j;
+    const uint32_t n = jCount_;
+    j.count     = n > UINT16_MAX ? UINT16_MAX : (uint16_t)n;
+    j.wakeMaxUs = jWakeMax_;
+    if (n > 0) {
+        float mean = jSum_ / n;
+        float var  = jSumSq_ / n - mean * mean;
+        j.meanUs = (uint32_t)(jRef_ + mean);
+        j.rmsUs  = (uint32_t)sqrtf(var > 0.0f ? var : 0.0f);
+
+        float wMean = jWSum_ / n;           // wake latency is small: no shift needed
+        float wVar  = jWSumSq_ / n - wMean * wMean;
+        j.wakeMeanUs = (uint32_t)wMean;
+        j.wakeRmsUs  = (uint32_t)sqrtf(wVar > 0.0f ? wVar : 0.0f);
+    }
+
+    jCount_ = jWakeMax_ = 0;
+    jSum_ = jSumSq_ = jWSum_ = jWSumSq_ = 0.0f;
+    return j;
+}
+
+/* ============== Reporting ============== */
+
+void LoopMonitor::accumulate(Stats &st, const Sample &s)
+{
+    if (s.periodUs  > st.maxPeriodUs)  st.maxPeriodUs  = s.periodUs;
+    if (s.periodUs  < st.minPeriodUs)  st.minPeriodUs  = s.periodUs;
+    if (s.wakeUs    > st.maxWakeUs)    st.maxWakeUs    = s.wakeUs;
+    if (s.computeUs > st.maxComputeUs) st.maxComputeUs = s.computeUs;
+    if (s.slackUs   < st.minSlackUs)   st.minSlackUs   = s.slackUs;
+}
+
+int LoopMonitor::summary(char *buf, size_t len) const
+{
+    const Stats &w = lastWindow_;
+    return snprintf(buf, len,
+        "ticks=%lu period %lu..%lu us (max %lu) wake max %lu us (max %lu) "
+        "cpu max %lu us (max %lu) "
+        "slack min %ld us, overrun p=%lu c=%lu, miss imu=%lu/%lu dt=%lu, drop=%lu%s",
+        ticks_,
+        (w.minPeriodUs == UINT32_MAX) ? 0UL : w.minPeriodUs, w.maxPeriodUs,
+        allTime_.maxPeriodUs,
+        w.maxWakeUs, allTime_.maxWakeUs,
+        w.maxComputeUs, allTime_.maxComputeUs,
+        (w.minSlackUs == INT32_MAX) ? 0L : (long)w.minSlackUs,
+        periodOverruns_, computeOverruns_,
+        miss_[(uint8_t)Miss::ImuRead], miss_[(uint8_t)Miss::ImuZero],
+        miss_[(uint8_t)Miss::DtClamp], ringDrops_,
+        degraded_ ? " DEGRADED" : "");
+}
+
+int LoopMonitor::summaryCsv(char *buf, size_t len) const
+{
+    const Stats &w = lastWindow_;
+    return snprintf(buf, len, "%lu,%lu,%lu,%ld,%lu,%lu,%lu,%d",
+        ticks_, w.maxPeriodUs, w.maxComputeUs,
+        (w.minSlackUs == INT32_MAX) ? 0L : (long)w.minSlackUs,
+        periodOverruns_, computeOverruns_,
+        miss_[(uint8_t)Miss::ImuRead] + miss_[(uint8_t)Miss::ImuZero],
+        degraded_ ? 1 : 0);
+}
@@ -0,0 +1,185 @@
+/**
+ * @file    loop_monitor.hpp
+ * @brief   Control loop deadline / jitter supervisor (DWT based)
+ *
+ * Per tick:
+ *   beginTick(stamp)   stamp = DWT cycle count of the IMU sample that
+ *                      started the tick (EXTI edge or poll time)
+ *   endTick()          after the servo command went out — optional work
+ *                      (logging, display) comes after and is not counted
+ *
+ * Each finished tick yields a Sample {period, compute, slack} pushed into a
+ * lock-free single-producer / single-consumer ring, so a reporter in another
+ * context (shell, low-priority task) can drain raw samples without locking
+ * the loop. When the ring is full the newest sample is dropped and counted.
+ *
+ *   period   stamp − previous stamp
+ *   wake     beginTick − stamp        (sample → loop / control task running)
+ *   compute  endTick − stamp          (sample → actuation latency)
+ *   slack    deadline − compute
+ *
+ * A tick whose period or compute exceeds the deadline is an overrun. The
+ * first overrun calls the degrade hook with `true`; after `recoverTicks`
+ * clean ticks in a row it is called with `false`.
+ *
+ * Worst cases are kept over a rolling window of `windowTicks` ticks (last
+ * complete window) and since boot.
+ */
+
+#pragma once
+
+#include "stm32h7xx.h"
+#include <cstdint>
+#include <cstddef>
+
+class LoopMonitor {
+public:
+    /** Tick anomalies (previously silent in the loop) */
+    enum class Miss : uint8_t {
+        ImuRead = 0,   // I2C read failed
+        ImuZero,       // accel all zeros (sensor lockup)
+        DtClamp,       // dt outside the safety floor / ceiling, clamped (tick still runs)
+        COUNT
+    };
+
+    struct Sample {
+        uint32_t periodUs;
+        uint32_t wakeUs;
+        uint32_t computeUs;
+        int32_t  slackUs;
+    };
+
+    struct Stats {
+        uint32_t maxPeriodUs  = 0;
+        uint32_t minPeriodUs  = UINT32_MAX;
+        uint32_t maxWakeUs    = 0;
+        uint32_t maxComputeUs = 0;
+        int32_t  minSlackUs   = INT32_MAX;
+    };
+
+    /** Period and wake-up jitter over the samples drained by drainJitter() */
+    struct Jitter {
+        uint16_t count      = 0;
+        uint32_t meanUs     = 0;
+        uint32_t rmsUs      = 0;    // RMS deviation from the mean period
+        uint32_t wakeMeanUs = 0;
+        uint32_t wakeRmsUs  = 0;    // RMS deviation from the mean wake latency
+        uint32_t wakeMaxUs  = 0;
+    };
+
+    struct Config {
+        uint32_t deadlineUs   = 10000;   // period and compute budget (100 Hz)
+        uint16_t windowTicks  = 100;     // worst-case window length
+        uint16_t recoverTicks = 200;     // clean ticks before leaving degrade
+    };
+
+    using DegradeHook = void (*)(bool degraded);
+
+    static constexpr uint32_t DRAIN_MS = 100;   // consumer drain period
+
+    LoopMonitor() = default;
+
+    /** Set limits; cycles/us is taken from SystemCoreClock */
+    void configure(const Config &cfg, DegradeHook hook = nullptr);
+
+    void beginTick(uint32_t stampCycles);
+    void endTick();
+
+    /**
+     * @brief  Forget the previous stamp: the next tick reports no period
+     * @note   After intentional blocking work (SD / flash service)
+     */
+    void resync() { havePrev_ = false; }
+
+    /** Count an anomaly; ImuRead / ImuZero ticks never reach endTick() */
+    void noteMiss(Miss m) { miss_[(uint8_t)m]++; }
+
+    /**
+     * @brief  Pop the oldest raw sample (consumer side)
+     * @retval false if the ring is empty
+     */
+    bool pop(Sample &out);
+
+    /**
+     * @brief  Move queued samples into the running jitter sums (consumer side)
+     * @note   Call every DRAIN_MS or faster, the ring holds RING_LEN ticks
+     */
+    void drain();
+
+    /** drain(), then reduce the sums since the last call to period jitter */
+    Jitter drainJitter();
+
+    bool degraded() const { return degraded_; }
+
+    uint32_t ticks() const           { return ticks_; }
+    uint32_t periodOverruns() const  { return periodOverruns_; }
+    uint32_t computeOverruns() const { return computeOverruns_; }
+    uint32_t misses(Miss m) const    { return miss_[(uint8_t)m]; }
+    uint32_t ringDrops() const       { return ringDrops_; }
+
+    const Stats& window() const   { return lastWindow_; }
+    const Stats& allTime() const  { return allTime_; }
+
+    /** Last finished tick */
+    const Sample& last() const { return last_; }
+
+    /**
+     * @brief  One-line human readable summary (debug UART)
+     * @return Characters written (snprintf semantics)
+     */
+    int summary(char *buf, size_t len) const;
+
+    /** Comma separated summary for the ESP status channel */
+    int summaryCsv(char *buf, size_t len) const;
+
+private:
+    /* Power of two. The loop follows the ICM-20948 data-ready (~1.1 kHz):
+     * 256 samples are ~230 ms, twice the DRAIN_MS between drain() calls */
+    static constexpr uint16_t RING_LEN = 256;
+
+    Config      cfg_;
+    DegradeHook hook_ = nullptr;
+    uint32_t    cyclesPerUs_ = 1;
+
+    /* Tick state */
+    uint32_t stamp_     = 0;
+    uint32_t prevStamp_ = 0;
+    uint32_t wakeUs_    = 0;
+    bool     inTick_    = false;
+    bool     havePrev_  = false;
+    Sample   last_      = {};
+
+    /* Counters */
+    uint32_t ticks_           = 0;
+    uint32_t periodOverruns_  = 0;
+    uint32_t computeOverruns_ = 0;
+    uint32_t miss_[(uint8_t)Miss::COUNT] = {};
+    uint32_t ringDrops_       = 0;
+
+    /* Degrade */
+    bool     degraded_   = false;
+    uint16_t cleanTicks_ = 0;
+
+    /* Worst-case windows */
+    Stats    curWindow_;
+    Stats    lastWindow_;
+    Stats    allTime_;
+    uint16_t windowCount_ = 0;
+
+    /* SPSC ring: head_ written by the loop only, tail_ by the reader only */
+    Sample            ring_[RING_LEN];
+    volatile uint16_t head_ = 0;
+    volatile uint16_t tail_ = 0;
+
+    /* Jitter sums since the last drainJitter() (consumer side) */
+    uint32_t jCount_   = 0;
+    uint32_t jWakeMax_ = 0;
+    float    jRef_     = 0.0f;      // first period: shift avoids cancellation
+    float    jSum_     = 0.0f;
+    float    jSumSq_   = 0.0f;
+    float    jWSum_    = 0.0f;
+    float    jWSumSq_  = 0.0f;
+
+    void push(const Sample &s);
+    static void accumulate(Stats &st, const Sample &s);
+};
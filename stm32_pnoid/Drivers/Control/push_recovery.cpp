@@ -0,0 +1,159 @@
+/**
+ * @file    push_recovery.cpp
+ * @brief   Capture-point push recovery implementation
+ */
+
+#include "push_recovery.hpp"
+#include "fast_math.hpp"
+#include "main.h"     // PNOID_FAST_CODE
+#include <cmath>
+
+static constexpr float PI      = 3.14159265f;
+static constexpr float DEG2RAD = PI / 180.0f;
+static constexpr float G_MM    = 9810.0f;   // mm/s^2
+
+static inline int16_t roundDeg(float v)
+{
+    return (int16_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+}
+
+/* ============== Setup ============== */
+
+void PushRecovery::configure(const Config &cfg, const LegIK &ik)
+{
+    cfg_   = cfg;
+    ik_    = ik;
+    zcMm_  = cfg.comHeightMm;
+    omega_ = FastMath::sqrt(G_MM / zcMm_);
+
+    /* §5.3 modified cycloid (zero end velocity) and §5.4 half-sine lift */
+    for (uint8_t i = 0; i < PROFILE_N; i++) {
+        float s = (float)i / (PROFILE_N - 1);
+        profX_[i] = s - FastMath::sin(2.0f * PI * s) / (2.0f * PI);
+        profZ_[i] = FastMath::sin(PI * s);
+    }
+}
+
+void PushRecovery::setStance(const Pose &stance)
+{
+    stanceAnkle_[0] = ik_.forward(LegIK::Side::Left,  stance.leftLeg);
+    stanceAnkle_[1] = ik_.forward(LegIK::Side::Right, stance.rightLeg);
+
+    /* §6.4 double support: bounding box of both feet */
+    halfX_ = cfg_.footLength * 0.5f
+           + fabsf(stanceAnkle_[0].x - stanceAnkle_[1].x) * 0.5f;
+    halfY_ = cfg_.footWidth * 0.5f
+           + fabsf(stanceAnkle_[0].y - stanceAnkle_[1].y) * 0.5f;
+}
+
+/* ============== Per tick ============== */
+
+PNOID_FAST_CODE PushRecovery::Event PushRecovery::update(float rollDeg, float pitchDeg,
+                                         float rollRateDps, float pitchRateDps,
+                                         float dt)
+{
+    /* LIPM CoM state from tilt about the stance centre */
+    float p = pitchDeg * DEG2RAD;
+    float r = rollDeg  * DEG2RAD;
+    float xc = -zcMm_ * FastMath::sin(p);
+    float yc = -zcMm_ * FastMath::sin(r);
+    float vx = -zcMm_ * FastMath::cos(p) * pitchRateDps * DEG2RAD;
+    float vy = -zcMm_ * FastMath::cos(r) * rollRateDps  * DEG2RAD;
+
+    /* §10.4 instantaneous capture point */
+    float invW = 1.0f / omega_;
+    cp_.x = xc + vx * invW;
+    cp_.y = yc + vy * invW;
+
+    float ex = fabsf(cp_.x) - halfX_;
+    float ey = fabsf(cp_.y) - halfY_;
+    excess_ = (ex > ey) ? ex : ey;
+
+    switch (state_) {
+    case State::Idle:
+        if (excess_ > cfg_.marginMm) {
+            startStep();
+            return Event::StepStarted;
+        }
+        break;
+
+    case State::Stepping: {
+        t_ += dt;
+        float s = t_ / cfg_.stepTimeS;
+        if (s >= 1.0f) {
+            s      = 1.0f;
+            t_     = 0.0f;
+            state_ = State::Settling;
+        }
+        solveSwing(s);
+        break;
+    }
+
+    case State::Settling:
+        t_ += dt;
+        if (t_ >= cfg_.settleTimeS) {
+            state_ = State::Idle;
+            return Event::StepFinished;
+        }
+        break;
+    }
+    return Event::None;
+}
+
+PNOID_FAST_CODE void PushRecovery::applySwing(Pose &pose) const
+{
+    int16_t *leg = (swingSide_ == LegIK::Side::Left) ? pose.leftLeg : pose.rightLeg;
+    for (int j = 0; j < Leg::NUM_JOINTS; j++)
+        leg[j] = roundDeg(swing_[j]);
+}
+
+/* ============== Internal ============== */
+
+void PushRecovery::startStep()
+{
+    /* Step with the leg on the side the capture point escaped to */
+    swingSide_ = (cp_.y >= 0.0f) ? LegIK::Side::Left : LegIK::Side::Right;
+    const LegIK::Vec3 &a = stanceAnkle_[(int)swingSide_];
+
+    /* Stance centre is the pelvis projection; move the foot onto ξ */
+    float cx = (stanceAnkle_[0].x + stanceAnkle_[1].x) * 0.5f;
+    float cy = (stanceAnkle_[0].y + stanceAnkle_[1].y) * 0.5f;
+    float dx = (cx + cp_.x) - a.x;
+    float dy = (cy + cp_.y) - a.y;
+
+    /* Never step inwards across the support leg */
+    if (swingSide_ == LegIK::Side::Left  && dy < 0.0f) dy = 0.0f;
+    if (swingSide_ == LegIK::Side::Right && dy > 0.0f) dy = 0.0f;
+
+    float d = FastMath::sqrt(dx * dx + dy * dy);
+    if (d > cfg_.maxStepMm) {
+        float k = cfg_.maxStepMm / d;
+        dx *= k;
+        dy *= k;
+    }
+
+    step_.x = dx;
+    step_.y = dy;
+    t_      = 0.0f;
+    state_  = State::Stepping;
+    solveSwing(0.0f);
+}
+
+PNOID_FAST_CODE void PushRecovery::solveSwing(float s)
+{
+    /* Linear interpolation in the precomputed profile */
+    float fi = s * (PROFILE_N - 1);
+    int   i0 = (int)fi;
+    if (i0 >= PROFILE_N - 1) i0 = PROFILE_N - 2;
+    float f  = fi - (float)i0;
+    float px = profX_[i0] + (profX_[i0 + 1] - profX_[i0]) * f;
+    float pz = profZ_[i0] + (profZ_[i0 + 1] - profZ_[i0]) * f;
+
+    const LegIK::Vec3 &a = stanceAnkle_[(int)swingSide_];
+    LegIK::Vec3 target;
+    target.x = a.x + step_.x * px;
+    target.y = a.y + step_.y * px;
+    target.z = a.z + cfg_.stepHeight * pz;
+
+    ik_.solve(swingSide_, target, 0.0f, swing_);
+}
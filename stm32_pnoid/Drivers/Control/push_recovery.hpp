@@ -0,0 +1,119 @@
+/**
+ * @file    push_recovery.hpp
+ * @brief   Capture-point push recovery with a reflex step (Docs §6.4, §10.4)
+ *
+ * Each tick:
+ *   CoM (LIPM, about the stance centre)   x_c = -z_c sin(pitch), y_c = -z_c sin(roll)
+ *   Capture point                         ξ = c + ċ / ω,  ω = sqrt(g / z_c)
+ *   Support polygon (double support)      bounding box of both feet
+ *
+ * Tilt signs follow App::run(): pitch + = leaning back, roll + = leaning right.
+ *
+ * When ξ leaves the polygon by more than `marginMm`, a step is started with
+ * the leg on the side of ξ: the swing ankle travels from its stance position
+ * towards ξ (clamped to maxStepMm) along a precomputed cycloid/half-sine
+ * profile (§5.3, §5.4), converted to joint angles through LegIK every tick.
+ * The support leg keeps its blended pose and stabilizer corrections.
+ */
+
+#pragma once
+
+#include "leg_ik.hpp"
+#include <cstdint>
+
+class PushRecovery {
+public:
+    enum class State : uint8_t {
+        Idle = 0,
+        Stepping,
+        Settling,   // foot down at the new position, waiting before re-blend
+    };
+
+    enum class Event : uint8_t {
+        None = 0,
+        StepStarted,
+        StepFinished,  // caller should blend back to its stance
+    };
+
+    struct Config {
+        float comHeightMm = 90.0f;    // z_c (§11.3)
+        float footLength  = 40.0f;    // mm, X (§6.4)
+        float footWidth   = 20.0f;    // mm, Y
+        float marginMm    = 5.0f;     // hysteresis outside the polygon
+        float maxStepMm   = 40.0f;    // clamp on foot displacement
+        float stepHeight  = 15.0f;    // H (§5.4)
+        float stepTimeS   = 0.30f;    // swing duration
+        float settleTimeS = 0.30f;    // hold after touchdown
+    };
+
+    struct Vec2 {
+        float x = 0.0f, y = 0.0f;
+    };
+
+    PushRecovery() = default;
+
+    /** Set parameters, precompute ω and the swing profile table */
+    void configure(const Config &cfg, const LegIK &ik);
+
+    /**
+     * @brief  Set the nominal stance; foot positions come from FK of the pose
+     * @note   Call again whenever the stance pose changes
+     */
+    void setStance(const Pose &stance);
+
+    /**
+     * @brief  Run one tick
+     * @param  rollDeg, pitchDeg          Tilt relative to upright (deg)
+     * @param  rollRateDps, pitchRateDps  Gyro rates (deg/s)
+     * @param  dt                         Tick period (s)
+     */
+    Event update(float rollDeg, float pitchDeg,
+                 float rollRateDps, float pitchRateDps, float dt);
+
+    /**
+     * @brief  Overwrite the swing leg joints in a pose
+     * @note   Valid while not Idle and on the tick that returns StepFinished
+     */
+    void applySwing(Pose &pose) const;
+
+    State state() const { return state_; }
+    bool  isActive() const { return state_ != State::Idle; }
+
+    /** Last capture point relative to stance centre (mm) */
+    const Vec2& capturePoint() const { return cp_; }
+
+    /** Signed distance of ξ outside the polygon (mm, <= 0 = inside) */
+    float excess() const { return excess_; }
+
+    LegIK::Side swingSide() const { return swingSide_; }
+    const Vec2& stepOffset() const { return step_; }
+
+private:
+    static constexpr uint8_t PROFILE_N = 33;   // samples over s = 0..1
+
+    Config cfg_;
+    LegIK  ik_;
+    float  omega_ = 10.4f;    // rad/s
+    float  zcMm_  = 90.0f;
+
+    /* Precomputed swing profile: forward progress and lift, both 0..1 */
+    float profX_[PROFILE_N] = {};
+    float profZ_[PROFILE_N] = {};
+
+    /* Stance */
+    LegIK::Vec3 stanceAnkle_[2];
+    float halfX_ = 20.0f;     // polygon half extents about the centre (mm)
+    float halfY_ = 45.0f;
+
+    /* Runtime */
+    State       state_     = State::Idle;
+    LegIK::Side swingSide_ = LegIK::Side::Left;
+    Vec2        cp_;
+    Vec2        step_;
+    float       excess_    = 0.0f;
+    float       t_         = 0.0f;
+    float       swing_[Leg::NUM_JOINTS] = {};
+
+    void startStep();
+    void solveSwing(float s);
+};
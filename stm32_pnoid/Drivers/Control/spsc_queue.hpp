@@ -0,0 +1,67 @@
+/**
+ * @file    spsc_queue.hpp
+ * @brief   Lock-free single-producer / single-consumer queue
+ *
+ * Fixed-capacity ring for passing messages between one writer and one
+ * reader in different contexts (ISR → task, control task → audio task,
+ * ...). No locks, no allocation, never blocks: push() fails when full and
+ * the drop is counted, pop() fails when empty.
+ *
+ *   head_  written by the producer only
+ *   tail_  written by the consumer only
+ *
+ * N must be a power of two; usable capacity is N − 1.
+ * T must be trivially copyable.
+ */
+
+#pragma once
+
+#include "stm32h7xx.h"
+#include <cstdint>
+#include <type_traits>
+
+template <typename T, uint16_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue needs a POD type");
+
+public:
+    SpscQueue() = default;
+
+    /** Producer side; false (and counted) when full */
+    bool push(const T &item)
+    {
+        uint16_t h    = head_;
+        uint16_t next = (h + 1) & (N - 1);
+        if (next == tail_) {
+            drops_++;
+            return false;
+        }
+        buf_[h] = item;
+        __DMB();            // item visible before the index
+        head_ = next;
+        return true;
+    }
+
+    /** Consumer side; false when empty */
+    bool pop(T &out)
+    {
+        uint16_t t = tail_;
+        if (t == head_) return false;
+        __DMB();
+        out = buf_[t];
+        __DMB();            // done reading before releasing the slot
+        tail_ = (t + 1) & (N - 1);
+        return true;
+    }
+
+    bool     empty() const { return head_ == tail_; }
+    uint16_t size() const  { return (uint16_t)((head_ - tail_) & (N - 1)); }
+    uint32_t drops() const { return drops_; }
+
+private:
+    T                 buf_[N];
+    volatile uint16_t head_  = 0;
+    volatile uint16_t tail_  = 0;
+    volatile uint32_t drops_ = 0;     // producer side only
+};
@@ -0,0 +1,188 @@
+/**
+ * @file    walk_controller.cpp
+ * @brief   Walking state machine implementation
+ */
+
+#include "walk_controller.hpp"
+#include "fast_math.hpp"
+#include "main.h"     // PNOID_FAST_CODE
+#include <cmath>
+
+static constexpr float PI = 3.14159265f;
+
+static inline int16_t roundDeg(float v)
+{
+    return (int16_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+}
+
+static inline LegIK::Side other(LegIK::Side s)
+{
+    return (s == LegIK::Side::Left) ? LegIK::Side::Right : LegIK::Side::Left;
+}
+
+/* ============== Setup ============== */
+
+void WalkController::configure(const Config &cfg, const FootstepPlanner::Config &plan,
+                               const LegIK &ik)
+{
+    cfg_       = cfg;
+    ik_        = ik;
+    stepTimeS_ = plan.stepTimeS;
+    planner_.configure(plan);
+}
+
+void WalkController::setStance(const Pose &stance)
+{
+    stance_ = stance;
+
+    const int16_t *legs[2] = { stance.leftLeg, stance.rightLeg };
+    for (int s = 0; s < 2; s++) {
+        LegIK::Side side = (LegIK::Side)s;
+        stanceAnkle_[s] = ik_.forward(side, legs[s]);
+
+        /* Trim: IK keeps the sole flat, the stance may not — remember the
+         * difference so zero offsets give back the stance exactly */
+        float q[Leg::NUM_JOINTS];
+        ik_.solve(side, stanceAnkle_[s], 0.0f, q);
+        for (int j = 0; j < Leg::NUM_JOINTS; j++)
+            trim_[s][j] = legs[s][j] - q[j];
+    }
+}
+
+/* ============== Per tick ============== */
+
+PNOID_FAST_CODE WalkController::Event WalkController::update(float dt, Pose &out)
+{
+    Event ev = Event::None;
+
+    if (state_ == State::Stand) {
+        out = stance_;
+        if (cmd_.isZero()) return Event::None;
+
+        /* The leg leading the motion (left for +Y / CCW) takes the first
+         * real step; the start step lifts the other one in place */
+        bool rightLeads = (cmd_.vy < 0.0f) || (cmd_.vy == 0.0f && cmd_.yawRate < 0.0f);
+        LegIK::Side lead = rightLeads ? LegIK::Side::Right : LegIK::Side::Left;
+        planner_.reset(lead);
+
+        Footstep f;
+        f.side = other(lead);
+        state_ = State::Start;
+        t_     = 0.0f;
+        beginStep(f);
+        ev = Event::StepStarted;
+    } else {
+        t_ += dt;
+        if (t_ >= stepTimeS_) {
+            /* Touchdown */
+            t_ -= stepTimeS_;
+            if (t_ > stepTimeS_) t_ = 0.0f;   // stalled loop, don't replay
+            foot_[0] = to_[0];
+            foot_[1] = to_[1];
+
+            bool home = true;
+            for (int s = 0; s < 2; s++)
+                if (fabsf(foot_[s].x) > 0.5f || fabsf(foot_[s].y) > 0.5f
+                    || fabsf(foot_[s].yaw) > 0.5f) home = false;
+
+            if (cmd_.isZero()) {
+                if (home && planner_.current().isZero()) {
+                    state_ = State::Stand;
+                    t_     = 0.0f;
+                    out    = stance_;
+                    return Event::Stopped;
+                }
+                state_ = State::Stop;
+            } else {
+                state_ = (cmd_.vx == 0.0f && cmd_.vy == 0.0f) ? State::Turn : State::Walk;
+            }
+
+            planner_.replan(cmd_);
+            beginStep(planner_.pop());
+            ev = Event::StepStarted;
+        }
+    }
+
+    /* Phase within the step */
+    float s    = t_ / stepTimeS_;
+    float cyc  = s - FastMath::sin(2.0f * PI * s) / (2.0f * PI);
+    float arc  = FastMath::sin(PI * s);
+    float bump = 0.5f - 0.5f * FastMath::cos(2.0f * PI * s);   // lift, zero end velocity
+
+    int sw = (int)step_.side;
+    int sp = 1 - sw;
+
+    foot_[sw].x   = from_[sw].x   + (to_[sw].x   - from_[sw].x)   * cyc;
+    foot_[sw].y   = from_[sw].y   + (to_[sw].y   - from_[sw].y)   * cyc;
+    foot_[sw].yaw = from_[sw].yaw + (to_[sw].yaw - from_[sw].yaw) * cyc;
+    foot_[sp].x   = from_[sp].x   + (to_[sp].x   - from_[sp].x)   * s;
+    foot_[sp].y   = from_[sp].y   + (to_[sp].y   - from_[sp].y)   * s;
+    foot_[sp].yaw = from_[sp].yaw + (to_[sp].yaw - from_[sp].yaw) * s;
+
+    /* Pelvis over the support foot = feet shifted towards the swing side */
+    float sway = cfg_.swayMm * arc * ((step_.side == LegIK::Side::Left) ? 1.0f : -1.0f);
+    float lift = cfg_.stepHeight * bump;
+
+    out.torso[Torso::Roll] = stance_.torso[Torso::Roll];
+    out.torso[Torso::Yaw]  = stance_.torso[Torso::Yaw];
+    solveLeg(LegIK::Side::Left,  sw == 0 ? lift : 0.0f, sway, out.leftLeg);
+    solveLeg(LegIK::Side::Right, sw == 1 ? lift : 0.0f, sway, out.rightLeg);
+    return ev;
+}
+
+void WalkController::abort()
+{
+    state_ = State::Stand;
+    t_     = 0.0f;
+    step_  = Footstep();
+    for (int s = 0; s < 2; s++) foot_[s] = from_[s] = to_[s] = Foot();
+}
+
+const char* WalkController::stateName(State s)
+{
+    switch (s) {
+        case State::Stand: return "stand";
+        case State::Start: return "start";
+        case State::Walk:  return "walk";
+        case State::Turn:  return "turn";
+        case State::Stop:  return "stop";
+        default:           return "?";
+    }
+}
+
+/* ============== Internal ============== */
+
+void WalkController::beginStep(const Footstep &f)
+{
+    step_ = f;
+    steps_++;
+
+    int sw = (int)f.side;
+    int sp = 1 - sw;
+
+    from_[0] = foot_[0];
+    from_[1] = foot_[1];
+
+    /* Symmetric about the pelvis: swing lands half a step ahead,
+     * support ends half a step behind */
+    to_[sw].x   =  0.5f * f.dx;
+    to_[sw].y   =  0.5f * f.dy;
+    to_[sw].yaw =  0.5f * f.dyaw;
+    to_[sp].x   = -0.5f * f.dx;
+    to_[sp].y   = -0.5f * f.dy;
+    to_[sp].yaw = -0.5f * f.dyaw;
+}
+
+PNOID_FAST_CODE void WalkController::solveLeg(LegIK::Side side, float lift, float sway, int16_t *leg) const
+{
+    int i = (int)side;
+    LegIK::Vec3 a = stanceAnkle_[i];
+    a.x += foot_[i].x;
+    a.y += foot_[i].y + sway;
+    a.z += lift;
+
+    float q[Leg::NUM_JOINTS];
+    ik_.solve(side, a, foot_[i].yaw, q);
+    for (int j = 0; j < Leg::NUM_JOINTS; j++)
+        leg[j] = roundDeg(q[j] + trim_[i][j]);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file    walk_controller.hpp
+ * @brief   Walking state machine: velocity command → leg poses every tick
+ *
+ * States:
+ *   Stand   feet at the stance, waiting for a non-zero command
+ *   Start   one in-place step to build up the lateral sway
+ *   Walk    stepping from the footstep queue (dx / dy)
+ *   Turn    same as Walk, but the command is a pure yaw rate
+ *   Stop    closing steps until both feet are back at the stance
+ *
+ * Each step lasts T = planner stepTimeS. In the pelvis frame:
+ *   swing foot    (x, y, yaw) from where it is → +step/2, lifted by
+ *                 stepHeight·(1 − cos 2πs)/2, forward motion on a cycloid
+ *                 (§5.3) — both start and land with zero velocity
+ *   support foot  linearly → −step/2 (the body moves over it)
+ *   both feet     shifted by swayMm·sin(πs) towards the swing side, so
+ *                 the CoM rides over the support foot (§6.4)
+ *
+ * Ankle targets go through LegIK. A per-joint trim, taken at setStance(),
+ * makes zero foot offsets reproduce the stance pose exactly, so entering and
+ * leaving the walk never jumps. Balance corrections are added by the caller
+ * on top of the returned pose, as for the blender.
+ *
+ * No allocation, constant work per tick (two IK solves).
+ */
+
+#pragma once
+
+#include "leg_ik.hpp"
+#include "footstep_planner.hpp"
+#include <cstdint>
+
+class WalkController {
+public:
+    enum class State : uint8_t {
+        Stand = 0,
+        Start,
+        Walk,
+        Turn,
+        Stop,
+    };
+
+    enum class Event : uint8_t {
+        None = 0,
+        StepStarted,   // a new footstep was popped this tick
+        Stopped,       // back in Stand
+    };
+
+    struct Config {
+        float stepHeight = 12.0f;   // swing lift (mm)
+        float swayMm     = 10.0f;   // lateral CoM shift over the support foot
+    };
+
+    WalkController() = default;
+
+    void configure(const Config &cfg, const FootstepPlanner::Config &plan,
+                   const LegIK &ik);
+
+    /** Stance the walk starts from and returns to (also sets the trim) */
+    void setStance(const Pose &stance);
+
+    /** Latest velocity command (from the mailbox); zero = stop */
+    void setCommand(const WalkCommand &cmd) { cmd_ = cmd; }
+    const WalkCommand& command() const { return cmd_; }
+
+    /**
+     * @brief  Advance by dt and compute this tick's pose
+     * @param  out  Receives both legs; torso copied from the stance
+     */
+    Event update(float dt, Pose &out);
+
+    /** Abort immediately (fall / push recovery); caller takes over from the last pose */
+    void abort();
+
+    State state() const { return state_; }
+    bool  isWalking() const { return state_ != State::Stand; }
+
+    /** Footstep being executed (zero step during Start) */
+    const Footstep& currentStep() const { return step_; }
+    uint32_t stepCount() const { return steps_; }
+
+    static const char* stateName(State s);
+
+private:
+    /** Foot offset from its stance position, pelvis frame */
+    struct Foot {
+        float x = 0.0f, y = 0.0f, yaw = 0.0f;
+    };
+
+    Config          cfg_;
+    FootstepPlanner planner_;
+    LegIK           ik_;
+    float           stepTimeS_ = 0.4f;
+
+    Pose        stance_;
+    LegIK::Vec3 stanceAnkle_[2];
+    float       trim_[2][Leg::NUM_JOINTS] = {};
+
+    WalkCommand cmd_;
+    State       state_ = State::Stand;
+    float       t_     = 0.0f;
+    uint32_t    steps_ = 0;
+    Footstep    step_;
+
+    Foot from_[2];      // offsets at step start
+    Foot to_[2];        // offsets at touchdown
+    Foot foot_[2];      // current offsets
+
+    void beginStep(const Footstep &f);
+    void solveLeg(LegIK::Side side, float lift, float sway, int16_t *leg) const;
+};
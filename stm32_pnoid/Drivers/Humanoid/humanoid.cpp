@@ -39,6 +39,7 @@ Leg::Status Leg::setJoint(Joint joint, int16_t angle)
         return Status::ErrPCA;
 
     currentAngle_[joint] = angle;
+    stale_[joint] = false;
     return Status::OK;
 }
 
@@ -53,8 +54,10 @@ Leg::Status Leg::home()
 
 void Leg::setOffset(Joint joint, int16_t offset)
 {
-    if (joint < NUM_JOINTS)
+    if (joint < NUM_JOINTS) {
         cfg_[joint].offset = offset;
+        stale_[joint] = true;
+    }
 }
 
 const char* Leg::jointName(Joint joint)
@@ -93,6 +96,7 @@ Torso::Status Torso::setJoint(Joint joint, int16_t angle)
         return Status::ErrPCA;
 
     currentAngle_[joint] = angle;
+    stale_[joint] = false;
     return Status::OK;
 }
 
@@ -107,8 +111,10 @@ Torso::Status Torso::home()
 
 void Torso::setOffset(Joint joint, int16_t offset)
 {
-    if (joint < NUM_JOINTS)
+    if (joint < NUM_JOINTS) {
         cfg_[joint].offset = offset;
+        stale_[joint] = true;
+    }
 }
 
 const char* Torso::jointName(Joint joint)
@@ -127,6 +133,8 @@ Humanoid::Humanoid(PCA9685 &pcaLeft, PCA9685 &pcaRight)
 
 Humanoid::Status Humanoid::init()
 {
+    if (!configured_) configure();
+
     /* Init PCA modules */
     if (pcaLeft_.init() != PCA9685::Status::OK) {
         LOGE(TAG, "PCA Left (0x41) init failed!");
@@ -137,6 +145,15 @@ Humanoid::Status Humanoid::init()
         return Status::ErrInit;
     }
 
+    /* Home position */
+    home();
+
+    LOGI(TAG, "Init OK (14 joints: 2 legs + torso)");
+    return Status::OK;
+}
+
+void Humanoid::configure()
+{
     /*
      * PCA#1 (0x41) — Left leg CH0-5, Torso CH6-7
      * PCA#2 (0x42) — Right leg CH0-5
@@ -219,12 +236,7 @@ Humanoid::Status Humanoid::init()
         {&pcaRight_,  9,  -20,  20,   0,  +1,   0},  // TorsoRoll (180=right, ±20°)
     };
     torso.configure(torsoCfg);
-
-    /* Home position */
-    home();
-
-    LOGI(TAG, "Init OK (14 joints: 2 legs + torso)");
-    return Status::OK;
+    configured_ = true;
 }
 
 Humanoid::Status Humanoid::home()
@@ -238,3 +250,39 @@ Humanoid::Status Humanoid::home()
     LOGI(TAG, "Home position OK");
     return Status::OK;
 }
+
+Pose Humanoid::getPose() const
+{
+    Pose p;
+    for (int i = 0; i < Leg::NUM_JOINTS; i++) {
+        p.leftLeg[i]  = leftLeg.getAngle((Leg::Joint)i);
+        p.rightLeg[i] = rightLeg.getAngle((Leg::Joint)i);
+    }
+    for (int i = 0; i < Torso::NUM_JOINTS; i++)
+        p.torso[i] = torso.getAngle((Torso::Joint)i);
+    return p;
+}
+
+Humanoid::Status Humanoid::setPose(const Pose &pose)
+{
+    Status st = Status::OK;
+
+    /* Skip unchanged joints — each write is one I2C transaction (~150 us).
+     * A joint whose trim changed is written again even at the same angle. */
+    for (int i = 0; i < Leg::NUM_JOINTS; i++) {
+        Leg::Joint j = (Leg::Joint)i;
+        if ((pose.leftLeg[i] != leftLeg.getAngle(j) || leftLeg.isStale(j)) &&
+            leftLeg.setJoint(j, pose.leftLeg[i]) != Leg::Status::OK)
+            st = Status::ErrPCA;
+        if ((pose.rightLeg[i] != rightLeg.getAngle(j) || rightLeg.isStale(j)) &&
+            rightLeg.setJoint(j, pose.rightLeg[i]) != Leg::Status::OK)
+            st = Status::ErrPCA;
+    }
+    for (int i = 0; i < Torso::NUM_JOINTS; i++) {
+        Torso::Joint j = (Torso::Joint)i;
+        if ((pose.torso[i] != torso.getAngle(j) || torso.isStale(j)) &&
+            torso.setJoint(j, pose.torso[i]) != Torso::Status::OK)
+            st = Status::ErrPCA;
+    }
+    return st;
+}
@@ -58,15 +58,19 @@ public:
     /** Get current commanded angle */
     int16_t getAngle(Joint joint) const { return currentAngle_[joint]; }
 
-    /** Set trim offset for a joint */
+    /** Set trim offset for a joint (applied by the next setJoint / setPose) */
     void setOffset(Joint joint, int16_t offset);
 
+    /** Offset changed since the joint was last written */
+    bool isStale(Joint joint) const { return stale_[joint]; }
+
     /** Get joint name string */
     static const char* jointName(Joint joint);
 
 private:
     JointConfig cfg_[NUM_JOINTS] = {};
     int16_t currentAngle_[NUM_JOINTS] = {};
+    volatile bool stale_[NUM_JOINTS] = {};
 };
 
 /* ============== Torso ============== */
@@ -92,11 +96,36 @@ public:
     Status home();
     int16_t getAngle(Joint joint) const { return currentAngle_[joint]; }
     void setOffset(Joint joint, int16_t offset);
+    bool isStale(Joint joint) const { return stale_[joint]; }
     static const char* jointName(Joint joint);
 
 private:
     JointConfig cfg_[NUM_JOINTS] = {};
     int16_t currentAngle_[NUM_JOINTS] = {};
+    volatile bool stale_[NUM_JOINTS] = {};
+};
+
+/* ============== Pose ============== */
+
+/**
+ * Commanded angle of every joint (degrees, robot frame).
+ * Flat index order: left leg (0-5), right leg (6-11), torso (12-13).
+ */
+struct Pose {
+    static constexpr uint8_t NUM_JOINTS = Leg::NUM_JOINTS * 2 + Torso::NUM_JOINTS;
+
+    int16_t leftLeg[Leg::NUM_JOINTS]  = {};
+    int16_t rightLeg[Leg::NUM_JOINTS] = {};
+    int16_t torso[Torso::NUM_JOINTS]  = {};
+
+    int16_t& operator[](uint8_t i) {
+        if (i < Leg::NUM_JOINTS)     return leftLeg[i];
+        if (i < Leg::NUM_JOINTS * 2) return rightLeg[i - Leg::NUM_JOINTS];
+        return torso[i - Leg::NUM_JOINTS * 2];
+    }
+    int16_t operator[](uint8_t i) const {
+        return const_cast<Pose&>(*this)[i];
+    }
 };
 
 /* ============== Humanoid ============== */
@@ -116,12 +145,26 @@ public:
      */
     Humanoid(PCA9685 &pcaLeft, PCA9685 &pcaRight);
 
-    /** Init both PCA9685 modules and configure all joints */
+    /** Init both PCA9685 modules, configure all joints (unless done), home */
     Status init();
 
+    /**
+     * Load the joint tables (limits, direction, compiled-in trim), no I2C.
+     * Call before init() to apply stored trims with setOffset() so that
+     * the home pose already uses them.
+     */
+    void configure();
+
     /** Move all joints to home (standing) position */
     Status home();
 
+    /** Snapshot of the currently commanded angles */
+    Pose getPose() const;
+
+    /** Command every joint; joints already at the target are not re-sent
+     *  unless their trim offset changed */
+    Status setPose(const Pose &pose);
+
     Leg   leftLeg;
     Leg   rightLeg;
     Torso torso;
@@ -129,4 +172,5 @@ public:
 private:
     PCA9685 &pcaLeft_;
     PCA9685 &pcaRight_;
+    bool     configured_ = false;
 };
@@ -0,0 +1,103 @@
+/**
+ * @file    leg_ik.cpp
+ * @brief   Analytic leg IK/FK implementation
+ */
+
+#include "leg_ik.hpp"
+#include "fast_math.hpp"
+#include "main.h"     // PNOID_FAST_CODE
+#include <cmath>
+
+static constexpr float DEG2RAD = 3.14159265f / 180.0f;
+static constexpr float RAD2DEG = 180.0f / 3.14159265f;
+
+static inline float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* ============== Public API ============== */
+
+LegIK::Vec3 LegIK::hipOrigin(Side side) const
+{
+    Vec3 p;
+    p.y = (side == Side::Left) ? geo_.hipHalfWidth : -geo_.hipHalfWidth;
+    p.z = -geo_.hipDrop;
+    return p;
+}
+
+PNOID_FAST_CODE bool LegIK::solve(Side side, const Vec3 &ankle, float yawDeg,
+                  float out[Leg::NUM_JOINTS]) const
+{
+    const float sgn = (side == Side::Left) ? 1.0f : -1.0f;
+    const float L1 = geo_.thigh, L2 = geo_.shank;
+
+    /* §4.3 — into the hip frame, undo HipYaw */
+    Vec3 hip = hipOrigin(side);
+    float dx = ankle.x - hip.x;
+    float dy = ankle.y - hip.y;
+    float dz = ankle.z - hip.z;
+
+    float s, c;
+    FastMath::sincos(yawDeg * DEG2RAD, s, c);
+    float px =  c * dx + s * dy;
+    float py = (-s * dx + c * dy) * sgn;   // outward positive
+    float pz = dz;
+
+    /* §4.7 — roll in the frontal plane */
+    float gamma = FastMath::atan2(py, -pz);
+    float lv    = FastMath::sqrt(py * py + pz * pz);
+
+    /* §4.4 — reach, clamped to the bent-knee workspace */
+    float L    = FastMath::sqrt(px * px + lv * lv);
+    float Lmax = FastMath::sqrt(L1 * L1 + L2 * L2
+                     + 2.0f * L1 * L2 * FastMath::cos(geo_.kneeMinDeg * DEG2RAD));
+    float Lmin = fabsf(L1 - L2) + 1.0f;
+    bool  reachable = (L <= Lmax && L >= Lmin);
+    L = clampf(L, Lmin, Lmax);
+
+    float cosK = (L1 * L1 + L2 * L2 - L * L) / (2.0f * L1 * L2);
+    float knee = 3.14159265f - FastMath::acos(clampf(cosK, -1.0f, 1.0f));
+
+    /* §4.5 — thigh sits β in front of the hip–ankle line */
+    float alpha = FastMath::atan2(px, lv);
+    float cosB  = (L1 * L1 + L * L - L2 * L2) / (2.0f * L1 * L);
+    float beta  = FastMath::acos(clampf(cosB, -1.0f, 1.0f));
+    float hipP  = alpha + beta;
+
+    out[Leg::HipYaw]     = yawDeg * sgn;
+    out[Leg::HipRoll]    = gamma * RAD2DEG;
+    out[Leg::HipPitch]   = hipP * RAD2DEG;
+    out[Leg::KneePitch]  = knee * RAD2DEG;
+    out[Leg::AnklePitch] = (knee - hipP) * RAD2DEG;   // §4.6, sole flat
+    out[Leg::AnkleRoll]  = -gamma * RAD2DEG;
+    return reachable;
+}
+
+PNOID_FAST_CODE LegIK::Vec3 LegIK::forward(Side side, const int16_t angles[Leg::NUM_JOINTS]) const
+{
+    const float sgn = (side == Side::Left) ? 1.0f : -1.0f;
+    const float L1 = geo_.thigh, L2 = geo_.shank;
+
+    float h = angles[Leg::HipPitch]  * DEG2RAD;
+    float k = angles[Leg::KneePitch] * DEG2RAD;
+    float g = angles[Leg::HipRoll]   * DEG2RAD;
+
+    /* Sagittal chain in the leg plane, then frontal roll */
+    float px = L1 * FastMath::sin(h) + L2 * FastMath::sin(h - k);
+    float l  = L1 * FastMath::cos(h) + L2 * FastMath::cos(h - k);
+    float py = l * FastMath::sin(g) * sgn;
+    float pz = -l * FastMath::cos(g);
+
+    /* Redo HipYaw (stored mirrored for the right leg) */
+    float yaw = angles[Leg::HipYaw] * sgn * DEG2RAD;
+    float s, c;
+    FastMath::sincos(yaw, s, c);
+
+    Vec3 hip = hipOrigin(side);
+    Vec3 p;
+    p.x = hip.x + c * px - s * py;
+    p.y = hip.y + s * px + c * py;
+    p.z = hip.z + pz;
+    return p;
+}
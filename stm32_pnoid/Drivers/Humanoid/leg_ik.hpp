@@ -0,0 +1,65 @@
+/**
+ * @file    leg_ik.hpp
+ * @brief   Analytic leg inverse/forward kinematics (Docs §2–§4)
+ *
+ * Frame: pelvis centre, X forward, Y left, Z up (mm).
+ * Targets are ankle-joint positions; the sole is h0 below the ankle.
+ *
+ * Angles are returned in the robot joint convention used by Leg::setJoint()
+ * (degrees, 0 = straight standing, + = forward / bend / outward), so the
+ * same numbers can be written to either leg — Humanoid's direction/offset
+ * config takes care of servo mirroring.
+ *
+ *   HipPitch   = α + β             (thigh forward of the hip–ankle line)
+ *   KneePitch  = π − acos(cosine rule)
+ *   AnklePitch = Knee − Hip        (sole parallel to ground)
+ *   HipRoll    = γ,  AnkleRoll = −γ
+ */
+
+#pragma once
+
+#include "humanoid.hpp"
+#include <cstdint>
+
+class LegIK {
+public:
+    enum class Side : uint8_t { Left = 0, Right };
+
+    /** Geometry (Docs §11.1, mm) */
+    struct Geometry {
+        float hipHalfWidth = 35.0f;   // d
+        float hipDrop      = 15.0f;   // h_z
+        float thigh        = 55.0f;   // L1
+        float shank        = 55.0f;   // L2
+        float footHeight   = 20.0f;   // h0
+        float kneeMinDeg   = 5.0f;    // keep the knee bent (singularity)
+    };
+
+    struct Vec3 {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+    };
+
+    LegIK() = default;
+
+    void configure(const Geometry &g) { geo_ = g; }
+    const Geometry& geometry() const { return geo_; }
+
+    /**
+     * @brief  Ankle position → 6 joint angles (deg, robot convention)
+     * @param  side    Which leg
+     * @param  ankle   Ankle target in pelvis frame (mm)
+     * @param  yawDeg  Foot yaw, CCW positive (world sense, not mirrored)
+     * @param  out     Leg::NUM_JOINTS angles
+     * @retval false if the target was out of reach and had to be clamped
+     */
+    bool solve(Side side, const Vec3 &ankle, float yawDeg, float out[Leg::NUM_JOINTS]) const;
+
+    /** Joint angles (deg, robot convention) → ankle position (mm) */
+    Vec3 forward(Side side, const int16_t angles[Leg::NUM_JOINTS]) const;
+
+    /** Hip joint origin in pelvis frame */
+    Vec3 hipOrigin(Side side) const;
+
+private:
+    Geometry geo_;
+};
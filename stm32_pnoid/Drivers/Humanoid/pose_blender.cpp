@@ -0,0 +1,108 @@
+/**
+ * @file    pose_blender.cpp
+ * @brief   Quintic pose blending implementation
+ */
+
+#include "pose_blender.hpp"
+#include "main.h"     // PNOID_FAST_CODE
+
+/* ============== Helpers ============== */
+
+static inline int16_t roundDeg(float v)
+{
+    return (int16_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+}
+
+/* ============== Public API ============== */
+
+void PoseBlender::reset(const Pose &pose)
+{
+    for (uint8_t i = 0; i < N; i++) {
+        pos_[i] = (float)pose[i];
+        c_[i][0] = pos_[i];
+        for (int k = 1; k < 6; k++) c_[i][k] = 0.0f;
+    }
+    out_    = pose;
+    s_      = 1.0f;
+    active_ = false;
+}
+
+void PoseBlender::moveTo(const Pose &target, uint32_t durationMs)
+{
+    if (durationMs == 0) {
+        reset(target);
+        return;
+    }
+
+    const float T = durationMs * 0.001f;
+
+    /* Ratio to rescale derivatives of the running blend to the new duration:
+     * dq/ds_new = dq/ds_old * T_new / T_old, d2q/ds2 scales with the square */
+    const float r  = active_ ? T / durationS_ : 0.0f;
+    const float r2 = r * r;
+    const float s  = s_;
+
+    for (uint8_t i = 0; i < N; i++) {
+        const float *c = c_[i];
+        float p0 = pos_[i];
+        float v0 = 0.0f;   // dq/ds at start, new time scale
+        float a0 = 0.0f;   // d2q/ds2 at start, new time scale
+
+        if (active_) {
+            v0 = (c[1] + s * (2.0f * c[2] + s * (3.0f * c[3]
+                 + s * (4.0f * c[4] + s * 5.0f * c[5])))) * r;
+            a0 = (2.0f * c[2] + s * (6.0f * c[3]
+                 + s * (12.0f * c[4] + s * 20.0f * c[5]))) * r2;
+        }
+
+        /* Boundary: (p0, v0, a0) -> (p1, 0, 0) over s = 0..1 */
+        float h = (float)target[i] - p0;
+        float *o = c_[i];
+        o[0] = p0;
+        o[1] = v0;
+        o[2] = 0.5f * a0;
+        o[3] =  10.0f * h - 6.0f * v0 - 1.5f * a0;
+        o[4] = -15.0f * h + 8.0f * v0 + 1.5f * a0;
+        o[5] =   6.0f * h - 3.0f * v0 - 0.5f * a0;
+    }
+
+    durationS_ = T;
+    invT_      = 1.0f / T;
+    s_         = 0.0f;
+    active_    = true;
+}
+
+PNOID_FAST_CODE const Pose& PoseBlender::update(float dt)
+{
+    if (!active_) return out_;
+
+    s_ += dt * invT_;
+    if (s_ >= 1.0f) s_ = 1.0f;
+
+    evaluate();
+
+    if (s_ >= 1.0f) {
+        /* Settle exactly on the target and drop the polynomial */
+        for (uint8_t i = 0; i < N; i++) {
+            float p = c_[i][0] + c_[i][1] + c_[i][2] + c_[i][3] + c_[i][4] + c_[i][5];
+            c_[i][0] = p;
+            c_[i][1] = c_[i][2] = c_[i][3] = c_[i][4] = c_[i][5] = 0.0f;
+        }
+        active_ = false;
+    }
+    return out_;
+}
+
+/* ============== Internal ============== */
+
+PNOID_FAST_CODE void PoseBlender::evaluate()
+{
+    const float s = s_;
+    for (uint8_t i = 0; i < N; i++) {
+        const float *c = c_[i];
+        /* Horner: 5 multiply-adds */
+        float q = c[0] + s * (c[1] + s * (c[2] + s * (c[3] + s * (c[4] + s * c[5]))));
+        pos_[i] = q;
+        out_[i] = roundDeg(q);
+    }
+}
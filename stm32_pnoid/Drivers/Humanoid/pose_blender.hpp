@@ -0,0 +1,70 @@
+/**
+ * @file    pose_blender.hpp
+ * @brief   Non-blocking pose transitions with quintic (jerk-limited) profiles
+ *
+ * Usage:
+ *   PoseBlender blender;
+ *   blender.reset(robot.getPose());
+ *   blender.moveTo(stance, 1500);          // start transition, returns at once
+ *   while (1) {
+ *       Pose cmd = blender.update(dt);     // base pose for this tick
+ *       cmd.leftLeg[Leg::AnklePitch] += corr;   // stabilizer on top
+ *       robot.setPose(cmd);
+ *   }
+ *
+ * Each joint follows q(s) = c0 + c1*s + ... + c5*s^5, s = t / T in [0, 1],
+ * with zero velocity and acceleration at the target. Retargeting mid-blend
+ * keeps position, velocity and acceleration continuous. Coefficients are
+ * solved once in moveTo(); update() costs 5 multiply-adds per joint.
+ */
+
+#pragma once
+
+#include "humanoid.hpp"
+#include <cstdint>
+
+class PoseBlender {
+public:
+    PoseBlender() = default;
+
+    /** Jump to a pose without blending (e.g. the pose commanded at boot) */
+    void reset(const Pose &pose);
+
+    /**
+     * @brief  Start a transition from the current blended pose
+     * @param  target      Final pose
+     * @param  durationMs  Transition time (0 = jump)
+     */
+    void moveTo(const Pose &target, uint32_t durationMs);
+
+    /**
+     * @brief  Advance the transition by dt and return the blended pose
+     * @param  dt  Elapsed time since last call (s)
+     */
+    const Pose& update(float dt);
+
+    /** Current blended pose (no time advance) */
+    const Pose& pose() const { return out_; }
+
+    /** Blended angle of a joint before rounding (deg, flat Pose index) */
+    float angle(uint8_t joint) const { return pos_[joint]; }
+
+    bool  isBlending() const { return active_; }
+
+    /** Transition progress 0..1 (1 when idle) */
+    float progress() const { return active_ ? s_ : 1.0f; }
+
+private:
+    static constexpr uint8_t N = Pose::NUM_JOINTS;
+
+    float c_[N][6] = {};     // polynomial coefficients in s
+    float pos_[N]  = {};     // blended angle (deg)
+    Pose  out_;              // rounded pose handed to the servos
+
+    float s_        = 1.0f;  // normalized time 0..1
+    float invT_     = 0.0f;  // 1 / duration (1/s)
+    float durationS_ = 0.0f;
+    bool  active_   = false;
+
+    void evaluate();
+};
@@ -245,13 +245,25 @@ void LCD::initSequence()
 /* ---------- Public API --------------------------------------------------- */
 
 LCD::Status LCD::init()
+{
+    beginInit();
+    return finishInit();
+}
+
+void LCD::beginInit()
 {
     csHigh();
     HAL_Delay(5);
     csLow();
     HAL_Delay(20);
     csHigh();
-    HAL_Delay(150);
+    resetTick_ = HAL_GetTick();
+}
+
+LCD::Status LCD::finishInit()
+{
+    /* Remaining reset settle time, if the caller did not use it up */
+    while ((HAL_GetTick() - resetTick_) < 150) {}
 
     initSequence();
     backlightOn();
@@ -381,5 +393,27 @@ void LCD::drawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16
     writeDataBulk(reinterpret_cast<const uint8_t*>(data), static_cast<uint32_t>(w) * h * 2);
 }
 
+void LCD::beginImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    setWindow(x, y, x + w - 1, y + h - 1);
+    dcData();
+    csLow();
+}
+
+void LCD::writeImage(const uint8_t *data, uint32_t len)
+{
+    while (len > 0) {
+        uint16_t chunk = (len > 65535) ? 65535 : static_cast<uint16_t>(len);
+        HAL_SPI_Transmit(&hspi_, const_cast<uint8_t*>(data), chunk, 1000);
+        data += chunk;
+        len  -= chunk;
+    }
+}
+
+void LCD::endImage()
+{
+    csHigh();
+}
+
 void LCD::backlightOn()  { HAL_GPIO_WritePin(blkPort_, blkPin_, GPIO_PIN_SET);   }
 void LCD::backlightOff() { HAL_GPIO_WritePin(blkPort_, blkPin_, GPIO_PIN_RESET); }
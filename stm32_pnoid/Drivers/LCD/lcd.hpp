@@ -53,6 +53,16 @@ public:
         GPIO_TypeDef *blkPort, uint16_t blkPin);
 
     Status init();
+
+    /*
+     * Split init for staged boot: beginInit() pulses the reset and returns;
+     * finishInit() waits out the rest of the 150 ms settle time (other
+     * devices can be brought up in between) and sends the init sequence.
+     * init() == beginInit() + finishInit().
+     */
+    void   beginInit();
+    Status finishInit();
+
     void setRotation(Rotation rot);
 
     void fillScreen(uint16_t color);
@@ -63,6 +73,16 @@ public:
     void drawString(uint16_t x, uint16_t y, const char *str, uint16_t fg, uint16_t bg);
     void drawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
 
+    /*
+     * Streamed image: beginImage() opens the window and keeps CS low,
+     * writeImage() sends big-endian RGB565 bytes as they are produced
+     * (a decoded line at a time), endImage() releases CS. Nothing else
+     * may use the SPI bus in between.
+     */
+    void beginImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    void writeImage(const uint8_t *data, uint32_t len);
+    void endImage();
+
     void backlightOn();
     void backlightOff();
 
@@ -81,6 +101,7 @@ private:
 
     uint16_t width_  = DEFAULT_WIDTH;
     uint16_t height_ = DEFAULT_HEIGHT;
+    uint32_t resetTick_ = 0;   // HAL tick at the end of the reset pulse
 
     void csLow();
     void csHigh();
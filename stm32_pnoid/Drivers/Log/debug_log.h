@@ -10,7 +10,7 @@
  *   LOGD(TAG, "Raw data: 0x%08X", val);
  *
  * Output example (with color on terminal):
- *   I (1234) APP: System started, clock = 480 MHz
+ *   I (1234.567) APP: System started, clock = 480 MHz   (ms.µs, timebase.h)
  *   W (1235) APP: Buffer almost full: 90%
  *   E (1236) APP: Failed to init SD card
  *   D (1237) APP: Raw data: 0xDEADBEEF
@@ -20,11 +20,23 @@
  *   #define LOG_LEVEL  LOG_LEVEL_DEBUG  -- minimum log level (default: DEBUG)
  *   #define LOG_SD_ENABLE     1   -- also write logs to SD card (default: disabled)
  *   #define LOG_SD_LEVEL LOG_LEVEL_INFO -- min level for SD (default: INFO)
+ *   #define LOG_UART_BAUD     115200 -- console baud, set by LOG_TX_Init
  *
- * SD card logging:
+ * UART output (debug_log_tx.c):
+ *   The macros only format into a stack buffer and copy the line into a
+ *   lock-free ring; USART1 TX is drained by DMA in the background. Safe
+ *   from ISRs, never blocks — lines are dropped (and counted) when the
+ *   ring is full. Call LOG_TX_Init() once after MX init (BSP::init);
+ *   LOG_TX_Flush() waits for the ring to drain (before reset / halt).
+ *
+ * SD card logging (debug_log_sd.cpp, write-behind):
  *   Call LOG_SD_Init() after SD card + FATFS are mounted.
+ *   Call LOG_SD_Service() periodically from a low-priority context
+ *   (log service) — the only place FatFs is touched.
  *   Call LOG_SD_DeInit() before unmounting.
  *   Logs are written to "log.txt" (appended). No ANSI colors on SD.
+ *   One snprintf per line: the SD copy is the UART line without the
+ *   color prefix / reset (the reset goes after "\r\n").
  */
 
 #ifndef DEBUG_LOG_H_
@@ -37,6 +49,7 @@ extern "C" {
 #include "stm32h7xx_hal.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include "timebase.h"
 
 /* UART handle for log output -- defined in main.c */
 extern UART_HandleTypeDef huart1;
@@ -61,6 +74,10 @@ extern UART_HandleTypeDef huart1;
 #define LOG_BUF_SIZE      256
 #endif
 
+#ifndef LOG_UART_BAUD
+#define LOG_UART_BAUD     115200u
+#endif
+
 #ifndef LOG_SD_ENABLE
 #define LOG_SD_ENABLE     1
 #endif
@@ -85,6 +102,42 @@ extern UART_HandleTypeDef huart1;
   #define LOG_COLOR_RESET   ""
 #endif
 
+/* ---------- UART output API --------------------------------------------- */
+
+typedef struct {
+    uint32_t lines;     /* lines queued since boot                   */
+    uint32_t bytes;     /* bytes queued since boot                   */
+    uint32_t drops;     /* lines dropped (ring full / before init)   */
+    uint32_t used;      /* bytes waiting in the ring now             */
+    uint32_t peak;      /* most bytes ever waiting                   */
+    uint32_t size;      /* ring size in bytes                        */
+    uint32_t baud;      /* console baud rate                         */
+} LOG_TX_Stats_t;
+
+/**
+ * @brief  Set up DMA1 Stream 5 for USART1 TX and start draining
+ * @note   Call once after MX_DMA_Init / MX_USART1_UART_Init and TIME_Init.
+ *         Lines written before this are dropped.
+ */
+void LOG_TX_Init(void);
+
+/**
+ * @brief  Queue a pre-formatted line for output (used internally by macros)
+ * @note   Any context. Never blocks: drops the line when the ring is full.
+ */
+void LOG_TX_Write(const char *buf, int len);
+
+/**
+ * @brief  Wait until every queued line has gone out
+ * @param  timeoutMs  Give up after this long (< 8 s)
+ * @retval 0 when drained, -1 on timeout or before init
+ * @note   Polls the DMA, so it also works with interrupts disabled.
+ */
+int  LOG_TX_Flush(uint32_t timeoutMs);
+
+/** Counters for the "log" command */
+void LOG_TX_GetStats(LOG_TX_Stats_t *s);
+
 /* ---------- SD card logging API ----------------------------------------- */
 
 #if LOG_SD_ENABLE
@@ -97,14 +150,47 @@ extern UART_HandleTypeDef huart1;
 
   /**
    * @brief  Close log file on SD card
-   * @note   Call before unmount or power off
+   * @note   Call before unmount or power off. Stops LOG_SD_Write first and
+   *         waits for a LOG_SD_Service() in progress, then flushes.
    */
   void LOG_SD_DeInit(void);
 
   /**
-   * @brief  Write a pre-formatted string to SD log file (used internally by macros)
+   * @brief  Queue a pre-formatted string for the SD log file (used internally by macros)
+   * @note   Any context. Copies into RAM only; drops (and counts) bytes when
+   *         both buffers are waiting for the card.
    */
   void LOG_SD_Write(const char *buf, int len);
+
+  /**
+   * @brief  Write one full / stale buffer, or f_sync on the time / size policy
+   * @retval 1 if the card was written (the call blocked), 0 otherwise
+   * @note   Low-priority context only — this is where the SD latency goes.
+   *         One card operation per call; LOG_SD_Due() stays set while
+   *         there is more.
+   */
+  int  LOG_SD_Service(void);
+
+  /**
+   * @brief  Would LOG_SD_Service() touch the card now? (cheap, no FatFs)
+   * @note   Lets the SD scheduler queue the flush only when there is one.
+   */
+  int  LOG_SD_Due(void);
+
+  typedef struct {
+      uint32_t written;       /* bytes handed to f_write                 */
+      uint32_t droppedBytes;  /* bytes lost (buffers full / write error) */
+      uint32_t buffered;      /* bytes waiting in RAM now                */
+      uint32_t flushes;       /* f_write calls                           */
+      uint32_t lastFlushUs;   /* latest f_write duration                 */
+      uint32_t maxFlushUs;    /* worst f_write duration                  */
+      uint32_t syncs;         /* f_sync calls                            */
+      uint32_t maxSyncUs;     /* worst f_sync duration                   */
+      uint32_t errors;        /* failed f_write calls                    */
+  } LOG_SD_Stats_t;
+
+  /** Counters for the "log" command */
+  void LOG_SD_GetStats(LOG_SD_Stats_t *s);
 #endif
 
 /* ---------- Internal log macro ------------------------------------------- */
@@ -113,22 +199,22 @@ extern UART_HandleTypeDef huart1;
 
 #define _LOG_IMPL(color, level_char, level_num, tag, fmt, ...) do { \
     char _log_buf[LOG_BUF_SIZE]; \
-    /* UART: with color */ \
+    uint64_t _log_us = TIME_Micros(); \
+    uint32_t _log_ms = (uint32_t)(_log_us / 1000u); \
+    uint32_t _log_fr = (uint32_t)(_log_us % 1000u); \
+    /* One format: UART gets it all, SD skips the color codes */ \
     int _log_len = snprintf(_log_buf, LOG_BUF_SIZE, \
-        color level_char " (%lu) %s: " fmt LOG_COLOR_RESET "\r\n", \
-        HAL_GetTick(), (tag), ##__VA_ARGS__); \
+        color level_char " (%lu.%03lu) %s: " fmt "\r\n" LOG_COLOR_RESET, \
+        _log_ms, _log_fr, (tag), ##__VA_ARGS__); \
     if (_log_len > 0) { \
-        if (_log_len > LOG_BUF_SIZE - 1) _log_len = LOG_BUF_SIZE - 1; \
-        HAL_UART_Transmit(&huart1, (uint8_t*)_log_buf, (uint16_t)_log_len, HAL_MAX_DELAY); \
-    } \
-    /* SD: without color */ \
-    if ((level_num) <= LOG_SD_LEVEL) { \
-        int _sd_len = snprintf(_log_buf, LOG_BUF_SIZE, \
-            level_char " (%lu) %s: " fmt "\r\n", \
-            HAL_GetTick(), (tag), ##__VA_ARGS__); \
-        if (_sd_len > 0) { \
-            if (_sd_len > LOG_BUF_SIZE - 1) _sd_len = LOG_BUF_SIZE - 1; \
-            LOG_SD_Write(_log_buf, _sd_len); \
+        int _sd_len = _log_len - (int)(sizeof(color) - 1) - (int)(sizeof(LOG_COLOR_RESET) - 1); \
+        if (_log_len > LOG_BUF_SIZE - 1) { \
+            _log_len = LOG_BUF_SIZE - 1; \
+            _sd_len  = _log_len - (int)(sizeof(color) - 1); \
+        } \
+        LOG_TX_Write(_log_buf, _log_len); \
+        if ((level_num) <= LOG_SD_LEVEL) { \
+            LOG_SD_Write(_log_buf + sizeof(color) - 1, _sd_len); \
         } \
     } \
 } while(0)
@@ -137,12 +223,15 @@ extern UART_HandleTypeDef huart1;
 
 #define _LOG_IMPL(color, level_char, level_num, tag, fmt, ...) do { \
     char _log_buf[LOG_BUF_SIZE]; \
+    uint64_t _log_us = TIME_Micros(); \
+    uint32_t _log_ms = (uint32_t)(_log_us / 1000u); \
+    uint32_t _log_fr = (uint32_t)(_log_us % 1000u); \
     int _log_len = snprintf(_log_buf, LOG_BUF_SIZE, \
-        color level_char " (%lu) %s: " fmt LOG_COLOR_RESET "\r\n", \
-        HAL_GetTick(), (tag), ##__VA_ARGS__); \
+        color level_char " (%lu.%03lu) %s: " fmt "\r\n" LOG_COLOR_RESET, \
+        _log_ms, _log_fr, (tag), ##__VA_ARGS__); \
     if (_log_len > 0) { \
         if (_log_len > LOG_BUF_SIZE - 1) _log_len = LOG_BUF_SIZE - 1; \
-        HAL_UART_Transmit(&huart1, (uint8_t*)_log_buf, (uint16_t)_log_len, HAL_MAX_DELAY); \
+        LOG_TX_Write(_log_buf, _log_len); \
     } \
 } while(0)
 
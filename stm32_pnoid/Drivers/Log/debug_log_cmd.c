@@ -67,7 +67,9 @@ void LOG_CMD_Poll(void)
 
 /* ---------- IRQ Handler -------------------------------------------------- */
 
-void USART1_IRQHandler(void)
+#include "main.h"
+
+PNOID_FAST_CODE void USART1_IRQHandler(void)
 {
     /* Check RXNE flag (RX data register not empty) */
     if (__HAL_UART_GET_FLAG(&huart1, UART_FLAG_RXNE)) {
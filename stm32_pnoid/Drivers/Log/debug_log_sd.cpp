@@ -1,7 +1,23 @@
 /**
  * @file    debug_log_sd.cpp
- * @brief   SD card logging backend for debug_log.h
+ * @brief   SD card logging backend for debug_log.h — write-behind
  * @note    Only compiled when LOG_SD_ENABLE == 1
+ *
+ * LOG_SD_Write() (any context) only copies the line into the active half
+ * of a double buffer — a short PRIMASK section, never FatFs. When the
+ * active half is full it is handed to LOG_SD_Service() and writing moves
+ * to the other half; if that one is still waiting for the card, the bytes
+ * are dropped and counted.
+ *
+ * LOG_SD_Service() (log service / log task, low priority) writes handed-
+ * off halves with one f_write each. The halves are whole sectors and the
+ * file is padded to a sector boundary at open, so under load every write
+ * is a multi-sector transfer straight from the buffer. A half that has
+ * been waiting longer than LOG_SD_FLUSH_MS goes out partially filled;
+ * the next half is then shortened so it ends back on a sector boundary.
+ * f_sync (FAT + directory entry) runs on a byte / time policy instead of
+ * per line count. Each service call does at most one of the two, which
+ * bounds one call to a single 8-sector write or one sync.
  */
 
 #include "debug_log.h"
@@ -9,19 +25,102 @@
 #if LOG_SD_ENABLE
 
 #include "fatfs.h"
+#include "main.h"
 #include <cstring>
 
+#if PNOID_RTOS_ENABLE
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
 #ifndef LOG_SD_FILENAME
 #define LOG_SD_FILENAME  "log.txt"
 #endif
 
-#ifndef LOG_SD_SYNC_INTERVAL
-#define LOG_SD_SYNC_INTERVAL  10   /* f_sync every N writes */
+#ifndef LOG_SD_BUF_SIZE
+#define LOG_SD_BUF_SIZE       4096    /* per half, multiple of 512 */
+#endif
+
+#ifndef LOG_SD_FLUSH_MS
+#define LOG_SD_FLUSH_MS       1000    /* oldest unwritten line, max age */
+#endif
+
+#ifndef LOG_SD_SYNC_MS
+#define LOG_SD_SYNC_MS        5000    /* f_sync at least this often ... */
+#endif
+
+#ifndef LOG_SD_SYNC_BYTES
+#define LOG_SD_SYNC_BYTES     (64u * 1024u)   /* ... or after this much data */
 #endif
 
+static_assert(LOG_SD_BUF_SIZE % 512 == 0, "LOG_SD_BUF_SIZE must be whole sectors");
+
 static FIL   logFile;
-static bool  logFileOpen = false;
-static int   writeCount  = 0;
+static volatile bool logFileOpen = false;
+static volatile uint8_t inService = 0;      /* LOG_SD_Service() calls past the open check */
+
+/* Double buffer: producers fill buf[active], the service writes buf[pending] */
+alignas(32) static uint8_t buf[2][LOG_SD_BUF_SIZE];
+static uint32_t          fill[2];
+static uint32_t          cap[2];             /* usable bytes (sector realign) */
+static uint32_t          queuedEnd = 0;      /* file offset after the last hand-off */
+static volatile uint8_t  active    = 0;
+static volatile int8_t   pending   = -1;     /* half waiting for f_write */
+static uint32_t          firstMs   = 0;      /* first byte in buf[active] */
+
+static LOG_SD_Stats_t stats;
+static uint32_t       sinceSync  = 0;
+static uint32_t       lastSyncMs = 0;
+
+static inline uint32_t nowMs() { return (uint32_t)(TIME_Micros() / 1000); }
+
+/** Hand buf[active] to the service; caller holds PRIMASK */
+static inline bool handOff()
+{
+    if (pending >= 0) return false;
+    queuedEnd += fill[active];
+    pending = (int8_t)active;
+    active ^= 1;
+    fill[active] = 0;
+    cap[active]  = LOG_SD_BUF_SIZE - (queuedEnd & 511u);
+    return true;
+}
+
+/** Write one half and time it */
+static void flushPending()
+{
+    uint8_t  idx = (uint8_t)pending;
+    uint32_t len = fill[idx];
+
+    if (len > 0) {
+        uint64_t t0 = TIME_Micros();
+        UINT bw = 0;
+        if (f_write(&logFile, buf[idx], len, &bw) != FR_OK || bw != len) {
+            stats.errors++;
+            stats.droppedBytes += len - bw;
+        }
+        uint32_t us = (uint32_t)(TIME_Micros() - t0);
+        stats.lastFlushUs = us;
+        if (us > stats.maxFlushUs) stats.maxFlushUs = us;
+        stats.flushes++;
+        stats.written += bw;
+        sinceSync     += bw;
+    }
+
+    __DMB();
+    pending = -1;
+}
+
+static void syncFile()
+{
+    uint64_t t0 = TIME_Micros();
+    f_sync(&logFile);
+    uint32_t us = (uint32_t)(TIME_Micros() - t0);
+    if (us > stats.maxSyncUs) stats.maxSyncUs = us;
+    stats.syncs++;
+    sinceSync  = 0;
+    lastSyncMs = nowMs();
+}
 
 extern "C" int LOG_SD_Init(void)
 {
@@ -31,38 +130,144 @@ extern "C" int LOG_SD_Init(void)
                          FA_OPEN_APPEND | FA_WRITE);
     if (res != FR_OK) return -1;
 
-    logFileOpen = true;
-    writeCount  = 0;
+    /* Separator on each boot, padded so the file ends on a sector
+     * boundary — every later buffer write starts sector-aligned */
+    char sep[512 + 32];
+    int  n   = snprintf(sep, sizeof(sep), "\r\n===== BOOT =====");
+    uint32_t end = (uint32_t)f_size(&logFile) + (uint32_t)n + 2;
+    uint32_t pad = (512u - (end & 511u)) & 511u;
+    memset(sep + n, ' ', pad);
+    sep[n + pad]     = '\r';
+    sep[n + pad + 1] = '\n';
 
-    /* Write a separator on each boot */
-    const char *sep = "\r\n===== BOOT =====\r\n";
     UINT bw;
-    f_write(&logFile, sep, strlen(sep), &bw);
+    f_write(&logFile, sep, (UINT)(n + pad + 2), &bw);
     f_sync(&logFile);
 
+    fill[0] = fill[1] = 0;
+    cap[0]  = cap[1]  = LOG_SD_BUF_SIZE;
+    queuedEnd = (uint32_t)f_size(&logFile);
+    active  = 0;
+    pending = -1;
+    sinceSync  = 0;
+    lastSyncMs = nowMs();
+    __DMB();
+    logFileOpen = true;
+
     return 0;
 }
 
 extern "C" void LOG_SD_DeInit(void)
 {
     if (!logFileOpen) return;
+
+    /* Stop producers: LOG_SD_Write re-checks the flag under PRIMASK, so
+     * once it is clear no line can land in the buffers any more */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool wasOpen = logFileOpen;
+    logFileOpen = false;
+    __set_PRIMASK(primask);
+    if (!wasOpen) return;
+
+    /* A service call (log task) may still be inside f_write / f_sync */
+    while (inService) {
+#if PNOID_RTOS_ENABLE
+        vTaskDelay(1);
+#else
+        __NOP();
+#endif
+    }
+
+    if (pending >= 0) flushPending();
+    pending = (int8_t)active;
+    flushPending();
+
     f_sync(&logFile);
     f_close(&logFile);
-    logFileOpen = false;
 }
 
-extern "C" void LOG_SD_Write(const char *buf, int len)
+extern "C" void LOG_SD_Write(const char *line, int len)
 {
-    if (!logFileOpen || buf == nullptr || len <= 0) return;
+    if (!logFileOpen || line == nullptr || len <= 0) return;
 
-    UINT bw;
-    f_write(&logFile, buf, (UINT)len, &bw);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!logFileOpen) {                     /* DeInit since the check above */
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    const uint8_t *src  = (const uint8_t *)line;
+    uint32_t       left = (uint32_t)len;
+    while (left > 0) {
+        uint8_t  a    = active;
+        uint32_t room = cap[a] - fill[a];
+        if (room == 0) {
+            if (!handOff()) {               /* card still busy with the other half */
+                stats.droppedBytes += left;
+                break;
+            }
+            continue;
+        }
+        if (fill[a] == 0) firstMs = nowMs();
 
-    /* Periodic sync to avoid data loss on power cut */
-    if (++writeCount >= LOG_SD_SYNC_INTERVAL) {
-        f_sync(&logFile);
-        writeCount = 0;
+        uint32_t n = left < room ? left : room;
+        memcpy(&buf[a][fill[a]], src, n);
+        fill[a] += n;
+        src     += n;
+        left    -= n;
     }
+
+    __set_PRIMASK(primask);
+}
+
+extern "C" int LOG_SD_Service(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!logFileOpen) {
+        __set_PRIMASK(primask);
+        return 0;
+    }
+    inService++;
+
+    /* Time policy: push out a partly filled half that got too old */
+    if (pending < 0 && fill[active] > 0 && (nowMs() - firstMs) >= LOG_SD_FLUSH_MS) handOff();
+    __set_PRIMASK(primask);
+
+    /* One card operation per call — a half or an f_sync, never both —
+     * so the SD scheduler can put audio reads in between */
+    int busy = 0;
+
+    if (pending >= 0) {
+        flushPending();
+        busy = 1;
+    } else if (sinceSync >= LOG_SD_SYNC_BYTES
+            || (sinceSync > 0 && (nowMs() - lastSyncMs) >= LOG_SD_SYNC_MS)) {
+        syncFile();
+        busy = 1;
+    }
+
+    __disable_irq();
+    inService--;
+    __set_PRIMASK(primask);
+    return busy;
+}
+
+extern "C" int LOG_SD_Due(void)
+{
+    if (!logFileOpen) return 0;
+    if (pending >= 0) return 1;
+    if (fill[active] > 0 && (nowMs() - firstMs) >= LOG_SD_FLUSH_MS) return 1;
+    return sinceSync >= LOG_SD_SYNC_BYTES
+        || (sinceSync > 0 && (nowMs() - lastSyncMs) >= LOG_SD_SYNC_MS);
+}
+
+extern "C" void LOG_SD_GetStats(LOG_SD_Stats_t *s)
+{
+    *s = stats;
+    s->buffered = fill[0] + fill[1];
 }
 
 #endif /* LOG_SD_ENABLE */
@@ -0,0 +1,250 @@
+/**
+ * @file    debug_log_tx.c
+ * @brief   Non-blocking log output — lock-free MPSC ring drained by DMA
+ * @note    Uses huart1 (USART1) TX on DMA1 Stream 5.
+ *          Producers (any context, ISRs included) reserve space with
+ *          LDREX/STREX, copy the line and commit; they never wait for the
+ *          UART. When the ring is full the line is dropped and counted.
+ *
+ * Ring layout (LOG_TX_RING_SIZE bytes, .dma_buffer — non-cacheable, so
+ * DMA reads the payload in place):
+ *
+ *   [hdr][payload...pad][hdr][payload...pad] ... [skip hdr ......]
+ *
+ *   hdr = len | tag << 16  (one 32-bit store, written last by the producer)
+ *   tag   READY  record committed, DMA may send it
+ *         SKIP   unusable tail end of the ring, record continues at 0
+ *         0      free, or reserved but still being copied
+ *
+ * Records never wrap, so every payload is one contiguous DMA transfer.
+ * The consumer (DMA complete ISR) zeroes a record after sending it, so
+ * free space is always zero and a stale header can never look committed.
+ */
+
+#include "debug_log.h"
+#include "main.h"
+#include <string.h>
+
+/* ---------- Configuration ------------------------------------------------ */
+
+#ifndef LOG_TX_RING_SIZE
+#define LOG_TX_RING_SIZE   8192     /* bytes, power of two */
+#endif
+
+#ifndef LOG_TX_IRQ_PRIO
+#define LOG_TX_IRQ_PRIO    6        /* same as the USART1 RX interrupt */
+#endif
+
+#if (LOG_TX_RING_SIZE & (LOG_TX_RING_SIZE - 1)) != 0
+#error "LOG_TX_RING_SIZE must be a power of two"
+#endif
+
+#define RING_MASK   (LOG_TX_RING_SIZE - 1u)
+#define HDR_SIZE    4u
+#define TAG_READY   0xC0DEu
+#define TAG_SKIP    0x5A1Fu
+
+/* ---------- Internal state ----------------------------------------------- */
+
+PNOID_DMA_BUFFER static uint8_t ring[LOG_TX_RING_SIZE];
+
+static volatile uint32_t head = 0;      /* reserve position (producers)  */
+static volatile uint32_t tail = 0;      /* release position (consumer)   */
+static volatile uint32_t txLen = 0;     /* record in flight, 0 = idle    */
+static volatile uint8_t  ready = 0;     /* LOG_TX_Init done              */
+
+static volatile uint32_t statLines = 0;
+static volatile uint32_t statBytes = 0;
+static volatile uint32_t statDrops = 0;
+static volatile uint32_t statPeak  = 0;
+
+static DMA_HandleTypeDef hdmaTx;
+
+/* ---------- Helpers ------------------------------------------------------ */
+
+static inline void atomicAdd(volatile uint32_t *p, uint32_t v)
+{
+    uint32_t x;
+    do {
+        x = __LDREXW(p) + v;
+    } while (__STREXW(x, p));
+}
+
+static inline uint32_t recordSize(uint32_t len)
+{
+    return HDR_SIZE + ((len + 3u) & ~3u);
+}
+
+static inline volatile uint32_t *hdrAt(uint32_t pos)
+{
+    return (volatile uint32_t *)&ring[pos & RING_MASK];
+}
+
+/**
+ * Start the next committed record if the DMA is idle.
+ * Caller holds exclusivity (PRIMASK, or the DMA ISR itself).
+ */
+static void txStart(void)
+{
+    if (txLen != 0 || !ready) return;
+
+    while (tail != head) {
+        uint32_t hdr = *hdrAt(tail);
+        uint32_t tag = hdr >> 16;
+
+        if (tag == TAG_SKIP) {
+            uint32_t skip = LOG_TX_RING_SIZE - (tail & RING_MASK);
+            *hdrAt(tail) = 0;           /* rest of the skip area is already 0 */
+            __DMB();
+            tail += skip;
+            continue;
+        }
+        if (tag != TAG_READY) return;   /* oldest record still being copied */
+
+        txLen = hdr & 0xFFFFu;
+        if (HAL_DMA_Start_IT(&hdmaTx, (uint32_t)&ring[(tail & RING_MASK) + HDR_SIZE],
+                             (uint32_t)&huart1.Instance->TDR, txLen) != HAL_OK) {
+            txLen = 0;                  /* retried on the next kick */
+        }
+        return;
+    }
+}
+
+/** Drop the record that just went out and start the next one */
+static void txDone(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    uint32_t size = recordSize(txLen);
+    memset(&ring[tail & RING_MASK], 0, size);
+    __DMB();                            /* zeroed before producers can reuse it */
+    tail += size;
+    txLen = 0;
+    txStart();
+}
+
+static void kick(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    txStart();
+    __set_PRIMASK(primask);
+}
+
+/* ---------- Public API --------------------------------------------------- */
+
+void LOG_TX_Init(void)
+{
+    if (ready) return;
+
+    memset(ring, 0, sizeof(ring));      /* .dma_buffer is not zeroed at startup */
+
+    /* DMA1 clock is enabled by MX_DMA_Init */
+    hdmaTx.Instance                 = DMA1_Stream5;
+    hdmaTx.Init.Request             = DMA_REQUEST_USART1_TX;
+    hdmaTx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+    hdmaTx.Init.PeriphInc           = DMA_PINC_DISABLE;
+    hdmaTx.Init.MemInc              = DMA_MINC_ENABLE;
+    hdmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdmaTx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    hdmaTx.Init.Mode                = DMA_NORMAL;
+    hdmaTx.Init.Priority            = DMA_PRIORITY_LOW;
+    hdmaTx.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdmaTx) != HAL_OK) return;    /* stays in drop mode */
+
+    hdmaTx.XferCpltCallback  = txDone;
+    hdmaTx.XferErrorCallback = txDone;  /* lose the line, keep draining */
+
+    HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, LOG_TX_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+
+    /* Optional faster console: reprogram BRR, leave the rest of MX init */
+    if (huart1.Init.BaudRate != LOG_UART_BAUD) {
+        while (!__HAL_UART_GET_FLAG(&huart1, UART_FLAG_TC)) {}
+        __HAL_UART_DISABLE(&huart1);
+        huart1.Instance->BRR = (HAL_RCC_GetPCLK2Freq() + LOG_UART_BAUD / 2u) / LOG_UART_BAUD;
+        huart1.Init.BaudRate = LOG_UART_BAUD;
+        __HAL_UART_ENABLE(&huart1);
+    }
+
+    /* USART1 TX requests go to the DMA; RX stays on RXNE (debug_log_cmd.c) */
+    SET_BIT(huart1.Instance->CR3, USART_CR3_DMAT);
+
+    ready = 1;
+}
+
+void LOG_TX_Write(const char *buf, int len)
+{
+    if (len <= 0) return;
+    if (!ready) {
+        atomicAdd(&statDrops, 1);
+        return;
+    }
+
+    uint32_t size = recordSize((uint32_t)len);
+    uint32_t h, pos, pad;
+
+    /* Reserve: pad to the ring end if the record would straddle it */
+    do {
+        h   = __LDREXW(&head);
+        pad = LOG_TX_RING_SIZE - (h & RING_MASK);
+        if (pad >= size) pad = 0;
+        if (h + pad + size - tail > LOG_TX_RING_SIZE) {
+            __CLREX();
+            atomicAdd(&statDrops, 1);
+            return;
+        }
+    } while (__STREXW(h + pad + size, &head));
+
+    pos = h + pad;
+    if (pad) *hdrAt(h) = TAG_SKIP << 16;
+
+    uint32_t used = pos + size - tail;
+    if (used > statPeak) statPeak = used;           /* approximate under races */
+
+    memcpy(&ring[(pos & RING_MASK) + HDR_SIZE], buf, (uint32_t)len);
+    __DMB();                                        /* payload before commit */
+    *hdrAt(pos) = (uint32_t)len | (TAG_READY << 16);
+
+    atomicAdd(&statLines, 1);
+    atomicAdd(&statBytes, (uint32_t)len);
+    kick();
+}
+
+int LOG_TX_Flush(uint32_t timeoutMs)
+{
+    if (!ready) return -1;
+
+    uint32_t start  = DWT->CYCCNT;
+    uint32_t budget = timeoutMs * 1000u * TIME_CyclesPerUs();
+
+    while (tail != head) {
+        if ((DWT->CYCCNT - start) > budget) return -1;
+
+        /* Poll the stream too, so this also works with interrupts masked
+         * (Error_Handler) or from an ISR that outranks the DMA interrupt */
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        HAL_DMA_IRQHandler(&hdmaTx);
+        txStart();
+        __set_PRIMASK(primask);
+    }
+    return 0;
+}
+
+void LOG_TX_GetStats(LOG_TX_Stats_t *s)
+{
+    s->lines = statLines;
+    s->bytes = statBytes;
+    s->drops = statDrops;
+    s->used  = head - tail;
+    s->peak  = statPeak;
+    s->size  = LOG_TX_RING_SIZE;
+    s->baud  = huart1.Init.BaudRate;
+}
+
+/* ---------- IRQ Handler -------------------------------------------------- */
+
+void DMA1_Stream5_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdmaTx);
+}
@@ -0,0 +1,150 @@
+/**
+ * @file    trace.c
+ * @brief   Deferred binary trace ring — see trace.h
+ * @note    Same reservation scheme as the UART log ring (debug_log_tx.c),
+ *          in 32-bit words: LDREX/STREX reserve, header stored last as the
+ *          commit, consumer zeroes what it has read so free space is 0.
+ *          Records never wrap; a skip header pads the end of the ring.
+ */
+
+#include "trace.h"
+#include "debug_log.h"
+#include "main.h"
+
+/* ---------- Configuration ------------------------------------------------ */
+
+#if (TRACE_RING_WORDS & (TRACE_RING_WORDS - 1)) != 0
+#error "TRACE_RING_WORDS must be a power of two"
+#endif
+
+#define RING_MASK     (TRACE_RING_WORDS - 1u)
+#define HDR_WORDS     2u                  /* header + timestamp */
+#define MAGIC_REC     0xA5u
+#define MAGIC_SKIP    0x5Au
+#define HDR(id, m, n) (((uint32_t)(id) << 16) | ((uint32_t)(m) << 8) | (uint32_t)(n))
+
+/* ---------- Internal state ----------------------------------------------- */
+
+static uint32_t ring[TRACE_RING_WORDS];
+
+static volatile uint32_t head = 0;      /* reserve position (producers)  */
+static volatile uint32_t tail = 0;      /* release position (consumer)   */
+
+static volatile uint32_t statRecords = 0;
+static volatile uint32_t statDrops   = 0;
+static volatile uint32_t statPeak    = 0;
+static uint32_t          dropsSent   = 0;   /* consumer side */
+
+/* ---------- Helpers ------------------------------------------------------ */
+
+static inline void atomicAdd(volatile uint32_t *p, uint32_t v)
+{
+    uint32_t x;
+    do {
+        x = __LDREXW(p) + v;
+    } while (__STREXW(x, p));
+}
+
+/* ---------- Producer ----------------------------------------------------- */
+
+PNOID_FAST_CODE void TRACE_Write(uint32_t id, const uint32_t *args, uint32_t n)
+{
+    uint32_t size = HDR_WORDS + n;
+    uint32_t h, pos, pad;
+
+    do {
+        h   = __LDREXW(&head);
+        pad = TRACE_RING_WORDS - (h & RING_MASK);
+        if (pad >= size) pad = 0;
+        if (h + pad + size - tail > TRACE_RING_WORDS) {
+            __CLREX();
+            atomicAdd(&statDrops, 1);
+            return;
+        }
+    } while (__STREXW(h + pad + size, &head));
+
+    pos = h + pad;
+    if (pad) ring[h & RING_MASK] = HDR(0, MAGIC_SKIP, 0);
+
+    uint32_t used = pos + size - tail;
+    if (used > statPeak) statPeak = used;           /* approximate under races */
+
+    uint32_t *w = &ring[pos & RING_MASK];
+    w[1] = (uint32_t)TIME_Micros();
+    for (uint32_t i = 0; i < n; i++) w[HDR_WORDS + i] = args[i];
+    __DMB();                                        /* body before commit */
+    w[0] = HDR(id, MAGIC_REC, n);
+
+    atomicAdd(&statRecords, 1);
+}
+
+/* ---------- Consumer ----------------------------------------------------- */
+
+uint32_t TRACE_Drain(uint8_t *buf, uint32_t size)
+{
+    uint32_t out = 0;
+
+    /* Lost records first, so the decoder shows the gap where it happened */
+    uint32_t drops = statDrops;
+    if (drops != dropsSent && size >= 4u * (HDR_WORDS + 1)) {
+        uint32_t rec[3] = { HDR(TRACE_ID_DROPS, MAGIC_REC, 1),
+                            (uint32_t)TIME_Micros(), drops - dropsSent };
+        memcpy(buf, rec, sizeof(rec));
+        out += sizeof(rec);
+        dropsSent = drops;
+    }
+
+    while (tail != head) {
+        uint32_t *w   = &ring[tail & RING_MASK];
+        uint32_t  hdr = *(volatile uint32_t *)w;
+        uint32_t  magic = (hdr >> 8) & 0xFFu;
+
+        if (magic == MAGIC_SKIP) {
+            *w = 0;
+            __DMB();
+            tail += TRACE_RING_WORDS - (tail & RING_MASK);
+            continue;
+        }
+        if (magic != MAGIC_REC) break;              /* still being written */
+
+        uint32_t bytes = 4u * (HDR_WORDS + (hdr & 0xFFu));
+        if (out + bytes > size) break;
+
+        __DMB();
+        memcpy(buf + out, w, bytes);
+        memset(w, 0, bytes);
+        __DMB();                                    /* zeroed before reuse */
+        tail += bytes / 4u;
+        out  += bytes;
+    }
+    return out;
+}
+
+void TRACE_Pump(uint32_t maxLines)
+{
+    static const char HEX[] = "0123456789ABCDEF";
+    uint8_t bin[48];
+    char    line[3 + 2 * sizeof(bin) + 2];
+
+    while (maxLines--) {
+        uint32_t n = TRACE_Drain(bin, sizeof(bin));
+        if (n == 0) return;
+
+        char *p = line;
+        *p++ = '#'; *p++ = 'T'; *p++ = ' ';
+        for (uint32_t i = 0; i < n; i++) {
+            *p++ = HEX[bin[i] >> 4];
+            *p++ = HEX[bin[i] & 0x0F];
+        }
+        *p++ = '\r'; *p++ = '\n';
+        LOG_TX_Write(line, (int)(p - line));
+    }
+}
+
+void TRACE_GetStats(TRACE_Stats_t *s)
+{
+    s->records = statRecords;
+    s->drops   = statDrops;
+    s->used    = head - tail;
+    s->peak    = statPeak;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file trace.h
+ * @brief Deferred binary trace — format IDs + raw arguments, decoded on the host
+ *
+ * Usage:
+ *   TRACE("tick dt=%lu roll=%f pitch=%f", dtUs, roll, pitch);
+ *
+ * A call site stores only a record in a RAM ring:
+ *
+ *   word 0   id << 16 | 0xA5 << 8 | nargs
+ *   word 1   timestamp, low 32 bits of TIME_Micros()
+ *   word 2+  arguments, one 32-bit word each (floats as IEEE bits)
+ *
+ * The id is the offset of the format string in the .trace_fmt section,
+ * which the linker keeps in the ELF but never loads (INFO, address 0).
+ * No formatting happens on the target: a call is a reservation, a few
+ * stores and a commit, cheap enough for the control tick.
+ *
+ * TRACE_Pump() (log service, low priority) moves committed records to the
+ * console as "#T <hex>" lines through the DMA log ring. On the host:
+ *   python3 scripts/trace_decode.py build/stm32_pnoid.elf console.txt
+ * rebuilds the text from the ELF format strings.
+ *
+ * Arguments: up to 6 integers, chars or floats (%d %u %x %c %f ...).
+ * %s is decoded only for strings in flash (.rodata); cast other pointers
+ * to uint32_t and print them with %x.
+ *
+ * Config:
+ *   #define TRACE_ENABLE        1     -- 0 compiles every TRACE() away
+ *   #define TRACE_RING_WORDS    1024  -- ring size (power of two)
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE  1
+#endif
+
+#ifndef TRACE_RING_WORDS
+#define TRACE_RING_WORDS  1024
+#endif
+
+#define TRACE_MAX_ARGS    6
+#define TRACE_ID_DROPS    0xFFFFu   /* synthetic record: arg 0 = lines lost */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------- API ---------------------------------------------------------- */
+
+typedef struct {
+    uint32_t records;   /* committed since boot              */
+    uint32_t drops;     /* lost to a full ring               */
+    uint32_t used;      /* words waiting now                 */
+    uint32_t peak;      /* most words ever waiting           */
+} TRACE_Stats_t;
+
+/**
+ * @brief  Append one record (used internally by TRACE)
+ * @param  id    Format string address in .trace_fmt
+ * @param  args  Argument words
+ * @param  n     Number of arguments (0..TRACE_MAX_ARGS)
+ * @note   Any context, lock-free, never blocks — drops when full.
+ */
+void TRACE_Write(uint32_t id, const uint32_t *args, uint32_t n);
+
+/**
+ * @brief  Copy whole committed records out of the ring
+ * @param  buf   Destination
+ * @param  size  Bytes available (at least 4 · (2 + TRACE_MAX_ARGS))
+ * @retval Bytes copied (0 when empty)
+ * @note   Single consumer. Reports drops as a TRACE_ID_DROPS record.
+ */
+uint32_t TRACE_Drain(uint8_t *buf, uint32_t size);
+
+/**
+ * @brief  Drain up to `maxLines` "#T <hex>" lines into the console log
+ * @note   Call from the log service, not from the control path.
+ */
+void TRACE_Pump(uint32_t maxLines);
+
+void TRACE_GetStats(TRACE_Stats_t *s);
+
+/* ---------- Argument packing --------------------------------------------- */
+
+static inline uint32_t _trace_f(double v)
+{
+    float f = (float)v;
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+/* Never called: lets the compiler check the format against the arguments */
+static inline void __attribute__((format(printf, 1, 2))) _trace_check(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+#ifdef __cplusplus
+}
+
+inline uint32_t _trace_arg(float v)  { return _trace_f(v); }
+inline uint32_t _trace_arg(double v) { return _trace_f(v); }
+template <typename T>
+inline uint32_t _trace_arg(T v)      { return (uint32_t)v; }
+
+#define TRACE_ARG(x)  _trace_arg(x)
+#else
+static inline uint32_t _trace_u(uint32_t v) { return v; }
+
+#define TRACE_ARG(x)  _Generic((x), float: _trace_f, double: _trace_f, default: _trace_u)(x)
+#endif
+
+/* ---------- Internal macros ---------------------------------------------- */
+
+#define _TR_NARG(...)   _TR_NARG_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define _TR_NARG_(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+
+#define _TR_CAT(a, b)   _TR_CAT_(a, b)
+#define _TR_CAT_(a, b)  a##b
+
+#define _TR_A0()
+#define _TR_A1(a)                 , TRACE_ARG(a)
+#define _TR_A2(a, b)              _TR_A1(a) _TR_A1(b)
+#define _TR_A3(a, b, c)           _TR_A2(a, b) _TR_A1(c)
+#define _TR_A4(a, b, c, d)        _TR_A3(a, b, c) _TR_A1(d)
+#define _TR_A5(a, b, c, d, e)     _TR_A4(a, b, c, d) _TR_A1(e)
+#define _TR_A6(a, b, c, d, e, f)  _TR_A5(a, b, c, d, e) _TR_A1(f)
+
+#define _TR_ARGS(...)   _TR_CAT(_TR_A, _TR_NARG(__VA_ARGS__))(__VA_ARGS__)
+
+/* ---------- Public macro ------------------------------------------------- */
+
+#if TRACE_ENABLE
+
+#define TRACE(fmt, ...) do { \
+    static const char _tr_fmt[] __attribute__((section(".trace_fmt"), used)) = fmt; \
+    if (0) _trace_check(fmt, ##__VA_ARGS__); \
+    const uint32_t _tr_a[] = { 0u _TR_ARGS(__VA_ARGS__) }; \
+    TRACE_Write((uint32_t)_tr_fmt, _tr_a + 1, _TR_NARG(__VA_ARGS__)); \
+} while (0)
+
+#else
+
+#define TRACE(fmt, ...) do { if (0) _trace_check(fmt, ##__VA_ARGS__); } while (0)
+
+#endif /* TRACE_ENABLE */
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,156 @@
+/**
+ * @file    mem_guard.c
+ * @brief   Heap lock and heap / stack watermark implementation
+ */
+
+#include "mem_guard.h"
+#include "main.h"
+#include "debug_log.h"
+#include <malloc.h>
+
+static const char *TAG = "MEM";
+
+/* Linker script symbols (main stack bounds, heap region) */
+extern uint8_t _sstack;
+extern uint8_t _estack;
+extern uint8_t _end;
+extern uint8_t _heap_limit;
+
+extern void *_sbrk(ptrdiff_t incr);
+
+/* ---------- Internal state ----------------------------------------------- */
+
+typedef struct {
+    const char *name;
+    uint32_t   *base;
+    uint32_t    words;
+} StackEntry_t;
+
+static volatile uint8_t  heapLocked = 0;
+static volatile uint8_t  heapExempt = 0;   /* mallinfo() takes the malloc lock */
+static volatile uint32_t violations = 0;
+static const void       *lastCaller = NULL;
+static const void *volatile allocCaller = NULL;   /* operator new / delete */
+
+static StackEntry_t stacks[MEM_MAX_STACKS];
+static int          stackCount = 0;
+
+/* ---------- Heap --------------------------------------------------------- */
+
+void MEM_HeapLock(void)
+{
+    heapLocked = 1;
+}
+
+int MEM_HeapLocked(void)
+{
+    return heapLocked && !heapExempt;
+}
+
+void MEM_AllocCaller(const void *caller)
+{
+    allocCaller = caller;
+}
+
+void MEM_HeapViolation(void)
+{
+    violations++;
+    lastCaller = allocCaller;
+
+#if PNOID_ALLOC_FREE
+    /* Stop at the offending call when debugging, otherwise fail hard */
+    if (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk) {
+        __BKPT(0);
+    }
+    Error_Handler();
+#endif
+}
+
+void MEM_GetHeapStats(MEM_HeapStats_t *out)
+{
+    uint8_t *brk = (uint8_t *)_sbrk(0);
+
+    heapExempt = 1;
+    struct mallinfo mi = mallinfo();
+    heapExempt = 0;
+
+    out->sbrkUsed   = (uint32_t)(brk - &_end);
+    out->sbrkLimit  = (uint32_t)(&_heap_limit - &_end);
+    out->inUse      = (uint32_t)mi.uordblks;
+    out->violations = violations;
+    out->lastCaller = lastCaller;
+    out->locked     = heapLocked;
+}
+
+/* ---------- Stacks ------------------------------------------------------- */
+
+int MEM_StackRegister(const char *name, void *base, uint32_t size)
+{
+    if (stackCount >= MEM_MAX_STACKS) return -1;
+
+    StackEntry_t *e = &stacks[stackCount];
+    e->name  = name;
+    e->base  = (uint32_t *)(((uintptr_t)base + 3u) & ~(uintptr_t)3u);
+    e->words = size / 4u;
+
+    for (uint32_t i = 0; i < e->words; i++) {
+        e->base[i] = MEM_STACK_PATTERN;
+    }
+    return stackCount++;
+}
+
+void MEM_Init(void)
+{
+    /* The main stack is live: paint only up to just below the current SP */
+    uint32_t *bottom = (uint32_t *)&_sstack;
+    uint32_t *sp     = (uint32_t *)(__get_MSP() - 64u);
+    for (uint32_t *p = bottom; p < sp; p++) {
+        *p = MEM_STACK_PATTERN;
+    }
+
+    if (stackCount < MEM_MAX_STACKS) {
+        StackEntry_t *e = &stacks[stackCount++];
+        e->name  = "main";
+        e->base  = bottom;
+        e->words = (uint32_t)(&_estack - &_sstack) / 4u;
+    }
+}
+
+int MEM_StackCount(void)
+{
+    return stackCount;
+}
+
+int MEM_GetStackStats(int idx, MEM_StackStats_t *out)
+{
+    if (idx < 0 || idx >= stackCount) return 0;
+
+    const StackEntry_t *e = &stacks[idx];
+    uint32_t untouched = 0;
+    while (untouched < e->words && e->base[untouched] == MEM_STACK_PATTERN) {
+        untouched++;
+    }
+
+    out->name    = e->name;
+    out->size    = e->words * 4u;
+    out->minFree = untouched * 4u;
+    return 1;
+}
+
+/* ---------- Report ------------------------------------------------------- */
+
+void MEM_Report(void)
+{
+    MEM_HeapStats_t h;
+    MEM_GetHeapStats(&h);
+    LOGI(TAG, "heap: peak %lu / %lu B, in use %lu B, %s, violations %lu (last %p)",
+         h.sbrkUsed, h.sbrkLimit, h.inUse,
+         h.locked ? "locked" : "open", h.violations, h.lastCaller);
+
+    for (int i = 0; i < stackCount; i++) {
+        MEM_StackStats_t s;
+        MEM_GetStackStats(i, &s);
+        LOGI(TAG, "stack %-8s: %lu / %lu B used (min free %lu B)",
+             s.name, s.size - s.minFree, s.size, s.minFree);
+    }
+}
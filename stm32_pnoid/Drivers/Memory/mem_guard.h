@@ -0,0 +1,116 @@
+/**
+ * @file    mem_guard.h
+ * @brief   Heap lock (allocation-free mode) and heap / stack watermarks
+ *
+ * Allocation-free mode (PNOID_ALLOC_FREE, main.h):
+ *   All dynamic memory is obtained during App::init(); MEM_HeapLock() is
+ *   called at its end. From then on any malloc / free / realloc / new (all
+ *   go through __malloc_lock) and any _sbrk growth is a violation:
+ *     PNOID_ALLOC_FREE = 1   trap — breakpoint if a debugger is attached,
+ *                            then Error_Handler()
+ *     PNOID_ALLOC_FREE = 0   count and remember the caller only
+ *   Drivers size their buffers statically (members / .bss).
+ *
+ *   The caller is the call site of operator new / delete (mem_new.cpp
+ *   records it before entering malloc). __malloc_lock itself only sees
+ *   newlib internals, so a plain malloc() from C is reported as NULL.
+ *
+ * Watermarks:
+ *   Heap   _sbrk high-water mark (newlib never returns memory, so the
+ *          current break is the peak) and bytes in use (mallinfo)
+ *   Stack  each registered stack is painted with a pattern; the untouched
+ *          bytes left at its bottom are its minimum free space so far.
+ *          The main (MSP) stack is registered by MEM_Init(); tasks add
+ *          their own with MEM_StackRegister().
+ *
+ * MEM_Report() prints everything — bound to the "mem" shell command.
+ */
+
+#ifndef MEM_GUARD_H_
+#define MEM_GUARD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------- Configuration ------------------------------------------------ */
+
+#ifndef MEM_MAX_STACKS
+#define MEM_MAX_STACKS      8
+#endif
+
+#define MEM_STACK_PATTERN   0xA5A5A5A5UL
+
+/* ---------- Types -------------------------------------------------------- */
+
+typedef struct {
+    uint32_t sbrkUsed;      /* bytes taken from the heap region (= peak) */
+    uint32_t sbrkLimit;     /* heap region size                          */
+    uint32_t inUse;         /* bytes currently allocated (mallinfo)      */
+    uint32_t violations;    /* heap use after MEM_HeapLock()             */
+    const void *lastCaller; /* new / delete call site, NULL = C malloc   */
+    uint8_t  locked;
+} MEM_HeapStats_t;
+
+typedef struct {
+    const char *name;
+    uint32_t size;          /* bytes               */
+    uint32_t minFree;       /* untouched bytes     */
+} MEM_StackStats_t;
+
+/* ---------- Public API --------------------------------------------------- */
+
+/**
+ * @brief  Paint the free part of the main stack and register it
+ * @note   Call early in App::init(), before the stack has grown deep.
+ */
+void MEM_Init(void);
+
+/**
+ * @brief  Forbid heap use from now on (end of App::init())
+ */
+void MEM_HeapLock(void);
+
+/** Non-zero once MEM_HeapLock() ran */
+int MEM_HeapLocked(void);
+
+/**
+ * @brief  Called by __malloc_lock / _sbrk when the heap is locked
+ * @note   Attributed to the call site set by MEM_AllocCaller(), if any
+ */
+void MEM_HeapViolation(void);
+
+/**
+ * @brief  Call site of the allocation about to enter malloc / free
+ * @note   Set by the operator new / delete wrappers, NULL afterwards.
+ *         Best effort with RTOS preemption between the two.
+ */
+void MEM_AllocCaller(const void *caller);
+
+void MEM_GetHeapStats(MEM_HeapStats_t *out);
+
+/**
+ * @brief  Paint and register a stack (task stacks)
+ * @param  base  Lowest address of the stack
+ * @param  size  Bytes
+ * @retval Index for MEM_GetStackStats(), -1 if the table is full
+ */
+int MEM_StackRegister(const char *name, void *base, uint32_t size);
+
+/** Number of registered stacks */
+int MEM_StackCount(void);
+
+/** Watermark of stack `idx`; returns 0 if idx is out of range */
+int MEM_GetStackStats(int idx, MEM_StackStats_t *out);
+
+/** Log heap and stack watermarks (debug UART) */
+void MEM_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_GUARD_H_ */
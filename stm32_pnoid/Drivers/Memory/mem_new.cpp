@@ -0,0 +1,79 @@
+/**
+ * @file    mem_new.cpp
+ * @brief   Global operator new / delete that record their call site
+ * @note    Same allocation as the toolchain's (malloc / free); the call
+ *          site lets MEM_HeapViolation() name the code that allocated
+ *          after MEM_HeapLock(), which __malloc_lock cannot see.
+ */
+
+#include "mem_guard.h"
+#include "main.h"
+#include <cstdlib>
+#include <new>
+
+/* ---------- Helpers ------------------------------------------------------ */
+
+static void *allocFrom(std::size_t n, const void *caller)
+{
+    MEM_AllocCaller(caller);
+    void *p = malloc(n ? n : 1);
+    MEM_AllocCaller(nullptr);
+    if (p == nullptr) Error_Handler();      // no exceptions: new never returns null
+    return p;
+}
+
+static void freeFrom(void *p, const void *caller)
+{
+    if (p == nullptr) return;
+    MEM_AllocCaller(caller);
+    free(p);
+    MEM_AllocCaller(nullptr);
+}
+
+/* ---------- Replacements ------------------------------------------------- */
+
+void *operator new(std::size_t n)
+{
+    return allocFrom(n, __builtin_return_address(0));
+}
+
+void *operator new[](std::size_t n)
+{
+    return allocFrom(n, __builtin_return_address(0));
+}
+
+void *operator new(std::size_t n, const std::nothrow_t &) noexcept
+{
+    MEM_AllocCaller(__builtin_return_address(0));
+    void *p = malloc(n ? n : 1);
+    MEM_AllocCaller(nullptr);
+    return p;
+}
+
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept
+{
+    MEM_AllocCaller(__builtin_return_address(0));
+    void *p = malloc(n ? n : 1);
+    MEM_AllocCaller(nullptr);
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    freeFrom(p, __builtin_return_address(0));
+}
+
+void operator delete[](void *p) noexcept
+{
+    freeFrom(p, __builtin_return_address(0));
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    freeFrom(p, __builtin_return_address(0));
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    freeFrom(p, __builtin_return_address(0));
+}
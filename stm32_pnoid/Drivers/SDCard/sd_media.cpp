@@ -0,0 +1,275 @@
+/**
+ * @file    sd_media.cpp
+ * @brief   SDCard::MediaIndex — open asset files with cached fast-seek maps
+ * @note    Needs _USE_FASTSEEK. Each open file costs one FIL (~560 B) and
+ *          one _FS_LOCK slot.
+ *
+ * Without a map, f_lseek follows the FAT chain from the start of the file:
+ * one get_fat per cluster, i.e. a FAT sector read every 128 clusters, so a
+ * jump to the end of a 100 MB clip can cost tens of sector reads. With
+ * the cluster link map table (CLMT: [size, (run length, start cluster)...,
+ * 0]) the cluster is found by walking the runs in RAM — one entry for a
+ * contiguous file — and only the data sectors are read.
+ *
+ * All maps share one pool; it is rebuilt whenever the set of open files
+ * changes. A file whose map does not fit stays usable with linear seeks.
+ *
+ * ReadAhead keeps a ring of chunks of one file queued on the SD
+ * scheduler's audio class, so playback reads overtake telemetry and log
+ * work instead of calling read() from the consumer's task.
+ */
+
+#include "sdcard.hpp"
+#include "fatfs.h"
+#include "timebase.h"
+#include "debug_log.h"
+#include <cstring>
+
+static const char *TAG = "SDMEDIA";
+
+/* ---------- Maps --------------------------------------------------------- */
+
+void SDCard::MediaIndex::buildMaps()
+{
+    poolUsed_ = 0;
+
+    for (Entry &e : files_) {
+        if (!e.used || !e.open) continue;
+
+        e.clmt      = nullptr;
+        e.fil.cltbl = nullptr;
+
+        uint32_t avail = POOL_WORDS - poolUsed_;
+        if (avail < 4) {
+            LOGW(TAG, "%s: CLMT pool full, linear seeks", e.path);
+            continue;
+        }
+
+        DWORD *tbl = &pool_[poolUsed_];
+        tbl[0]      = avail;
+        e.fil.cltbl = tbl;
+        FRESULT res = f_lseek(&e.fil, CREATE_LINKMAP);
+        if (res != FR_OK) {
+            /* FR_NOT_ENOUGH_CORE leaves the required size in tbl[0] */
+            LOGW(TAG, "%s: CLMT needs %lu words, %lu free — linear seeks",
+                 e.path, (uint32_t)tbl[0], avail);
+            e.fil.cltbl = nullptr;
+            continue;
+        }
+
+        e.clmt      = tbl;
+        poolUsed_  += tbl[0];
+    }
+}
+
+/* ---------- Public API --------------------------------------------------- */
+
+int SDCard::MediaIndex::add(const char *path)
+{
+    if (strlen(path) >= PATH_LEN) return -1;
+
+    int h = -1;
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (files_[i].used && strcmp(files_[i].path, path) == 0) return i;
+        if (!files_[i].used && h < 0) h = i;
+    }
+    if (h < 0) {
+        LOGW(TAG, "Index full (%d files)", MAX_FILES);
+        return -1;
+    }
+
+    Entry &e = files_[h];
+    strcpy(e.path, path);
+    e.clmt = nullptr;
+
+    FRESULT res = f_open(&e.fil, path, FA_READ);
+    if (res == FR_NOT_ENABLED || res == FR_NOT_READY) {
+        e.used = true;                      /* not mounted yet: opened by reopenAll() */
+        e.open = false;
+        return h;
+    }
+    if (res != FR_OK) {
+        LOGW(TAG, "%s: open failed (FRESULT=%d)", path, (int)res);
+        return -1;
+    }
+
+    e.used = true;
+    e.open = true;
+    buildMaps();
+
+    LOGI(TAG, "%s: %lu B, %lu fragment(s)", path,
+         (uint32_t)f_size(&e.fil), fragments(h));
+    return h;
+}
+
+void SDCard::MediaIndex::remove(int h)
+{
+    if (h < 0 || h >= MAX_FILES || !files_[h].used) return;
+
+    Entry &e = files_[h];
+    if (e.open) f_close(&e.fil);
+    e.used = false;
+    e.open = false;
+    buildMaps();                            /* compact the pool */
+}
+
+SDCard::Status SDCard::MediaIndex::read(int h, uint32_t offset, void *dst,
+                                        uint32_t len, uint32_t *bytesRead)
+{
+    if (bytesRead) *bytesRead = 0;
+    if (!valid(h)) return Status::ErrNotMounted;
+
+    FIL &fil = files_[h].fil;
+    if (f_lseek(&fil, offset) != FR_OK) return Status::ErrRead;
+
+    UINT br = 0;
+    if (f_read(&fil, dst, len, &br) != FR_OK) return Status::ErrRead;
+    if (bytesRead) *bytesRead = br;
+    return Status::OK;
+}
+
+uint32_t SDCard::MediaIndex::size(int h) const
+{
+    return valid(h) ? (uint32_t)f_size(&files_[h].fil) : 0;
+}
+
+uint32_t SDCard::MediaIndex::fragments(int h) const
+{
+    if (!valid(h) || files_[h].clmt == nullptr) return 0;
+    return (files_[h].clmt[0] - 2) / 2;
+}
+
+void SDCard::MediaIndex::setFastSeek(int h, bool on)
+{
+    if (!valid(h)) return;
+    files_[h].fil.cltbl = on ? files_[h].clmt : nullptr;
+}
+
+void SDCard::MediaIndex::reopenAll()
+{
+    for (Entry &e : files_) {
+        if (!e.used || e.open) continue;
+        if (f_open(&e.fil, e.path, FA_READ) == FR_OK) {
+            e.open = true;
+        } else {
+            LOGW(TAG, "%s: missing after mount", e.path);
+        }
+    }
+    buildMaps();
+}
+
+void SDCard::MediaIndex::closeAll()
+{
+    for (Entry &e : files_) {
+        if (!e.open) continue;
+        f_close(&e.fil);
+        e.open = false;
+        e.clmt = nullptr;
+    }
+    poolUsed_ = 0;
+}
+
+/* ---------- ReadAhead ---------------------------------------------------- */
+
+SDCard::ReadAhead::ReadAhead(MediaIndex &media, SDScheduler &sched,
+                             uint8_t *buf, uint32_t chunkSize, uint32_t chunks)
+    : media_(media), sched_(sched),
+      chunks_(chunks < MAX_CHUNKS ? chunks : MAX_CHUNKS), chunkSize_(chunkSize)
+{
+    for (uint32_t i = 0; i < chunks_; i++) {
+        Chunk &c     = chunk_[i];
+        c.owner      = this;
+        c.data       = buf + i * chunkSize;
+        c.req.op     = SDScheduler::Op::Job;
+        c.req.stream = SDScheduler::Stream::Audio;
+        c.req.job    = fillJob;
+        c.req.done   = fillDone;
+        c.req.ctx    = &c;
+    }
+}
+
+SDCard::Status SDCard::ReadAhead::start(int h, uint32_t offset, uint32_t bytesPerSec)
+{
+    if (!idle() || chunks_ == 0 || bytesPerSec == 0) return Status::ErrRead;
+    if (media_.size(h) == 0) return Status::ErrNotMounted;
+
+    h_       = h;
+    base_    = offset;
+    next_    = offset;
+    bps_     = bytesPerSec;
+    head_    = 0;
+    error_   = false;
+    stopped_ = false;
+    startUs_ = TIME_Micros();
+
+    for (uint32_t i = 0; i < chunks_; i++) queue(chunk_[i]);
+    return Status::OK;
+}
+
+/** Point c at the next offset and queue its read, due when the consumer gets there */
+void SDCard::ReadAhead::queue(Chunk &c)
+{
+    c.ready  = false;
+    c.offset = next_;
+    c.len    = 0;
+    next_   += chunkSize_;
+
+    if (c.offset >= media_.size(h_)) {
+        c.ready = true;                     /* past the end: no read */
+        return;
+    }
+    c.req.deadlineUs = startUs_ + (uint64_t)(c.offset - base_) * 1000000u / bps_;
+    sched_.submit(c.req);
+}
+
+bool SDCard::ReadAhead::fillJob(void *ctx)
+{
+    Chunk     &c    = *static_cast<Chunk *>(ctx);
+    ReadAhead &self = *c.owner;
+    bool       ok   = true;
+
+    if (!self.stopped_) {
+        uint32_t br = 0;
+        ok    = self.media_.read(self.h_, c.offset, c.data, self.chunkSize_, &br) == Status::OK;
+        c.len = ok ? br : 0;
+        if (!ok) self.error_ = true;
+    }
+    return ok;
+}
+
+/** Published only here: the request is no longer queued, pop() may resubmit it */
+void SDCard::ReadAhead::fillDone(void *ctx, bool)
+{
+    Chunk &c = *static_cast<Chunk *>(ctx);
+    __DMB();
+    c.ready = true;
+}
+
+const uint8_t *SDCard::ReadAhead::front(uint32_t &len) const
+{
+    const Chunk &c = chunk_[head_];
+    if (!c.ready) return nullptr;
+    len = c.len;
+    return c.data;
+}
+
+void SDCard::ReadAhead::pop()
+{
+    Chunk &c = chunk_[head_];
+    head_ = (head_ + 1) % chunks_;
+    if (stopped_) return;
+    queue(c);
+}
+
+void SDCard::ReadAhead::stop()
+{
+    stopped_ = true;
+}
+
+bool SDCard::ReadAhead::idle() const
+{
+    for (uint32_t i = 0; i < chunks_; i++) {
+        if (chunk_[i].req.queued) return false;
+    }
+    return true;
+}
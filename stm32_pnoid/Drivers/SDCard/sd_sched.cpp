@@ -0,0 +1,194 @@
+/**
+ * @file    sd_sched.cpp
+ * @brief   SD I/O scheduler — see sd_sched.hpp
+ */
+
+#include "sd_sched.hpp"
+#include "fatfs.h"
+#include "main.h"
+#include "timebase.h"
+#include <cstring>
+
+static constexpr uint32_t SECTOR = 512;
+
+/* Gather / scatter buffer for merged commands: AXI SRAM, IDMA-ready */
+alignas(32) static uint8_t staging[SDScheduler::MERGE_SECTORS * SECTOR];
+
+/* ---------- Queue (PRIMASK held by the caller) --------------------------- */
+
+static inline bool before(const SDScheduler::Request *a, const SDScheduler::Request *b)
+{
+    if (a->stream != b->stream) return a->stream < b->stream;
+    uint64_t da = a->deadlineUs ? a->deadlineUs : UINT64_MAX;
+    uint64_t db = b->deadlineUs ? b->deadlineUs : UINT64_MAX;
+    return da < db;                         /* ties keep submit order */
+}
+
+SDScheduler::Request *SDScheduler::pickLocked()
+{
+    Request *best = head_, *bestPrev = nullptr;
+    if (best == nullptr) return nullptr;
+
+    if (!fifo_) {
+        for (Request *prev = head_, *r = head_->next; r != nullptr; prev = r, r = r->next) {
+            if (before(r, best)) {
+                best     = r;
+                bestPrev = prev;
+            }
+        }
+    }
+
+    if (bestPrev) bestPrev->next = best->next;
+    else          head_          = best->next;
+    if (tail_ == best) tail_ = bestPrev;
+    best->next = nullptr;
+    return best;
+}
+
+/** Unlink a queued sector request of the same direction starting at `lba` */
+SDScheduler::Request *SDScheduler::takeNextLocked(const Request &r, uint32_t lba)
+{
+    for (Request *prev = nullptr, *q = head_; q != nullptr; prev = q, q = q->next) {
+        if (q->op != r.op || q->lba != lba) continue;
+
+        if (prev) prev->next = q->next;
+        else      head_      = q->next;
+        if (tail_ == q) tail_ = prev;
+        q->next = nullptr;
+        return q;
+    }
+    return nullptr;
+}
+
+/* ---------- Public API --------------------------------------------------- */
+
+bool SDScheduler::submit(Request &r)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (r.queued) {
+        __set_PRIMASK(primask);
+        return false;
+    }
+    r.queued   = true;
+    r.submitUs = TIME_Micros();
+    r.next     = nullptr;
+    if (tail_) tail_->next = &r;
+    else       head_       = &r;
+    tail_ = &r;
+
+    __set_PRIMASK(primask);
+    return true;
+}
+
+uint32_t SDScheduler::run(uint32_t budgetUs)
+{
+    uint64_t start = TIME_Micros();
+    uint32_t done  = 0;
+
+    for (;;) {
+        if (budgetUs && (TIME_Micros() - start) >= budgetUs) break;
+
+        Request *batch[MERGE_MAX];
+        uint32_t n = 0, sectors = 0;
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        Request *r = pickLocked();
+        if (r != nullptr) {
+            batch[n++] = r;
+            sectors    = r->count;
+            /* Coalesce: follow the LBA run while it fits one command */
+            while (!fifo_ && r->op != Op::Job && n < MERGE_MAX) {
+                Request *q = takeNextLocked(*r, batch[n - 1]->lba + batch[n - 1]->count);
+                if (q == nullptr) break;
+                if (sectors + q->count > MERGE_SECTORS) {
+                    /* Does not fit: put it back at the front */
+                    q->next = head_;
+                    head_   = q;
+                    if (tail_ == nullptr) tail_ = q;
+                    break;
+                }
+                batch[n++] = q;
+                sectors   += q->count;
+            }
+        }
+        __set_PRIMASK(primask);
+
+        if (r == nullptr) break;
+
+        uint64_t t0 = TIME_Micros();
+        bool ok = execute(batch, n, sectors);
+        uint32_t us = (uint32_t)(TIME_Micros() - t0);
+
+        for (uint32_t i = 0; i < n; i++) complete(batch[i], ok, us, i > 0);
+        done += n;
+    }
+    return done;
+}
+
+void SDScheduler::resetStats()
+{
+    memset(stats_, 0, sizeof(stats_));
+}
+
+/* ---------- Execution ---------------------------------------------------- */
+
+bool SDScheduler::execute(Request **batch, uint32_t n, uint32_t sectors)
+{
+    Request *r = batch[0];
+
+    if (r->op == Op::Job) {
+        return r->job ? r->job(r->ctx) : false;
+    }
+
+    /* One command straight from the caller's memory if it is contiguous */
+    bool inPlace = true;
+    for (uint32_t i = 1; i < n; i++) {
+        if (batch[i]->buf != batch[i - 1]->buf + batch[i - 1]->count * SECTOR) {
+            inPlace = false;
+            break;
+        }
+    }
+
+    if (inPlace) {
+        return (r->op == Op::Read ? disk_read(drv_, r->buf, r->lba, sectors)
+                                  : disk_write(drv_, r->buf, r->lba, sectors)) == RES_OK;
+    }
+
+    uint32_t off = 0;
+    if (r->op == Op::Write) {
+        for (uint32_t i = 0; i < n; i++) {
+            memcpy(&staging[off], batch[i]->buf, batch[i]->count * SECTOR);
+            off += batch[i]->count * SECTOR;
+        }
+        return disk_write(drv_, staging, r->lba, sectors) == RES_OK;
+    }
+
+    if (disk_read(drv_, staging, r->lba, sectors) != RES_OK) return false;
+    for (uint32_t i = 0; i < n; i++) {
+        memcpy(batch[i]->buf, &staging[off], batch[i]->count * SECTOR);
+        off += batch[i]->count * SECTOR;
+    }
+    return true;
+}
+
+void SDScheduler::complete(Request *r, bool ok, uint32_t serviceUs, bool rider)
+{
+    uint64_t     now = TIME_Micros();
+    StreamStats &st  = stats_[(int)r->stream];
+    uint32_t     lat = (uint32_t)(now - r->submitUs);
+
+    st.requests++;
+    st.sectors      += r->count;
+    st.sumLatencyUs += lat;
+    if (rider)                              st.merged++;
+    if (!ok)                                st.errors++;
+    if (r->deadlineUs && now > r->deadlineUs) st.missed++;
+    if (lat > st.maxLatencyUs)              st.maxLatencyUs = lat;
+    if (serviceUs > st.maxServiceUs)        st.maxServiceUs = serviceUs;
+
+    r->queued = false;
+    if (r->done) r->done(r->ctx, ok);
+}
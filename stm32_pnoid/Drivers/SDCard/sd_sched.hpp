@@ -0,0 +1,105 @@
+/**
+ * @file    sd_sched.hpp
+ * @brief   SD I/O scheduler — one owner for the card, several streams
+ * @note    Requests are caller-owned objects linked into the queue (no
+ *          allocation). submit() from any context; run() only from the
+ *          context that owns the card (log task / superloop SD step),
+ *          since it calls FatFs and the block driver.
+ *
+ * Order: stream class first (audio read-ahead, then telemetry, then log),
+ * earliest deadline within a class, submit order last. Execution is
+ * non-preemptive — a started job runs to the end — so jobs must stay
+ * bounded: one FatFs operation each (a log half, one f_sync, one read-
+ * ahead chunk), resubmitting for the rest. Audio then waits at most one
+ * lower-class service time; it must submit read-ahead at least that far
+ * ahead of its deadline, and stats() reports that time per stream.
+ *
+ * Sector requests for the same direction whose LBAs continue each other
+ * go out as one multi-sector command: in place if the buffers are also
+ * adjacent in memory, otherwise gathered / scattered through a staging
+ * buffer.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class SDScheduler {
+public:
+    enum class Stream : uint8_t {
+        Audio = 0,      // playback read-ahead — underruns are audible
+        Telemetry,      // recorder slots — ring overflow drops data
+        Log,            // text log flush / sync — can wait
+        Count
+    };
+
+    enum class Op : uint8_t {
+        Read,           // count sectors at lba into buf
+        Write,          // count sectors at lba from buf
+        Job,            // job(ctx): a whole FatFs operation, never merged
+    };
+
+    struct Request {
+        Op        op         = Op::Job;
+        Stream    stream     = Stream::Log;
+        uint32_t  lba        = 0;
+        uint32_t  count      = 0;
+        uint8_t  *buf        = nullptr;
+        bool    (*job)(void *ctx)          = nullptr;
+        void    (*done)(void *ctx, bool ok) = nullptr;   // owner context
+        void     *ctx        = nullptr;
+        uint64_t  deadlineUs = 0;       // absolute TIME_Micros(), 0 = none
+
+        /* Scheduler-owned */
+        volatile bool queued = false;
+        uint64_t  submitUs   = 0;
+        Request  *next       = nullptr;
+    };
+
+    struct StreamStats {
+        uint32_t requests;
+        uint32_t sectors;
+        uint32_t merged;        // requests that rode in another's command
+        uint32_t missed;        // completed after their deadline
+        uint32_t errors;
+        uint32_t maxLatencyUs;  // submit → done
+        uint32_t maxServiceUs;  // longest command / job of this stream
+        uint64_t sumLatencyUs;
+    };
+
+    static constexpr uint32_t MERGE_SECTORS = 32;   // staging buffer, 16 KB
+    static constexpr uint32_t MERGE_MAX     = 8;    // requests per command
+
+    explicit SDScheduler(uint8_t drv = 0) : drv_(drv) {}
+
+    /** Queue a request; false if it is still queued from last time */
+    bool     submit(Request &r);
+
+    /**
+     * @brief  Execute queued requests in order
+     * @param  budgetUs  Stop starting new work after this long (0 = drain)
+     * @retval Requests completed
+     */
+    uint32_t run(uint32_t budgetUs);
+
+    bool     idle() const { return head_ == nullptr; }
+
+    /** Baseline for comparison: plain submit order, no merging */
+    void     setFifo(bool on) { fifo_ = on; }
+    bool     isFifo() const   { return fifo_; }
+
+    const StreamStats &stats(Stream s) const { return stats_[(int)s]; }
+    void     resetStats();
+
+private:
+    Request *pickLocked();
+    Request *takeNextLocked(const Request &r, uint32_t lba);
+    bool     execute(Request **batch, uint32_t n, uint32_t sectors);
+    void     complete(Request *r, bool ok, uint32_t serviceUs, bool rider);
+
+    uint8_t      drv_;
+    bool         fifo_ = false;
+    Request     *head_ = nullptr;
+    Request     *tail_ = nullptr;
+    StreamStats  stats_[(int)Stream::Count] = {};
+};
@@ -0,0 +1,349 @@
+/**
+ * @file    sd_shell.cpp
+ * @brief   "sd ..." debug shell commands — see sd_shell.hpp
+ */
+
+#include "sd_shell.hpp"
+#include "fatfs.h"
+#include "main.h"
+#include "debug_log.h"
+#include "timebase.h"
+#include <cstdlib>
+#include <cstring>
+
+#if PNOID_RTOS_ENABLE
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+static const char *TAG = "SDSH";
+
+static constexpr uint32_t SEEK_READS = 200;        // per mode
+
+SDShell::SDShell(SDCard &sd, SDScheduler &sched, AudioOut &audio)
+    : sd_(sd), sched_(sched), audio_(audio),
+      readAhead_(sd.media(), sched, playBuf_, PLAY_CHUNK, PLAY_CHUNKS),
+      writer_(recRing_, sizeof(recRing_), REC_SLOT)
+{
+    writer_.attach(sched, REC_WAIT_MS);
+}
+
+void SDShell::submitJob(SDScheduler::Request &r, SDScheduler::Stream stream,
+                        bool (*job)(void *), void (*done)(void *, bool))
+{
+    r.op         = SDScheduler::Op::Job;
+    r.stream     = stream;
+    r.job        = job;
+    r.done       = done;
+    r.ctx        = this;
+    r.deadlineUs = 0;
+    sched_.submit(r);
+}
+
+/* ---------- Commands ----------------------------------------------------- */
+
+bool SDShell::command(const char *args)
+{
+    if (strncmp(args, "bench", 5) == 0) {
+        if (benchReq_.queued) {
+            LOGW(TAG, "SD bench busy");
+        } else if (!sd_.isMounted()) {
+            LOGW(TAG, "SD not mounted");
+        } else {
+            long kb = strtol(args + 5, nullptr, 10);
+            benchKB_    = kb > 0 ? (uint32_t)kb : 4096u;
+            benchPhase_ = 0;
+            submitJob(benchReq_, SDScheduler::Stream::Log, benchJob, benchDone);
+            LOGI(TAG, "SD bench %lu KB queued", benchKB_);
+        }
+    } else if (strncmp(args, "sched", 5) == 0) {
+        if (strcmp(args + 5, " fifo") == 0)      { sched_.setFifo(true);  sched_.resetStats(); }
+        else if (strcmp(args + 5, " prio") == 0) { sched_.setFifo(false); sched_.resetStats(); }
+        schedReport();
+    } else if (strncmp(args, "seek ", 5) == 0) {
+        if (seekReq_.queued) {
+            LOGW(TAG, "SD seek busy");
+        } else {
+            strncpy(seekPath_, args + 5, sizeof(seekPath_) - 1);
+            seekStep_ = 0;
+            submitJob(seekReq_, SDScheduler::Stream::Log, seekJob, seekDone);
+            LOGI(TAG, "SD seek %s queued", seekPath_);
+        }
+    } else if (strncmp(args, "play ", 5) == 0) {
+#if PNOID_RTOS_ENABLE
+        if (playState_ != Idle) {
+            LOGW(TAG, "SD play busy");
+        } else {
+            strncpy(playPath_, args + 5, sizeof(playPath_) - 1);
+            playState_ = Opening;
+            submitJob(playReq_, SDScheduler::Stream::Audio, playOpenJob, nullptr);
+        }
+#else
+        LOGW(TAG, "SD play needs the audio task (PNOID_RTOS_ENABLE)");
+#endif
+    } else if (strcmp(args, "rec stop") == 0) {
+        if (recState_ == Running) recState_ = Stopping;
+    } else if (strncmp(args, "rec ", 4) == 0) {
+        if (recState_ != Idle) {
+            LOGW(TAG, "SD rec busy");
+        } else {
+            const char *p  = args + 4;
+            const char *sp = strchr(p, ' ');
+            size_t      n  = sp ? (size_t)(sp - p) : strlen(p);
+            if (n >= sizeof(recPath_)) n = sizeof(recPath_) - 1;
+            memcpy(recPath_, p, n);
+            recPath_[n] = '\0';
+            long kb = sp ? strtol(sp, nullptr, 10) : 0;
+            recKB_    = kb > 0 ? (uint32_t)kb : 1024u;
+            recState_ = Opening;
+            submitJob(recReq_, SDScheduler::Stream::Telemetry, recOpenJob, nullptr);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void SDShell::service()
+{
+    if (recState_ == Running || recState_ == Stopping) writer_.service();
+
+    /* Close once nothing of the file is left in the queue */
+    if (recState_ == Stopping && writer_.idle() && !recReq_.queued) {
+        recState_ = Closing;
+        submitJob(recReq_, SDScheduler::Stream::Telemetry, recCloseJob, nullptr);
+    }
+    if (playState_ == Stopping && readAhead_.idle() && !playReq_.queued) {
+        playState_ = Closing;
+        submitJob(playReq_, SDScheduler::Stream::Audio, playCloseJob, nullptr);
+    }
+}
+
+/* ---------- Benches ------------------------------------------------------ */
+
+/** One measurement per job (poll, IDMA, stream): audio waits at most one */
+bool SDShell::benchJob(void *ctx)
+{
+    SDShell &s = *static_cast<SDShell *>(ctx);
+    uint8_t  p = s.benchPhase_;
+    s.benchSt_[p] = p == 2 ? s.sd_.benchmarkStream("bench.pns", s.benchKB_, s.benchRes_[p])
+                           : s.sd_.benchmark("bench.bin", s.benchKB_, p == 1, s.benchRes_[p]);
+    return s.benchSt_[p] == SDCard::Status::OK;
+}
+
+void SDShell::benchDone(void *ctx, bool ok)
+{
+    SDShell &s = *static_cast<SDShell *>(ctx);
+    if (ok && ++s.benchPhase_ < 3) {
+        s.sched_.submit(s.benchReq_);
+        return;
+    }
+    if (!ok) {
+        LOGE(TAG, "SD bench failed (%d/%d/%d)",
+             (int)s.benchSt_[0], (int)s.benchSt_[1], (int)s.benchSt_[2]);
+        return;
+    }
+
+    const SDCard::BenchResult &poll = s.benchRes_[0], &dma = s.benchRes_[1],
+                              &strm = s.benchRes_[2];
+    SD_IO_Stats_t io;
+    SD_IO_GetStats(&io);
+    LOGI(TAG, "SD %lu KB poll/dma: write %lu/%lu KB/s cpu %lu/%lu%%, "
+              "read %lu/%lu KB/s cpu %lu/%lu%%, %lu bounced, %lu errors",
+         s.benchKB_, poll.writeKBps, dma.writeKBps, poll.writeCpuPct, dma.writeCpuPct,
+         poll.readKBps, dma.readKBps, poll.readCpuPct, dma.readCpuPct,
+         io.bounced, io.errors);
+    LOGI(TAG, "SD %lu KB stream: write %lu KB/s cpu %lu%%, read %lu KB/s cpu %lu%%",
+         s.benchKB_, strm.writeKBps, strm.writeCpuPct, strm.readKBps, strm.readCpuPct);
+}
+
+/**
+ * Random 512 B reads, FAT chain vs cached CLMT: step 0 opens, then one
+ * read per job (timed inside it), the last step reports and closes.
+ */
+bool SDShell::seekJob(void *ctx)
+{
+    SDShell            &s     = *static_cast<SDShell *>(ctx);
+    SDCard::MediaIndex &media = s.sd_.media();
+    uint32_t            step  = s.seekStep_;
+
+    if (step == 0) {
+        s.seekH_ = media.add(s.seekPath_);
+        if (s.seekH_ < 0) {
+            LOGW(TAG, "SD seek: cannot open %s", s.seekPath_);
+            return false;
+        }
+        return true;
+    }
+
+    if (step > 2 * SEEK_READS) {
+        LOGI(TAG, "SD seek %s (%lu KB, %lu fragments): chain %lu/%lu us, CLMT %lu/%lu us (avg/max)",
+             s.seekPath_, media.size(s.seekH_) / 1024, media.fragments(s.seekH_),
+             s.seekTotal_[0] / SEEK_READS, s.seekWorst_[0],
+             s.seekTotal_[1] / SEEK_READS, s.seekWorst_[1]);
+        media.remove(s.seekH_);
+        s.seekH_ = -1;
+        return true;
+    }
+
+    uint32_t fast = step > SEEK_READS ? 1 : 0;
+    if (step == 1 || step == SEEK_READS + 1) {
+        media.setFastSeek(s.seekH_, fast != 0);
+        s.seekX_           = 0x2545F491u;       // same offsets both ways
+        s.seekTotal_[fast] = 0;
+        s.seekWorst_[fast] = 0;
+    }
+
+    uint8_t  buf[512];
+    uint32_t size = media.size(s.seekH_);
+    uint32_t x    = s.seekX_;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    s.seekX_ = x;
+    uint32_t off = size > sizeof(buf) ? x % (size - sizeof(buf)) : 0;
+
+    uint64_t t0 = TIME_Micros();
+    media.read(s.seekH_, off, buf, sizeof(buf));
+    uint32_t us = (uint32_t)(TIME_Micros() - t0);
+    s.seekTotal_[fast] += us;
+    if (us > s.seekWorst_[fast]) s.seekWorst_[fast] = us;
+    return true;
+}
+
+void SDShell::seekDone(void *ctx, bool ok)
+{
+    SDShell &s = *static_cast<SDShell *>(ctx);
+    if (ok && ++s.seekStep_ <= 2 * SEEK_READS + 1) s.sched_.submit(s.seekReq_);
+}
+
+/* ---------- Playback ----------------------------------------------------- */
+
+bool SDShell::playOpenJob(void *ctx)
+{
+    SDShell &s = *static_cast<SDShell *>(ctx);
+    s.playH_ = s.sd_.media().add(s.playPath_);
+    if (s.playH_ < 0) {
+        LOGW(TAG, "SD play: cannot open %s", s.playPath_);
+        s.playState_ = Idle;
+        return false;
+    }
+    if (s.readAhead_.start(s.playH_, 0, PLAY_BPS) != SDCard::Status::OK) {
+        LOGW(TAG, "SD play: %s is empty", s.playPath_);
+        s.sd_.media().remove(s.playH_);
+        s.playState_ = Idle;
+        return false;
+    }
+    s.playOff_   = 0;
+    s.underruns_ = 0;
+    s.playState_ = Running;         // audioService picks it up
+    return true;
+}
+
+bool SDShell::playCloseJob(void *ctx)
+{
+    SDShell &s = *static_cast<SDShell *>(ctx);
+    s.sd_.media().remove(s.playH_);
+    s.playH_     = -1;
+    s.playState_ = Idle;
+    return true;
+}
+
+/** AudioOut::playStream fill: copy out of filled chunks, wait for the next one */
+uint32_t SDShell::playFill(void *ctx, int16_t *dst, uint32_t frames)
+{
+    SDShell  &s    = *static_cast<SDShell *>(ctx);
+    uint8_t  *out  = reinterpret_cast<uint8_t *>(dst);
+    uint32_t  want = frames * 4, got = 0;
+    bool      stalled = false;
+
+    while (got < want) {
+        uint32_t       len;
+        const uint8_t *p = s.readAhead_.front(len);
+        if (p == nullptr) {
+            if (s.readAhead_.failed()) break;
+            if (!stalled) s.underruns_++;
+            stalled = true;
+#if PNOID_RTOS_ENABLE
+            vTaskDelay(1);
+#endif
+            continue;
+        }
+        if (s.playOff_ >= len) break;               // end of file (len 0)
+
+        uint32_t n = len - s.playOff_;
+        if (n > want - got) n = want - got;
+        memcpy(out + got, p + s.playOff_, n);
+        got        += n;
+        s.playOff_ += n;
+        if (s.playOff_ == len) {
+            s.readAhead_.pop();
+            s.playOff_ = 0;
+        }
+    }
+    return got / 4;
+}
+
+bool SDShell::audioService()
+{
+    if (playState_ != Running) return false;
+
+    /* Prefill: the first chunk is a start-up wait, not an underrun */
+    uint32_t len;
+    while (readAhead_.front(len) == nullptr && !readAhead_.failed()) {
+#if PNOID_RTOS_ENABLE
+        vTaskDelay(1);
+#endif
+    }
+
+    uint64_t t0 = TIME_Micros();
+    audio_.playStream(playFill, this);
+    uint32_t ms = (uint32_t)((TIME_Micros() - t0) / 1000u);
+    readAhead_.stop();
+
+    LOGI(TAG, "SD play %s: %lu ms, %lu underruns%s", playPath_, ms, underruns_,
+         readAhead_.failed() ? ", read error" : "");
+    playState_ = Stopping;          // service() closes once the chunks are out
+    return true;
+}
+
+/* ---------- Recorder ----------------------------------------------------- */
+
+bool SDShell::recOpenJob(void *ctx)
+{
+    SDShell       &s  = *static_cast<SDShell *>(ctx);
+    SDCard::Status st = s.writer_.open(s.recPath_, s.recKB_ * 1024u);
+    if (st != SDCard::Status::OK) {
+        LOGW(TAG, "SD rec: cannot open %s (%d)", s.recPath_, (int)st);
+        s.recState_ = Idle;
+        return false;
+    }
+    LOGI(TAG, "SD rec %s, %lu KB", s.recPath_, s.recKB_);
+    s.recState_ = Running;
+    return true;
+}
+
+bool SDShell::recCloseJob(void *ctx)
+{
+    SDShell       &s  = *static_cast<SDShell *>(ctx);
+    SDCard::Status st = s.writer_.close();
+    SDCard::StreamStats ws = s.writer_.stats();
+    LOGI(TAG, "SD rec %s closed (%d): %lu bytes, %lu dropped, %lu sectors, slot max %lu us",
+         s.recPath_, (int)st, ws.bytes, ws.dropped, ws.sectors, ws.maxWriteUs);
+    s.recState_ = Idle;
+    return st == SDCard::Status::OK;
+}
+
+/* ---------- Reports ------------------------------------------------------ */
+
+void SDShell::schedReport()
+{
+    static const char *const NAMES[] = { "audio", "telemetry", "log" };
+    LOGI(TAG, "SD sched %s", sched_.isFifo() ? "fifo (baseline)" : "priority");
+    for (int i = 0; i < (int)SDScheduler::Stream::Count; i++) {
+        const SDScheduler::StreamStats &st = sched_.stats((SDScheduler::Stream)i);
+        LOGI(TAG, "  %-9s %lu req %lu sectors (%lu merged), latency avg %lu max %lu us, "
+                  "service max %lu us, %lu missed, %lu errors",
+             NAMES[i], st.requests, st.sectors, st.merged,
+             st.requests ? (uint32_t)(st.sumLatencyUs / st.requests) : 0u,
+             st.maxLatencyUs, st.maxServiceUs, st.missed, st.errors);
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file    sd_shell.hpp
+ * @brief   "sd ..." debug shell commands: benches, playback, recorder, reports
+ * @note    Every card access is a request on the SD scheduler, executed by
+ *          the card owner's run() (SD service / log task): command() only
+ *          submits, service() queues recorder slots, audioService() plays
+ *          from read-ahead chunks the scheduler fills.
+ *
+ *   sd bench [KB]          MB/s + CPU load, polling vs IDMA vs stream
+ *                          (default 4096 KB; three log-class jobs, seconds each)
+ *   sd seek <file>         random 512 B reads, FAT chain vs fast-seek CLMT
+ *   sd sched [fifo|prio]   per-stream latency; fifo = baseline ordering
+ *   sd play <file>         raw 16 kHz stereo s16 PCM, audio-class read-ahead
+ *                          (audio task: RTOS build only)
+ *   sd rec <file> [KB]     telemetry recorder (contiguous stream file,
+ *                          telemetry-class slot writes), default 1024 KB
+ *   sd rec stop
+ */
+
+#pragma once
+
+#include "sdcard.hpp"
+#include "sd_sched.hpp"
+#include "audio_out.hpp"
+#include <cstdint>
+
+class SDShell {
+public:
+    static constexpr uint32_t PLAY_CHUNK  = 4096;     // 64 ms of 16 kHz stereo
+    static constexpr uint32_t PLAY_CHUNKS = 4;
+    static constexpr uint32_t PLAY_BPS    = 16000 * 4;
+    static constexpr uint32_t REC_SLOT    = 16;       // sectors per slot write
+    static constexpr uint32_t REC_SLOTS   = 2;
+    static constexpr uint32_t REC_WAIT_MS = 500;      // slot deadline
+
+    SDShell(SDCard &sd, SDScheduler &sched, AudioOut &audio);
+
+    /**
+     * @brief  Handle one "sd" command (link context)
+     * @param  args  Text after "sd "
+     * @retval false if args is not an sd command
+     */
+    bool command(const char *args);
+
+    /** Card owner context, before SDScheduler::run(): recorder slots, close */
+    void service();
+
+    /**
+     * @brief  Play a file opened by "sd play" (audio context)
+     * @retval true if it played (the call blocked for the clip)
+     */
+    bool audioService();
+
+    /** Telemetry producer (one context, e.g. the control loop); no-op unless recording */
+    void record(const void *data, uint32_t len)
+    {
+        if (recState_ == Running) writer_.write(data, len);
+    }
+
+private:
+    enum State : uint8_t { Idle = 0, Opening, Running, Stopping, Closing };
+
+    /* "sd bench" */
+    static bool benchJob(void *ctx);
+    static void benchDone(void *ctx, bool ok);
+
+    /* "sd seek" */
+    static bool seekJob(void *ctx);
+    static void seekDone(void *ctx, bool ok);
+
+    /* "sd play" */
+    static bool     playOpenJob(void *ctx);
+    static bool     playCloseJob(void *ctx);
+    static uint32_t playFill(void *ctx, int16_t *dst, uint32_t frames);
+
+    /* "sd rec" */
+    static bool recOpenJob(void *ctx);
+    static bool recCloseJob(void *ctx);
+
+    void schedReport();
+    void submitJob(SDScheduler::Request &r, SDScheduler::Stream stream,
+                   bool (*job)(void *), void (*done)(void *, bool));
+
+    SDCard            &sd_;
+    SDScheduler       &sched_;
+    AudioOut          &audio_;
+
+    SDScheduler::Request benchReq_;
+    uint32_t           benchKB_    = 0;
+    uint8_t            benchPhase_ = 0;     // poll, IDMA, stream
+    SDCard::Status     benchSt_[3] = {};
+    SDCard::BenchResult benchRes_[3] = {};
+
+    SDScheduler::Request seekReq_;
+    char               seekPath_[SDCard::MediaIndex::PATH_LEN] = {};
+    int                seekH_      = -1;
+    uint32_t           seekStep_   = 0;     // 0 open, 1..2N reads, 2N+1 close
+    uint32_t           seekX_      = 0;     // xorshift state
+    uint32_t           seekTotal_[2] = {};
+    uint32_t           seekWorst_[2] = {};
+
+    SDScheduler::Request playReq_;
+    volatile uint8_t   playState_  = Idle;
+    char               playPath_[SDCard::MediaIndex::PATH_LEN] = {};
+    int                playH_      = -1;
+    uint32_t           playOff_    = 0;     // bytes used of the front chunk
+    uint32_t           underruns_  = 0;
+    SDCard::ReadAhead  readAhead_;
+
+    SDScheduler::Request recReq_;
+    volatile uint8_t   recState_   = Idle;
+    char               recPath_[SDCard::MediaIndex::PATH_LEN] = {};
+    uint32_t           recKB_      = 0;
+    SDCard::StreamWriter writer_;
+
+    /* IDMA buffers (AXI SRAM, whole cache lines) */
+    alignas(32) uint8_t playBuf_[PLAY_CHUNKS * PLAY_CHUNK];
+    alignas(32) uint8_t recRing_[REC_SLOTS * REC_SLOT * 512];
+};
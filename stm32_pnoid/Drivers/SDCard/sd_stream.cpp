@@ -0,0 +1,391 @@
+/**
+ * @file    sd_stream.cpp
+ * @brief   SDCard::StreamWriter / StreamReader — raw-sector streaming into a
+ *          preallocated contiguous file
+ * @note    Needs _USE_EXPAND (f_expand) and _USE_FASTSEEK (contiguity check).
+ *
+ * open() allocates the whole file in one contiguous cluster run and commits
+ * FAT + directory entry once. From then on payload goes to the card as
+ * multi-sector disk_write calls at fixed LBAs, with no FatFs bookkeeping;
+ * close() truncates the file to what was actually written.
+ *
+ * Sector = 16-byte header (magic, session, seq, len) + 496 bytes payload.
+ * A stream is a prefix of sectors whose seq counts up from 0 under one
+ * session id; anything after it (stale data of an older recording, or
+ * sectors never written before a power loss) fails the check.
+ */
+
+#include "sdcard.hpp"
+#include "fatfs.h"
+#include "debug_log.h"
+#include "timebase.h"
+#include <cstring>
+
+static const char *TAG = "SDSTREAM";
+
+static constexpr uint32_t SECTOR = 512;
+
+static_assert(sizeof(SDCard::StreamSector) == SECTOR, "StreamSector must be one sector");
+
+/* ---------- Helpers ------------------------------------------------------ */
+
+static uint32_t newSession(uint32_t lba)
+{
+    uint32_t x = (uint32_t)TIME_Micros() ^ (DWT->CYCCNT << 7) ^ SysTick->VAL ^ lba;
+    x ^= x >> 16; x *= 0x7FEB352Du;                     /* lowbias32 mix */
+    x ^= x >> 15; x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x ? x : 1u;
+}
+
+static inline uint32_t clusterLba(FATFS *fs, DWORD clst)
+{
+    return fs->database + (clst - 2) * fs->csize;
+}
+
+/**
+ * Start LBA of a file if it is one contiguous cluster run (fast-seek
+ * link map with a single fragment), 0 otherwise
+ */
+static uint32_t contiguousLba(FIL &fil, DWORD *clmt, uint32_t clmtLen)
+{
+    if (fil.obj.sclust == 0) return 0;
+
+    fil.cltbl = clmt;
+    clmt[0]   = clmtLen;
+    FRESULT res = f_lseek(&fil, CREATE_LINKMAP);
+    fil.cltbl = nullptr;
+
+    if (res != FR_OK || clmt[0] != 4) return 0;         /* size, [ncl, start], 0 */
+    return clusterLba(fil.obj.fs, clmt[2]);
+}
+
+static inline bool sectorValid(const SDCard::StreamSector *s, uint32_t session, uint32_t seq)
+{
+    return s->magic == SDCard::StreamSector::MAGIC && s->session == session
+        && s->seq == seq && s->len <= SDCard::StreamSector::PAYLOAD;
+}
+
+/* ---------- StreamWriter ------------------------------------------------- */
+
+SDCard::StreamWriter::StreamWriter(uint8_t *ring, uint32_t ringSize, uint32_t slotSectors)
+    : ring_(ring), slotSectors_(slotSectors ? slotSectors : 1)
+{
+    ringSectors_ = (ringSize / SECTOR / slotSectors_) * slotSectors_;
+}
+
+SDCard::StreamSector *SDCard::StreamWriter::sectorAt(uint32_t n)
+{
+    return reinterpret_cast<StreamSector *>(ring_ + (n % ringSectors_) * SECTOR);
+}
+
+SDCard::Status SDCard::StreamWriter::open(const char *path, uint32_t maxBytes)
+{
+    if (open_ || ringSectors_ == 0) return Status::ErrFile;
+    if ((reinterpret_cast<uintptr_t>(ring_) & 31u) != 0) {
+        LOGW(TAG, "Ring not 32-byte aligned: every slot is bounced");
+    }
+
+    uint32_t sectors = (maxBytes + StreamSector::PAYLOAD - 1) / StreamSector::PAYLOAD;
+    if (sectors == 0) sectors = 1;
+
+    if (f_open(&fil_, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return Status::ErrFile;
+
+    /* One contiguous run, committed now: a power cut leaves a full-size
+     * file that streamRecover() trims */
+    FRESULT res = f_expand(&fil_, (FSIZE_t)sectors * SECTOR, 1);
+    if (res == FR_OK) res = f_sync(&fil_);
+    if (res != FR_OK) {
+        LOGE(TAG, "No contiguous %lu KB for %s (FRESULT=%d)",
+             sectors / 2, path, (int)res);
+        f_close(&fil_);
+        f_unlink(path);
+        return Status::ErrWrite;
+    }
+
+    startLba_   = clusterLba(fil_.obj.fs, fil_.obj.sclust);
+    capSectors_ = sectors;
+    session_    = newSession(startLba_);
+    head_       = 0;
+    tail_       = 0;
+    fillOff_    = 0;
+    error_      = false;
+    stats_      = {};
+    open_       = true;
+
+    LOGI(TAG, "%s: %lu sectors at LBA %lu", path, capSectors_, startLba_);
+    return Status::OK;
+}
+
+uint32_t SDCard::StreamWriter::write(const void *data, uint32_t len)
+{
+    if (!open_) return 0;
+
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    uint32_t done = 0;
+
+    while (done < len) {
+        uint32_t h = head_;
+        if (fillOff_ == 0) {
+            /* New sector: needs a free ring slot and room in the file */
+            if (error_ || h - tail_ >= ringSectors_ || h >= capSectors_) break;
+            StreamSector *s = sectorAt(h);
+            s->magic    = StreamSector::MAGIC;
+            s->session  = session_;
+            s->seq      = h;
+            s->reserved = 0;
+        }
+
+        StreamSector *s = sectorAt(h);
+        uint32_t n = StreamSector::PAYLOAD - fillOff_;
+        if (n > len - done) n = len - done;
+        memcpy(&s->data[fillOff_], src + done, n);
+        fillOff_ += n;
+        done     += n;
+
+        if (fillOff_ == StreamSector::PAYLOAD) {
+            s->len   = (uint16_t)StreamSector::PAYLOAD;
+            fillOff_ = 0;
+            __DMB();                                    /* sector before publish */
+            head_    = h + 1;
+        }
+    }
+
+    stats_.bytes   += done;
+    stats_.dropped += len - done;
+    return done;
+}
+
+/** Send `sectors` published sectors from tail_, slot by slot */
+bool SDCard::StreamWriter::writeSlots(uint32_t sectors)
+{
+    BYTE drv = fil_.obj.fs->drv;
+
+    while (sectors > 0) {
+        uint32_t n = sectors < slotSectors_ ? sectors : slotSectors_;
+        uint64_t t0 = TIME_Micros();
+        DRESULT  r  = disk_write(drv, reinterpret_cast<BYTE *>(sectorAt(tail_)),
+                                 startLba_ + tail_, n);
+        uint32_t us = (uint32_t)(TIME_Micros() - t0);
+        if (us > stats_.maxWriteUs) stats_.maxWriteUs = us;
+
+        if (r != RES_OK) {
+            LOGE(TAG, "disk_write LBA %lu x%lu failed", startLba_ + tail_, n);
+            error_ = true;
+            return false;
+        }
+        __DMB();
+        tail_          += n;
+        stats_.sectors += n;
+        sectors        -= n;
+    }
+    return true;
+}
+
+void SDCard::StreamWriter::attach(SDScheduler &sched, uint32_t deadlineMs)
+{
+    sched_      = &sched;
+    deadlineMs_ = deadlineMs;
+    req_.op     = SDScheduler::Op::Write;
+    req_.stream = SDScheduler::Stream::Telemetry;
+    req_.done   = slotsDone;
+    req_.ctx    = this;
+}
+
+/** Scheduler completion: the queued run of slots is on the card */
+void SDCard::StreamWriter::slotsDone(void *ctx, bool ok)
+{
+    StreamWriter *w = static_cast<StreamWriter *>(ctx);
+    if (!ok) {
+        LOGE(TAG, "Scheduled write LBA %lu x%lu failed", w->req_.lba, w->req_.count);
+        w->error_ = true;
+        return;
+    }
+    __DMB();
+    w->tail_          += w->req_.count;
+    w->stats_.sectors += w->req_.count;
+}
+
+bool SDCard::StreamWriter::service()
+{
+    if (!open_ || error_) return false;
+
+    uint32_t ready = head_ - tail_;
+    if (ready < slotSectors_) return false;
+
+    /* Whole slots only; tail_ stays slot-aligned so a slot never wraps */
+    ready -= ready % slotSectors_;
+    if (sched_ == nullptr) {
+        writeSlots(ready);
+        return true;
+    }
+
+    /* Scheduled: one run of slots in flight, up to the ring end */
+    if (req_.queued) return false;
+    uint32_t toEnd = ringSectors_ - tail_ % ringSectors_;
+    req_.lba        = startLba_ + tail_;
+    req_.count      = ready < toEnd ? ready : toEnd;
+    req_.buf        = reinterpret_cast<uint8_t *>(sectorAt(tail_));
+    req_.deadlineUs = TIME_Micros() + (uint64_t)deadlineMs_ * 1000u;
+    return sched_->submit(req_);
+}
+
+SDCard::Status SDCard::StreamWriter::close()
+{
+    if (!open_) return Status::OK;
+
+    /* Let the scheduled run land, then seal the partly filled sector and
+     * send everything left directly (this is the card-owner context) */
+    while (sched_ && req_.queued) sched_->run(0);
+    if (fillOff_ > 0) {
+        StreamSector *s = sectorAt(head_);
+        s->len   = (uint16_t)fillOff_;
+        memset(&s->data[fillOff_], 0, StreamSector::PAYLOAD - fillOff_);
+        fillOff_ = 0;
+        __DMB();
+        head_++;
+    }
+    bool ok = error_ ? false : writeSlots(head_ - tail_);
+    open_ = false;
+
+    /* Trim the preallocation to the data: the only FAT / directory update */
+    FRESULT res = f_lseek(&fil_, (FSIZE_t)tail_ * SECTOR);
+    if (res == FR_OK) res = f_truncate(&fil_);
+    FRESULT cres = f_close(&fil_);
+
+    LOGI(TAG, "Closed: %lu B in %lu sectors, %lu B dropped, slot write max %lu us",
+         stats_.bytes, stats_.sectors, stats_.dropped, stats_.maxWriteUs);
+
+    if (!ok) return Status::ErrWrite;
+    return (res == FR_OK && cres == FR_OK) ? Status::OK : Status::ErrFile;
+}
+
+/* ---------- StreamReader ------------------------------------------------- */
+
+SDCard::StreamReader::StreamReader(uint8_t *buf, uint32_t bufSize)
+    : buf_(buf), bufSectors_(bufSize / SECTOR)
+{
+}
+
+SDCard::Status SDCard::StreamReader::open(const char *path)
+{
+    if (bufSectors_ == 0) return Status::ErrRead;
+    if (f_open(&fil_, path, FA_READ) != FR_OK) return Status::ErrFile;
+
+    fileSectors_ = (uint32_t)(f_size(&fil_) / SECTOR);
+    startLba_    = contiguousLba(fil_, clmt_, sizeof(clmt_) / sizeof(clmt_[0]));
+    if (fileSectors_ > 0 && startLba_ == 0) {
+        LOGE(TAG, "%s is not a contiguous stream file", path);
+        f_close(&fil_);
+        return Status::ErrFile;
+    }
+
+    session_ = 0;
+    next_    = 0;
+    loaded_  = 0;
+    cur_     = 0;
+    curOff_  = 0;
+    end_     = (fileSectors_ == 0);
+    return Status::OK;
+}
+
+uint32_t SDCard::StreamReader::read(void *dst, uint32_t len)
+{
+    uint8_t *out  = static_cast<uint8_t *>(dst);
+    uint32_t done = 0;
+
+    while (done < len && !end_) {
+        if (cur_ == loaded_) {
+            uint32_t n = fileSectors_ - next_;
+            if (n > bufSectors_) n = bufSectors_;
+            if (n == 0 || disk_read(fil_.obj.fs->drv, buf_, startLba_ + next_, n) != RES_OK) {
+                end_ = true;
+                break;
+            }
+            next_  += n;
+            loaded_ = n;
+            cur_    = 0;
+            curOff_ = 0;
+        }
+
+        const StreamSector *s = reinterpret_cast<const StreamSector *>(buf_ + cur_ * SECTOR);
+        uint32_t seq = next_ - loaded_ + cur_;
+        if (seq == 0) session_ = s->session;
+        if (!sectorValid(s, session_, seq)) {
+            end_ = true;
+            break;
+        }
+
+        uint32_t n = s->len - curOff_;
+        if (n > len - done) n = len - done;
+        memcpy(out + done, &s->data[curOff_], n);
+        done    += n;
+        curOff_ += n;
+        if (curOff_ >= s->len) {
+            cur_++;
+            curOff_ = 0;
+        }
+    }
+    return done;
+}
+
+void SDCard::StreamReader::close()
+{
+    f_close(&fil_);
+    end_ = true;
+}
+
+/* ---------- Power-loss recovery ------------------------------------------ */
+
+SDCard::Status SDCard::streamRecover(const char *path, uint32_t &payloadBytes)
+{
+    static FIL fil;
+    static DWORD clmt[8];
+    alignas(32) static uint8_t sec[SECTOR];
+    const StreamSector *s = reinterpret_cast<const StreamSector *>(sec);
+
+    payloadBytes = 0;
+    if (f_open(&fil, path, FA_READ | FA_WRITE) != FR_OK) return Status::ErrFile;
+
+    uint32_t n   = (uint32_t)(f_size(&fil) / SECTOR);
+    uint32_t lba = contiguousLba(fil, clmt, sizeof(clmt) / sizeof(clmt[0]));
+    BYTE     drv = fil.obj.fs->drv;
+    if (n > 0 && lba == 0) {
+        f_close(&fil);
+        return Status::ErrFile;
+    }
+
+    /* Sector 0 names the session; the valid sectors are a prefix, so
+     * binary-search its end: lo is valid, hi is past it */
+    uint32_t valid = 0, lastLen = 0;
+    if (n > 0 && disk_read(drv, sec, lba, 1) == RES_OK
+              && sectorValid(s, s->session, 0)) {
+        uint32_t session = s->session;
+        uint32_t lo = 0, hi = n;
+        lastLen = s->len;
+        while (hi - lo > 1) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (disk_read(drv, sec, lba + mid, 1) != RES_OK) {
+                f_close(&fil);
+                return Status::ErrRead;
+            }
+            if (sectorValid(s, session, mid)) {
+                lo = mid;
+                lastLen = s->len;
+            } else {
+                hi = mid;
+            }
+        }
+        valid        = lo + 1;
+        payloadBytes = lo * StreamSector::PAYLOAD + lastLen;
+    }
+
+    FRESULT res = FR_OK;
+    if (valid < n) {
+        res = f_lseek(&fil, (FSIZE_t)valid * SECTOR);
+        if (res == FR_OK) res = f_truncate(&fil);
+        LOGW(TAG, "%s: recovered %lu of %lu sectors (%lu B)", path, valid, n, payloadBytes);
+    }
+    FRESULT cres = f_close(&fil);
+    return (res == FR_OK && cres == FR_OK) ? Status::OK : Status::ErrWrite;
+}
@@ -7,12 +7,18 @@
 #include "sdcard.hpp"
 #include "fatfs.h"
 #include "debug_log.h"
+#include "timebase.h"
 #include <cstring>
 
 static const char *TAG = "SD";
 
 static FATFS sd_fs;
 
+/* Benchmark: AXI SRAM, cache-line aligned → IDMA straight from/to it */
+static const uint32_t BENCH_CHUNK = 16 * 1024;
+alignas(32) static uint8_t benchBuf[BENCH_CHUNK];
+static FIL benchFile;
+
 /* ---------- Constructor -------------------------------------------------- */
 
 SDCard::SDCard(SD_HandleTypeDef &hsd) : hsd_(hsd) {}
@@ -71,6 +77,7 @@ SDCard::Status SDCard::mount()
 
     mounted_ = true;
     LOGI(TAG, "Mounted OK");
+    media_.reopenAll();
     return Status::OK;
 }
 
@@ -78,6 +85,7 @@ SDCard::Status SDCard::unmount()
 {
     if (!mounted_) return Status::OK;
 
+    media_.closeAll();
     FRESULT res = f_mount(nullptr, SDPath, 0);
     if (res != FR_OK) return Status::ErrUnmount;
 
@@ -206,3 +214,120 @@ SDCard::Status SDCard::getFreeSpace(uint32_t &freeKB)
     freeKB = static_cast<uint32_t>(freClust * fs->csize) / 2;
     return Status::OK;
 }
+
+/** KB/s and CPU busy % of one timed pass */
+static void benchRate(uint32_t sizeKB, uint32_t us, uint64_t waitCycles,
+                      uint32_t &kbps, uint32_t &cpuPct)
+{
+    uint64_t cycles = (uint64_t)us * TIME_CyclesPerUs();
+    kbps   = us ? (uint32_t)((uint64_t)sizeKB * 1000000u / us) : 0;
+    cpuPct = cycles ? 100u - (uint32_t)(waitCycles * 100u / cycles) : 100u;
+}
+
+SDCard::Status SDCard::benchmark(const char *path, uint32_t sizeKB, bool dma,
+                                 BenchResult &r)
+{
+    if (!mounted_) return Status::ErrNotMounted;
+
+    uint32_t chunks = (sizeKB * 1024u + BENCH_CHUNK - 1) / BENCH_CHUNK;
+    sizeKB = chunks * (BENCH_CHUNK / 1024u);
+    for (uint32_t i = 0; i < BENCH_CHUNK; i++) benchBuf[i] = (uint8_t)(i * 7u);
+
+    SD_IO_SetDma(dma ? 1 : 0);
+    Status st = Status::OK;
+    SD_IO_Stats_t s0, s1;
+    UINT n = 0;
+
+    /* Write: f_sync inside the timed region so the data is on the card */
+    if (f_open(&benchFile, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        SD_IO_SetDma(1);
+        return Status::ErrFile;
+    }
+    SD_IO_GetStats(&s0);
+    uint64_t t0 = TIME_Micros();
+    for (uint32_t i = 0; i < chunks && st == Status::OK; i++) {
+        if (f_write(&benchFile, benchBuf, BENCH_CHUNK, &n) != FR_OK || n != BENCH_CHUNK)
+            st = Status::ErrWrite;
+    }
+    if (f_sync(&benchFile) != FR_OK) st = Status::ErrWrite;
+    uint32_t us = (uint32_t)(TIME_Micros() - t0);
+    SD_IO_GetStats(&s1);
+    f_close(&benchFile);
+    benchRate(sizeKB, us, s1.waitCycles - s0.waitCycles, r.writeKBps, r.writeCpuPct);
+
+    /* Read back */
+    if (st == Status::OK && f_open(&benchFile, path, FA_READ) == FR_OK) {
+        SD_IO_GetStats(&s0);
+        t0 = TIME_Micros();
+        for (uint32_t i = 0; i < chunks && st == Status::OK; i++) {
+            if (f_read(&benchFile, benchBuf, BENCH_CHUNK, &n) != FR_OK || n != BENCH_CHUNK)
+                st = Status::ErrRead;
+        }
+        us = (uint32_t)(TIME_Micros() - t0);
+        SD_IO_GetStats(&s1);
+        f_close(&benchFile);
+        benchRate(sizeKB, us, s1.waitCycles - s0.waitCycles, r.readKBps, r.readCpuPct);
+    } else if (st == Status::OK) {
+        st = Status::ErrFile;
+    }
+
+    f_unlink(path);
+    SD_IO_SetDma(1);
+    return st;
+}
+
+SDCard::Status SDCard::benchmarkStream(const char *path, uint32_t sizeKB, BenchResult &r)
+{
+    if (!mounted_) return Status::ErrNotMounted;
+
+    uint8_t  src[1024];
+    uint32_t total = sizeKB * 1024u;
+    for (uint32_t i = 0; i < sizeof(src); i++) src[i] = (uint8_t)(i * 13u);
+
+    SD_IO_Stats_t s0, s1;
+    Status st;
+
+    /* Write: producer and service interleaved, as a recorder would run them */
+    {
+        StreamWriter w(benchBuf, BENCH_CHUNK, 16);
+        st = w.open(path, total);
+        if (st != Status::OK) return st;
+
+        SD_IO_GetStats(&s0);
+        uint64_t t0 = TIME_Micros();
+        for (uint32_t sent = 0; sent < total; ) {
+            uint32_t n = total - sent < sizeof(src) ? total - sent : sizeof(src);
+            n = w.write(src, n);
+            sent += n;
+            if (n == 0 && !w.service()) break;          /* ring full and no progress */
+        }
+        st = w.close();
+        uint32_t us = (uint32_t)(TIME_Micros() - t0);
+        SD_IO_GetStats(&s1);
+        benchRate(sizeKB, us, s1.waitCycles - s0.waitCycles, r.writeKBps, r.writeCpuPct);
+        if (st == Status::OK && w.stats().bytes != total) st = Status::ErrWrite;
+    }
+
+    /* Read back and check the payload */
+    if (st == Status::OK) {
+        StreamReader rd(benchBuf, BENCH_CHUNK);
+        st = rd.open(path);
+        if (st == Status::OK) {
+            SD_IO_GetStats(&s0);
+            uint64_t t0 = TIME_Micros();
+            uint32_t got = 0, n;
+            while ((n = rd.read(src, sizeof(src))) > 0) {
+                if (src[0] != (uint8_t)((got % sizeof(src)) * 13u)) st = Status::ErrRead;
+                got += n;
+            }
+            uint32_t us = (uint32_t)(TIME_Micros() - t0);
+            SD_IO_GetStats(&s1);
+            rd.close();
+            benchRate(sizeKB, us, s1.waitCycles - s0.waitCycles, r.readKBps, r.readCpuPct);
+            if (got != total) st = Status::ErrRead;
+        }
+    }
+
+    f_unlink(path);
+    return st;
+}
@@ -7,6 +7,8 @@
 #pragma once
 
 #include "stm32h7xx_hal.h"
+#include "ff.h"
+#include "sd_sched.hpp"
 #include <cstdint>
 
 class SDCard {
@@ -29,6 +31,13 @@ public:
         uint8_t  cardType;
     };
 
+    struct BenchResult {
+        uint32_t writeKBps;
+        uint32_t readKBps;
+        uint32_t writeCpuPct;   // CPU busy share while writing (100 = spinning)
+        uint32_t readCpuPct;
+    };
+
     /**
      * @brief  Construct with SD handle from CubeMX
      */
@@ -53,7 +62,251 @@ public:
     Status listDir(const char *path);
     Status getFreeSpace(uint32_t &freeKB);
 
+    /**
+     * @brief  Sequential write then read of a scratch file, deleted afterwards
+     * @param  dma  true: IDMA + interrupt completion, false: blocking FIFO polling
+     * @note   Blocks for the whole run (seconds) — only while standing still.
+     */
+    Status benchmark(const char *path, uint32_t sizeKB, bool dma, BenchResult &r);
+
+    /**
+     * @brief  Same sizes through StreamWriter / StreamReader (IDMA, 16-sector slots)
+     */
+    Status benchmarkStream(const char *path, uint32_t sizeKB, BenchResult &r);
+
+    /* ---------- Streaming (sd_stream.cpp) -------------------------------- */
+
+    /**
+     * Stream file layout: a contiguous, preallocated FatFs file whose
+     * sectors are written raw through the block driver. Every sector
+     * carries a header so the valid prefix can be found after power loss.
+     */
+    struct StreamSector {
+        static constexpr uint32_t MAGIC   = 0x54534E50;   // "PNST"
+        static constexpr uint32_t PAYLOAD = 512 - 16;
+
+        uint32_t magic;
+        uint32_t session;   // random per open(); stale sectors never match
+        uint32_t seq;       // sector index in the file
+        uint16_t len;       // payload bytes used (PAYLOAD except the last)
+        uint16_t reserved;
+        uint8_t  data[PAYLOAD];
+    };
+
+    struct StreamStats {
+        uint32_t bytes;         // payload accepted
+        uint32_t dropped;       // payload lost to a full ring / full file
+        uint32_t sectors;       // written to the card
+        uint32_t maxWriteUs;    // longest slot write
+    };
+
+    /**
+     * Recorder: write() copies into a ring of sector slots (single
+     * producer, any context), service() sends whole slots with one
+     * multi-sector disk_write each. FAT and directory are touched only
+     * by open() (f_expand + f_sync) and close() (truncate to the data).
+     */
+    class StreamWriter {
+    public:
+        /**
+         * @param ring         Slot memory: AXI SRAM, 32-byte aligned (IDMA
+         *                     reads it in place), multiple of slotSectors·512
+         * @param slotSectors  Sectors per disk_write
+         */
+        StreamWriter(uint8_t *ring, uint32_t ringSize, uint32_t slotSectors = 16);
+
+        /** Create `path` and preallocate `maxBytes` of payload contiguously */
+        Status   open(const char *path, uint32_t maxBytes);
+        /** Copy payload into the ring; returns bytes accepted (never blocks) */
+        uint32_t write(const void *data, uint32_t len);
+        /** Write full slots to the card; true if it wrote */
+        bool     service();
+        /** Write the partial slot, truncate the file to the data, close */
+        Status   close();
+
+        /**
+         * @brief  Send slots through the SD scheduler (telemetry class)
+         * @param  deadlineMs  Time a slot may wait — about the ring fill time
+         * @note   service() then only queues the next run of slots; the
+         *         scheduler's run() writes them. Call before open().
+         */
+        void     attach(SDScheduler &sched, uint32_t deadlineMs);
+
+        bool        isOpen() const { return open_; }
+        /** No scheduled slot write outstanding (close() would not wait) */
+        bool        idle()   const { return !req_.queued; }
+        StreamStats stats()  const { return stats_; }
+
+    private:
+        StreamSector *sectorAt(uint32_t n);
+        bool          writeSlots(uint32_t sectors);
+        static void   slotsDone(void *ctx, bool ok);
+
+        FIL       fil_;
+        uint8_t  *ring_;
+        uint32_t  slotSectors_;
+        uint32_t  ringSectors_;
+        uint32_t  startLba_    = 0;
+        uint32_t  capSectors_  = 0;
+        uint32_t  session_     = 0;
+        uint32_t  fillOff_     = 0;             // payload bytes in sector `head_`
+        volatile uint32_t head_ = 0;            // sector being filled (producer)
+        volatile uint32_t tail_ = 0;            // next sector to write (service)
+        bool      open_        = false;
+        bool      error_       = false;
+        StreamStats stats_{};
+        SDScheduler         *sched_      = nullptr;
+        SDScheduler::Request req_;
+        uint32_t             deadlineMs_ = 0;
+    };
+
+    /**
+     * Player: reads whole slots with disk_read and returns the payload.
+     * Stops at the first sector whose header does not continue the stream.
+     */
+    class StreamReader {
+    public:
+        StreamReader(uint8_t *buf, uint32_t bufSize);
+
+        Status   open(const char *path);
+        /** Payload bytes copied, 0 at end of stream */
+        uint32_t read(void *dst, uint32_t len);
+        void     close();
+
+    private:
+        FIL       fil_;
+        DWORD     clmt_[8];
+        uint8_t  *buf_;
+        uint32_t  bufSectors_;
+        uint32_t  startLba_   = 0;
+        uint32_t  fileSectors_ = 0;
+        uint32_t  session_    = 0;
+        uint32_t  next_       = 0;              // next sector to load
+        uint32_t  loaded_     = 0;              // sectors in buf_
+        uint32_t  cur_        = 0;              // sector in buf_ being consumed
+        uint32_t  curOff_     = 0;
+        bool      end_        = true;
+    };
+
+    /* ---------- Media index (sd_media.cpp) ------------------------------ */
+
+    /**
+     * Large read-only assets (audio / motion clips, recordings) kept open
+     * with a cached fast-seek cluster map, so a seek anywhere in the file
+     * costs no FAT reads — scrubbing and looping never stall on the chain.
+     * Registrations survive unmount; mount() reopens them and rebuilds the
+     * maps. Task / superloop context only (FatFs is not reentrant).
+     */
+    class MediaIndex {
+    public:
+        static constexpr int      MAX_FILES  = 6;
+        static constexpr uint32_t POOL_WORDS = 256;   // CLMT words, all files
+        static constexpr uint32_t PATH_LEN   = 32;
+
+        /** Register and open `path`; handle >= 0, or -1 */
+        int      add(const char *path);
+        void     remove(int h);
+
+        /** pread: `len` bytes from `offset`, seek is O(fragments) not O(clusters) */
+        Status   read(int h, uint32_t offset, void *dst, uint32_t len,
+                      uint32_t *bytesRead = nullptr);
+        uint32_t size(int h) const;
+        uint32_t fragments(int h) const;  // 0 = no map, linear seeks
+
+        /** Benchmark baseline: drop / restore the map of one file */
+        void     setFastSeek(int h, bool on);
+
+        void     reopenAll();             // after mount
+        void     closeAll();              // before unmount
+
+    private:
+        struct Entry {
+            char     path[PATH_LEN];
+            FIL      fil;
+            DWORD   *clmt;
+            bool     used;
+            bool     open;
+        };
+
+        bool  valid(int h) const { return h >= 0 && h < MAX_FILES && files_[h].used && files_[h].open; }
+        void  buildMaps();
+
+        Entry    files_[MAX_FILES] = {};
+        DWORD    pool_[POOL_WORDS];
+        uint32_t poolUsed_ = 0;
+    };
+
+    MediaIndex &media() { return media_; }
+
+    /**
+     * Read-ahead over a MediaIndex file for a steady consumer (audio):
+     * `chunks` buffers refilled by Job requests on the scheduler's audio
+     * class, each due when the consumer will reach it at `bytesPerSec`.
+     * The consumer side (front / pop, any task) never touches FatFs; the
+     * reads run in the card owner's SDScheduler::run().
+     */
+    class ReadAhead {
+    public:
+        static constexpr uint32_t MAX_CHUNKS = 8;
+
+        /**
+         * @param buf        chunks · chunkSize bytes, 32-byte aligned (IDMA)
+         * @param chunkSize  Bytes per read, sector multiple
+         */
+        ReadAhead(MediaIndex &media, SDScheduler &sched,
+                  uint8_t *buf, uint32_t chunkSize, uint32_t chunks);
+
+        /** Queue every chunk from `offset`; file h must be open */
+        Status         start(int h, uint32_t offset, uint32_t bytesPerSec);
+        /** Filled chunk at the read position, nullptr while it is not in; len 0 = end */
+        const uint8_t *front(uint32_t &len) const;
+        /** Done with front(): refill it one ring further on */
+        void           pop();
+        /** No more refills; queued ones finish without reading */
+        void           stop();
+        /** Nothing queued (the file can be removed) */
+        bool           idle() const;
+        bool           failed() const { return error_; }
+
+    private:
+        struct Chunk {
+            SDScheduler::Request req;
+            ReadAhead           *owner;
+            uint8_t             *data;
+            uint32_t             offset;
+            uint32_t             len;
+            volatile bool        ready;
+        };
+
+        void        queue(Chunk &c);
+        static bool fillJob(void *ctx);
+        static void fillDone(void *ctx, bool ok);
+
+        MediaIndex    &media_;
+        SDScheduler   &sched_;
+        Chunk          chunk_[MAX_CHUNKS] = {};
+        uint32_t       chunks_;
+        uint32_t       chunkSize_;
+        int            h_        = -1;
+        uint32_t       base_     = 0;       // offset at start()
+        uint32_t       next_     = 0;       // offset of the next chunk to queue
+        uint32_t       bps_      = 1;
+        uint64_t       startUs_  = 0;
+        uint32_t       head_     = 0;       // chunk at the read position
+        volatile bool  stopped_  = true;
+        volatile bool  error_    = false;
+    };
+
+    /**
+     * @brief  Repair a stream file after power loss
+     * @param  payloadBytes  Recovered payload size
+     * @note   Binary-searches the last valid sector (log2 N reads), then
+     *         truncates the file to it so FAT and size match the data.
+     */
+    static Status streamRecover(const char *path, uint32_t &payloadBytes);
+
 private:
     SD_HandleTypeDef &hsd_;
     bool mounted_ = false;
+    MediaIndex media_;
 };
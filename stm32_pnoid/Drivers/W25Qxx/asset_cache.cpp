@@ -0,0 +1,320 @@
+/**
+ * @file    asset_cache.cpp
+ * @brief   MDMA prefetch line cache — see asset_cache.hpp
+ */
+
+#include "asset_cache.hpp"
+#include <cstring>
+
+/* ---------- Singleton pointer for HAL callbacks -------------------------- */
+
+static AssetCache *g_cache = nullptr;
+
+AssetCache::AssetCache(W25Qxx &flash, MDMA_HandleTypeDef &hmdma, uint8_t *buf, uint32_t size)
+    : flash_(flash), hmdma_(hmdma), buf_(buf),
+      lines_(size / LINE_SIZE < MAX_LINES ? size / LINE_SIZE : MAX_LINES)
+{
+}
+
+AssetCache::Status AssetCache::init(MDMA_Channel_TypeDef *channel)
+{
+    if (lines_ == 0 || (reinterpret_cast<uintptr_t>(buf_) & 31u) != 0) return Status::ErrParam;
+
+    __HAL_RCC_MDMA_CLK_ENABLE();
+
+    /* Software-triggered block: one request moves the whole line,
+     * 16-beat word bursts never cross a 1 KB boundary inside a line */
+    hmdma_.Instance                      = channel;
+    hmdma_.Init.Request                  = MDMA_REQUEST_SW;
+    hmdma_.Init.TransferTriggerMode      = MDMA_BLOCK_TRANSFER;
+    hmdma_.Init.Priority                 = MDMA_PRIORITY_LOW;
+    hmdma_.Init.Endianness               = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+    hmdma_.Init.SourceInc                = MDMA_SRC_INC_WORD;
+    hmdma_.Init.DestinationInc           = MDMA_DEST_INC_WORD;
+    hmdma_.Init.SourceDataSize           = MDMA_SRC_DATASIZE_WORD;
+    hmdma_.Init.DestDataSize             = MDMA_DEST_DATASIZE_WORD;
+    hmdma_.Init.DataAlignment            = MDMA_DATAALIGN_PACKENABLE;
+    hmdma_.Init.BufferTransferLength     = 128;
+    hmdma_.Init.SourceBurst              = MDMA_SOURCE_BURST_16BEATS;
+    hmdma_.Init.DestBurst                = MDMA_DEST_BURST_16BEATS;
+    hmdma_.Init.SourceBlockAddressOffset = 0;
+    hmdma_.Init.DestBlockAddressOffset   = 0;
+    if (HAL_MDMA_Init(&hmdma_) != HAL_OK) return Status::ErrDma;
+
+    HAL_MDMA_RegisterCallback(&hmdma_, HAL_MDMA_XFER_CPLT_CB_ID, dmaDone);
+    HAL_MDMA_RegisterCallback(&hmdma_, HAL_MDMA_XFER_ERROR_CB_ID, dmaError);
+
+    /* Same level as the QSPI / SD completions it runs next to */
+    HAL_NVIC_SetPriority(MDMA_IRQn, 7, 0);
+    HAL_NVIC_EnableIRQ(MDMA_IRQn);
+
+    g_cache = this;
+    flash_.setInvalidateHook(invalidateHook, this);
+    ready_ = true;
+    return Status::OK;
+}
+
+/* ---------- Requests ----------------------------------------------------- */
+
+AssetCache::Status AssetCache::prefetch(Request &req)
+{
+    if (req.pending) return Status::ErrBusy;
+    if (req.size == 0 || req.address > W25Qxx::CHIP_SIZE
+            || req.size > W25Qxx::CHIP_SIZE - req.address) return Status::ErrParam;
+
+    const uint32_t first = req.address / LINE_SIZE;
+    const uint32_t last  = (req.address + req.size - 1) / LINE_SIZE;
+    if (last - first + 1 > lines_) return Status::ErrParam;
+
+    req.result  = Status::OK;
+    req.next    = nullptr;
+    req.pending = true;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (qTail_) qTail_->next = &req;
+    else        qHead_       = &req;
+    qTail_ = &req;
+    stats_.requests++;
+    __set_PRIMASK(primask);
+    return Status::OK;
+}
+
+void AssetCache::service()
+{
+    if (fetching_) {
+        if (!dmaDone_ && !dmaError_) {
+            if (HAL_GetTick() - fetchMs_ <= TIMEOUT_MS) return;
+            HAL_MDMA_Abort(&hmdma_);
+            dmaError_ = true;
+        }
+        finishFetch();
+    }
+
+    /* Head request: touch its resident lines (newest in LRU order), fetch
+     * the first missing one; one line in flight at a time */
+    while (qHead_ != nullptr && !fetching_) {
+        const Request &r = *qHead_;
+        const uint32_t end = r.address + r.size;
+        bool resident = true;
+
+        for (uint32_t tag = r.address & ~(LINE_SIZE - 1); tag < end; tag += LINE_SIZE) {
+            int i = find(tag);
+            if (i >= 0 && line_[i].state == Valid) {
+                line_[i].stamp = ++clock_;
+                continue;
+            }
+            resident = false;
+            if (!startFetch(tag)) return;   // a write covers it / holds the bus
+            break;
+        }
+        if (resident) complete(Status::OK);
+    }
+}
+
+/** Pop the head request and notify it */
+void AssetCache::complete(Status st)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Request *r = qHead_;
+    qHead_ = r->next;
+    if (qHead_ == nullptr) qTail_ = nullptr;
+    __set_PRIMASK(primask);
+
+    r->result  = st;
+    r->pending = false;
+    if (r->ready) r->ready(r->ctx, st);
+}
+
+/* ---------- Line fetch --------------------------------------------------- */
+
+int AssetCache::find(uint32_t tag) const
+{
+    for (uint32_t i = 0; i < lines_; i++) {
+        if (line_[i].state != Empty && line_[i].tag == tag) return (int)i;
+    }
+    return -1;
+}
+
+/** Claim the LRU line and start the MDMA copy; false to retry next pass */
+bool AssetCache::startFetch(uint32_t tag)
+{
+    if (!flash_.regionStable(tag, LINE_SIZE)) return false;
+    if (!flash_.mmapAcquire()) return false;
+
+    uint32_t victim = 0;
+    for (uint32_t i = 0; i < lines_; i++) {
+        if (line_[i].state == Empty) { victim = i; break; }
+        if (line_[i].stamp < line_[victim].stamp) victim = i;
+    }
+
+    Line &l = line_[victim];
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (l.state == Valid) stats_.evictions++;
+    l.gen++;                            // readers of the old contents retry
+    l.state = Filling;
+    l.tag   = tag;
+    l.stale = false;
+    __set_PRIMASK(primask);
+    l.stamp = ++clock_;
+
+    /* The CPU never writes the lines: nothing dirty to lose */
+    SCB_InvalidateDCache_by_Addr(data(victim), (int32_t)LINE_SIZE);
+
+    fetchLine_  = victim;
+    fetchMs_    = HAL_GetTick();
+    dmaDone_    = false;
+    dmaError_   = false;
+    fetching_   = true;
+    fetchStart_ = DWT->CYCCNT;
+    if (HAL_MDMA_Start_IT(&hmdma_, W25Qxx::MMAP_BASE + tag,
+                          (uint32_t)reinterpret_cast<uintptr_t>(data(victim)), LINE_SIZE, 1) != HAL_OK) {
+        dmaError_ = true;
+        finishFetch();
+        return false;
+    }
+    return true;
+}
+
+/** Hand the mapping back and publish (or drop) the fetched line */
+void AssetCache::finishFetch()
+{
+    Line &l = line_[fetchLine_];
+    flash_.mmapRelease();
+
+    bool failed = dmaError_;
+    if (!failed) {
+        SCB_InvalidateDCache_by_Addr(data(fetchLine_), (int32_t)LINE_SIZE);
+        stats_.fetches++;
+        stats_.dmaCycles += fetchCycles_;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (failed || l.stale) {
+        l.gen++;
+        l.state = Empty;
+    } else {
+        l.state = Valid;
+    }
+    __set_PRIMASK(primask);
+    fetching_ = false;
+
+    if (failed) {
+        stats_.errors++;
+        complete(Status::ErrDma);
+    }
+}
+
+void AssetCache::dmaDone(MDMA_HandleTypeDef *)
+{
+    AssetCache *self = g_cache;
+    if (self == nullptr) return;
+    self->fetchCycles_ = DWT->CYCCNT - self->fetchStart_;
+    self->dmaDone_     = true;
+}
+
+void AssetCache::dmaError(MDMA_HandleTypeDef *)
+{
+    if (g_cache) g_cache->dmaError_ = true;
+}
+
+/* ---------- Reads -------------------------------------------------------- */
+
+/** Copy from a resident line; false if it is missing or was reused meanwhile */
+bool AssetCache::copyLine(uint32_t tag, uint32_t offset, uint8_t *out, uint32_t n)
+{
+    int i = find(tag);
+    if (i < 0) return false;
+
+    Line &l = line_[i];
+    uint32_t gen = l.gen;
+    __COMPILER_BARRIER();
+    if (l.state != Valid || l.tag != tag) return false;
+    memcpy(out, data((uint32_t)i) + offset, n);
+    __COMPILER_BARRIER();
+    if (l.gen != gen) return false;
+
+    l.stamp = ++clock_;
+    return true;
+}
+
+bool AssetCache::read(uint32_t address, void *out, uint32_t len)
+{
+    if (address > W25Qxx::CHIP_SIZE || len > W25Qxx::CHIP_SIZE - address) return false;
+
+    uint32_t c0  = DWT->CYCCNT;
+    uint8_t *dst = static_cast<uint8_t *>(out);
+    uint32_t got = 0;
+
+    while (got < len) {
+        const uint32_t a   = address + got;
+        const uint32_t tag = a & ~(LINE_SIZE - 1);
+        const uint32_t n   = (len - got) < (tag + LINE_SIZE - a) ? (len - got) : (tag + LINE_SIZE - a);
+        if (!copyLine(tag, a - tag, dst + got, n)) break;
+        got += n;
+    }
+
+    if (got == len) {
+        stats_.hits++;
+        stats_.hitBytes  += len;
+        stats_.hitCycles += DWT->CYCCNT - c0;
+        return true;
+    }
+
+    /* Miss: the rest straight from the mapped window */
+    if (!flash_.mmapAcquire()) return false;
+    memcpy(dst + got, reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE + address + got), len - got);
+    flash_.mmapRelease();
+
+    stats_.misses++;
+    stats_.hitBytes   += got;
+    stats_.missBytes  += len - got;
+    stats_.missCycles += DWT->CYCCNT - c0;
+    return true;
+}
+
+bool AssetCache::contains(uint32_t address, uint32_t len) const
+{
+    if (len == 0) return true;
+    for (uint32_t tag = address & ~(LINE_SIZE - 1); tag < address + len; tag += LINE_SIZE) {
+        int i = find(tag);
+        if (i < 0 || line_[i].state != Valid) return false;
+    }
+    return true;
+}
+
+/* ---------- Invalidation ------------------------------------------------- */
+
+void AssetCache::invalidate(uint32_t address, uint32_t size)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < lines_; i++) {
+        Line &l = line_[i];
+        if (l.state == Empty || l.tag >= address + size || address >= l.tag + LINE_SIZE) continue;
+        if (l.state == Filling) {
+            l.stale = true;             // dropped by finishFetch()
+        } else {
+            l.gen++;
+            l.state = Empty;
+        }
+        stats_.invalidations++;
+    }
+    __set_PRIMASK(primask);
+}
+
+void AssetCache::invalidateHook(void *ctx, uint32_t address, uint32_t size)
+{
+    static_cast<AssetCache *>(ctx)->invalidate(address, size);
+}
+
+void AssetCache::resetStats()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats_ = {};
+    __set_PRIMASK(primask);
+}
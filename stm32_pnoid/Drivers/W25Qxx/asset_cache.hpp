@@ -0,0 +1,166 @@
+/**
+ * @file    asset_cache.hpp
+ * @brief   MDMA prefetch of QSPI asset ranges into an SRAM line cache
+ * @note    For random-access consumers (mixing, sprite compositing) that
+ *          would otherwise stall on mapped-flash cache misses.
+ *
+ * The cache is a caller-provided buffer (AXI SRAM) split into LINE_SIZE
+ * lines, each holding one LINE_SIZE-aligned piece of the flash:
+ *
+ *   prefetch(req)   queue a range; service() copies its missing lines
+ *                   out of the mapped window with MDMA (software-triggered
+ *                   block transfer, CPU free meanwhile) and calls
+ *                   req.ready once every line is resident
+ *   read()          copy bytes out; cached lines come from SRAM, the rest
+ *                   from the mapped window as before (counted as a miss)
+ *
+ * Eviction is LRU: every read() and prefetch() touch stamps the line, the
+ * fetch reuses the line with the oldest stamp. Lines of the request being
+ * filled are the newest, so a request never evicts itself.
+ *
+ * Flash writes: the W25Qxx invalidate hook drops every line a queued
+ * write overlaps (or marks it stale if its fetch is in flight), and a
+ * fetch waits until regionStable() says no write covers it. While a line
+ * is being copied the cache holds the mapping (mmapAcquire), ~140 us per
+ * 4 KB line at the board's QSPI clock.
+ *
+ * Thread safety: read() / contains() / prefetch() from any thread; a line
+ * reused under a reader is detected by its generation count and re-read
+ * from flash. service() from one thread, next to W25Qxx::service().
+ */
+
+#pragma once
+
+#include "w25qxx.hpp"
+#include <cstdint>
+
+class AssetCache {
+public:
+    enum class Status {
+        OK = 0,
+        ErrParam,       // range outside the chip or larger than the cache
+        ErrBusy,        // request already queued
+        ErrDma,
+    };
+
+    static constexpr uint32_t LINE_SIZE  = 4096;
+    static constexpr uint32_t MAX_LINES  = 32;
+    static constexpr uint32_t TIMEOUT_MS = 10;     // one line, MDMA stuck
+
+    struct Request {
+        uint32_t        address = 0;    // flash offset
+        uint32_t        size    = 0;
+        void          (*ready)(void *ctx, Status st) = nullptr;   // from service()
+        void           *ctx     = nullptr;
+
+        /* Cache-owned */
+        volatile bool   pending = false;    // queued or being fetched
+        Status          result  = Status::OK;
+        Request        *next    = nullptr;
+    };
+
+    struct Stats {
+        uint32_t requests;
+        uint32_t fetches;           // lines copied by MDMA
+        uint32_t evictions;         // valid lines reused
+        uint32_t invalidations;     // lines dropped by a flash write
+        uint32_t errors;
+        uint32_t dmaCycles;         // MDMA busy time over all fetches
+        uint32_t hits;              // read() served from SRAM only
+        uint32_t misses;            // read() that went to the mapped window
+        uint32_t hitBytes;
+        uint32_t missBytes;
+        uint64_t hitCycles;         // CPU cycles spent in read()
+        uint64_t missCycles;
+    };
+
+    /**
+     * @param  flash  Driver in memory-mapped default mode
+     * @param  hmdma  Handle for the channel used (Instance set by init())
+     * @param  buf    Line storage, 32-byte aligned, cacheable or not
+     * @param  size   Bytes, LINE_SIZE multiple up to MAX_LINES lines
+     */
+    AssetCache(W25Qxx &flash, MDMA_HandleTypeDef &hmdma, uint8_t *buf, uint32_t size);
+
+    /**
+     * @brief  Configure the MDMA channel, register the invalidate hook
+     * @note   Enables the MDMA clock and MDMA_IRQn; the IRQ handler calls
+     *         HAL_MDMA_IRQHandler on the same handle
+     */
+    Status   init(MDMA_Channel_TypeDef *channel);
+
+    /** Queue a range; req.ready(ctx, st) from service() when resident */
+    Status   prefetch(Request &req);
+
+    /**
+     * @brief  Start / finish line fetches, deliver ready callbacks
+     * @note   Thread context, one thread
+     */
+    void     service();
+
+    /**
+     * @brief  Copy len bytes at flash offset address into out
+     * @retval false if the range was not cached and the mapping is held
+     *         by a write (try again)
+     */
+    bool     read(uint32_t address, void *out, uint32_t len);
+
+    /** Every line of the range is resident */
+    bool     contains(uint32_t address, uint32_t len) const;
+
+    /** Drop the lines overlapping a range (W25Qxx invalidate hook) */
+    void     invalidate(uint32_t address, uint32_t size);
+
+    bool     isReady() const { return ready_; }     // init() succeeded
+    bool     busy() const { return fetching_ || qHead_ != nullptr; }
+    uint32_t lines() const { return lines_; }
+
+    const Stats &stats() const { return stats_; }
+    void     resetStats();
+
+    /** MDMA completion / error (HAL callbacks, MDMA_IRQHandler context) */
+    static void dmaDone(MDMA_HandleTypeDef *hmdma);
+    static void dmaError(MDMA_HandleTypeDef *hmdma);
+
+private:
+    enum State : uint8_t { Empty = 0, Filling, Valid };
+
+    struct Line {
+        volatile uint32_t tag;      // flash offset, LINE_SIZE aligned
+        volatile uint32_t gen;      // bumped whenever the contents change
+        volatile uint8_t  state;
+        volatile bool     stale;    // invalidated while its fetch ran
+        uint32_t          stamp;    // LRU: clock_ at the last use
+    };
+
+    W25Qxx              &flash_;
+    MDMA_HandleTypeDef  &hmdma_;
+    uint8_t             *buf_;
+    uint32_t             lines_;
+    Line                 line_[MAX_LINES] = {};
+    uint32_t             clock_    = 0;
+    bool                 ready_    = false;
+
+    Request             *qHead_    = nullptr;
+    Request             *qTail_    = nullptr;
+
+    /* Line being fetched */
+    volatile bool        fetching_ = false;
+    volatile bool        dmaDone_  = false;
+    volatile bool        dmaError_ = false;
+    uint32_t             fetchLine_   = 0;
+    uint32_t             fetchStart_  = 0;     // DWT cycles
+    uint32_t             fetchMs_     = 0;
+    volatile uint32_t    fetchCycles_ = 0;
+
+    Stats                stats_ = {};
+
+    int      find(uint32_t tag) const;
+    uint8_t *data(uint32_t i) const { return buf_ + i * LINE_SIZE; }
+    bool     copyLine(uint32_t tag, uint32_t offset, uint8_t *out, uint32_t n);
+    bool     startFetch(uint32_t tag);
+    void     finishFetch();
+    void     complete(Status st);
+
+    static void invalidateHook(void *ctx, uint32_t address, uint32_t size);
+};
@@ -0,0 +1,180 @@
+/**
+ * @file    asset_codec.cpp
+ * @brief   Streaming PLZ decoder — see asset_codec.hpp
+ */
+
+#include "asset_codec.hpp"
+#include <cstring>
+
+LzDecoder::LzDecoder(uint8_t *ring, uint32_t ringSize)
+    : ring_(ring), ringMask_(ringSize - 1)
+{
+}
+
+LzDecoder::Status LzDecoder::open(const uint8_t *&in, const uint8_t *inEnd)
+{
+    pos_    = 0;
+    state_  = State::Token;
+    carry_  = false;
+    low_    = 0;
+    prev_[0] = prev_[1] = 0;
+    status_ = Status::ErrFormat;
+
+    if (inEnd - in < (int32_t)HEADER_SIZE) return status_;
+    uint32_t magic, raw;
+    memcpy(&magic, in, 4);
+    memcpy(&raw, in + 4, 4);
+    uint8_t windowLog = in[8];
+    uint8_t filter    = in[9];
+
+    if (magic != MAGIC || windowLog > 16 || filter > (uint8_t)Filter::Delta16Stereo
+            || (1u << windowLog) > ringMask_ + 1) return status_;
+
+    rawSize_ = raw;
+    window_  = 1u << windowLog;
+    filter_  = static_cast<Filter>(filter);
+    in      += HEADER_SIZE;
+    status_  = Status::OK;
+    return status_;
+}
+
+/** Append n decoded (still filtered) bytes to out and the history ring */
+inline void LzDecoder::put(uint8_t *out, const uint8_t *src, uint32_t n)
+{
+    memcpy(out, src, n);
+    uint32_t at    = pos_ & ringMask_;
+    uint32_t first = ringMask_ + 1 - at;
+    if (first > n) first = n;
+    memcpy(&ring_[at], src, first);
+    if (n > first) memcpy(ring_, src + first, n - first);
+    pos_ += n;
+}
+
+uint32_t LzDecoder::decode(const uint8_t *&in, const uint8_t *inEnd, uint8_t *out, uint32_t outLen)
+{
+    const uint32_t start = pos_;
+    uint32_t produced = 0;
+
+    while (status_ == Status::OK && pos_ < rawSize_) {
+        uint32_t space = outLen - produced;
+
+        if (state_ == State::Match) {
+            if (space == 0) break;
+            uint32_t n = match_ < space ? match_ : space;
+            match_ -= n;
+            if (offset_ < 16) {
+                /* Short period (runs, repeated pixels): byte copy */
+                for (; n > 0; n--) {
+                    uint8_t c = ring_[(pos_ - offset_) & ringMask_];
+                    ring_[pos_ & ringMask_] = c;
+                    out[produced++] = c;
+                    pos_++;
+                }
+            }
+            while (n > 0) {
+                /* Contiguous run: no ring wrap on either side, no overlap */
+                uint32_t src   = (pos_ - offset_) & ringMask_;
+                uint32_t dst   = pos_ & ringMask_;
+                uint32_t chunk = n;
+                if (chunk > offset_)               chunk = offset_;
+                if (chunk > ringMask_ + 1 - src)   chunk = ringMask_ + 1 - src;
+                if (chunk > ringMask_ + 1 - dst)   chunk = ringMask_ + 1 - dst;
+                memcpy(&out[produced], &ring_[src], chunk);
+                memmove(&ring_[dst], &ring_[src], chunk);   // same bytes when offset == ring
+                pos_     += chunk;
+                produced += chunk;
+                n        -= chunk;
+            }
+            if (match_ == 0) state_ = State::Token;
+            continue;
+        }
+
+        if (state_ == State::Literal) {
+            uint32_t avail = (uint32_t)(inEnd - in);
+            uint32_t n = lit_;
+            if (n > space) n = space;
+            if (n > avail) n = avail;
+            if (n == 0 && lit_ > 0) break;
+            put(&out[produced], in, n);
+            in       += n;
+            produced += n;
+            lit_     -= n;
+            if (lit_ == 0) state_ = State::Off0;
+            continue;
+        }
+
+        if (in >= inEnd) break;
+        uint8_t b = *in++;
+
+        switch (state_) {
+        case State::Token:
+            lit_   = b >> 4;
+            match_ = (b & 0x0F) + 4u;
+            state_ = lit_ == 15 ? State::LitExt : (lit_ ? State::Literal : State::Off0);
+            break;
+        case State::LitExt:
+            lit_ += b;
+            if (b != 255) state_ = State::Literal;
+            break;
+        case State::Off0:
+            offset_ = b;
+            state_  = State::Off1;
+            break;
+        case State::Off1:
+            offset_ |= (uint32_t)b << 8;
+            if (offset_ == 0 || offset_ > window_ || offset_ > pos_) {
+                status_ = Status::ErrCorrupt;
+                break;
+            }
+            state_ = match_ == 19 ? State::MatchExt : State::Match;
+            break;
+        case State::MatchExt:
+            match_ += b;
+            if (b != 255) state_ = State::Match;
+            break;
+        default:
+            break;
+        }
+
+        if (state_ == State::Match && match_ > rawSize_ - pos_) status_ = Status::ErrCorrupt;
+        if (state_ == State::Literal && lit_ > rawSize_ - pos_) status_ = Status::ErrCorrupt;
+    }
+
+    if (filter_ != Filter::None) unfilter(out, produced, start);
+    return produced;
+}
+
+/**
+ * Undo the 16-bit delta in place. Whole samples in one add; a sample split
+ * across two decode() calls keeps its low byte and carry in low_ / carry_.
+ */
+void LzDecoder::unfilter(uint8_t *out, uint32_t n, uint32_t p)
+{
+    const uint32_t chMask = filter_ == Filter::Delta16 ? 0 : 1;
+    uint32_t i = 0;
+
+    if ((p & 1) && n > 0) {                 /* high byte of a split sample */
+        uint32_t ch = (p >> 1) & chMask;
+        uint8_t  hi = (uint8_t)(out[0] + (prev_[ch] >> 8) + (carry_ ? 1 : 0));
+        prev_[ch] = (uint16_t)(low_ | hi << 8);
+        out[0] = hi;
+        i = 1;
+        p++;
+    }
+
+    for (; i + 1 < n; i += 2, p += 2) {
+        uint32_t ch = (p >> 1) & chMask;
+        uint16_t v  = (uint16_t)((out[i] | out[i + 1] << 8) + prev_[ch]);
+        prev_[ch]  = v;
+        out[i]     = (uint8_t)v;
+        out[i + 1] = (uint8_t)(v >> 8);
+    }
+
+    if (i < n) {                            /* low byte; high byte next call */
+        uint32_t ch = (p >> 1) & chMask;
+        uint32_t v  = (uint32_t)out[i] + (prev_[ch] & 0xFF);
+        carry_ = v > 0xFF;
+        low_   = (uint8_t)v;
+        out[i] = low_;
+    }
+}
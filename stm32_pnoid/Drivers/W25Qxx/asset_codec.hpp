@@ -0,0 +1,89 @@
+/**
+ * @file    asset_codec.hpp
+ * @brief   Streaming LZ decoder for compressed assets (PLZ format)
+ * @note    Encoder: scripts/asset_codec.py (asset_pack.py --compress).
+ *
+ * PLZ is LZ4's sequence format with a small window, so the decoder's only
+ * RAM is a history ring of 2^windowLog bytes (4 KB by default) instead of
+ * the whole asset:
+ *
+ *   header   "PLZ1", rawSize u32, windowLog u8, filter u8, u16 reserved
+ *   sequence token (literals << 4 | match - 4), literal length bytes
+ *            (255 = more), literals, offset u16 (1..window), match
+ *            length bytes; the last sequence has literals only
+ *
+ * decode() is incremental on both sides: input arrives in any pieces
+ * (the whole blob from mapped flash, or SD sectors) and output goes
+ * straight into the caller's buffer — an LCD line, an I2S chunk — up to
+ * its size, resuming mid-literal-run or mid-match on the next call.
+ *
+ * Filters (16-bit PCM): Delta16 / Delta16Stereo store each sample as the
+ * difference to the previous one of its channel, which LZ then finds
+ * repeats in. Undone on the fly after the LZ step.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class LzDecoder {
+public:
+    enum class Status {
+        OK = 0,
+        ErrFormat,      // bad header, or window larger than the ring
+        ErrCorrupt,     // offset / length outside the data
+    };
+
+    enum class Filter : uint8_t {
+        None = 0,
+        Delta16,        // mono 16-bit LE
+        Delta16Stereo,  // interleaved L/R 16-bit LE
+    };
+
+    static constexpr uint32_t MAGIC       = 0x315A4C50;    // "PLZ1"
+    static constexpr uint32_t HEADER_SIZE = 12;
+
+    /**
+     * @param  ring      History RAM, power of two ≥ the stream's window
+     * @param  ringSize  Bytes
+     */
+    LzDecoder(uint8_t *ring, uint32_t ringSize);
+
+    /** Parse the header; in advances by HEADER_SIZE */
+    Status   open(const uint8_t *&in, const uint8_t *inEnd);
+
+    /**
+     * @brief  Decode up to outLen bytes
+     * @param  in      Compressed input, advanced past what was consumed
+     * @retval Bytes written to out; less than outLen when the input ran
+     *         out, at the end of the stream, or on error (see status())
+     */
+    uint32_t decode(const uint8_t *&in, const uint8_t *inEnd, uint8_t *out, uint32_t outLen);
+
+    bool     done() const      { return pos_ == rawSize_ || status_ != Status::OK; }
+    Status   status() const    { return status_; }
+    uint32_t rawSize() const   { return rawSize_; }
+    uint32_t position() const  { return pos_; }
+
+private:
+    enum class State : uint8_t { Token, LitExt, Literal, Off0, Off1, MatchExt, Match };
+
+    uint8_t  *ring_;
+    uint32_t  ringMask_;
+
+    uint32_t  rawSize_  = 0;
+    uint32_t  window_   = 0;
+    uint32_t  pos_      = 0;        // decoded bytes so far
+    uint32_t  lit_      = 0;
+    uint32_t  match_    = 0;
+    uint32_t  offset_   = 0;
+    State     state_    = State::Token;
+    Status    status_   = Status::OK;
+    Filter    filter_   = Filter::None;
+    uint16_t  prev_[2]  = {};       // delta filter: last sample per channel
+    uint8_t   low_      = 0;        // low byte of a sample split across calls
+    bool      carry_    = false;    // ... and its carry into the high byte
+
+    void     put(uint8_t *out, const uint8_t *src, uint32_t n);
+    void     unfilter(uint8_t *out, uint32_t n, uint32_t p);
+};
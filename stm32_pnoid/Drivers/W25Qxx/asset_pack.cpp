@@ -0,0 +1,320 @@
+/**
+ * @file    asset_pack.cpp
+ * @brief   Asset pack lookup and in-place writer — see asset_pack.hpp
+ */
+
+#include "asset_pack.hpp"
+#include <cstring>
+
+/* Read-modify-write buffer: one sector in flight */
+alignas(32) static uint8_t staging[W25Qxx::SECTOR_SIZE];
+
+static constexpr uint32_t SECTOR = W25Qxx::SECTOR_SIZE;
+
+AssetPack::AssetPack(W25Qxx &flash, uint32_t base, uint32_t maxSize)
+    : flash_(flash), base_(base), maxSize_(maxSize),
+      map_(reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE + base))
+{
+}
+
+/* ---------- CRC-32 (zlib polynomial, nibble table) ----------------------- */
+
+uint32_t AssetPack::crc32(uint32_t crc, const void *data, uint32_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/* ---------- Lookup ------------------------------------------------------- */
+
+AssetPack::Status AssetPack::mount()
+{
+    mounted_ = false;
+    if (!flash_.mmapAcquire()) return Status::ErrBusy;
+
+    const Header *h = reinterpret_cast<const Header *>(map_);
+    Status st = Status::OK;
+
+    if (h->magic != MAGIC || h->version != VERSION
+            || h->slotCount == 0 || (h->slotCount & (h->slotCount - 1)) != 0
+            || h->dirSize % SECTOR != 0
+            || sizeof(Header) + h->slotCount * sizeof(Entry) > h->dirSize
+            || h->dirSize > h->totalSize || h->totalSize > maxSize_) {
+        st = Status::ErrNoPack;
+    } else {
+        Header copy = *h;
+        copy.dirCrc = 0;
+        uint32_t crc = crc32(0, &copy, sizeof(copy));
+        crc = crc32(crc, map_ + sizeof(Header), h->dirSize - sizeof(Header));
+        if (crc != h->dirCrc) st = Status::ErrCorrupt;
+    }
+
+    if (st == Status::OK) hdr_ = *h;
+    flash_.mmapRelease();
+
+    mounted_ = st == Status::OK;
+    return st;
+}
+
+const AssetPack::Entry *AssetPack::lookup(uint32_t h, const char *name) const
+{
+    if (!mounted_) return nullptr;
+
+    const Entry   *tbl  = slotTable();
+    const uint32_t mask = hdr_.slotCount - 1u;
+    uint32_t i = h & mask;
+    for (uint32_t n = 0; n <= mask; n++, i = (i + 1) & mask) {
+        const Entry &e = tbl[i];
+        if (e.hash == 0) return nullptr;
+        if (e.hash == h && strcmp(reinterpret_cast<const char *>(map_ + e.nameOffset), name) == 0)
+            return &e;
+    }
+    return nullptr;
+}
+
+bool AssetPack::find(uint32_t h, const char *name, Asset &out) const
+{
+    const Entry *e = lookup(h, name);
+    if (e == nullptr) return false;
+
+    out.data = map_ + e->offset;
+    out.size = e->size;
+    out.type = static_cast<Type>(e->type);
+    out.crc  = e->crc;
+    out.slot = static_cast<uint16_t>(e - slotTable());
+    out.flags = e->flags;
+    return true;
+}
+
+bool AssetPack::at(uint32_t slot, Asset &out, const char **name) const
+{
+    if (!mounted_ || slot >= hdr_.slotCount) return false;
+    const Entry &e = slotTable()[slot];
+    if (e.hash == 0) return false;
+
+    out.data = map_ + e.offset;
+    out.size = e.size;
+    out.type = static_cast<Type>(e.type);
+    out.crc  = e.crc;
+    out.slot = static_cast<uint16_t>(slot);
+    out.flags = e.flags;
+    if (name) *name = reinterpret_cast<const char *>(map_ + e.nameOffset);
+    return true;
+}
+
+bool AssetPack::verify(const Asset &a) const
+{
+    return crc32(0, a.data, a.size) == a.crc;
+}
+
+/* ---------- Writer ------------------------------------------------------- */
+
+AssetPack::Status AssetPack::write(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    if (busy()) return Status::ErrBusy;
+    if (len == 0 || offset > maxSize_ || len > maxSize_ - offset) return Status::ErrTooBig;
+
+    mounted_   = false;
+    remount_   = false;
+    seg_[0]    = { offset, data, len };
+    segCount_  = 1;
+    segIndex_  = 0;
+    segDone_   = 0;
+    result_    = Status::OK;
+    startMs_   = HAL_GetTick();
+    service();
+    return Status::OK;
+}
+
+AssetPack::Status AssetPack::erase(uint32_t offset, uint32_t len)
+{
+    if (busy()) return Status::ErrBusy;
+    if (len == 0 || offset > maxSize_ || len > maxSize_ - offset
+            || offset % SECTOR != 0 || len % SECTOR != 0) return Status::ErrTooBig;
+
+    mounted_  = false;
+    remount_  = false;
+    result_   = Status::OK;
+    startMs_  = HAL_GetTick();
+
+    eraseOp_.kind    = W25Qxx::AsyncOp::Kind::Erase;
+    eraseOp_.address = base_ + offset;
+    eraseOp_.size    = len;
+    eraseOp_.done    = sectorDone;
+    eraseOp_.ctx     = this;
+    sectorPending_   = true;
+    if (flash_.submit(eraseOp_) != W25Qxx::Status::OK) {
+        sectorPending_ = false;
+        result_ = Status::ErrFlash;
+        return result_;
+    }
+
+    for (uint32_t s = offset / SECTOR; s < (offset + len) / SECTOR; s++)
+        erased_[s / 8] |= (uint8_t)(1u << (s % 8));
+    return Status::OK;
+}
+
+AssetPack::Status AssetPack::replace(const char *name, const uint8_t *data, uint32_t size)
+{
+    if (busy()) return Status::ErrBusy;
+    if (!mounted_) return Status::ErrNoPack;
+    if (!flash_.mmapAcquire()) return Status::ErrBusy;
+
+    const Entry *e = lookup(hash(name), name);
+    Status st = Status::OK;
+    if (e == nullptr)              st = Status::ErrNotFound;
+    else if (size > e->capacity)   st = Status::ErrTooBig;
+
+    if (st == Status::OK) {
+        newEntry_      = *e;
+        newEntry_.size = size;
+        newEntry_.crc  = crc32(0, data, size);
+
+        /* Directory CRC with the new entry spliced in */
+        const uint32_t entryOff = (uint32_t)(reinterpret_cast<const uint8_t *>(e) - map_);
+        newHeader_        = hdr_;
+        newHeader_.dirCrc = 0;
+        uint32_t crc = crc32(0, &newHeader_, sizeof(Header));
+        crc = crc32(crc, map_ + sizeof(Header), entryOff - sizeof(Header));
+        crc = crc32(crc, &newEntry_, sizeof(Entry));
+        crc = crc32(crc, map_ + entryOff + sizeof(Entry),
+                    hdr_.dirSize - entryOff - sizeof(Entry));
+        newHeader_.dirCrc = crc;
+
+        /* Blob first, header (CRC) last; entry + header share sector 0 */
+        segCount_ = 0;
+        if (size > 0) seg_[segCount_++] = { e->offset, data, size };
+        seg_[segCount_++] = { entryOff, reinterpret_cast<const uint8_t *>(&newEntry_), sizeof(Entry) };
+        seg_[segCount_++] = { 0, reinterpret_cast<const uint8_t *>(&newHeader_), sizeof(Header) };
+    }
+    flash_.mmapRelease();
+    if (st != Status::OK) return st;
+
+    mounted_  = false;
+    remount_  = true;
+    segIndex_ = 0;
+    segDone_  = 0;
+    result_   = Status::OK;
+    startMs_  = HAL_GetTick();
+    service();
+    return Status::OK;
+}
+
+void AssetPack::service()
+{
+    if (sectorPending_ || segCount_ == 0) return;
+
+    if (result_ == Status::OK && segIndex_ < segCount_) {
+        startSector();
+        return;
+    }
+
+    /* Last sector programmed (or an error): re-validate a patched pack */
+    if (result_ == Status::OK && remount_) {
+        Status st = mount();
+        if (st == Status::ErrBusy) return;          // mapping back next pass
+        result_ = st;
+    }
+    segCount_       = 0;
+    wstats_.lastMs  = HAL_GetTick() - startMs_;
+}
+
+/**
+ * Stage and submit the sector under the write cursor; false to retry later.
+ * A partly covered sector takes every queued piece that lands in it, in
+ * order, so it is erased and programmed once.
+ */
+bool AssetPack::startSector()
+{
+    const Segment &s      = seg_[segIndex_];
+    const uint32_t pos    = s.offset + segDone_;
+    const uint32_t sector = pos & ~(SECTOR - 1);
+    uint8_t        index  = segIndex_;
+    uint32_t       done   = segDone_;
+    const uint8_t *src;
+
+    if (pos == sector && s.len - segDone_ >= SECTOR) {
+        src   = s.data + segDone_;                  // whole sector: program in place
+        done += SECTOR;
+        if (done == s.len) {
+            index++;
+            done = 0;
+        }
+    } else {
+        W25Qxx::Status rs = flash_.readQuad(base_ + sector, staging, SECTOR);
+        if (rs == W25Qxx::Status::ErrBusy) return false;
+        if (rs != W25Qxx::Status::OK) {
+            result_ = Status::ErrFlash;
+            wstats_.errors++;
+            return false;
+        }
+        while (index < segCount_) {
+            const Segment &q = seg_[index];
+            const uint32_t p = q.offset + done;
+            if (p < sector || p >= sector + SECTOR) break;
+            const uint32_t room = sector + SECTOR - p;
+            const uint32_t n    = (q.len - done) < room ? (q.len - done) : room;
+            memcpy(&staging[p - sector], q.data + done, n);
+            done += n;
+            if (done < q.len) break;                // continues in the next sector
+            index++;
+            done = 0;
+        }
+        src = staging;
+        wstats_.rmwSectors++;
+    }
+
+    const uint32_t idx   = sector / SECTOR;
+    const uint8_t  bit   = (uint8_t)(1u << (idx % 8));
+    const bool     clean = (erased_[idx / 8] & bit) != 0;
+
+    eraseOp_.kind      = W25Qxx::AsyncOp::Kind::Erase;
+    eraseOp_.address   = base_ + sector;
+    eraseOp_.size      = SECTOR;
+    eraseOp_.done      = sectorDone;
+    eraseOp_.ctx       = this;
+    programOp_.kind    = W25Qxx::AsyncOp::Kind::Program;
+    programOp_.address = base_ + sector;
+    programOp_.size    = SECTOR;
+    programOp_.data    = src;
+    programOp_.done    = sectorDone;
+    programOp_.ctx     = this;
+
+    sectorPending_ = true;
+    erased_[idx / 8] &= (uint8_t)~bit;
+    if ((!clean && flash_.submit(eraseOp_) != W25Qxx::Status::OK)
+            || flash_.submit(programOp_) != W25Qxx::Status::OK) {
+        sectorPending_ = eraseOp_.pending || programOp_.pending;
+        result_ = Status::ErrFlash;
+        wstats_.errors++;
+        return false;
+    }
+
+    wstats_.sectors++;
+    segIndex_ = index;
+    segDone_  = done;
+    return true;
+}
+
+/** Erase / program completions (W25Qxx::service context) */
+void AssetPack::sectorDone(void *ctx, W25Qxx::Status st)
+{
+    AssetPack *self = static_cast<AssetPack *>(ctx);
+    if (st != W25Qxx::Status::OK && self->result_ == Status::OK) {
+        self->result_ = Status::ErrFlash;
+        self->wstats_.errors++;
+    }
+    if (!self->eraseOp_.pending && !self->programOp_.pending) self->sectorPending_ = false;
+}
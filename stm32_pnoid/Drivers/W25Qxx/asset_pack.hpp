@@ -0,0 +1,228 @@
+/**
+ * @file    asset_pack.hpp
+ * @brief   Read-only asset pack in QSPI flash — hashed directory, XIP blobs
+ * @note    Built on the host by scripts/asset_pack.py, installed from SD or
+ *          patched in place through the W25Qxx async engine.
+ *
+ * Layout (little-endian, offsets relative to the pack base):
+ *
+ *   0       Header (32 B)
+ *   32      Slot table: slotCount × Entry (32 B), slotCount a power of two,
+ *           at most half full; empty slots have hash 0
+ *   ...     Names, NUL-terminated
+ *   dirSize Blobs, each CACHE_LINE aligned, capacity ≥ size (room for an
+ *           in-place update); dirSize is a SECTOR_SIZE multiple
+ *
+ * The packer places every entry at hash(name) & (slotCount - 1), probing
+ * linearly, so find() is one FNV-1a hash, usually one slot read and one
+ * name compare — no file open, no copy: Asset::data points straight
+ * into the memory-mapped flash. hash() is constexpr, so find("walk.clip")
+ * with a literal folds the hash at compile time.
+ *
+ * Mapped pointers are only valid while the reader holds the mapping:
+ * mount(), find(), at() and every use of Asset::data go between
+ * W25Qxx::mmapAcquire() / mmapRelease().
+ *
+ * Updates (installing a whole pack, replacing one asset) go sector by
+ * sector: read-modify-write through a 4 KB staging buffer, erase + program
+ * as AsyncOps, one sector in flight; service() advances. Queued pieces
+ * that land in the same sector are merged into one image, so a replace
+ * writes the blob, then entry + header (directory CRC) with one erase +
+ * program of sector 0 (unless the slot table runs past it).
+ *
+ * A cut before the directory sector leaves the old directory, CRC intact,
+ * over a partly written blob; and a blob sector shared with a neighbour
+ * is read back and programmed whole, so a cut there can damage the
+ * neighbour too. mount() does not see either — verify() (the blob CRC,
+ * "asset ls") does. A cut inside the sector-0 rewrite leaves no
+ * directory: mount() fails (never mounts a half-written one) and the
+ * pack has to be installed again.
+ */
+
+#pragma once
+
+#include "w25qxx.hpp"
+#include <cstdint>
+
+class AssetPack {
+public:
+    enum class Status {
+        OK = 0,
+        ErrNoPack,      // bad magic / version, or not mounted
+        ErrCorrupt,     // directory or blob CRC mismatch
+        ErrNotFound,
+        ErrTooBig,      // does not fit the pack region / asset capacity
+        ErrBusy,        // an update is still running
+        ErrFlash,
+    };
+
+    enum class Type : uint16_t {
+        Raw = 0,
+        Sprite,         // u16 width, u16 height, then big-endian RGB565 rows
+        Sound,          // PCM / WAV as stored
+        Font,
+        Clip,           // motion clip (keyframes)
+    };
+
+    static constexpr uint32_t MAGIC      = 0x50414E50;   // "PNAP"
+    static constexpr uint16_t VERSION    = 1;
+    static constexpr uint32_t CACHE_LINE = 32;           // blob alignment
+
+    /* Entry::flags */
+    static constexpr uint16_t FLAG_PLZ   = 0x0001;       // blob is PLZ (asset_codec.hpp)
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t slotCount;
+        uint32_t assetCount;
+        uint32_t dirSize;       // header + slots + names, sector rounded
+        uint32_t totalSize;     // whole pack, bytes
+        uint32_t dirCrc;        // CRC-32 of [0, dirSize) with this field 0
+        uint32_t reserved[2];
+    };
+
+    struct Entry {
+        uint32_t hash;          // 0 = empty slot
+        uint32_t offset;        // blob, from the pack base
+        uint32_t size;
+        uint32_t capacity;
+        uint32_t crc;           // CRC-32 of the blob
+        uint32_t nameOffset;    // from the pack base
+        uint16_t type;
+        uint16_t flags;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32 && sizeof(Entry) == 32, "pack layout");
+
+    struct Asset {
+        const uint8_t *data;    // memory-mapped flash
+        uint32_t       size;
+        Type           type;
+        uint32_t       crc;
+        uint16_t       slot;
+        uint16_t       flags;   // FLAG_*; size is the stored (compressed) size
+    };
+
+    struct WriteStats {
+        uint32_t sectors;       // sectors programmed
+        uint32_t rmwSectors;    // partly covered: read back and merged
+        uint32_t lastMs;
+        uint32_t errors;
+    };
+
+    /** FNV-1a, 0 reserved for empty slots */
+    static constexpr uint32_t hash(const char *s)
+    {
+        uint32_t h = 2166136261u;
+        while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+        return h ? h : 1;
+    }
+
+    /**
+     * @param  flash     Driver in memory-mapped default mode
+     * @param  base      Pack region start, SECTOR_SIZE aligned
+     * @param  maxSize   Region size, SECTOR_SIZE multiple
+     */
+    AssetPack(W25Qxx &flash, uint32_t base, uint32_t maxSize);
+
+    /** Validate header and directory CRC (holds the mapping itself) */
+    Status mount();
+    void   unmount()          { mounted_ = false; }
+    bool   isMounted() const  { return mounted_; }
+
+    /* From the header copied at mount(): no mapping needed */
+    uint32_t count() const    { return mounted_ ? hdr_.assetCount : 0; }
+    uint32_t slots() const    { return mounted_ ? hdr_.slotCount : 0; }
+    uint32_t size() const     { return mounted_ ? hdr_.totalSize : 0; }
+    uint32_t capacity() const { return maxSize_; }
+
+    /** O(1) lookup; caller holds the mapping */
+    bool   find(const char *name, Asset &out) const { return find(hash(name), name, out); }
+    bool   find(uint32_t h, const char *name, Asset &out) const;
+
+    /** Directory walk by slot (false for an empty slot); caller holds the mapping */
+    bool   at(uint32_t slot, Asset &out, const char **name = nullptr) const;
+
+    /** Blob CRC check; caller holds the mapping */
+    bool   verify(const Asset &a) const;
+
+    /* ---------- Writer (W25Qxx async engine) ----------------------------- */
+
+    /**
+     * @brief  Queue raw pack bytes at `offset` (install / patch)
+     * @note   data must stay valid until busy() is false. Unmounts: the
+     *         caller mount()s again after the last write of an install.
+     *         Parts of a sector not covered are read back and kept.
+     */
+    Status write(uint32_t offset, const uint8_t *data, uint32_t len);
+
+    /**
+     * @brief  Erase [offset, offset + len) ahead of an install
+     * @note   One AsyncOp, 64 KB blocks where aligned — much faster than a
+     *         sector erase per write(). The next write() to each of these
+     *         sectors programs it without erasing again.
+     */
+    Status erase(uint32_t offset, uint32_t len);
+
+    /**
+     * @brief  Replace one asset's contents in place (size ≤ capacity)
+     * @note   data must stay valid until busy() is false. Unmounted while
+     *         the directory is rewritten, mounted again (CRC checked) at
+     *         the end
+     */
+    Status replace(const char *name, const uint8_t *data, uint32_t size);
+
+    /** Advance the running update; thread context, next to W25Qxx::service() */
+    void   service();
+
+    bool   busy() const         { return segCount_ > 0 || sectorPending_; }
+    Status lastResult() const   { return result_; }
+    const WriteStats &writeStats() const { return wstats_; }
+
+    static uint32_t crc32(uint32_t crc, const void *data, uint32_t len);
+
+private:
+    struct Segment {
+        uint32_t       offset;
+        const uint8_t *data;
+        uint32_t       len;
+    };
+
+    static constexpr uint32_t MAX_SEGMENTS = 3;     // blob, entry, header
+    static constexpr uint32_t MAX_SECTORS  = W25Qxx::CHIP_SIZE / W25Qxx::SECTOR_SIZE;
+
+    W25Qxx          &flash_;
+    uint32_t         base_;
+    uint32_t         maxSize_;
+    const uint8_t   *map_;
+    Header           hdr_     = {};         // RAM copy, valid while mounted_
+    bool             mounted_ = false;
+
+    /* Update state */
+    Segment          seg_[MAX_SEGMENTS] = {};
+    uint8_t          segCount_  = 0;
+    uint8_t          segIndex_  = 0;
+    bool             remount_   = false;    // replace: mount() once written
+    uint32_t         segDone_   = 0;        // bytes of seg_[segIndex_] written
+    volatile bool    sectorPending_ = false;
+    W25Qxx::AsyncOp  eraseOp_;
+    W25Qxx::AsyncOp  programOp_;
+    Status           result_    = Status::OK;
+    uint32_t         startMs_   = 0;
+    WriteStats       wstats_    = {};
+    uint8_t          erased_[MAX_SECTORS / 8] = {};    // by erase(), not yet programmed
+
+    /* Replace: new entry / header images, written after the blob */
+    Entry            newEntry_  = {};
+    Header           newHeader_ = {};
+
+    const Entry *slotTable() const
+    {
+        return reinterpret_cast<const Entry *>(map_ + sizeof(Header));
+    }
+    const Entry *lookup(uint32_t h, const char *name) const;
+    bool   startSector();
+    static void sectorDone(void *ctx, W25Qxx::Status st);
+};
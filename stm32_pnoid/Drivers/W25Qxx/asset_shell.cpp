@@ -0,0 +1,550 @@
+/**
+ * @file    asset_shell.cpp
+ * @brief   "asset ..." debug shell commands — see asset_shell.hpp
+ */
+
+#include "asset_shell.hpp"
+#include "main.h"
+#include "debug_log.h"
+#include "timebase.h"
+#include "bsp.hpp"
+#include <cstdio>
+#include <cstring>
+
+static const char *TAG = "ASSH";
+
+static constexpr uint32_t SECTOR = W25Qxx::SECTOR_SIZE;
+
+AssetShell::AssetShell(W25Qxx &flash, AssetPack &pack, AssetCache &cache, SDScheduler &sched,
+                       LCD &lcd, AudioOut &audio)
+    : flash_(flash), pack_(pack), cache_(cache), sched_(sched), lcd_(lcd), audio_(audio),
+      show_(&showRing_[0]), play_(&playRing_[0])
+{
+}
+
+/* ---------- Commands ----------------------------------------------------- */
+
+bool AssetShell::command(const char *args)
+{
+    if (strcmp(args, "ls") == 0) {
+        list();
+    } else if (strcmp(args, "bench") == 0) {
+        if (benchReq_.queued) {
+            LOGW(TAG, "Asset bench busy");
+        } else {
+            benchReq_.op         = SDScheduler::Op::Job;
+            benchReq_.stream     = SDScheduler::Stream::Log;
+            benchReq_.job        = benchJob;
+            benchReq_.done       = nullptr;
+            benchReq_.ctx        = this;
+            benchReq_.deadlineUs = 0;
+            sched_.submit(benchReq_);
+            LOGI(TAG, "Asset bench queued");
+        }
+    } else if (strncmp(args, "show ", 5) == 0) {
+        strncpy(showName_, args + 5, sizeof(showName_) - 1);
+        LOGI(TAG, "Asset show %s queued", showName_);
+    } else if (strncmp(args, "play ", 5) == 0) {
+        strncpy(playName_, args + 5, sizeof(playName_) - 1);
+        LOGI(TAG, "Asset play %s queued", playName_);
+    } else if (strcmp(args, "cache") == 0) {
+        cacheReport();
+    } else if (strncmp(args, "cache bench ", 12) == 0) {
+        if (!cache_.isReady()) {
+            LOGW(TAG, "Asset cache not ready");
+        } else {
+            strncpy(cacheBenchName_, args + 12, sizeof(cacheBenchName_) - 1);
+            LOGI(TAG, "Asset cache bench %s queued", cacheBenchName_);
+        }
+    } else if (strncmp(args, "install ", 8) == 0) {
+        if (state_ != Idle || pack_.busy()) {
+            LOGW(TAG, "Asset install busy");
+        } else {
+            installStart(args + 8);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* ---------- "asset ls" --------------------------------------------------- */
+
+/** Directory + CRC of each blob; the mapping is held one slot at a time */
+void AssetShell::list()
+{
+    if (!pack_.isMounted()) {
+        LOGW(TAG, "No asset pack");
+        return;
+    }
+    const uint32_t slots = pack_.slots();
+    LOGI(TAG, "Asset pack: %lu assets in %lu slots, %lu KB",
+         pack_.count(), slots, pack_.size() / 1024);
+
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        char name[PATH_LEN];
+        AssetPack::Asset a;
+        const char *mapped;
+        if (!flash_.mmapAcquire()) continue;
+        bool used = pack_.at(slot, a, &mapped);
+        bool good = used && pack_.verify(a);
+        if (used) {
+            strncpy(name, mapped, sizeof(name) - 1);
+            name[sizeof(name) - 1] = '\0';
+        }
+        flash_.mmapRelease();
+
+        if (used) {
+            LOGI(TAG, "  %4lu %-24s %7lu B type %u %s%s", slot, name, a.size,
+                 (unsigned)a.type, (a.flags & AssetPack::FLAG_PLZ) ? "plz " : "",
+                 good ? "" : "CRC BAD");
+        }
+    }
+}
+
+/* ---------- "asset install": SD → flash, header sector last -------------- */
+
+void AssetShell::installStart(const char *path)
+{
+    strncpy(path_, path, sizeof(path_) - 1);
+    fileOpen_ = false;
+    erased_   = false;
+    offset_   = 0;
+    startUs_  = TIME_Micros();
+    pack_.unmount();
+    installRead();
+    LOGI(TAG, "Asset install %s queued", path_);
+}
+
+void AssetShell::installRead()
+{
+    state_                 = Reading;
+    installReq_.op         = SDScheduler::Op::Job;
+    installReq_.stream     = SDScheduler::Stream::Log;
+    installReq_.job        = installJob;
+    installReq_.done       = installDone;
+    installReq_.ctx        = this;
+    installReq_.deadlineUs = 0;
+    sched_.submit(installReq_);
+}
+
+/** SD job (card owner): open on the first call, read the sector at offset_ */
+bool AssetShell::installJob(void *ctx)
+{
+    AssetShell &s = *static_cast<AssetShell *>(ctx);
+
+    if (!s.fileOpen_) {
+        if (f_open(&s.file_, s.path_, FA_READ) != FR_OK) return false;
+        s.fileOpen_ = true;
+        s.fileSize_ = (uint32_t)f_size(&s.file_);
+        if (s.fileSize_ == 0 || s.fileSize_ > s.pack_.capacity()) return false;
+        s.offset_   = s.fileSize_ > SECTOR ? SECTOR : 0;
+    }
+
+    s.len_ = s.fileSize_ - s.offset_ < SECTOR ? s.fileSize_ - s.offset_ : SECTOR;
+    UINT br = 0;
+    bool ok = f_lseek(&s.file_, s.offset_) == FR_OK
+           && f_read(&s.file_, s.chunk_, s.len_, &br) == FR_OK && br == s.len_;
+    if (s.offset_ == 0 || !ok) {            // the header is read last
+        f_close(&s.file_);
+        s.fileOpen_ = false;
+    }
+    return ok;
+}
+
+void AssetShell::installDone(void *ctx, bool ok)
+{
+    AssetShell &s = *static_cast<AssetShell *>(ctx);
+    if (ok) {
+        s.state_ = Ready;
+        return;
+    }
+    if (s.fileOpen_) {
+        f_close(&s.file_);
+        s.fileOpen_ = false;
+    }
+    LOGE(TAG, "Asset install: cannot read %s (%lu B, max %lu)",
+         s.path_, s.fileSize_, s.pack_.capacity());
+    s.state_ = Idle;
+}
+
+bool AssetShell::service(bool idle)
+{
+    installService();
+
+    if (cacheBenchName_[0] != '\0' && idle) {
+        cacheBench(cacheBenchName_);
+        cacheBenchName_[0] = '\0';
+        return true;
+    }
+    return false;
+}
+
+/** Sector read → pack writer; writer done → next sector */
+void AssetShell::installService()
+{
+    if (state_ == Ready) {
+        if (!erased_) {
+            if (pack_.erase(0, (fileSize_ + SECTOR - 1) / SECTOR * SECTOR) == AssetPack::Status::OK)
+                erased_ = true;
+            return;
+        }
+        if (pack_.busy()) return;
+        if (pack_.lastResult() != AssetPack::Status::OK) {
+            LOGE(TAG, "Asset install: flash erase / write failed");
+            state_ = Idle;
+            return;
+        }
+        if (pack_.write(offset_, chunk_, len_) == AssetPack::Status::OK)
+            state_ = Writing;
+        return;
+    }
+    if (state_ != Writing || pack_.busy()) return;
+
+    if (pack_.lastResult() != AssetPack::Status::OK) {
+        LOGE(TAG, "Asset install: flash write failed at 0x%06lX", offset_);
+        state_ = Idle;
+        return;
+    }
+    if (offset_ != 0) {
+        offset_ += SECTOR;
+        if (offset_ >= fileSize_) offset_ = 0;
+        installRead();
+        return;
+    }
+
+    state_ = Idle;
+    AssetPack::Status st = pack_.mount();
+    const AssetPack::WriteStats &ws = pack_.writeStats();
+    LOGI(TAG, "Asset install %s: %lu KB in %lu ms, %lu sectors (%lu merged), mount %d, %lu assets",
+         path_, fileSize_ / 1024, (uint32_t)((TIME_Micros() - startUs_) / 1000),
+         ws.sectors, ws.rmwSectors, (int)st, pack_.count());
+}
+
+/* ---------- "asset bench": pack lookup vs FatFs open --------------------- */
+
+/** SD job (card owner): the FatFs half needs the card, the pack half is short */
+bool AssetShell::benchJob(void *ctx)
+{
+    AssetShell &s = *static_cast<AssetShell *>(ctx);
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+    volatile uint32_t sink = 0;
+
+    /* Pack */
+    const uint32_t slots = s.pack_.slots();
+    uint32_t n = 0, cold = 0, coldMax = 0, warm = 0;
+    for (uint32_t slot = 0; slot < slots && n < BENCH_FILES; slot++) {
+        AssetPack::Asset a;
+        const char *mapped;
+        if (!s.flash_.mmapAcquire()) continue;
+        if (s.pack_.at(slot, a, &mapped)) {
+            strncpy(s.names_[n], mapped, PATH_LEN - 1);
+            s.names_[n][PATH_LEN - 1] = '\0';
+            n++;
+        }
+        s.flash_.mmapRelease();
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 0) SCB_CleanInvalidateDCache();
+            uint32_t c0 = DWT->CYCCNT;
+            if (s.flash_.mmapAcquire()) {
+                AssetPack::Asset a;
+                if (s.pack_.find(s.names_[i], a) && a.size > 0) sink += a.data[0];
+                s.flash_.mmapRelease();
+            }
+            uint32_t c = DWT->CYCCNT - c0;
+            if (pass == 0) {
+                cold += c;
+                if (c > coldMax) coldMax = c;
+            } else {
+                warm += c;
+            }
+        }
+    }
+
+    /* FatFs */
+    uint32_t m = 0, fat = 0, fatMax = 0;
+    DIR dir;
+    FILINFO fi;
+    if (f_opendir(&dir, "assets") == FR_OK) {
+        while (m < BENCH_FILES && f_readdir(&dir, &fi) == FR_OK && fi.fname[0] != '\0') {
+            if (fi.fattrib & AM_DIR) continue;
+            snprintf(s.names_[m], PATH_LEN, "assets/%s", fi.fname);
+            m++;
+        }
+        f_closedir(&dir);
+    }
+    for (uint32_t i = 0; i < m; i++) {
+        uint8_t b0 = 0;
+        UINT    br = 0;
+        uint64_t t0 = TIME_Micros();
+        if (f_open(&s.benchFile_, s.names_[i], FA_READ) == FR_OK) {
+            f_read(&s.benchFile_, &b0, 1, &br);
+            f_close(&s.benchFile_);
+        }
+        uint32_t us = (uint32_t)(TIME_Micros() - t0);
+        sink += b0;
+        fat += us;
+        if (us > fatMax) fatMax = us;
+    }
+    (void)sink;
+
+    LOGI(TAG, "Asset open, pack (%lu): cold %lu ns (max %lu), warm %lu ns; "
+              "FatFs (%lu in assets/): %lu us (max %lu)",
+         n, n ? cold * 1000u / cyclesPerUs / n : 0, coldMax * 1000u / cyclesPerUs,
+         n ? warm * 1000u / cyclesPerUs / n : 0, m, m ? fat / m : 0, fatMax);
+    return true;
+}
+
+/* ---------- "asset show|play": PLZ / raw → LCD line, I2S chunk ---------- */
+
+bool AssetShell::displayService()
+{
+    if (showName_[0] == '\0') return false;
+    show(showName_);
+    showName_[0] = '\0';
+    return true;
+}
+
+bool AssetShell::audioService()
+{
+    if (playName_[0] == '\0') return false;
+    play(playName_);
+    playName_[0] = '\0';
+    return true;
+}
+
+/** Hold the mapping; the writer yields at its next unit (erase suspends), so the wait is short */
+bool AssetShell::map()
+{
+    uint32_t t0 = HAL_GetTick();
+    while (!flash_.mmapAcquire()) {
+        if (HAL_GetTick() - t0 > 20) return false;
+    }
+    return true;
+}
+
+bool AssetShell::open(Stream &s, const char *name, AssetPack::Type type)
+{
+    if (!pack_.isMounted() || pack_.busy()) {
+        LOGW(TAG, "No asset pack / pack busy");
+        return false;
+    }
+    AssetPack::Asset a;
+    if (!map()) return false;
+    bool found = pack_.find(name, a) && a.type == type;
+    bool ok = found;
+    if (found) {
+        s.in     = a.data;
+        s.end    = a.data + a.size;
+        s.plz    = (a.flags & AssetPack::FLAG_PLZ) != 0;
+        s.cycles = 0;
+        ok = !s.plz || s.dec.open(s.in, s.end) == LzDecoder::Status::OK;
+    }
+    flash_.mmapRelease();
+
+    if (!ok) LOGW(TAG, "Asset %s: %s", name, found ? "bad PLZ header" : "not found / wrong type");
+    return ok;
+}
+
+/** Next n bytes into dst (fewer at the end / on error); mapping held only while reading */
+uint32_t AssetShell::read(Stream &s, uint8_t *dst, uint32_t n)
+{
+    if (!map()) return 0;
+    uint32_t c0 = DWT->CYCCNT;
+    uint32_t got;
+    if (s.plz) {
+        got = s.dec.decode(s.in, s.end, dst, n);
+    } else {
+        got = (uint32_t)(s.end - s.in);
+        if (got > n) got = n;
+        memcpy(dst, s.in, got);
+        s.in += got;
+    }
+    s.cycles += DWT->CYCCNT - c0;
+    flash_.mmapRelease();
+    return got;
+}
+
+/** Sprite to the top left corner, one decoded line at a time, then SPI */
+void AssetShell::show(const char *name)
+{
+    Stream &s = show_;
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+
+    if (!open(s, name, AssetPack::Type::Sprite)) return;
+    uint16_t wh[2];
+    if (read(s, reinterpret_cast<uint8_t *>(wh), 4) != 4
+            || wh[0] == 0 || wh[0] > lcd_.width() || wh[1] == 0) {
+        LOGW(TAG, "Asset %s: bad sprite header", name);
+        return;
+    }
+    const uint16_t w = wh[0];
+    const uint16_t h = wh[1] < lcd_.height() ? wh[1] : lcd_.height();   // clip, first frame
+    const uint32_t stride = w * 2u;
+
+    uint32_t spi = 0, rows = 0;
+    lcd_.beginImage(0, 0, w, h);
+    for (; rows < h; rows++) {
+        if (read(s, line_, stride) != stride) break;
+        uint32_t c0 = DWT->CYCCNT;
+        lcd_.writeImage(line_, stride);
+        spi += DWT->CYCCNT - c0;
+    }
+    lcd_.endImage();
+
+    LOGI(TAG, "Asset show %s: %ux%u%s, %lu rows, decode %lu us, SPI %lu us",
+         name, w, h, s.plz ? " plz" : "", rows,
+         s.cycles / cyclesPerUs, spi / cyclesPerUs);
+    if (rows != h) LOGW(TAG, "Asset %s: short / corrupt (%d)", name, (int)s.dec.status());
+}
+
+/** AudioOut::playStream fill: 16 kHz stereo 16-bit LE */
+uint32_t AssetShell::playFill(void *ctx, int16_t *dst, uint32_t frames)
+{
+    AssetShell &s = *static_cast<AssetShell *>(ctx);
+    return s.read(s.play_, reinterpret_cast<uint8_t *>(dst), frames * 4) / 4;
+}
+
+/** Decoded chunk by chunk (1024 frames) into the AudioOut buffer */
+void AssetShell::play(const char *name)
+{
+    Stream &s = play_;
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+
+    if (!open(s, name, AssetPack::Type::Sound)) return;
+    uint64_t t0 = TIME_Micros();
+    audio_.playStream(playFill, this);
+    uint32_t us = (uint32_t)(TIME_Micros() - t0);
+    uint32_t decodeUs = s.cycles / cyclesPerUs;
+
+    LOGI(TAG, "Asset play %s%s: %lu ms, decode %lu us (%lu.%lu%% CPU)",
+         name, s.plz ? " plz" : "", us / 1000, decodeUs,
+         us ? decodeUs * 100u / us : 0, us ? decodeUs * 1000u / us % 10 : 0);
+    if (s.plz && !s.dec.done()) LOGW(TAG, "Asset %s: short / corrupt (%d)", name, (int)s.dec.status());
+}
+
+/* ---------- "asset cache": MDMA prefetch cache --------------------------- */
+
+/** Lines, hit rate, CPU saved: hit bytes priced at the cycles / byte of the misses */
+void AssetShell::cacheReport()
+{
+    if (!cache_.isReady()) {
+        LOGW(TAG, "Asset cache not ready");
+        return;
+    }
+    const AssetCache::Stats &s = cache_.stats();
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+    const uint32_t reads = s.hits + s.misses;
+    const uint32_t dmaUs = s.dmaCycles / cyclesPerUs;
+
+    uint64_t saved = 0;
+    if (s.missBytes > 0) {
+        uint64_t direct = s.missCycles * s.hitBytes / s.missBytes;
+        if (direct > s.hitCycles) saved = direct - s.hitCycles;
+    }
+
+    LOGI(TAG, "Asset cache %lu x %lu KB%s: %lu requests, %lu fetches (MDMA %lu KB/s), "
+              "%lu evicted, %lu invalidated, %lu errors",
+         cache_.lines(), AssetCache::LINE_SIZE / 1024, cache_.busy() ? " (fetching)" : "",
+         s.requests, s.fetches,
+         dmaUs ? (uint32_t)((uint64_t)s.fetches * AssetCache::LINE_SIZE * 1000u / 1024u * 1000u / dmaUs) : 0u,
+         s.evictions, s.invalidations, s.errors);
+    LOGI(TAG, "  %lu reads, hit %lu%%, %lu KB from SRAM / %lu KB mapped, CPU saved ~%lu us%s",
+         reads, reads ? s.hits * 100u / reads : 0u, s.hitBytes / 1024, s.missBytes / 1024,
+         (uint32_t)(saved / cyclesPerUs), s.missBytes ? "" : " (no misses to price)");
+}
+
+/**
+ * 2000 random 64 B reads in the asset (a sprite row / a mix grain): first
+ * mapped, each one a D-cache miss, then the same offsets after an MDMA
+ * prefetch. Uses half the cache, the rest stays with other consumers.
+ */
+void AssetShell::cacheBench(const char *name)
+{
+    constexpr uint32_t READS = 2000;
+    constexpr uint32_t CHUNK = 64;
+    alignas(32) static uint8_t buf[CHUNK];
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+
+    AssetPack::Asset a;
+    bool found = false;
+    if (flash_.mmapAcquire()) {
+        found = pack_.find(name, a);
+        flash_.mmapRelease();
+    }
+    if (!found || a.size < CHUNK) {
+        LOGW(TAG, "Asset %s not found / smaller than %lu B", name, CHUNK);
+        return;
+    }
+
+    const uint8_t *xip   = reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE);
+    const uint32_t base  = (uint32_t)(a.data - xip);
+    const uint32_t limit = cache_.lines() / 2 * AssetCache::LINE_SIZE;
+    const uint32_t span  = a.size < limit ? a.size : limit;
+    uint32_t seed = 0x9E3779B9u;
+    auto nextOffset = [&seed, span]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed % (span - CHUNK + 1);
+    };
+
+    /* 1. Mapped, D-cache cold for every read (the invalidate is not timed) */
+    uint64_t mappedCycles = 0;
+    for (uint32_t i = 0; i < READS; i++) {
+        const uint8_t *src = xip + base + nextOffset();
+        SCB_InvalidateDCache_by_Addr(const_cast<uint8_t *>(src), (int32_t)CHUNK);
+        uint32_t c0 = DWT->CYCCNT;
+        if (!flash_.mmapAcquire()) continue;
+        memcpy(buf, src, CHUNK);
+        flash_.mmapRelease();
+        mappedCycles += DWT->CYCCNT - c0;
+    }
+
+    /* 2. Prefetch from cold: the CPU only pays for service() */
+    AssetCache::Request req;
+    req.address = base;
+    req.size    = span;
+    cache_.invalidate(base, span);
+    cache_.resetStats();
+    uint32_t serviceCycles = 0;
+    uint64_t t0 = TIME_Micros();
+    if (cache_.prefetch(req) != AssetCache::Status::OK) {
+        LOGW(TAG, "Asset cache: prefetch rejected");
+        return;
+    }
+    while (req.pending && TIME_Micros() - t0 < 100000u) {
+        BSP::delayUs(20);               // about one flash service pass
+        flash_.service();
+        uint32_t c0 = DWT->CYCCNT;
+        cache_.service();
+        serviceCycles += DWT->CYCCNT - c0;
+    }
+    uint32_t fetchUs = (uint32_t)(TIME_Micros() - t0);
+    if (req.pending || req.result != AssetCache::Status::OK) {
+        LOGW(TAG, "Asset cache: prefetch failed (%d)", (int)req.result);
+        return;
+    }
+
+    /* 3. Same offsets from the cache */
+    seed = 0x9E3779B9u;
+    for (uint32_t i = 0; i < READS; i++) cache_.read(base + nextOffset(), buf, CHUNK);
+
+    const AssetCache::Stats &cs = cache_.stats();
+    const uint64_t cacheCycles  = cs.hitCycles + cs.missCycles + serviceCycles;
+    const uint32_t dmaUs        = cs.dmaCycles / cyclesPerUs;
+    const uint32_t reads        = cs.hits + cs.misses;
+
+    LOGI(TAG, "Asset cache %s: %lu KB prefetched in %lu us (MDMA %lu KB/s, CPU %lu us)",
+         name, span / 1024, fetchUs,
+         dmaUs ? (uint32_t)((uint64_t)cs.fetches * AssetCache::LINE_SIZE * 1000u / 1024u * 1000u / dmaUs) : 0u,
+         serviceCycles / cyclesPerUs);
+    LOGI(TAG, "  %lu x %lu B random: mapped miss %lu cyc/read, cache %lu cyc/read, "
+              "hit %lu%%, CPU saved %lu us",
+         READS, CHUNK, (uint32_t)(mappedCycles / READS),
+         (uint32_t)((cs.hitCycles + cs.missCycles) / (reads ? reads : 1)),
+         reads ? cs.hits * 100u / reads : 0u,
+         mappedCycles > cacheCycles ? (uint32_t)((mappedCycles - cacheCycles) / cyclesPerUs) : 0u);
+}
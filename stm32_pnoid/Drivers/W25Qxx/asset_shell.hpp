@@ -0,0 +1,146 @@
+/**
+ * @file    asset_shell.hpp
+ * @brief   "asset ..." debug shell commands: directory, install from SD,
+ *          open cost, streamed sprite / sound, prefetch cache
+ * @note    command() runs in the link context and only queues. SD reads are
+ *          jobs on the SD scheduler (card owner: SD service / log task);
+ *          flash writes and the cache bench advance in service(), from the
+ *          flash service; show / play run in displayService() / audioService().
+ *
+ *   asset ls               directory + blob CRC (verify() per asset)
+ *   asset install <file>   pack file (scripts/asset_pack.py build) from SD
+ *                          to QSPI, sector by sector, header sector last
+ *   asset bench            open cost: pack lookup (cold / warm D-cache) vs
+ *                          FatFs f_open + 1 B read for SD "assets/" (log-class job)
+ *   asset show <name>      sprite (u16 w, u16 h, RGB565 BE) to the LCD top
+ *                          left, PLZ decoded line by line (decode vs SPI us)
+ *   asset play <name>      16 kHz stereo s16 PCM, PLZ decoded per I2S chunk
+ *                          (decode % CPU)
+ *   asset cache            prefetch cache: lines, hit rate, CPU saved vs
+ *                          mapped reads (priced at the measured miss cost)
+ *   asset cache bench <name>  2000 random 64 B reads in the asset, mapped
+ *                          (D-cache miss each) vs after an MDMA prefetch;
+ *                          blocks a few ms in service(idle)
+ *
+ * Show and play each own a 4 KB ring = the stream window (asset_pack.py
+ * --window 12); the mapping is held only while a line / chunk decodes.
+ */
+
+#pragma once
+
+#include "w25qxx.hpp"
+#include "asset_pack.hpp"
+#include "asset_codec.hpp"
+#include "asset_cache.hpp"
+#include "sd_sched.hpp"
+#include "lcd.hpp"
+#include "audio_out.hpp"
+#include "fatfs.h"
+#include <cstdint>
+
+class AssetShell {
+public:
+    static constexpr uint32_t PATH_LEN    = 32;
+    static constexpr uint32_t BENCH_FILES = 16;
+    static constexpr uint32_t RING_SIZE   = 4096;
+
+    AssetShell(W25Qxx &flash, AssetPack &pack, AssetCache &cache, SDScheduler &sched,
+               LCD &lcd, AudioOut &audio);
+
+    /**
+     * @brief  Handle one "asset" command (link context, flash initialised)
+     * @param  args  Text after "asset "
+     * @retval false if args is not an asset command
+     */
+    bool command(const char *args);
+
+    /**
+     * @brief  Flash service context: hand read sectors to the pack writer,
+     *         report, run a queued cache bench
+     * @param  idle  Caller may block (robot standing / log task)
+     * @retval true if it blocked
+     */
+    bool service(bool idle);
+
+    /**
+     * @brief  Draw a sprite queued by "asset show" (display context, LCD ready)
+     * @retval true if it drew
+     */
+    bool displayService();
+
+    /**
+     * @brief  Play a sound queued by "asset play" (audio context, audio ready)
+     * @retval true if it played (the call blocked for the clip)
+     */
+    bool audioService();
+
+private:
+    enum State : uint8_t { Idle = 0, Reading, Ready, Writing };
+
+    void list();
+    void installStart(const char *path);
+    void installRead();
+    void installService();
+
+    static bool installJob(void *ctx);
+    static void installDone(void *ctx, bool ok);
+    static bool benchJob(void *ctx);
+
+    void cacheReport();
+    void cacheBench(const char *name);
+
+    /** Sequential reader of one asset; in / end point into mapped flash */
+    struct Stream {
+        LzDecoder      dec;
+        const uint8_t *in     = nullptr;
+        const uint8_t *end    = nullptr;
+        bool           plz    = false;
+        uint32_t       cycles = 0;      // decode / copy, not SPI / I2S
+
+        explicit Stream(uint8_t *ring) : dec(ring, RING_SIZE) {}
+    };
+
+    bool            map();
+    bool            open(Stream &s, const char *name, AssetPack::Type type);
+    uint32_t        read(Stream &s, uint8_t *dst, uint32_t n);
+    void            show(const char *name);
+    void            play(const char *name);
+    static uint32_t playFill(void *ctx, int16_t *dst, uint32_t frames);
+
+    W25Qxx            &flash_;
+    AssetPack         &pack_;
+    AssetCache        &cache_;
+    SDScheduler       &sched_;
+    LCD               &lcd_;
+    AudioOut          &audio_;
+
+    /* "asset install": SD sector → chunk_ → pack writer, header sector last */
+    SDScheduler::Request installReq_;
+    volatile uint8_t   state_      = Idle;
+    bool               fileOpen_   = false;
+    bool               erased_     = false;     // whole range erased before the first sector
+    FIL                file_;
+    uint32_t           fileSize_   = 0;
+    uint32_t           offset_     = 0;         // sector being read / written
+    uint32_t           len_        = 0;
+    uint64_t           startUs_    = 0;
+    char               path_[PATH_LEN] = {};
+
+    /* "asset bench" */
+    SDScheduler::Request benchReq_;
+    FIL                benchFile_;
+    char               names_[BENCH_FILES][PATH_LEN];
+
+    /* "asset show" / "asset play": name queued by command(), "" = none */
+    char               showName_[PATH_LEN] = {};
+    char               playName_[PATH_LEN] = {};
+    char               cacheBenchName_[PATH_LEN] = {};   // "asset cache bench"
+
+    alignas(32) uint8_t chunk_[W25Qxx::SECTOR_SIZE];
+    alignas(32) uint8_t line_[LCD::DEFAULT_WIDTH * 2];
+    alignas(32) uint8_t showRing_[RING_SIZE];
+    alignas(32) uint8_t playRing_[RING_SIZE];
+
+    Stream             show_;                   // decoders over the rings above
+    Stream             play_;
+};
@@ -0,0 +1,225 @@
+/**
+ * @file    flash_shell.cpp
+ * @brief   "flash ..." debug shell commands — see flash_shell.hpp
+ */
+
+#include "flash_shell.hpp"
+#include "main.h"
+#include "debug_log.h"
+#include "timebase.h"
+#include <cstring>
+
+static const char *TAG = "FLSH";
+
+/* ---------- Commands ----------------------------------------------------- */
+
+bool FlashShell::command(const char *args)
+{
+    if (strncmp(args, "rewrite", 7) == 0) {
+        if (mode_ != None || flash_.asyncBusy()) {
+            LOGW(TAG, "Flash busy");
+        } else if (strcmp(args + 7, " sync") == 0) {
+            mode_ = SyncQueued;
+            LOGI(TAG, "Flash rewrite (blocking) queued");
+        } else {
+            rewriteAsync();
+        }
+    } else if (strcmp(args, "xip") == 0) {
+        if (mode_ != None || flash_.asyncBusy()) {
+            LOGW(TAG, "Flash busy");
+        } else {
+            mode_ = XipQueued;
+            LOGI(TAG, "Flash XIP bench queued");
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool FlashShell::service(bool idle)
+{
+    switch (mode_) {
+    case AsyncRunning: {
+        /* Superloop: every tick; RTOS: sampled at the log task period */
+        const LoopMonitor::Sample &s = loopMon_.last();
+        if (s.periodUs > maxPeriodUs_)   maxPeriodUs_  = s.periodUs;
+        if (s.computeUs > maxComputeUs_) maxComputeUs_ = s.computeUs;
+        return false;
+    }
+    case AsyncDone:
+        if (!idle) return false;
+        mode_ = None;
+        rewriteReport();                // verify reads the 64 KB back
+        return true;
+    case SyncQueued:
+        if (!idle) return false;
+        mode_ = None;
+        rewriteSync();
+        return true;
+    case XipQueued:
+        if (!idle) return false;
+        benchXip();                     // leaves AsyncDone: rewrite report next pass
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* ---------- Rewrite: 64 KB erase + program, loop stall ------------------- */
+
+void FlashShell::fillPattern()
+{
+    uint32_t seed = DWT->CYCCNT;
+    for (uint32_t i = 0; i < sizeof(pattern_); i++) {
+        pattern_[i] = (uint8_t)(seed + i * 7u + (i >> 8));
+    }
+}
+
+/** Read the test block back (blocking, ~5 ms); returns bad bytes */
+uint32_t FlashShell::verify()
+{
+    uint8_t  page[W25Qxx::PAGE_SIZE];
+    uint32_t bad = 0;
+    for (uint32_t off = 0; off < W25Qxx::BLOCK_SIZE_64K; off += sizeof(page)) {
+        if (flash_.readQuad(TEST_ADDR + off, page, sizeof(page)) != W25Qxx::Status::OK)
+            return W25Qxx::BLOCK_SIZE_64K;
+        const uint8_t *ref = &pattern_[off % W25Qxx::SECTOR_SIZE];
+        for (uint32_t i = 0; i < sizeof(page); i++) bad += (page[i] != ref[i]);
+    }
+    return bad;
+}
+
+/** Blocking API: the whole loop stands still during erase / program */
+void FlashShell::rewriteSync()
+{
+    fillPattern();
+    uint64_t t0 = TIME_Micros();
+    W25Qxx::Status st = flash_.eraseBlock64K(TEST_ADDR);
+    for (uint32_t i = 0; i < TEST_SECTORS && st == W25Qxx::Status::OK; i++) {
+        st = flash_.writeData(TEST_ADDR + i * W25Qxx::SECTOR_SIZE, pattern_, sizeof(pattern_));
+    }
+    uint32_t us = (uint32_t)(TIME_Micros() - t0);
+
+    LOGI(TAG, "FLASH rewrite 64 KB sync: %lu ms, loop stall %lu ms, status %d, %lu bad bytes",
+         us / 1000, us / 1000, (int)st, verify());
+}
+
+void FlashShell::rewriteDone(void *ctx, W25Qxx::Status st)
+{
+    FlashShell &s = *static_cast<FlashShell *>(ctx);
+    if (st != W25Qxx::Status::OK && s.result_ == W25Qxx::Status::OK) s.result_ = st;
+}
+
+void FlashShell::rewriteLastDone(void *ctx, W25Qxx::Status st)
+{
+    FlashShell &s = *static_cast<FlashShell *>(ctx);
+    rewriteDone(ctx, st);
+    s.durationUs_ = (uint32_t)(TIME_Micros() - s.startUs_);
+    s.mode_       = AsyncDone;
+}
+
+/** Async engine: erase + program run from the QSPI IRQ, the loop keeps going */
+void FlashShell::rewriteAsync()
+{
+    fillPattern();
+    result_       = W25Qxx::Status::OK;
+    maxPeriodUs_  = 0;
+    maxComputeUs_ = 0;
+    overruns_     = loopMon_.periodOverruns();
+    startUs_      = TIME_Micros();
+    mode_         = AsyncRunning;
+
+    W25Qxx::AsyncOp &erase = ops_[0];
+    erase.kind    = W25Qxx::AsyncOp::Kind::Erase;
+    erase.address = TEST_ADDR;
+    erase.size    = W25Qxx::BLOCK_SIZE_64K;
+    erase.done    = rewriteDone;
+    erase.ctx     = this;
+    flash_.submit(erase);
+
+    for (uint32_t i = 0; i < TEST_SECTORS; i++) {
+        W25Qxx::AsyncOp &op = ops_[1 + i];
+        op.kind    = W25Qxx::AsyncOp::Kind::Program;
+        op.address = TEST_ADDR + i * W25Qxx::SECTOR_SIZE;
+        op.size    = sizeof(pattern_);
+        op.data    = pattern_;
+        op.done    = (i + 1 == TEST_SECTORS) ? rewriteLastDone : rewriteDone;
+        op.ctx     = this;
+        flash_.submit(op);
+    }
+}
+
+void FlashShell::rewriteReport()
+{
+    const W25Qxx::AsyncStats &as = flash_.asyncStats();
+    LOGI(TAG, "FLASH rewrite 64 KB async: %lu ms, loop period max %lu us compute max %lu us, "
+              "%lu overruns, status %d, %lu bad bytes (%lu pages, %lu erases, %lu timeouts)",
+         durationUs_ / 1000, maxPeriodUs_, maxComputeUs_,
+         loopMon_.periodOverruns() - overruns_, (int)result_,
+         verify(), as.pages, as.erases, as.timeouts);
+}
+
+/* ---------- XIP: mapped vs indirect, reads during a rewrite -------------- */
+
+void FlashShell::benchXip()
+{
+    constexpr uint32_t CHUNK = 4096;
+    constexpr uint32_t SPAN  = 256 * 1024;          // start of the chip, read only
+    alignas(32) static uint8_t buf[CHUNK];
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+    const uint8_t *xip = reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE);
+
+    /* 1. Mapped, cold cache */
+    SCB_InvalidateDCache_by_Addr(const_cast<uint8_t *>(xip), (int32_t)SPAN);
+    uint64_t t0 = TIME_Micros();
+    for (uint32_t off = 0; off < SPAN; off += CHUNK) {
+        if (!flash_.mmapAcquire()) break;
+        memcpy(buf, xip + off, CHUNK);
+        flash_.mmapRelease();
+    }
+    uint32_t mappedUs = (uint32_t)(TIME_Micros() - t0);
+
+    /* 2. Indirect (readQuad, CPU drains the FIFO) */
+    flash_.disableMemoryMapped();
+    t0 = TIME_Micros();
+    for (uint32_t off = 0; off < SPAN; off += CHUNK) flash_.readQuad(off, buf, CHUNK);
+    uint32_t indirectUs = (uint32_t)(TIME_Micros() - t0);
+    flash_.enableMemoryMapped();
+
+    /* 3. Mapped reads while the test block is rewritten */
+    const W25Qxx::MmapStats before = flash_.mmapStats();
+    rewriteAsync();
+    uint32_t bytes = 0, off = 0, worstWaitUs = 0;
+    t0 = TIME_Micros();
+    while (mode_ == AsyncRunning) {
+        uint64_t w0 = TIME_Micros();
+        while (!flash_.mmapAcquire()) {
+            flash_.service();
+            if (mode_ != AsyncRunning) break;
+        }
+        uint32_t waitUs = (uint32_t)(TIME_Micros() - w0);
+        if (waitUs > worstWaitUs) worstWaitUs = waitUs;
+        if (mode_ != AsyncRunning) break;
+
+        memcpy(buf, xip + off, CHUNK);
+        flash_.mmapRelease();
+        bytes += CHUNK;
+        off    = (off + CHUNK) % SPAN;
+        flash_.service();
+    }
+    uint32_t busyUs = (uint32_t)(TIME_Micros() - t0);
+    const W25Qxx::MmapStats &ms = flash_.mmapStats();
+
+    LOGI(TAG, "XIP %lu KB: mapped %lu KB/s, indirect %lu KB/s; enter %lu us (max %lu), "
+              "exit %lu us (max %lu)",
+         SPAN / 1024, SPAN / 1024 * 1000000u / (mappedUs ? mappedUs : 1),
+         SPAN / 1024 * 1000000u / (indirectUs ? indirectUs : 1),
+         ms.lastEnterCycles / cyclesPerUs, ms.maxEnterCycles / cyclesPerUs,
+         ms.lastExitCycles / cyclesPerUs, ms.maxExitCycles / cyclesPerUs);
+    LOGI(TAG, "XIP during 64 KB rewrite: %lu KB/s, worst wait %lu us, %lu suspends "
+              "(max %lu us), %lu read windows, %lu deferred",
+         bytes / 1024 * 1000000u / (busyUs ? busyUs : 1), worstWaitUs,
+         ms.suspends - before.suspends, ms.maxSuspendCycles / cyclesPerUs,
+         ms.pauses - before.pauses, ms.deferred - before.deferred);
+}
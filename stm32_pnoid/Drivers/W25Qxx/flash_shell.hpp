@@ -0,0 +1,69 @@
+/**
+ * @file    flash_shell.hpp
+ * @brief   "flash ..." debug shell commands: rewrite stall, XIP throughput
+ * @note    command() runs in the link context and only queues; service()
+ *          runs from the flash service (superloop / log task) and does
+ *          the blocking parts only when the caller says it may block.
+ *
+ *   flash rewrite [sync]   erase + program the last 64 KB of the chip,
+ *                          loop period / overruns during it (default
+ *                          async engine, sync = blocking API)
+ *   flash xip              mapped vs indirect KB/s, mode switch cost, mapped
+ *                          reads during an async rewrite (blocks ~0.5 s)
+ *
+ * The test block holds no data (see the flash map in app.cpp).
+ */
+
+#pragma once
+
+#include "w25qxx.hpp"
+#include "loop_monitor.hpp"
+#include <cstdint>
+
+class FlashShell {
+public:
+    static constexpr uint32_t TEST_ADDR    = W25Qxx::CHIP_SIZE - W25Qxx::BLOCK_SIZE_64K;
+    static constexpr uint32_t TEST_SECTORS = W25Qxx::BLOCK_SIZE_64K / W25Qxx::SECTOR_SIZE;
+
+    FlashShell(W25Qxx &flash, LoopMonitor &loopMon) : flash_(flash), loopMon_(loopMon) {}
+
+    /**
+     * @brief  Handle one "flash" command (link context, flash initialised)
+     * @param  args  Text after "flash "
+     * @retval false if args is not a flash command
+     */
+    bool command(const char *args);
+
+    /**
+     * @brief  Progress / report queued work (flash service context)
+     * @param  idle  Caller may block (robot standing / log task)
+     * @retval true if it blocked
+     */
+    bool service(bool idle);
+
+private:
+    enum Mode : uint8_t { None = 0, SyncQueued, AsyncRunning, AsyncDone, XipQueued };
+
+    void        fillPattern();
+    uint32_t    verify();
+    void        rewriteSync();
+    void        rewriteAsync();
+    void        rewriteReport();
+    void        benchXip();
+    static void rewriteDone(void *ctx, W25Qxx::Status st);
+    static void rewriteLastDone(void *ctx, W25Qxx::Status st);
+
+    W25Qxx           &flash_;
+    LoopMonitor      &loopMon_;
+
+    volatile uint8_t  mode_         = None;
+    W25Qxx::Status    result_       = W25Qxx::Status::OK;
+    uint64_t          startUs_      = 0;
+    uint32_t          durationUs_   = 0;
+    uint32_t          overruns_     = 0;    // loopMon.periodOverruns() at start
+    uint32_t          maxPeriodUs_  = 0;    // longest loop period while writing
+    uint32_t          maxComputeUs_ = 0;
+
+    W25Qxx::AsyncOp   ops_[1 + TEST_SECTORS];      // erase + 16 × 4 KB program
+    alignas(4) uint8_t pattern_[W25Qxx::SECTOR_SIZE];
+};
@@ -0,0 +1,519 @@
+/**
+ * @file    kv_store.cpp
+ * @brief   Log-structured key-value store — see kv_store.hpp
+ */
+
+#include "kv_store.hpp"
+#include <cstring>
+
+static constexpr uint32_t SECTOR = W25Qxx::SECTOR_SIZE;
+
+/* ---------- CRC-32 (zlib polynomial, byte table: load() checks every record) */
+
+namespace {
+
+struct CrcTable {
+    uint32_t t[256];
+    constexpr CrcTable() : t()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+            t[i] = c;
+        }
+    }
+};
+
+constexpr CrcTable kCrc;
+
+uint32_t crc32(uint32_t crc, const void *data, uint32_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    while (len--) crc = (crc >> 8) ^ kCrc.t[(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+/** FNV-1a, as AssetPack::hash() */
+uint32_t hashKey(const char *s)
+{
+    uint32_t h = 2166136261u;
+    while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+uint32_t recordSize(uint32_t keyLen, uint32_t valLen)
+{
+    return (8u + keyLen + valLen + 3u) & ~3u;
+}
+
+/** Record CRC: header bytes 0..3, key, value */
+uint32_t recordCrc(const uint8_t *hdr, const void *key, uint32_t keyLen,
+                   const void *value, uint32_t valLen)
+{
+    uint32_t crc = crc32(0, hdr, 4);
+    crc = crc32(crc, key, keyLen);
+    return crc32(crc, value, valLen);
+}
+
+} // namespace
+
+KvStore::KvStore(W25Qxx &flash, uint32_t base, uint32_t sectors)
+    : flash_(flash), base_(base), sectors_(sectors),
+      map_(reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE + base))
+{
+    memset(table_, 0xFF, sizeof(table_));
+}
+
+/* ---------- Index (PRIMASK held by the caller, or load()) ---------------- */
+
+int KvStore::lookup(uint32_t h, const char *key) const
+{
+    for (uint32_t n = 0, i = h & (TABLE - 1); n < TABLE; n++, i = (i + 1) & (TABLE - 1)) {
+        uint8_t e = table_[i];
+        if (e == 0xFF) return -1;
+        if (entries_[e].hash == h && strcmp(entries_[e].key, key) == 0) return e;
+    }
+    return -1;
+}
+
+int KvStore::insert(uint32_t h, const char *key, uint32_t keyLen)
+{
+    if (used_ == MAX_KEYS) return -1;
+    uint32_t i = h & (TABLE - 1);
+    while (table_[i] != 0xFF) i = (i + 1) & (TABLE - 1);
+
+    Entry &e = entries_[used_];
+    memset(&e, 0, sizeof(e));
+    e.hash   = h;
+    e.sector = NO_SECTOR;
+    memcpy(e.key, key, keyLen);
+    e.key[keyLen] = '\0';
+    table_[i] = (uint8_t)used_;
+    return (int)used_++;
+}
+
+/** Drop deleted entries and re-hash (after load: tombstones need no entry) */
+void KvStore::rebuild()
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < used_; i++) {
+        if (entries_[i].state != Live) continue;
+        if (n != i) entries_[n] = entries_[i];
+        n++;
+    }
+    used_ = n;
+    memset(table_, 0xFF, sizeof(table_));
+    for (uint32_t i = 0; i < used_; i++) {
+        uint32_t s = entries_[i].hash & (TABLE - 1);
+        while (table_[s] != 0xFF) s = (s + 1) & (TABLE - 1);
+        table_[s] = (uint8_t)i;
+    }
+}
+
+/* ---------- Load ---------------------------------------------------------- */
+
+bool KvStore::headerValid(uint32_t sector, uint32_t &seq) const
+{
+    SectorHeader h;
+    memcpy(&h, map_ + sector * SECTOR, sizeof(h));
+    if (h.magic != MAGIC || crc32(0, &h, 12) != h.crc) return false;
+    seq = h.seq;
+    return true;
+}
+
+/** Apply one sector's records; returns the append offset (SECTOR = sealed) */
+uint32_t KvStore::replay(uint32_t sector)
+{
+    const uint8_t *s = map_ + sector * SECTOR;
+    uint32_t pos = sizeof(SectorHeader);
+
+    while (pos + sizeof(RecordHeader) <= SECTOR) {
+        RecordHeader r;
+        memcpy(&r, s + pos, sizeof(r));
+        if (r.keyLen == 0xFF) break;                    // erased: end of log
+
+        const uint32_t size = recordSize(r.keyLen, r.valLen);
+        const char    *key  = reinterpret_cast<const char *>(s + pos + sizeof(r));
+        if (r.keyLen == 0 || r.keyLen > MAX_KEY || r.valLen > MAX_VALUE
+                || (r.kind != REC_SET && r.kind != REC_DEL) || pos + size > SECTOR
+                || recordCrc(s + pos, key, r.keyLen, key + r.keyLen, r.valLen) != r.crc) {
+            lstats_.bad++;
+            lstats_.bytes += sizeof(r);
+            return SECTOR;                              // cut write: never append here
+        }
+
+        char name[MAX_KEY + 1];
+        memcpy(name, key, r.keyLen);
+        name[r.keyLen] = '\0';
+        uint32_t h = hashKey(name);
+        int i = lookup(h, name);
+        if (i < 0) i = insert(h, name, r.keyLen);
+        if (i >= 0) {
+            Entry &e = entries_[i];
+            e.state  = r.kind == REC_SET ? Live : Deleted;
+            e.len    = r.valLen;
+            e.sector = (uint8_t)sector;
+            memcpy(e.value, key + r.keyLen, r.valLen);
+        }
+        lstats_.records++;
+        lstats_.bytes += size;
+        pos += size;
+    }
+    return pos;
+}
+
+KvStore::Status KvStore::load()
+{
+    used_     = 0;
+    hasHead_  = false;
+    window_   = 0;
+    headUsed_ = 0;
+    lstats_   = {};
+    memset(table_, 0xFF, sizeof(table_));
+
+    if (sectors_ < MIN_SECTORS || sectors_ > 255) return Status::ErrParam;
+    if (!flash_.mmapAcquire()) return Status::ErrBusy;
+
+    /* Head = newest valid sector header */
+    uint32_t seq;
+    for (uint32_t i = 0; i < sectors_; i++) {
+        if (headerValid(i, seq) && (!hasHead_ || (int32_t)(seq - headSeq_) > 0)) {
+            hasHead_ = true;
+            head_    = i;
+            headSeq_ = seq;
+        }
+    }
+    lstats_.bytes = sectors_ * sizeof(SectorHeader);
+
+    if (hasHead_) {
+        /* Window: contiguous run of sequence numbers ending at the head */
+        window_ = 1;
+        while (window_ < sectors_ - 1) {
+            uint32_t prev = (head_ + sectors_ - window_) % sectors_;
+            if (!headerValid(prev, seq) || seq != headSeq_ - window_) break;
+            window_++;
+        }
+        for (uint32_t k = window_; k-- > 0; ) {
+            uint32_t s   = (head_ + sectors_ - k) % sectors_;
+            uint32_t end = replay(s);
+            if (k == 0) headUsed_ = end;
+        }
+    }
+    flash_.mmapRelease();
+
+    rebuild();
+    lstats_.keys    = used_;
+    lstats_.sectors = window_;
+    lstats_.seq     = headSeq_;
+    return Status::OK;
+}
+
+/* ---------- Access -------------------------------------------------------- */
+
+bool KvStore::get(const char *key, void *out, uint32_t len) const
+{
+    uint32_t h = hashKey(key);
+    bool ok = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    int i = lookup(h, key);
+    if (i >= 0 && entries_[i].state == Live && entries_[i].len == len) {
+        memcpy(out, entries_[i].value, len);
+        ok = true;
+    }
+    __set_PRIMASK(primask);
+    return ok;
+}
+
+KvStore::Status KvStore::set(const char *key, const void *data, uint32_t len)
+{
+    uint32_t keyLen = (uint32_t)strlen(key);
+    if (keyLen == 0 || keyLen > MAX_KEY || len > MAX_VALUE || (len > 0 && data == nullptr)
+            || sectors_ < MIN_SECTORS || sectors_ > 255)
+        return Status::ErrParam;
+    uint32_t h = hashKey(key);
+    Status st = Status::OK;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    int i = lookup(h, key);
+    if (i < 0) i = insert(h, key, keyLen);
+    if (i < 0) {
+        st = Status::ErrFull;
+    } else {
+        Entry &e = entries_[i];
+        if (e.state != Live || e.len != len || memcmp(e.value, data, len) != 0) {
+            memcpy(e.value, data, len);
+            e.len   = (uint8_t)len;
+            e.state = Live;
+            e.dirty = true;
+            e.gen++;
+        }
+    }
+    __set_PRIMASK(primask);
+    return st;
+}
+
+KvStore::Status KvStore::remove(const char *key)
+{
+    uint32_t h = hashKey(key);
+    Status st = Status::OK;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    int i = lookup(h, key);
+    if (i < 0 || entries_[i].state != Live) {
+        st = Status::ErrNotFound;
+    } else {
+        Entry &e = entries_[i];
+        e.state = Deleted;
+        e.len   = 0;
+        e.dirty = e.sector != NO_SECTOR || e.batched;   // tombstone only if a record exists
+        e.gen++;
+    }
+    __set_PRIMASK(primask);
+    return st;
+}
+
+uint32_t KvStore::count() const
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < used_; i++) n += entries_[i].state == Live;
+    return n;
+}
+
+bool KvStore::at(uint32_t i, const char *&key, const uint8_t *&value, uint32_t &len) const
+{
+    if (i >= used_ || entries_[i].state != Live) return false;
+    key   = entries_[i].key;
+    value = entries_[i].value;
+    len   = entries_[i].len;
+    return true;
+}
+
+bool KvStore::busy() const
+{
+    if (op_ != Op::None || window_ > LIVE_SECTORS) return true;
+    for (uint32_t i = 0; i < used_; i++) {
+        if (entries_[i].dirty) return true;
+    }
+    return false;
+}
+
+/* ---------- Writer -------------------------------------------------------- */
+
+void KvStore::service()
+{
+    if (opPending_) return;
+    if (op_ != Op::None) finishOp();
+
+    /* Copy forward out of the oldest sector, then retire it */
+    if (window_ > LIVE_SECTORS && startCopy()) return;
+
+    for (uint32_t i = 0; i < used_; i++) {
+        if (entries_[i].dirty) {
+            startAppend();
+            return;
+        }
+    }
+}
+
+/** Completion of the op in flight (thread context, from service()) */
+void KvStore::finishOp()
+{
+    const Op op = op_;
+    op_ = Op::None;
+
+    if (opFailed_) {
+        wstats_.errors++;
+        if (op == Op::Append) {
+            for (uint32_t i = 0; i < used_; i++) entries_[i].batched = false;
+            headUsed_ = SECTOR;                 // tail unknown: seal, retry in a new sector
+        }
+        return;                                 // Open / Retire: retried by the next service()
+    }
+
+    switch (op) {
+    case Op::Open:
+        window_   = hasHead_ ? window_ + 1 : 1;
+        hasHead_  = true;
+        head_     = opSector_;
+        headSeq_  = newHeader_.seq;
+        headUsed_ = sizeof(SectorHeader);
+        wstats_.opened++;
+        break;
+
+    case Op::Append: {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        for (uint32_t i = 0; i < used_; i++) {
+            Entry &e = entries_[i];
+            if (!e.batched) continue;
+            e.batched = false;
+            e.sector  = (uint8_t)head_;
+            if (e.gen == e.flushGen) e.dirty = false;
+        }
+        __set_PRIMASK(primask);
+        headUsed_ += batchLen_;
+        wstats_.records += batchRecs_;
+        wstats_.batches++;
+        break;
+    }
+
+    case Op::Retire:
+        window_--;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Live records in the oldest sector become dirty (copied by the next
+ * append); once nothing refers to it, retire it.
+ * @retval true if an op was started
+ */
+bool KvStore::startCopy()
+{
+    const uint32_t old = oldest();
+    bool refs = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < used_; i++) {
+        Entry &e = entries_[i];
+        if (e.sector != old) continue;
+        if (e.state == Live) {
+            if (!e.dirty) wstats_.copied++;
+            e.dirty = true;
+            refs    = true;
+        } else if (!e.dirty) {
+            e.sector = NO_SECTOR;       // tombstone in the oldest sector: nothing older left
+        } else {
+            refs = true;
+        }
+    }
+    __set_PRIMASK(primask);
+    if (refs) return false;
+
+    programOp_.kind    = W25Qxx::AsyncOp::Kind::Program;
+    programOp_.address = base_ + old * SECTOR;
+    programOp_.size    = sizeof(zero_);
+    programOp_.data    = reinterpret_cast<const uint8_t *>(&zero_);
+    op_ = Op::Retire;
+    submit(false);
+    return true;
+}
+
+/** Erase the next sector of the ring and write its header */
+void KvStore::startOpen()
+{
+    if (hasHead_ && window_ + 1 >= sectors_) return;   // ring full (live set > a sector)
+
+    opSector_ = hasHead_ ? (head_ + 1) % sectors_ : 0;
+    newHeader_.magic    = MAGIC;
+    newHeader_.seq      = hasHead_ ? headSeq_ + 1 : 1;
+    newHeader_.reserved = 0xFFFFFFFF;
+    newHeader_.crc      = crc32(0, &newHeader_, 12);
+
+    eraseOp_.kind      = W25Qxx::AsyncOp::Kind::Erase;
+    eraseOp_.address   = base_ + opSector_ * SECTOR;
+    eraseOp_.size      = SECTOR;
+    programOp_.kind    = W25Qxx::AsyncOp::Kind::Program;
+    programOp_.address = eraseOp_.address;
+    programOp_.size    = sizeof(SectorHeader);
+    programOp_.data    = reinterpret_cast<const uint8_t *>(&newHeader_);
+    op_ = Op::Open;
+    submit(true);
+}
+
+/** Serialize dirty entries that fit the head sector into one program op */
+void KvStore::startAppend()
+{
+    uint32_t room = hasHead_ ? SECTOR - headUsed_ : 0;
+    if (room > BATCH) room = BATCH;
+
+    batchLen_  = 0;
+    batchRecs_ = 0;
+    for (uint32_t i = 0; i < used_; i++) {
+        Entry &e = entries_[i];
+        if (!e.dirty) continue;
+
+        /* Snapshot under PRIMASK; serialize + CRC outside */
+        char     key[MAX_KEY + 1];
+        uint8_t  value[MAX_VALUE];
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        const bool    del    = e.state != Live;
+        const uint8_t valLen = del ? 0 : e.len;
+        memcpy(key, e.key, sizeof(key));
+        memcpy(value, e.value, valLen);
+        e.flushGen = e.gen;
+        __set_PRIMASK(primask);
+
+        const uint32_t keyLen = (uint32_t)strlen(key);
+        const uint32_t size   = recordSize(keyLen, valLen);
+        if (batchLen_ + size > room) break;
+
+        uint8_t *r = &batch_[batchLen_];
+        memset(r, 0, size);
+        r[0] = (uint8_t)keyLen;
+        r[1] = valLen;
+        r[2] = del ? REC_DEL : REC_SET;
+        memcpy(r + sizeof(RecordHeader), key, keyLen);
+        memcpy(r + sizeof(RecordHeader) + keyLen, value, valLen);
+        uint32_t crc = recordCrc(r, key, keyLen, value, valLen);
+        memcpy(r + 4, &crc, 4);
+
+        e.batched = true;
+        batchLen_ += size;
+        batchRecs_++;
+    }
+
+    if (batchRecs_ == 0) {          // head full (or none): next sector first
+        startOpen();
+        return;
+    }
+
+    programOp_.kind    = W25Qxx::AsyncOp::Kind::Program;
+    programOp_.address = base_ + head_ * SECTOR + headUsed_;
+    programOp_.size    = batchLen_;
+    programOp_.data    = batch_;
+    op_ = Op::Append;
+    if (!submit(false)) {
+        for (uint32_t i = 0; i < used_; i++) entries_[i].batched = false;
+    }
+}
+
+bool KvStore::submit(bool erase)
+{
+    eraseOp_.done   = opDone;
+    eraseOp_.ctx    = this;
+    programOp_.done = opDone;
+    programOp_.ctx  = this;
+    opFailed_  = false;
+    opPending_ = true;
+
+    if ((erase && flash_.submit(eraseOp_) != W25Qxx::Status::OK)
+            || flash_.submit(programOp_) != W25Qxx::Status::OK) {
+        opPending_ = eraseOp_.pending || programOp_.pending;
+        opFailed_  = true;                  // counted by finishOp()
+        if (!opPending_) {
+            op_ = Op::None;                 // nothing queued: retry next service()
+            wstats_.errors++;
+        }
+        return false;
+    }
+    return true;
+}
+
+/** Erase / program completions (W25Qxx::service context) */
+void KvStore::opDone(void *ctx, W25Qxx::Status st)
+{
+    KvStore *self = static_cast<KvStore *>(ctx);
+    if (st != W25Qxx::Status::OK) self->opFailed_ = true;
+    if (!self->eraseOp_.pending && !self->programOp_.pending) self->opPending_ = false;
+}
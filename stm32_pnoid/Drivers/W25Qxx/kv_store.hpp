@@ -0,0 +1,214 @@
+/**
+ * @file    kv_store.hpp
+ * @brief   Log-structured key-value store in QSPI flash (calibration, tuning)
+ * @note    Reads come from a RAM index built by load(); writes are appended
+ *          through the W25Qxx async engine by service().
+ *
+ * The region is a ring of 4 KB sectors. Each opened sector starts with a
+ * SectorHeader (sequence number), followed by records appended in order:
+ *
+ *   RecordHeader (8 B)  keyLen, valLen, kind (set / delete), CRC-32 of
+ *                       the header bytes, key and value
+ *   key, value          padded to 4 bytes
+ *
+ * A set() never rewrites a record in place: the newer record wins on
+ * replay. Only the newest LIVE_SECTORS sectors hold data. When the head
+ * sector is full the next one in the ring is erased and opened, the live
+ * records still in the oldest sector are copied forward, and the oldest is
+ * retired (its magic programmed to 0). The window walks the whole ring, so
+ * every sector is erased equally often, and load() reads at most
+ * LIVE_SECTORS + 1 sectors however big the region is.
+ *
+ * Power loss: a cut while programming leaves a record whose CRC fails; the
+ * scan stops there and the sector is never appended to again. A cut during
+ * an erase or before the new sector's header is written leaves a sector
+ * without a valid header, which is simply reused. A cut between copying
+ * and retiring leaves duplicates of identical values. Every set() that
+ * completed (busy() went false) survives.
+ *
+ * Thread safety: get() / set() / remove() from any thread context (short
+ * PRIMASK sections), service() from one thread next to W25Qxx::service().
+ */
+
+#pragma once
+
+#include "w25qxx.hpp"
+#include <cstdint>
+
+class KvStore {
+public:
+    enum class Status {
+        OK = 0,
+        ErrNotFound,
+        ErrFull,        // MAX_KEYS reached
+        ErrParam,       // key / value length, region size
+        ErrBusy,        // flash mapping not available
+        ErrFlash,
+    };
+
+    static constexpr uint32_t MAGIC        = 0x564B4E50;   // "PNKV"
+    static constexpr uint32_t MAX_KEY      = 15;
+    static constexpr uint32_t MAX_VALUE    = 16;
+    static constexpr uint32_t MAX_KEYS     = 64;
+    static constexpr uint32_t LIVE_SECTORS = 2;            // data window after a copy
+    /* Copying out of the oldest sector can need one more open while the
+     * window is LIVE_SECTORS + 1: keep a spare so the ring never fills */
+    static constexpr uint32_t MIN_SECTORS  = LIVE_SECTORS + 3;
+
+    struct LoadStats {
+        uint32_t keys;
+        uint32_t records;       // valid records replayed
+        uint32_t bad;           // CRC / length failures (cut writes)
+        uint32_t bytes;         // flash bytes scanned
+        uint32_t sectors;       // sectors in the window
+        uint32_t seq;           // head sector sequence number
+    };
+
+    struct WriteStats {
+        uint32_t records;
+        uint32_t batches;       // program ops
+        uint32_t opened;        // sectors erased + opened
+        uint32_t copied;        // records moved forward out of the oldest sector
+        uint32_t errors;
+    };
+
+    /**
+     * @param  flash    Driver in memory-mapped default mode
+     * @param  base     Region start, SECTOR_SIZE aligned
+     * @param  sectors  Region size in sectors, MIN_SECTORS .. 255 (else load() and
+     *                  set() return ErrParam)
+     */
+    KvStore(W25Qxx &flash, uint32_t base, uint32_t sectors);
+
+    /**
+     * @brief  Scan the window and build the index (holds the mapping itself)
+     * @retval ErrParam for a region outside MIN_SECTORS .. 255 (nothing is written)
+     */
+    Status load();
+
+    /** Copy the value out; false when missing or stored with another length */
+    bool   get(const char *key, void *out, uint32_t len) const;
+
+    template <typename T>
+    T      get(const char *key, T def) const
+    {
+        T v;
+        return get(key, &v, sizeof(T)) ? v : def;
+    }
+
+    /**
+     * @brief  Update the index now; the record is written by service()
+     * @note   An unchanged value is not written again
+     */
+    Status set(const char *key, const void *data, uint32_t len);
+
+    template <typename T>
+    Status set(const char *key, const T &v) { return set(key, &v, sizeof(T)); }
+
+    Status remove(const char *key);
+
+    /** Write pending records, open / retire sectors; thread context */
+    void   service();
+
+    /** Records not yet on flash, or a write in flight */
+    bool   busy() const;
+
+    uint32_t count() const;
+
+    /** Live entry by index (0 .. MAX_KEYS - 1); false for a free / deleted one */
+    bool   at(uint32_t i, const char *&key, const uint8_t *&value, uint32_t &len) const;
+
+    const LoadStats  &loadStats() const  { return lstats_; }
+    const WriteStats &writeStats() const { return wstats_; }
+
+private:
+    struct SectorHeader {
+        uint32_t magic;         // 0 once retired
+        uint32_t seq;
+        uint32_t reserved;
+        uint32_t crc;           // of the first 12 bytes
+    };
+
+    struct RecordHeader {
+        uint8_t  keyLen;        // 0xFF: erased, end of the sector's log
+        uint8_t  valLen;
+        uint8_t  kind;
+        uint8_t  pad;
+        uint32_t crc;
+    };
+
+    static_assert(sizeof(SectorHeader) == 16 && sizeof(RecordHeader) == 8, "kv layout");
+
+    static constexpr uint8_t  REC_SET   = 0x5A;
+    static constexpr uint8_t  REC_DEL   = 0xA5;
+    static constexpr uint8_t  NO_SECTOR = 0xFF;
+    static constexpr uint32_t TABLE     = MAX_KEYS * 2;    // hash slots, power of two
+    static constexpr uint32_t MAX_RECORD = (sizeof(RecordHeader) + MAX_KEY + MAX_VALUE + 3) & ~3u;
+    static constexpr uint32_t BATCH     = 512;             // bytes per program op
+
+    /* The whole live set must fit one fresh sector, or a copy could stall */
+    static_assert(MAX_KEYS * MAX_RECORD <= W25Qxx::SECTOR_SIZE - sizeof(SectorHeader), "kv capacity");
+
+    enum State : uint8_t { Free = 0, Live, Deleted };
+    enum class Op : uint8_t { None, Open, Append, Retire };
+
+    struct Entry {
+        uint32_t hash;
+        char     key[MAX_KEY + 1];
+        uint8_t  value[MAX_VALUE];
+        uint8_t  len;
+        uint8_t  state;
+        uint8_t  sector;        // newest record on flash, NO_SECTOR if none
+        bool     dirty;         // RAM newer than flash
+        bool     batched;       // in the program op in flight
+        uint8_t  gen;           // bumped by every set() / remove()
+        uint8_t  flushGen;      // gen when batched
+    };
+
+    W25Qxx          &flash_;
+    uint32_t         base_;
+    uint32_t         sectors_;
+    const uint8_t   *map_;
+
+    /* Index */
+    Entry            entries_[MAX_KEYS] = {};
+    uint8_t          table_[TABLE];            // entry index, 0xFF empty
+    uint32_t         used_      = 0;           // entries_ in use
+
+    /* Log */
+    bool             hasHead_   = false;
+    uint32_t         head_      = 0;
+    uint32_t         headSeq_   = 0;
+    uint32_t         headUsed_  = 0;           // bytes; SECTOR_SIZE = sealed
+    uint32_t         window_    = 0;           // sectors holding data, head included
+
+    /* Writer */
+    Op               op_        = Op::None;
+    volatile bool    opPending_ = false;
+    bool             opFailed_  = false;
+    uint32_t         opSector_  = 0;
+    uint32_t         batchLen_  = 0;
+    uint32_t         batchRecs_ = 0;
+    W25Qxx::AsyncOp  eraseOp_;
+    W25Qxx::AsyncOp  programOp_;
+    SectorHeader     newHeader_ = {};
+    uint32_t         zero_      = 0;
+    alignas(4) uint8_t batch_[BATCH];
+
+    LoadStats        lstats_    = {};
+    WriteStats       wstats_    = {};
+
+    int      lookup(uint32_t h, const char *key) const;
+    int      insert(uint32_t h, const char *key, uint32_t keyLen);
+    void     rebuild();
+    uint32_t replay(uint32_t sector);
+    bool     headerValid(uint32_t sector, uint32_t &seq) const;
+    void     finishOp();
+    bool     startCopy();
+    void     startOpen();
+    void     startAppend();
+    bool     submit(bool erase);
+    uint32_t oldest() const { return (head_ + sectors_ - (window_ - 1)) % sectors_; }
+
+    static void opDone(void *ctx, W25Qxx::Status st);
+};
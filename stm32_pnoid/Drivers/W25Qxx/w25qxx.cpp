@@ -5,6 +5,7 @@
 
 #include "w25qxx.hpp"
 #include "debug_log.h"
+#include <cstring>
 
 static const char *TAG = "W25Q";
 
@@ -187,6 +188,13 @@ W25Qxx::Status W25Qxx::enableQE()
     return waitBusy(TIMEOUT_DEFAULT);
 }
 
+/** After a blocking write: stale mapped lines out of the D-cache */
+W25Qxx::Status W25Qxx::dropMapped(uint32_t address, uint32_t size, Status st)
+{
+    SCB_InvalidateDCache_by_Addr(reinterpret_cast<void *>(MMAP_BASE + address), (int32_t)size);
+    return st;
+}
+
 /* ---------- Public API --------------------------------------------------- */
 
 W25Qxx::Status W25Qxx::init()
@@ -270,6 +278,8 @@ W25Qxx::Status W25Qxx::readJEDECID(uint32_t &id)
 
 W25Qxx::Status W25Qxx::eraseSector(uint32_t address)
 {
+    if (!claimIndirect()) return Status::ErrBusy;
+
     auto st = writeEnable();
     if (st != Status::OK) return st;
 
@@ -278,11 +288,13 @@ W25Qxx::Status W25Qxx::eraseSector(uint32_t address)
                      QSPI_DATA_NONE, 0, 0);
     if (st != Status::OK) return Status::ErrErase;
 
-    return waitBusy(TIMEOUT_DEFAULT);
+    return dropMapped(address & ~(SECTOR_SIZE - 1), SECTOR_SIZE, waitBusy(TIMEOUT_DEFAULT));
 }
 
 W25Qxx::Status W25Qxx::eraseBlock64K(uint32_t address)
 {
+    if (!claimIndirect()) return Status::ErrBusy;
+
     auto st = writeEnable();
     if (st != Status::OK) return st;
 
@@ -291,11 +303,13 @@ W25Qxx::Status W25Qxx::eraseBlock64K(uint32_t address)
                      QSPI_DATA_NONE, 0, 0);
     if (st != Status::OK) return Status::ErrErase;
 
-    return waitBusy(TIMEOUT_DEFAULT);
+    return dropMapped(address & ~(BLOCK_SIZE_64K - 1), BLOCK_SIZE_64K, waitBusy(TIMEOUT_DEFAULT));
 }
 
 W25Qxx::Status W25Qxx::eraseChip()
 {
+    if (!claimIndirect()) return Status::ErrBusy;
+
     auto st = writeEnable();
     if (st != Status::OK) return st;
 
@@ -304,13 +318,21 @@ W25Qxx::Status W25Qxx::eraseChip()
                      QSPI_DATA_NONE, 0, 0);
     if (st != Status::OK) return Status::ErrErase;
 
-    return waitBusy(TIMEOUT_ERASE);
+    return dropMapped(0, CHIP_SIZE, waitBusy(TIMEOUT_ERASE));
 }
 
 W25Qxx::Status W25Qxx::readQuad(uint32_t address, uint8_t *data, uint32_t size)
 {
     if (data == nullptr || size == 0) return Status::ErrRead;
 
+    /* Mapped: plain copy, no mode switch */
+    if (mapped_ && mmapAcquire()) {
+        memcpy(data, reinterpret_cast<const void *>(MMAP_BASE + address), size);
+        mmapRelease();
+        return Status::OK;
+    }
+    if (!claimIndirect()) return Status::ErrBusy;
+
     QSPI_CommandTypeDef cmd{};
     cmd.Instruction       = CMD_QUAD_READ;
     cmd.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
@@ -335,6 +357,8 @@ W25Qxx::Status W25Qxx::readQuad(uint32_t address, uint8_t *data, uint32_t size)
 
 W25Qxx::Status W25Qxx::programPageQuad(uint32_t address, const uint8_t *data, uint32_t size)
 {
+    if (!claimIndirect()) return Status::ErrBusy;
+
     if (data == nullptr || size == 0 || size > PAGE_SIZE) return Status::ErrWrite;
 
     auto st = writeEnable();
@@ -359,7 +383,7 @@ W25Qxx::Status W25Qxx::programPageQuad(uint32_t address, const uint8_t *data, ui
     if (HAL_QSPI_Transmit(&hqspi_, const_cast<uint8_t*>(data), TIMEOUT_DEFAULT) != HAL_OK)
         return Status::ErrWrite;
 
-    return waitBusy(TIMEOUT_DEFAULT);
+    return dropMapped(address, size, waitBusy(TIMEOUT_DEFAULT));
 }
 
 W25Qxx::Status W25Qxx::writeData(uint32_t address, const uint8_t *data, uint32_t size)
@@ -384,23 +408,19 @@ W25Qxx::Status W25Qxx::writeData(uint32_t address, const uint8_t *data, uint32_t
 
 W25Qxx::Status W25Qxx::enableMemoryMapped()
 {
-    QSPI_CommandTypeDef cmd{};
-    cmd.Instruction       = CMD_QUAD_READ;
-    cmd.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-    cmd.AddressMode       = QSPI_ADDRESS_4_LINES;
-    cmd.AddressSize       = QSPI_ADDRESS_24_BITS;
-    cmd.DataMode          = QSPI_DATA_4_LINES;
-    cmd.DummyCycles       = 6;
-    cmd.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-    cmd.DdrMode           = QSPI_DDR_MODE_DISABLE;
-    cmd.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-
-    QSPI_MemoryMappedTypeDef mmap{};
-    mmap.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+    mmapDefault_ = true;
+    if (mapped_ || asyncBusy()) return Status::OK;     /* engine maps when idle */
 
-    if (HAL_QSPI_MemoryMapped(&hqspi_, &cmd, &mmap) != HAL_OK)
-        return Status::ErrMemoryMapped;
+    Status st = enterMapped();
+    if (st != Status::OK) return st;
 
     LOGI(TAG, "Memory-mapped mode enabled at 0x%08lX", MMAP_BASE);
     return Status::OK;
 }
+
+bool W25Qxx::disableMemoryMapped()
+{
+    mmapDefault_ = false;
+    if (!mapped_ || asyncBusy()) return true;          /* engine leaves it with the write */
+    return claimIndirect();
+}
@@ -2,6 +2,30 @@
  * @file    w25qxx.hpp
  * @brief   W25Q64JV QSPI Flash Driver (C++ OOP)
  * @note    Uses QUADSPI peripheral via HAL. Flash size: 8MB (64Mbit)
+ *
+ * Two ways to change the flash:
+ *   blocking   eraseSector / writeData / ...: spin in waitBusy() for the
+ *              whole erase or page program (up to TIMEOUT_ERASE)
+ *   async      submit(AsyncOp): WREN, command, data and the BUSY poll are
+ *              chained from the QUADSPI interrupt (HAL_QSPI_*_IT, auto
+ *              polling in hardware), one page / erase unit per step;
+ *              service() delivers completion callbacks in thread context
+ *
+ * While async work is pending the blocking calls return ErrBusy.
+ *
+ * Memory-mapped (XIP) reads are arbitrated with the writes: with
+ * enableMemoryMapped() the flash is mapped at MMAP_BASE whenever no write
+ * is running. Readers bracket every access with mmapAcquire() /
+ * mmapRelease(); the engine drops to indirect mode only while no reader
+ * holds the mapping, and between page / erase units it hands the mapping
+ * back to waiting readers. A reader arriving during a sector / block
+ * erase suspends it (0x75), reads, and the erase resumes (0x7A) on the
+ * last release. Ranges with a pending write are reported through the
+ * invalidate hook at submit() and by regionStable().
+ *
+ * The mapping owns MPU region MMAP_MPU_REGION (read-only, write-through),
+ * enabled only while the QSPI is actually memory-mapped: a stray access
+ * in indirect mode faults instead of stalling the bus.
  */
 
 #pragma once
@@ -19,6 +43,7 @@ public:
     static constexpr uint32_t BLOCK_SIZE_64K = 64 * 1024;
     static constexpr uint32_t JEDEC_ID       = 0xEF4017;
     static constexpr uint32_t MMAP_BASE      = 0x90000000;
+    static constexpr uint8_t  MMAP_MPU_REGION = 2;     // MPU_REGION_NUMBER2, after main.c's 0/1
 
     enum class Status {
         OK = 0,
@@ -31,6 +56,56 @@ public:
         ErrWrite,
         ErrMemoryMapped,
         ErrTimeout,
+        ErrBusy,
+    };
+
+    /**
+     * @brief  One queued erase / program (caller-owned, no allocation)
+     * @note   data must stay valid until done runs; any RAM, the CPU feeds
+     *         the QSPI FIFO
+     */
+    struct AsyncOp {
+        enum class Kind : uint8_t {
+            Program,        // size bytes from data, split at page boundaries
+            Erase,          // size bytes, 4 KB multiple: 64 KB blocks where aligned
+            EraseChip,
+        };
+
+        Kind            kind    = Kind::Program;
+        uint32_t        address = 0;
+        uint32_t        size    = 0;
+        const uint8_t  *data    = nullptr;
+        void          (*done)(void *ctx, Status st) = nullptr;   // from service()
+        void           *ctx     = nullptr;
+
+        /* Engine-owned */
+        volatile bool   pending = false;    // queued, running or awaiting done
+        Status          result  = Status::OK;
+        uint32_t        offset  = 0;
+        AsyncOp        *next    = nullptr;
+    };
+
+    struct MmapStats {
+        uint32_t enters;
+        uint32_t exits;
+        uint32_t suspends;          // erase suspended for a reader
+        uint32_t pauses;            // mapping handed back between units
+        uint32_t deferred;          // write start waited for readers
+        uint32_t lastEnterCycles;
+        uint32_t maxEnterCycles;    // indirect → mapped (incl. MPU)
+        uint32_t lastExitCycles;
+        uint32_t maxExitCycles;     // mapped → indirect (abort)
+        uint32_t maxSuspendCycles;  // reader during erase: suspend + map
+    };
+
+    struct AsyncStats {
+        uint32_t ops;
+        uint32_t pages;
+        uint32_t erases;
+        uint32_t errors;
+        uint32_t timeouts;
+        uint32_t lastOpMs;
+        uint32_t maxOpMs;
     };
 
     /**
@@ -80,11 +155,58 @@ public:
     Status writeData(uint32_t address, const uint8_t *data, uint32_t size);
 
     /**
-     * @brief  Enable memory-mapped mode. Flash readable at 0x90000000
-     * @note   After calling this, no other QSPI commands can be issued
+     * @brief  Make memory-mapped mode the default. Flash readable at
+     *         0x90000000 between mmapAcquire() / mmapRelease()
+     * @note   Blocking calls leave the mapping; service() restores it
      */
     Status enableMemoryMapped();
 
+    /** Back to indirect-only (false if a reader still holds the mapping) */
+    bool   disableMemoryMapped();
+
+    /**
+     * @brief  Hold the mapping for a read
+     * @retval true: MMAP_BASE is readable until mmapRelease(). false: a
+     *         write owns the bus — the engine yields at the next unit (or
+     *         suspends a running erase, which makes this call succeed)
+     * @note   Thread context; keep the hold short, writes wait for it
+     */
+    bool   mmapAcquire();
+    void   mmapRelease();
+    bool   isMapped() const { return mapped_; }
+
+    /** No queued / running write overlaps [address, address + size) */
+    bool   regionStable(uint32_t address, uint32_t size) const;
+
+    /** Called from submit() with the range a write is about to change */
+    void   setInvalidateHook(void (*fn)(void *ctx, uint32_t address, uint32_t size),
+                             void *ctx);
+
+    const MmapStats &mmapStats() const { return mstats_; }
+
+    /* ---------- Async engine (w25qxx_async.cpp) ------------------------- */
+
+    /**
+     * @brief  Queue an erase / program; starts at once if the engine is idle
+     * @note   Task / superloop context, not from an ISR
+     */
+    Status submit(AsyncOp &op);
+
+    /**
+     * @brief  Deliver completion callbacks, time out a stuck step
+     * @note   Call periodically from one thread context
+     */
+    void   service();
+
+    bool   asyncBusy() const { return cur_ != nullptr || qHead_ != nullptr; }
+    const AsyncStats &asyncStats() const { return astats_; }
+
+    /** HAL QSPI callbacks (file-local singleton) */
+    void   onCmdComplete();
+    void   onTxComplete();
+    void   onStatusMatch();
+    void   onError();
+
 private:
     QSPI_HandleTypeDef &hqspi_;
 
@@ -102,12 +224,18 @@ private:
     static constexpr uint8_t CMD_CHIP_ERASE         = 0xC7;
     static constexpr uint8_t CMD_QUAD_READ          = 0xEB;
     static constexpr uint8_t CMD_QUAD_PAGE_PROGRAM  = 0x32;
+    static constexpr uint8_t CMD_ERASE_SUSPEND      = 0x75;
+    static constexpr uint8_t CMD_ERASE_RESUME       = 0x7A;
     static constexpr uint8_t CMD_ENABLE_RESET       = 0x66;
     static constexpr uint8_t CMD_RESET_DEVICE       = 0x99;
 
     static constexpr uint8_t SR1_BUSY = 0x01;
     static constexpr uint8_t SR1_WEL  = 0x02;
     static constexpr uint8_t SR2_QE   = 0x02;
+    static constexpr uint8_t SR2_SUS  = 0x80;
+
+    static constexpr uint32_t SUSPEND_GAP_MS = 2;   // erase progress between suspends
+    static constexpr uint32_t PAUSE_MS       = 2;   // read window between write units
 
     Status sendCommand(uint32_t instruction, uint32_t address,
                        uint32_t addressMode, uint32_t addressSize,
@@ -116,4 +244,51 @@ private:
     Status waitBusy(uint32_t timeout);
     Status resetDevice();
     Status enableQE();
+    Status dropMapped(uint32_t address, uint32_t size, Status st);
+
+    /* Async engine: IRQ-driven step machine over cur_ */
+    enum class Step : uint8_t {
+        Idle, Starting, WriteEnable, WelPoll, Command, Transmit, BusyPoll,
+        Paused,         // between units, mapped for readers
+        Suspended,      // erase suspended, mapped for readers
+        Resuming,
+    };
+
+    AsyncOp          *qHead_    = nullptr;
+    AsyncOp          *qTail_    = nullptr;
+    AsyncOp *volatile cur_      = nullptr;
+    AsyncOp          *doneHead_ = nullptr;
+    AsyncOp          *doneTail_ = nullptr;
+    volatile Step     step_     = Step::Idle;
+    uint32_t          chunk_    = 0;        // bytes covered by the running step
+    uint8_t           eraseCmd_ = 0;
+    uint32_t          stepMs_   = 0;        // HAL_GetTick at step start
+    uint32_t          opMs_     = 0;
+    AsyncStats        astats_   = {};
+
+    /* XIP arbiter */
+    volatile bool     mapped_       = false;
+    bool              mmapDefault_  = false;
+    volatile uint8_t  readers_      = 0;
+    volatile bool     readWanted_   = false;
+    volatile bool     writeWaiting_ = false;
+    uint32_t          pauseMs_      = 0;
+    uint32_t          resumeMs_     = 0;
+    MmapStats         mstats_       = {};
+    void            (*invalidate_)(void *ctx, uint32_t address, uint32_t size) = nullptr;
+    void             *invalidateCtx_ = nullptr;
+
+    Status enterMapped();
+    void   exitMapped();
+    bool   claimIndirect();
+    void   kick();
+    void   resumeWrites();
+    void   suspendErase();
+
+    void   popLocked();
+    void   startNext();
+    void   beginUnit();
+    void   issueCommand();
+    void   pollStatus(uint8_t match, uint8_t mask, Step next);
+    void   finish(Status st);
 };
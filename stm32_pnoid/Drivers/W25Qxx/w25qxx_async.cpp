@@ -0,0 +1,596 @@
+/**
+ * @file    w25qxx_async.cpp
+ * @brief   W25Qxx non-blocking erase / program engine
+ * @note    Needs QUADSPI_IRQHandler → HAL_QSPI_IRQHandler and the QUADSPI
+ *          NVIC line enabled (stm32h7xx_hal_msp.c / stm32h7xx_it.c).
+ *
+ * Each page program / erase unit is a chain of interrupt-completed steps:
+ *
+ *   WREN (Command_IT) → WEL poll (AutoPolling_IT)
+ *     → program: Command_IT + Transmit_IT (CPU fills the FIFO in the IRQ)
+ *     → erase:   Command_IT
+ *   → BUSY poll (AutoPolling_IT: the QSPI reads SR1 in hardware and
+ *     interrupts on the match, no CPU time while the array is busy)
+ *
+ * The next unit (or the next queued op) starts from the status-match
+ * interrupt, so the flash never waits for the main loop. Only completion
+ * callbacks and the step watchdog need service().
+ *
+ * XIP arbiter (enableMemoryMapped): the bus is either memory-mapped with
+ * readers_ holders or owned by one write unit. Mode changes:
+ *
+ *   mapped → indirect   first op starts and readers_ == 0 (else the op
+ *                       waits, writeWaiting_ blocks new readers)
+ *   unit boundary       a reader asked (readWanted_): map, Step::Paused
+ *                       until the last release or PAUSE_MS
+ *   erase running       a reader asked: suspend, map, Step::Suspended
+ *                       until the last release, then resume + BUSY poll
+ *   queue empty         map again
+ *
+ * The mapped window is write-through cacheable; finished writes
+ * invalidate their range from the D-cache before the next mapping.
+ */
+
+#include "w25qxx.hpp"
+#include "debug_log.h"
+
+static const char *TAG = "W25Q";
+
+/* ---------- Singleton pointer for HAL callbacks -------------------------- */
+
+static W25Qxx *g_instance = nullptr;
+
+/* ---------- Command templates -------------------------------------------- */
+
+static QSPI_CommandTypeDef command(uint8_t instruction, uint32_t address,
+                                   uint32_t addressMode, uint32_t dataMode,
+                                   uint32_t nbData)
+{
+    QSPI_CommandTypeDef cmd{};
+    cmd.Instruction       = instruction;
+    cmd.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
+    cmd.Address           = address;
+    cmd.AddressMode       = addressMode;
+    cmd.AddressSize       = QSPI_ADDRESS_24_BITS;
+    cmd.DataMode          = dataMode;
+    cmd.DummyCycles       = 0;
+    cmd.NbData            = nbData;
+    cmd.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+    cmd.DdrMode           = QSPI_DDR_MODE_DISABLE;
+    cmd.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
+    return cmd;
+}
+
+/* ---------- Step machine (QSPI IRQ, or thread when the engine was idle) -- */
+
+/** Move the queue head to cur_; caller holds PRIMASK */
+void W25Qxx::popLocked()
+{
+    cur_ = qHead_;
+    if (cur_ == nullptr) return;
+    qHead_ = cur_->next;
+    if (qHead_ == nullptr) qTail_ = nullptr;
+    cur_->next = nullptr;
+}
+
+void W25Qxx::startNext()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    popLocked();
+    bool wait = false;
+    if (cur_ != nullptr && mapped_) {
+        if (readers_ > 0) {
+            /* Readers hold the bus: put the op back, last release kicks it */
+            cur_->next = qHead_;
+            qHead_     = cur_;
+            if (qTail_ == nullptr) qTail_ = cur_;
+            cur_          = nullptr;
+            writeWaiting_ = true;
+            wait          = true;
+        } else {
+            mapped_ = false;            /* no new readers from here on */
+        }
+    }
+    if (cur_ == nullptr) step_ = Step::Idle;
+    __set_PRIMASK(primask);
+
+    if (wait) {
+        mstats_.deferred++;
+        return;
+    }
+    if (cur_ == nullptr) {
+        if (mmapDefault_ && !mapped_) enterMapped();
+        return;
+    }
+
+    writeWaiting_ = false;
+    exitMapped();
+    opMs_ = HAL_GetTick();
+    beginUnit();
+}
+
+void W25Qxx::beginUnit()
+{
+    AsyncOp &op   = *cur_;
+    uint32_t addr = op.address + op.offset;
+    uint32_t left = op.size - op.offset;
+
+    switch (op.kind) {
+    case AsyncOp::Kind::Program:
+        chunk_ = PAGE_SIZE - (addr % PAGE_SIZE);
+        if (chunk_ > left) chunk_ = left;
+        break;
+    case AsyncOp::Kind::Erase:
+        if ((addr % BLOCK_SIZE_64K) == 0 && left >= BLOCK_SIZE_64K) {
+            eraseCmd_ = CMD_BLOCK_ERASE_64K;
+            chunk_    = BLOCK_SIZE_64K;
+        } else {
+            eraseCmd_ = CMD_SECTOR_ERASE;
+            chunk_    = SECTOR_SIZE;
+        }
+        break;
+    case AsyncOp::Kind::EraseChip:
+        eraseCmd_ = CMD_CHIP_ERASE;
+        chunk_    = 0;
+        break;
+    }
+
+    stepMs_ = HAL_GetTick();
+    step_   = Step::WriteEnable;        /* before the call: the IRQ may beat the return */
+    QSPI_CommandTypeDef cmd = command(CMD_WRITE_ENABLE, 0, QSPI_ADDRESS_NONE,
+                                      QSPI_DATA_NONE, 0);
+    if (HAL_QSPI_Command_IT(&hqspi_, &cmd) != HAL_OK) finish(Status::ErrWriteEnable);
+}
+
+void W25Qxx::issueCommand()
+{
+    AsyncOp &op   = *cur_;
+    uint32_t addr = op.address + op.offset;
+
+    if (op.kind == AsyncOp::Kind::Program) {
+        /* With a data phase Command_IT only configures; Transmit_IT starts it */
+        QSPI_CommandTypeDef cmd = command(CMD_QUAD_PAGE_PROGRAM, addr, QSPI_ADDRESS_1_LINE,
+                                          QSPI_DATA_4_LINES, chunk_);
+        step_ = Step::Transmit;
+        if (HAL_QSPI_Command_IT(&hqspi_, &cmd) != HAL_OK
+                || HAL_QSPI_Transmit_IT(&hqspi_, const_cast<uint8_t *>(op.data + op.offset)) != HAL_OK) {
+            finish(Status::ErrWrite);
+        }
+        return;
+    }
+
+    QSPI_CommandTypeDef cmd = command(eraseCmd_, addr,
+                                      op.kind == AsyncOp::Kind::EraseChip ? QSPI_ADDRESS_NONE
+                                                                          : QSPI_ADDRESS_1_LINE,
+                                      QSPI_DATA_NONE, 0);
+    step_ = Step::Command;
+    if (HAL_QSPI_Command_IT(&hqspi_, &cmd) != HAL_OK) finish(Status::ErrErase);
+}
+
+void W25Qxx::pollStatus(uint8_t match, uint8_t mask, Step next)
+{
+    QSPI_CommandTypeDef cmd = command(CMD_READ_STATUS_REG1, 0, QSPI_ADDRESS_NONE,
+                                      QSPI_DATA_1_LINE, 1);
+
+    QSPI_AutoPollingTypeDef cfg{};
+    cfg.Match           = match;
+    cfg.Mask            = mask;
+    cfg.MatchMode       = QSPI_MATCH_MODE_AND;
+    cfg.StatusBytesSize = 1;
+    cfg.Interval        = 0x10;
+    cfg.AutomaticStop   = QSPI_AUTOMATIC_STOP_ENABLE;
+
+    step_ = next;
+    if (HAL_QSPI_AutoPolling_IT(&hqspi_, &cmd, &cfg) != HAL_OK) finish(Status::ErrAutoPolling);
+}
+
+void W25Qxx::finish(Status st)
+{
+    AsyncOp *op = cur_;
+    op->result  = st;
+
+    /* Mapped window is cacheable: drop stale lines of the changed range */
+    if (op->kind == AsyncOp::Kind::EraseChip) dropMapped(0, CHIP_SIZE, st);
+    else                                      dropMapped(op->address, op->size, st);
+
+    uint32_t ms = HAL_GetTick() - opMs_;
+    astats_.ops++;
+    astats_.lastOpMs = ms;
+    if (ms > astats_.maxOpMs) astats_.maxOpMs = ms;
+    if (st != Status::OK)     astats_.errors++;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    op->next = nullptr;
+    if (doneTail_) doneTail_->next = op;
+    else           doneHead_       = op;
+    doneTail_ = op;
+    __set_PRIMASK(primask);
+
+    startNext();
+}
+
+void W25Qxx::onCmdComplete()
+{
+    if (step_ == Step::WriteEnable) {
+        pollStatus(SR1_WEL, SR1_WEL, Step::WelPoll);
+    } else if (step_ == Step::Command) {
+        astats_.erases++;
+        pollStatus(0x00, SR1_BUSY, Step::BusyPoll);
+    }
+}
+
+void W25Qxx::onTxComplete()
+{
+    if (step_ != Step::Transmit) return;
+    astats_.pages++;
+    pollStatus(0x00, SR1_BUSY, Step::BusyPoll);
+}
+
+void W25Qxx::onStatusMatch()
+{
+    if (step_ == Step::WelPoll) {
+        issueCommand();
+    } else if (step_ == Step::BusyPoll) {
+        cur_->offset += chunk_;
+        if (cur_->kind == AsyncOp::Kind::EraseChip || cur_->offset >= cur_->size) {
+            finish(Status::OK);
+        } else if (readWanted_) {
+            /* Hand the bus to the waiting readers for a while */
+            step_    = Step::Paused;
+            pauseMs_ = HAL_GetTick();
+            mstats_.pauses++;
+            enterMapped();
+        } else {
+            beginUnit();
+        }
+    }
+}
+
+void W25Qxx::onError()
+{
+    if (cur_ == nullptr) return;
+
+    switch (step_) {
+    case Step::WriteEnable:
+    case Step::WelPoll:   finish(Status::ErrWriteEnable); break;
+    case Step::Transmit:  finish(Status::ErrWrite);       break;
+    case Step::Command:   finish(Status::ErrErase);       break;
+    default:              finish(Status::ErrAutoPolling); break;
+    }
+}
+
+/* ---------- XIP arbiter -------------------------------------------------- */
+
+/** MPU window over the mapped flash: live only while the QSPI is mapped */
+static void mpuWindow(bool on)
+{
+    MPU_Region_InitTypeDef r{};
+    r.Enable           = on ? MPU_REGION_ENABLE : MPU_REGION_DISABLE;
+    r.Number           = W25Qxx::MMAP_MPU_REGION;
+    r.BaseAddress      = W25Qxx::MMAP_BASE;
+    r.Size             = MPU_REGION_SIZE_8MB;
+    r.SubRegionDisable = 0x0;
+    r.TypeExtField     = MPU_TEX_LEVEL0;
+    r.AccessPermission = MPU_REGION_PRIV_RO_URO;
+    r.DisableExec      = MPU_INSTRUCTION_ACCESS_DISABLE;
+    r.IsShareable      = MPU_ACCESS_NOT_SHAREABLE;
+    r.IsCacheable      = MPU_ACCESS_CACHEABLE;         /* write-through: C=1, B=0 */
+    r.IsBufferable     = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&r);
+    __DSB();
+    __ISB();
+}
+
+W25Qxx::Status W25Qxx::enterMapped()
+{
+    uint32_t c0 = DWT->CYCCNT;
+
+    /* 0xEB: address, then mode byte M7-0 on 4 lines (0xFF: M5-4 != 10, no
+     * continuous read mode — every access sends the instruction), then
+     * 4 dummy clocks; 2 + 4 = the 6 clocks the datasheet specifies */
+    QSPI_CommandTypeDef cmd = command(CMD_QUAD_READ, 0, QSPI_ADDRESS_4_LINES,
+                                      QSPI_DATA_4_LINES, 0);
+    cmd.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
+    cmd.AlternateBytes     = 0xFF;
+    cmd.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
+    cmd.DummyCycles        = 4;
+
+    QSPI_MemoryMappedTypeDef mmap{};
+    mmap.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+
+    if (HAL_QSPI_MemoryMapped(&hqspi_, &cmd, &mmap) != HAL_OK)
+        return Status::ErrMemoryMapped;
+
+    mpuWindow(true);
+    readWanted_ = false;
+    mapped_     = true;
+
+    uint32_t cyc = DWT->CYCCNT - c0;
+    mstats_.enters++;
+    mstats_.lastEnterCycles = cyc;
+    if (cyc > mstats_.maxEnterCycles) mstats_.maxEnterCycles = cyc;
+    return Status::OK;
+}
+
+/** Caller made sure readers_ == 0 and cleared mapped_ under PRIMASK */
+void W25Qxx::exitMapped()
+{
+    if (hqspi_.State != HAL_QSPI_STATE_BUSY_MEM_MAPPED) return;
+
+    uint32_t c0 = DWT->CYCCNT;
+    mpuWindow(false);
+    HAL_QSPI_Abort(&hqspi_);
+
+    uint32_t cyc = DWT->CYCCNT - c0;
+    mstats_.exits++;
+    mstats_.lastExitCycles = cyc;
+    if (cyc > mstats_.maxExitCycles) mstats_.maxExitCycles = cyc;
+}
+
+/** Blocking API entry: bus free of readers and async work, indirect mode */
+bool W25Qxx::claimIndirect()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool ok = !asyncBusy() && readers_ == 0;
+    if (ok) mapped_ = false;
+    __set_PRIMASK(primask);
+
+    if (ok) exitMapped();
+    return ok;
+}
+
+/** Start the queue head if nothing runs (thread context) */
+void W25Qxx::kick()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool go = (cur_ == nullptr && step_ == Step::Idle && qHead_ != nullptr);
+    if (go) step_ = Step::Starting;
+    __set_PRIMASK(primask);
+
+    if (go) startNext();
+}
+
+/** Readers gone: continue a paused / suspended write or a waiting one */
+void W25Qxx::resumeWrites()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Step from = step_;
+    bool go = readers_ == 0 && (from == Step::Paused || from == Step::Suspended);
+    if (go) {
+        step_   = Step::Resuming;
+        mapped_ = false;
+    }
+    __set_PRIMASK(primask);
+
+    if (!go) {
+        if (writeWaiting_ && readers_ == 0) kick();
+        return;
+    }
+
+    exitMapped();
+    stepMs_ = HAL_GetTick();
+    if (from == Step::Paused) {
+        beginUnit();
+        return;
+    }
+
+    resumeMs_ = stepMs_;
+    if (sendCommand(CMD_ERASE_RESUME, 0, QSPI_ADDRESS_NONE, QSPI_ADDRESS_24_BITS,
+                    QSPI_DATA_NONE, 0, 0) != Status::OK) {
+        finish(Status::ErrErase);
+        return;
+    }
+    pollStatus(0x00, SR1_BUSY, Step::BusyPoll);
+}
+
+/** Reader during a sector / block erase: suspend it and map (thread) */
+void W25Qxx::suspendErase()
+{
+    if (HAL_GetTick() - resumeMs_ < SUSPEND_GAP_MS) return;
+
+    uint32_t c0 = DWT->CYCCNT;
+    HAL_NVIC_DisableIRQ(QUADSPI_IRQn);
+
+    if (step_ != Step::BusyPoll || cur_ == nullptr || cur_->kind != AsyncOp::Kind::Erase) {
+        HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
+        return;
+    }
+
+    /* Stop the BUSY auto-poll, suspend, wait tSUS (≤ 20 µs) */
+    HAL_QSPI_Abort(&hqspi_);
+    uint8_t sr2 = 0;
+    bool ok = sendCommand(CMD_ERASE_SUSPEND, 0, QSPI_ADDRESS_NONE, QSPI_ADDRESS_24_BITS,
+                          QSPI_DATA_NONE, 0, 0) == Status::OK
+           && waitBusy(TIMEOUT_DEFAULT) == Status::OK
+           && sendCommand(CMD_READ_STATUS_REG2, 0, QSPI_ADDRESS_NONE, QSPI_ADDRESS_24_BITS,
+                          QSPI_DATA_1_LINE, 0, 1) == Status::OK
+           && HAL_QSPI_Receive(&hqspi_, &sr2, TIMEOUT_DEFAULT) == HAL_OK;
+
+    if (!ok) {
+        finish(Status::ErrErase);
+    } else if ((sr2 & SR2_SUS) == 0) {
+        onStatusMatch();                /* erase had already finished */
+    } else {
+        step_ = Step::Suspended;
+        enterMapped();
+        mstats_.suspends++;
+        uint32_t cyc = DWT->CYCCNT - c0;
+        if (cyc > mstats_.maxSuspendCycles) mstats_.maxSuspendCycles = cyc;
+    }
+
+    HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
+}
+
+bool W25Qxx::mmapAcquire()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool ok = mapped_ && !writeWaiting_;
+    if (ok) readers_++;
+    else    readWanted_ = true;
+    __set_PRIMASK(primask);
+    if (ok) return true;
+
+    /* Long erase in progress: suspend it rather than wait 45 ms .. 2 s */
+    if (step_ == Step::BusyPoll && cur_ != nullptr && cur_->kind == AsyncOp::Kind::Erase) {
+        suspendErase();
+        primask = __get_PRIMASK();
+        __disable_irq();
+        ok = mapped_;
+        if (ok) readers_++;
+        __set_PRIMASK(primask);
+    }
+    return ok;
+}
+
+void W25Qxx::mmapRelease()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (readers_ > 0) readers_--;
+    bool last = (readers_ == 0);
+    __set_PRIMASK(primask);
+
+    if (last) resumeWrites();
+}
+
+bool W25Qxx::regionStable(uint32_t address, uint32_t size) const
+{
+    auto overlaps = [address, size](const AsyncOp *op) {
+        return op->kind == AsyncOp::Kind::EraseChip
+            || (address < op->address + op->size && op->address < address + size);
+    };
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool stable = (cur_ == nullptr || !overlaps(cur_));
+    for (const AsyncOp *op = qHead_; op != nullptr && stable; op = op->next) {
+        stable = !overlaps(op);
+    }
+    __set_PRIMASK(primask);
+    return stable;
+}
+
+void W25Qxx::setInvalidateHook(void (*fn)(void *ctx, uint32_t address, uint32_t size),
+                               void *ctx)
+{
+    invalidate_    = fn;
+    invalidateCtx_ = ctx;
+}
+
+/* ---------- Public API --------------------------------------------------- */
+
+W25Qxx::Status W25Qxx::submit(AsyncOp &op)
+{
+    if (op.pending) return Status::ErrBusy;
+
+    if (op.kind == AsyncOp::Kind::Program) {
+        if (op.data == nullptr || op.size == 0 || op.address + op.size > CHIP_SIZE)
+            return Status::ErrWrite;
+    } else if (op.kind == AsyncOp::Kind::Erase) {
+        if (op.size == 0 || (op.address % SECTOR_SIZE) != 0 || (op.size % SECTOR_SIZE) != 0
+                || op.address + op.size > CHIP_SIZE)
+            return Status::ErrErase;
+    }
+
+    g_instance = this;
+    op.offset  = 0;
+    op.result  = Status::OK;
+    op.next    = nullptr;
+    op.pending = true;
+
+    /* Consumers drop what they cached from the range before it changes */
+    if (invalidate_) {
+        if (op.kind == AsyncOp::Kind::EraseChip) invalidate_(invalidateCtx_, 0, CHIP_SIZE);
+        else                                     invalidate_(invalidateCtx_, op.address, op.size);
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (qTail_) qTail_->next = &op;
+    else        qHead_       = &op;
+    qTail_ = &op;
+    __set_PRIMASK(primask);
+
+    /* Idle engine: no interrupt will pick the op up — start it here */
+    kick();
+    return Status::OK;
+}
+
+void W25Qxx::service()
+{
+    /* Read window over / readers gone: continue the write */
+    if (readers_ == 0) {
+        if (step_ == Step::Paused) {
+            if (HAL_GetTick() - pauseMs_ >= PAUSE_MS) resumeWrites();
+        } else if (step_ == Step::Suspended || writeWaiting_) {
+            resumeWrites();
+        }
+    }
+
+    /* Blocking calls left the mapping: back to XIP once idle */
+    if (mmapDefault_ && !mapped_ && step_ == Step::Idle && !asyncBusy()) enterMapped();
+
+    /* Watchdog: the BUSY poll has no timeout of its own */
+    if (cur_ != nullptr) {
+        uint32_t limit = cur_->kind == AsyncOp::Kind::EraseChip ? TIMEOUT_ERASE : TIMEOUT_DEFAULT;
+        HAL_NVIC_DisableIRQ(QUADSPI_IRQn);
+        Step s = step_;
+        if (cur_ != nullptr && s != Step::Paused && s != Step::Suspended
+                && (HAL_GetTick() - stepMs_) > limit) {
+            LOGE(TAG, "Async step %d timed out at 0x%06lX",
+                 (int)step_, cur_->address + cur_->offset);
+            HAL_QSPI_Abort(&hqspi_);
+            astats_.timeouts++;
+            finish(Status::ErrTimeout);
+        }
+        HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
+    }
+
+    for (;;) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        AsyncOp *op = doneHead_;
+        if (op) {
+            doneHead_ = op->next;
+            if (doneHead_ == nullptr) doneTail_ = nullptr;
+        }
+        __set_PRIMASK(primask);
+
+        if (op == nullptr) break;
+        Status st   = op->result;
+        op->pending = false;                /* done may resubmit the same op */
+        if (op->done) op->done(op->ctx, st);
+    }
+}
+
+/* ---------- HAL Callbacks (weak overrides) ------------------------------- */
+
+extern "C" {
+
+void HAL_QSPI_CmdCpltCallback(QSPI_HandleTypeDef *hqspi)
+{
+    if (g_instance) g_instance->onCmdComplete();
+}
+
+void HAL_QSPI_TxCpltCallback(QSPI_HandleTypeDef *hqspi)
+{
+    if (g_instance) g_instance->onTxComplete();
+}
+
+void HAL_QSPI_StatusMatchCallback(QSPI_HandleTypeDef *hqspi)
+{
+    if (g_instance) g_instance->onStatusMatch();
+}
+
+void HAL_QSPI_ErrorCallback(QSPI_HandleTypeDef *hqspi)
+{
+    if (g_instance) g_instance->onError();
+}
+
+} /* extern "C" */
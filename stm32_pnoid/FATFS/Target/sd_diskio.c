@@ -18,7 +18,10 @@
 /* USER CODE END Header */
 
 /* Note: code generation based on sd_diskio_template_bspv1.c v2.1.4
-   as "Use dma template" is disabled. */
+   as "Use dma template" is disabled.
+   SD_read / SD_write below are hand-edited to the IDMA scheme of
+   sd_diskio_dma_template_bspv1.c (interrupt completion, cache maintenance,
+   aligned scratch buffer) — re-apply after regenerating. */
 
 /* USER CODE BEGIN firstSection */
 /* can be used to modify / undefine following code or add new definitions */
@@ -87,9 +90,137 @@ const Diskio_drvTypeDef  SD_Driver =
 extern SD_HandleTypeDef hsd1;
 static const char *SDIO_TAG = "SDIO";
 
-/* SDMMC IDMA on STM32H7 requires 32-byte aligned buffer */
-#define SD_BLOCK_SIZE 512
-__ALIGNED(32) static uint8_t sd_align_buf[SD_BLOCK_SIZE];
+/*
+ * Block I/O runs on the SDMMC1 internal DMA (IDMA): multi-sector requests
+ * go out as one CMD18 / CMD25 transfer and completion arrives through
+ * SDMMC1_IRQHandler, so the caller sleeps (SD_WaitHook) instead of
+ * spinning on the FIFO.
+ *
+ * IDMA is an AXI master: it cannot reach DTCM (0x20000000, where stack
+ * FIL / FATFS buffers live) and moves whole cache lines, so buffers that
+ * are in DTCM or not 32-byte aligned go through sd_scratch in chunks.
+ */
+#define SD_BLOCK_SIZE       512
+#ifndef SD_SCRATCH_SECTORS
+#define SD_SCRATCH_SECTORS  8       /* bounce buffer, 4 KB in AXI SRAM */
+#endif
+#ifndef SD_IO_TIMEOUT_MS
+#define SD_IO_TIMEOUT_MS    2000    /* per transfer incl. card busy (SD_TIMEOUT is ~forever) */
+#endif
+#define SD_DTCM_BASE        0x20000000u
+#define SD_DTCM_END         0x20020000u
+
+__ALIGNED(32) static uint8_t sd_scratch[SD_SCRATCH_SECTORS * SD_BLOCK_SIZE];
+
+/* Transfer state, written by the SDMMC interrupt */
+#define SD_XFER_BUSY   0u
+#define SD_XFER_DONE   1u
+#define SD_XFER_ERROR  2u
+static volatile uint8_t sd_xfer = SD_XFER_DONE;
+
+static uint8_t      sd_dma = 1;         /* 0: blocking FIFO polling */
+static SD_IO_Stats_t sd_stats;
+
+static int SD_DmaReachable(const void *buf)
+{
+  uint32_t a = (uint32_t)buf;
+  if (a & 31u) return 0;
+  if (a >= SD_DTCM_BASE && a < SD_DTCM_END) return 0;
+  return 1;
+}
+
+/**
+  * @brief  Wait until the card is back in TRANSFER state (CMD13)
+  * @note   Covers the programming time after a write; polled, no interrupt
+  *         signals it.
+  */
+static int SD_WaitReady(uint32_t t0)
+{
+  while (BSP_SD_GetCardState() != SD_TRANSFER_OK)
+  {
+    if (HAL_GetTick() - t0 >= SD_IO_TIMEOUT_MS) return 0;
+  }
+  return 1;
+}
+
+/**
+  * @brief  One IDMA transfer of `count` sectors, buffer already DMA-safe
+  */
+static DRESULT SD_DmaXfer(uint8_t write, uint8_t *buf, DWORD sector, UINT count)
+{
+  uint32_t t0  = HAL_GetTick();
+  uint32_t len = count * SD_BLOCK_SIZE;
+  uint8_t  st;
+
+  if (!SD_WaitReady(t0)) return RES_ERROR;
+
+  /* Write: push dirty lines out. Read: drop lines so no eviction lands
+   * on top of the DMA data, and again afterwards for speculative fills */
+  if (write) SCB_CleanDCache_by_Addr((uint32_t *)buf, (int32_t)len);
+  else       SCB_InvalidateDCache_by_Addr((uint32_t *)buf, (int32_t)len);
+
+  sd_xfer = SD_XFER_BUSY;
+  st = write ? BSP_SD_WriteBlocks_DMA((uint32_t *)buf, (uint32_t)sector, count)
+             : BSP_SD_ReadBlocks_DMA((uint32_t *)buf, (uint32_t)sector, count);
+  if (st != MSD_OK)
+  {
+    sd_xfer = SD_XFER_DONE;
+    sd_stats.errors++;
+    return RES_ERROR;
+  }
+
+  while (sd_xfer == SD_XFER_BUSY)
+  {
+    if (HAL_GetTick() - t0 >= SD_IO_TIMEOUT_MS)
+    {
+      HAL_SD_Abort(&hsd1);
+      sd_xfer = SD_XFER_DONE;
+      sd_stats.errors++;
+      LOGE(SDIO_TAG, "%s timeout, sector %lu x%u", write ? "Write" : "Read",
+           (unsigned long)sector, count);
+      return RES_ERROR;
+    }
+    uint32_t c0 = DWT->CYCCNT;
+    SD_WaitHook(&sd_xfer);
+    sd_stats.waitCycles += DWT->CYCCNT - c0;
+  }
+
+  if (sd_xfer == SD_XFER_ERROR)
+  {
+    sd_xfer = SD_XFER_DONE;
+    sd_stats.errors++;
+    return RES_ERROR;
+  }
+
+  if (!write) SCB_InvalidateDCache_by_Addr((uint32_t *)buf, (int32_t)len);
+  return RES_OK;
+}
+
+/**
+  * @brief  Read or write through IDMA, bouncing unreachable buffers
+  * @note   The card is left programming after a write; the next transfer
+  *         or CTRL_SYNC waits for it.
+  */
+static DRESULT SD_DmaRW(uint8_t write, BYTE *buff, DWORD sector, UINT count)
+{
+  if (SD_DmaReachable(buff))
+  {
+    return SD_DmaXfer(write, buff, sector, count);
+  }
+
+  while (count > 0)
+  {
+    UINT n = count < SD_SCRATCH_SECTORS ? count : SD_SCRATCH_SECTORS;
+    if (write) memcpy(sd_scratch, buff, n * SD_BLOCK_SIZE);
+    if (SD_DmaXfer(write, sd_scratch, sector, n) != RES_OK) return RES_ERROR;
+    if (!write) memcpy(buff, sd_scratch, n * SD_BLOCK_SIZE);
+    sd_stats.bounced += n;
+    buff   += n * SD_BLOCK_SIZE;
+    sector += n;
+    count  -= n;
+  }
+  return RES_OK;
+}
 /* USER CODE END beforeFunctionSection */
 
 /* Private functions ---------------------------------------------------------*/
@@ -155,6 +286,14 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 {
   DRESULT res = RES_ERROR;
 
+  sd_stats.reads++;
+  sd_stats.sectorsRead += count;
+
+  if (sd_dma)
+  {
+    return SD_DmaRW(0, buff, sector, count);
+  }
+
   if(BSP_SD_ReadBlocks((uint32_t*)buff,
                        (uint32_t) (sector),
                        count, SD_TIMEOUT) == MSD_OK)
@@ -186,6 +325,14 @@ DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 {
   DRESULT res = RES_ERROR;
 
+  sd_stats.writes++;
+  sd_stats.sectorsWritten += count;
+
+  if (sd_dma)
+  {
+    return SD_DmaRW(1, (BYTE *)buff, sector, count);
+  }
+
   if(BSP_SD_WriteBlocks((uint32_t*)buff,
                         (uint32_t)(sector),
                         count, SD_TIMEOUT) == MSD_OK)
@@ -223,7 +370,7 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
   {
   /* Make sure that no pending write process */
   case CTRL_SYNC :
-    res = RES_OK;
+    res = SD_WaitReady(HAL_GetTick()) ? RES_OK : RES_ERROR;
     break;
 
   /* Get number of sectors on the disk (DWORD) */
@@ -261,4 +408,58 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
 
 /* USER CODE BEGIN lastSection */
 /* can be used to modify / undefine previous code or add new code */
+
+/* ---------- IDMA completion (SDMMC1_IRQHandler context) ------------------ */
+
+void BSP_SD_ReadCpltCallback(void)
+{
+  sd_xfer = SD_XFER_DONE;
+  SD_DoneHook();
+}
+
+void BSP_SD_WriteCpltCallback(void)
+{
+  sd_xfer = SD_XFER_DONE;
+  SD_DoneHook();
+}
+
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd)
+{
+  (void)hsd;
+  sd_xfer = SD_XFER_ERROR;
+  SD_DoneHook();
+}
+
+/* ---------- Wait hooks (overridden by app_rtos.cpp) ---------------------- */
+
+/**
+  * @brief  Sleep until the SDMMC interrupt (or any other) fires
+  * @note   PRIMASK closes the gap between the flag check and WFI: a pending
+  *         interrupt still wakes WFI and is taken right after.
+  */
+__weak void SD_WaitHook(volatile uint8_t *state)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (*state == SD_XFER_BUSY) __WFI();
+  __set_PRIMASK(primask);
+}
+
+__weak void SD_DoneHook(void)
+{
+}
+
+/* ---------- Control / stats ---------------------------------------------- */
+
+void SD_IO_SetDma(uint8_t on)
+{
+  sd_dma = on ? 1 : 0;
+}
+
+void SD_IO_GetStats(SD_IO_Stats_t *s)
+{
+  *s = sd_stats;
+  s->dma = sd_dma;
+}
+
 /* USER CODE END lastSection */
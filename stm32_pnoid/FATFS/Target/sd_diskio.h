@@ -36,6 +36,46 @@ extern const Diskio_drvTypeDef  SD_Driver;
 
 /* USER CODE BEGIN lastSection */
 /* can be used to modify / undefine previous code or add new definitions */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint32_t reads;           /* SD_read calls                              */
+  uint32_t writes;          /* SD_write calls                             */
+  uint32_t sectorsRead;
+  uint32_t sectorsWritten;
+  uint32_t bounced;         /* sectors copied through the scratch buffer  */
+  uint32_t errors;
+  uint64_t waitCycles;      /* CPU cycles spent asleep in SD_WaitHook     */
+  uint8_t  dma;             /* current mode                               */
+} SD_IO_Stats_t;
+
+/**
+  * @brief  Select IDMA (default) or the blocking FIFO path
+  * @note   The blocking path is kept as a benchmark baseline.
+  */
+void SD_IO_SetDma(uint8_t on);
+void SD_IO_GetStats(SD_IO_Stats_t *s);
+
+/**
+  * @brief  Called while an IDMA transfer is in flight
+  * @param  state  Transfer state, stays 0 until the completion interrupt
+  * @note   Weak: default sleeps in WFI. The RTOS build blocks the calling
+  *         task instead so lower-priority work runs.
+  */
+void SD_WaitHook(volatile uint8_t *state);
+
+/**
+  * @brief  Called from the SDMMC1 interrupt when a transfer ends
+  */
+void SD_DoneHook(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 /* USER CODE END lastSection */
 
 #endif /* __SD_DISKIO_H */
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+PLZ encoder / decoder for compressed assets (Drivers/W25Qxx/asset_codec.hpp).
+
+    python3 scripts/asset_codec.py bench assets/sprites/*.rgb565 assets/sounds/*.pcm
+    python3 scripts/asset_codec.py pack eye.rgb565 -o eye.plz --window 12
+
+LZ4 sequences with a window of 2^window bytes (the decoder's ring buffer)
+and an optional 16-bit delta filter for PCM. asset_pack.py --compress
+uses encode() per asset; "bench" prints the ratio per window / filter so
+the trade against decoder RAM can be picked per asset type.
+"""
+import argparse
+import struct
+import sys
+from typing import List
+
+MAGIC = 0x315A4C50          # "PLZ1"
+HEADER = struct.Struct("<IIBBH")
+MIN_MATCH = 4
+
+FILTER_NONE = 0
+FILTER_DELTA16 = 1
+FILTER_DELTA16_STEREO = 2
+FILTER_NAMES = {"none": FILTER_NONE, "delta16": FILTER_DELTA16, "delta16s": FILTER_DELTA16_STEREO}
+
+
+# ============================================================
+# Filter
+# ============================================================
+
+def delta16(data: bytes, stride: int) -> bytes:
+    """Each 16-bit LE sample minus the previous one of its channel (stride bytes back)"""
+    out = bytearray(data)
+    prev = [0] * (stride // 2)
+    for i in range(0, len(data) - 1, 2):
+        ch = (i // 2) % len(prev)
+        v = data[i] | data[i + 1] << 8
+        d = (v - prev[ch]) & 0xFFFF
+        prev[ch] = v
+        out[i] = d & 0xFF
+        out[i + 1] = d >> 8
+    if len(data) & 1:               # odd tail: low byte only, as the decoder sees it
+        i = len(data) - 1
+        out[i] = (data[i] - prev[(i // 2) % len(prev)]) & 0xFF
+    return bytes(out)
+
+
+def undelta16(data: bytes, stride: int) -> bytes:
+    out = bytearray(data)
+    prev = [0] * (stride // 2)
+    for i in range(0, len(data) - 1, 2):
+        ch = (i // 2) % len(prev)
+        v = ((data[i] | data[i + 1] << 8) + prev[ch]) & 0xFFFF
+        prev[ch] = v
+        out[i] = v & 0xFF
+        out[i + 1] = v >> 8
+    if len(data) & 1:
+        i = len(data) - 1
+        out[i] = (data[i] + prev[(i // 2) % len(prev)]) & 0xFF
+    return bytes(out)
+
+
+def _stride(filt: int) -> int:
+    return 2 if filt == FILTER_DELTA16 else 4
+
+
+# ============================================================
+# LZ
+# ============================================================
+
+def _length(out: bytearray, n: int):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def encode(data: bytes, window_log: int = 12, filt: int = FILTER_NONE, depth: int = 16) -> bytes:
+    """Greedy LZ with hash chains (depth candidates per position)"""
+    if filt != FILTER_NONE:
+        data = delta16(data, _stride(filt))
+    window = 1 << window_log
+    n = len(data)
+    out = bytearray(HEADER.pack(MAGIC, len(data), window_log, filt, 0))
+
+    head = {}
+    prev = [0] * n
+    lit_start = 0
+    i = 0
+
+    def insert(p: int):
+        key = data[p:p + MIN_MATCH]
+        prev[p] = head.get(key, -1)
+        head[key] = p
+
+    while i + MIN_MATCH <= n:
+        best_len, best_off = 0, 0
+        cand = head.get(data[i:i + MIN_MATCH], -1)
+        tries = depth
+        while cand >= 0 and i - cand <= min(window, 0xFFFF) and tries > 0:
+            if data[cand + best_len:cand + best_len + 1] == data[i + best_len:i + best_len + 1]:
+                m = MIN_MATCH
+                while i + m < n and data[cand + m] == data[i + m]:
+                    m += 1
+                if m > best_len:
+                    best_len, best_off = m, i - cand
+            cand = prev[cand]
+            tries -= 1
+
+        if best_len < MIN_MATCH:
+            insert(i)
+            i += 1
+            continue
+
+        lit = data[lit_start:i]
+        ml = best_len - MIN_MATCH
+        out.append((min(len(lit), 15) << 4) | min(ml, 15))
+        if len(lit) >= 15:
+            _length(out, len(lit) - 15)
+        out += lit
+        out += struct.pack("<H", best_off)
+        if ml >= 15:
+            _length(out, ml - 15)
+
+        for p in range(i, min(i + best_len, n - MIN_MATCH + 1)):
+            insert(p)
+        i += best_len
+        lit_start = i
+
+    # Last sequence: literals only (possibly none)
+    lit = data[lit_start:]
+    if lit:
+        out.append(min(len(lit), 15) << 4)
+        if len(lit) >= 15:
+            _length(out, len(lit) - 15)
+        out += lit
+    return bytes(out)
+
+
+def decode(blob: bytes) -> bytes:
+    magic, raw, window_log, filt, _ = HEADER.unpack_from(blob, 0)
+    if magic != MAGIC:
+        raise ValueError("not PLZ")
+    out = bytearray()
+    i = HEADER.size
+    while len(out) < raw:
+        tok = blob[i]
+        i += 1
+        lit = tok >> 4
+        if lit == 15:
+            while True:
+                b = blob[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += blob[i:i + lit]
+        i += lit
+        if len(out) >= raw:
+            break
+        off = blob[i] | blob[i + 1] << 8
+        i += 2
+        ml = (tok & 15) + MIN_MATCH
+        if ml == 19:
+            while True:
+                b = blob[i]
+                i += 1
+                ml += b
+                if b != 255:
+                    break
+        if off == 0 or off > len(out) or off > 1 << window_log:
+            raise ValueError("bad offset")
+        for _ in range(ml):
+            out.append(out[-off])
+    out = bytes(out)
+    if filt != FILTER_NONE:
+        out = undelta16(out, _stride(filt))
+    return out
+
+
+# ============================================================
+# Main
+# ============================================================
+
+def bench(paths: List[str], windows: List[int], depth: int):
+    filters = [("raw", FILTER_NONE), ("d16", FILTER_DELTA16), ("d16s", FILTER_DELTA16_STEREO)]
+    print("compressed size, % of raw, per filter / window log2")
+    print(f"{'asset':32s} {'bytes':>8s} " + " ".join(f"{f + '/' + str(w):>8s}" for f, _ in filters for w in windows))
+    for path in paths:
+        with open(path, "rb") as f:
+            data = f.read()
+        cells = []
+        for _name, filt in filters:
+            for w in windows:
+                blob = encode(data, w, filt, depth)
+                if decode(blob) != data:
+                    raise RuntimeError(f"{path}: round trip failed")
+                cells.append(f"{100.0 * len(blob) / max(len(data), 1):7.1f}%")
+        print(f"{path[-32:]:32s} {len(data):8d} " + " ".join(cells))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="PLZ asset codec")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    b = sub.add_parser("bench", help="Compressed size per window / filter")
+    b.add_argument("files", nargs="+")
+    b.add_argument("--windows", default="10,12,14,16", help="Window log2 list")
+    b.add_argument("--depth", type=int, default=16, help="Hash chain candidates")
+
+    p = sub.add_parser("pack", help="Compress one file")
+    p.add_argument("file")
+    p.add_argument("-o", "--output", required=True)
+    p.add_argument("--window", type=int, default=12)
+    p.add_argument("--filter", choices=FILTER_NAMES, default="none")
+    p.add_argument("--depth", type=int, default=16)
+
+    args = parser.parse_args()
+
+    if args.cmd == "bench":
+        bench(args.files, [int(w) for w in args.windows.split(",")], args.depth)
+        return 0
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+    blob = encode(data, args.window, FILTER_NAMES[args.filter], args.depth)
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print(f"{args.output}: {len(data)} -> {len(blob)} B ({100.0 * len(blob) / max(len(data), 1):.1f}%)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+Build / inspect the QSPI asset pack (Drivers/W25Qxx/asset_pack.hpp).
+
+    python3 scripts/asset_pack.py build assets/ -o assets.pak --reserve 25
+    python3 scripts/asset_pack.py build assets/ -o assets.pak --compress
+    python3 scripts/asset_pack.py list assets.pak
+
+Every file under the input directories becomes one asset named by its
+path relative to that directory ("sprites/eye.rgb565"). Type follows the
+extension. Copy the .pak to the SD card and run "asset install assets.pak"
+on the console.
+
+Layout (little-endian): 32-byte header, a power-of-two slot table of
+32-byte entries (FNV-1a hash, linear probing, at most half full), the
+names, then the blobs, each 32-byte aligned. The directory is padded to
+a 4 KB sector so the blobs can be rewritten without touching it;
+--reserve leaves spare capacity per blob for in-place replacement.
+
+--compress stores sprites and sounds as PLZ (asset_codec.py; sounds with
+the 16-bit delta filter) when that saves at least 10 %, and sets flag
+bit 0; size and CRC are then of the stored stream.
+"""
+import argparse
+import os
+import struct
+import sys
+import zlib
+from typing import List, Tuple
+
+import asset_codec
+
+MAGIC = 0x50414E50          # "PNAP"
+VERSION = 1
+SECTOR = 4096
+ALIGN = 32
+HEADER = struct.Struct("<IHHIIII8x")
+ENTRY = struct.Struct("<IIIIIIHH4x")
+
+TYPES = {
+    ".rgb565": 1, ".spr": 1,
+    ".pcm": 2, ".wav": 2,
+    ".fnt": 3,
+    ".clip": 4,
+}
+TYPE_NAMES = ["raw", "sprite", "sound", "font", "clip"]
+
+FLAG_PLZ = 0x0001
+COMPRESS_FILTER = {1: asset_codec.FILTER_NONE, 2: asset_codec.FILTER_DELTA16}
+MIN_SAVING = 0.10
+
+
+def fnv1a(name: str) -> int:
+    h = 2166136261
+    for b in name.encode():
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h or 1
+
+
+def align(n: int, a: int) -> int:
+    return (n + a - 1) // a * a
+
+
+# ============================================================
+# Build
+# ============================================================
+
+def collect(inputs: List[str]) -> List[Tuple[str, str]]:
+    files = []
+    for root in inputs:
+        if os.path.isfile(root):
+            files.append((os.path.basename(root), root))
+            continue
+        for dirpath, _dirs, names in os.walk(root):
+            for n in names:
+                path = os.path.join(dirpath, n)
+                files.append((os.path.relpath(path, root).replace(os.sep, "/"), path))
+    files.sort()
+    return files
+
+
+def compress(data: bytes, typ: int, window_log: int) -> Tuple[bytes, int]:
+    """PLZ stream and FLAG_PLZ, or the data unchanged when it does not pay"""
+    if typ not in COMPRESS_FILTER or not data:
+        return data, 0
+    blob = asset_codec.encode(data, window_log, COMPRESS_FILTER[typ])
+    if len(blob) > len(data) * (1.0 - MIN_SAVING):
+        return data, 0
+    return blob, FLAG_PLZ
+
+
+def build(files: List[Tuple[str, str]], reserve_pct: int, max_size: int,
+          window_log: int = 0) -> bytes:
+    names = [n for n, _ in files]
+    if len(set(names)) != len(names):
+        raise ValueError("duplicate asset names")
+
+    slots = 1
+    while slots < 2 * max(len(files), 1):
+        slots *= 2
+    if slots > 0xFFFF:
+        raise ValueError("too many assets")
+
+    # Names right after the slot table
+    name_blob = b""
+    name_off = {}
+    base = HEADER.size + slots * ENTRY.size
+    for n in names:
+        name_off[n] = base + len(name_blob)
+        name_blob += n.encode() + b"\0"
+    dir_size = align(base + len(name_blob), SECTOR)
+
+    # Blobs
+    blobs = bytearray()
+    table = [None] * slots
+    for name, path in files:
+        with open(path, "rb") as f:
+            data = f.read()
+        ext = os.path.splitext(name)[1].lower()
+        typ = TYPES.get(ext, 0)
+        flags = 0
+        if window_log:
+            data, flags = compress(data, typ, window_log)
+        cap = align(len(data) + len(data) * reserve_pct // 100, ALIGN)
+        offset = dir_size + len(blobs)
+        blobs += data + b"\xFF" * (cap - len(data))
+
+        h = fnv1a(name)
+        i = h & (slots - 1)
+        while table[i] is not None:
+            i = (i + 1) & (slots - 1)
+        table[i] = (h, offset, len(data), cap, zlib.crc32(data), name_off[name], typ, flags)
+
+    total = dir_size + len(blobs)
+    if total > max_size:
+        raise ValueError(f"pack is {total} B, region holds {max_size} B")
+
+    body = bytearray()
+    for e in table:
+        body += ENTRY.pack(*e) if e else b"\0" * ENTRY.size
+    body += name_blob
+    body += b"\0" * (dir_size - HEADER.size - len(body))
+
+    hdr = HEADER.pack(MAGIC, VERSION, slots, len(files), dir_size, total, 0)
+    crc = zlib.crc32(body, zlib.crc32(hdr))
+    hdr = HEADER.pack(MAGIC, VERSION, slots, len(files), dir_size, total, crc)
+    return bytes(hdr + body + blobs)
+
+
+# ============================================================
+# List
+# ============================================================
+
+def list_pack(data: bytes) -> int:
+    magic, version, slots, count, dir_size, total, crc = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        print("[ERR] not an asset pack", file=sys.stderr)
+        return 1
+    hdr = HEADER.pack(magic, version, slots, count, dir_size, total, 0)
+    ok = zlib.crc32(data[HEADER.size:dir_size], zlib.crc32(hdr)) == crc
+    print(f"{count} assets, {slots} slots, dir {dir_size} B, total {total} B, "
+          f"dir crc {'ok' if ok else 'BAD'}")
+
+    for slot in range(slots):
+        h, off, size, cap, bcrc, noff, typ, flags = ENTRY.unpack_from(data, HEADER.size + slot * ENTRY.size)
+        if h == 0:
+            continue
+        name = data[noff:data.index(b"\0", noff)].decode()
+        good = zlib.crc32(data[off:off + size]) == bcrc
+        home = h & (slots - 1)
+        probe = (slot - home) & (slots - 1)
+        tname = TYPE_NAMES[typ] if typ < len(TYPE_NAMES) else str(typ)
+        plz = ""
+        if flags & FLAG_PLZ:
+            raw = struct.unpack_from("<I", data, off + 4)[0]
+            plz = f"plz {100.0 * size / max(raw, 1):.0f}% "
+        print(f"  {slot:5d} +{probe} 0x{off:06X} {size:8d}/{cap:<8d} {tname:6s} "
+              f"{plz}{'' if good else 'CRC BAD '}{name}")
+    return 0 if ok else 1
+
+
+# ============================================================
+# Main
+# ============================================================
+
+def main():
+    parser = argparse.ArgumentParser(description="QSPI asset pack builder")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    b = sub.add_parser("build", help="Pack files / directories")
+    b.add_argument("inputs", nargs="+", help="Files or directories")
+    b.add_argument("-o", "--output", required=True, help="Output .pak")
+    b.add_argument("--reserve", type=int, default=0,
+                   help="Spare capacity per asset, percent of its size")
+    b.add_argument("--max-size", type=int, default=6 * 1024 * 1024,
+                   help="Pack region size in flash (app.cpp ASSET_PACK_SIZE)")
+    b.add_argument("--compress", action="store_true",
+                   help="PLZ-compress sprites and sounds where it saves >= 10%%")
+    b.add_argument("--window", type=int, default=12,
+                   help="PLZ window log2 (decoder ring, app.cpp ASSET_RING_SIZE)")
+
+    l = sub.add_parser("list", help="Show the directory of a .pak")
+    l.add_argument("pack")
+
+    args = parser.parse_args()
+
+    if args.cmd == "list":
+        with open(args.pack, "rb") as f:
+            return list_pack(f.read())
+
+    try:
+        data = build(collect(args.inputs), args.reserve, args.max_size,
+                     args.window if args.compress else 0)
+    except (OSError, ValueError) as e:
+        print(f"[ERR] {e}", file=sys.stderr)
+        return 1
+    with open(args.output, "wb") as f:
+        f.write(data)
+    print(f"{args.output}: {len(data)} B")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
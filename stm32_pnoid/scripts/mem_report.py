@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+Report what the linker placed in the tightly coupled memories.
+
+    python3 scripts/mem_report.py Debug/stm32_pnoid.elf
+
+Lists every symbol in ITCM (PNOID_FAST_CODE), DTCM (PNOID_FAST_DATA,
+.data/.bss, stack) and the non-cacheable D2 DMA region (PNOID_DMA_BUFFER),
+largest first, with per-region totals.
+"""
+import argparse
+import subprocess
+import sys
+from typing import Dict, List, Tuple
+
+# ============================================================
+# Memory map (STM32H743, see STM32H743VITX_FLASH.ld)
+# ============================================================
+
+REGIONS = [
+    # name,  start,       size
+    ("ITCM", 0x00000000, 64 * 1024),
+    ("DTCM", 0x20000000, 128 * 1024),
+    ("DMA",  0x30000000, 128 * 1024),
+]
+
+
+def region_of(addr: int) -> str:
+    for name, start, size in REGIONS:
+        if start <= addr < start + size:
+            return name
+    return ""
+
+
+# ============================================================
+# nm
+# ============================================================
+
+def read_symbols(elf: str, nm: str) -> List[Tuple[int, int, str]]:
+    out = subprocess.run(
+        [nm, "-S", "-C", "--size-sort", elf],
+        check=True, capture_output=True, text=True,
+    ).stdout
+
+    syms = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue
+        addr, size, _type, name = parts
+        syms.append((int(addr, 16), int(size, 16), name))
+    return syms
+
+
+# ============================================================
+# Main
+# ============================================================
+
+def main():
+    parser = argparse.ArgumentParser(description="ITCM / DTCM / DMA placement report")
+    parser.add_argument("elf", help="Linked firmware ELF")
+    parser.add_argument("--nm", default="arm-none-eabi-nm", help="nm executable")
+    parser.add_argument("--top", type=int, default=0,
+                        help="Show only the N largest symbols per region (0 = all)")
+    args = parser.parse_args()
+
+    try:
+        syms = read_symbols(args.elf, args.nm)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print(f"[ERR] {args.nm}: {e}", file=sys.stderr)
+        return 1
+
+    per_region: Dict[str, List[Tuple[int, int, str]]] = {n: [] for n, _, _ in REGIONS}
+    for addr, size, name in syms:
+        if "_tr_fmt" in name:       # trace format strings: INFO section at 0, not ITCM
+            continue
+        r = region_of(addr)
+        if r:
+            per_region[r].append((addr, size, name))
+
+    for name, start, size in REGIONS:
+        items = sorted(per_region[name], key=lambda s: s[1], reverse=True)
+        used = sum(s[1] for s in items)
+        print(f"== {name} 0x{start:08X}  {used} / {size} B ({100.0 * used / size:.1f}%)")
+        shown = items[:args.top] if args.top > 0 else items
+        for addr, sz, sym in shown:
+            print(f"  0x{addr:08X} {sz:7d}  {sym}")
+        if len(shown) < len(items):
+            print(f"  ... {len(items) - len(shown)} more")
+        print()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""
+Decode the deferred binary trace (Drivers/Log/trace.h) back into text.
+
+    python3 scripts/trace_decode.py Debug/stm32_pnoid.elf console.txt
+    python3 scripts/trace_decode.py Debug/stm32_pnoid.elf trace.bin --binary
+    picocom ... | python3 scripts/trace_decode.py Debug/stm32_pnoid.elf -
+
+Console input: "#T <hex>" lines are decoded, every other line is passed
+through unchanged, so the normal LOG output stays interleaved.
+Format strings come from the ELF .trace_fmt section (never loaded on the
+target); %s arguments are looked up in the ELF's loadable sections.
+
+Record (little-endian 32-bit words):
+    id << 16 | 0xA5 << 8 | nargs,  timestamp µs (low 32 bits),  args...
+"""
+import argparse
+import re
+import struct
+import sys
+from typing import Dict, List, Optional, Tuple
+
+MAGIC_REC = 0xA5
+ID_DROPS = 0xFFFF
+
+# ============================================================
+# ELF (32-bit little-endian, no dependencies)
+# ============================================================
+
+class Elf:
+    def __init__(self, path: str):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        d = self.data
+        if d[:4] != b"\x7fELF" or d[4] != 1 or d[5] != 1:
+            raise ValueError(f"{path}: not a 32-bit little-endian ELF")
+
+        shoff, = struct.unpack_from("<I", d, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", d, 0x2E)
+
+        raw = []
+        for i in range(shnum):
+            name, stype, flags, addr, off, size = struct.unpack_from(
+                "<IIIIII", d, shoff + i * shentsize)
+            raw.append((name, stype, flags, addr, off, size))
+
+        strtab_off = raw[shstrndx][4]
+        self.sections: List[Tuple[str, int, int, int, int]] = []
+        for name, stype, flags, addr, off, size in raw:
+            end = d.index(b"\0", strtab_off + name)
+            sname = d[strtab_off + name:end].decode()
+            self.sections.append((sname, stype, flags, addr, off if stype != 8 else -1, size))
+
+    def section(self, name: str) -> Optional[bytes]:
+        for sname, _t, _f, _a, off, size in self.sections:
+            if sname == name and off >= 0:
+                return self.data[off:off + size]
+        return None
+
+    def c_string(self, addr: int) -> Optional[str]:
+        """NUL-terminated string at a target address (SHF_ALLOC sections)"""
+        for _n, _t, flags, base, off, size in self.sections:
+            if flags & 0x2 and off >= 0 and base <= addr < base + size:
+                start = off + addr - base
+                end = self.data.find(b"\0", start, off + size)
+                if end >= 0:
+                    return self.data[start:end].decode(errors="replace")
+        return None
+
+
+# ============================================================
+# printf → Python
+# ============================================================
+
+SPEC = re.compile(r"%([-+ #0]*)(\d+)?(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diuxXocfFeEgGsp%])")
+
+
+def s32(v: int) -> int:
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def render(fmt: str, args: List[int], elf: Elf) -> str:
+    out = []
+    pos = 0
+    it = iter(args)
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, _len, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        spec = "%" + flags + (width or "") + ("." + prec if prec else "")
+        v = next(it, 0)
+        if conv in "di":
+            out.append((spec + "d") % s32(v))
+        elif conv == "u":
+            out.append((spec + "d") % v)
+        elif conv in "xXoc":
+            out.append((spec + conv) % (chr(v & 0xFF) if conv == "c" else v))
+        elif conv in "fFeEgG":
+            out.append((spec + conv) % struct.unpack("<f", struct.pack("<I", v))[0])
+        elif conv == "s":
+            s = elf.c_string(v)
+            out.append((spec + "s") % (s if s is not None else f"<0x{v:08X}>"))
+        else:  # p
+            out.append(f"0x{v:08X}")
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+# ============================================================
+# Records
+# ============================================================
+
+class Decoder:
+    def __init__(self, elf: Elf):
+        self.elf = elf
+        self.fmt = elf.section(".trace_fmt")
+        if self.fmt is None:
+            raise ValueError("no .trace_fmt section (TRACE_ENABLE off or old linker script?)")
+        self.cache: Dict[int, str] = {}
+        self.last_ts = None
+        self.epoch = 0
+        self.pending = b""
+
+    def format_of(self, fid: int) -> str:
+        if fid not in self.cache:
+            end = self.fmt.find(b"\0", fid)
+            if fid >= len(self.fmt) or end < 0:
+                self.cache[fid] = f"<unknown trace id 0x{fid:04X}>"
+            else:
+                self.cache[fid] = self.fmt[fid:end].decode(errors="replace")
+        return self.cache[fid]
+
+    def timestamp(self, ts: int) -> int:
+        """Unwrap the 32-bit µs stamp (wraps every 71 min)"""
+        if self.last_ts is not None and ts < self.last_ts and self.last_ts - ts > 0x80000000:
+            self.epoch += 1 << 32
+        self.last_ts = ts
+        return self.epoch + ts
+
+    def feed(self, data: bytes) -> List[str]:
+        buf = self.pending + data
+        lines = []
+        pos = 0
+        while len(buf) - pos >= 8:
+            hdr, ts = struct.unpack_from("<II", buf, pos)
+            if (hdr >> 8) & 0xFF != MAGIC_REC:
+                pos += 4                        # resync on the next word
+                continue
+            n = hdr & 0xFF
+            if len(buf) - pos < 8 + 4 * n:
+                break
+            args = list(struct.unpack_from(f"<{n}I", buf, pos + 8))
+            pos += 8 + 4 * n
+
+            us = self.timestamp(ts)
+            fid = hdr >> 16
+            if fid == ID_DROPS:
+                text = f"<{args[0] if args else '?'} trace records dropped>"
+            else:
+                text = render(self.format_of(fid), args, self.elf)
+            lines.append(f"T ({us // 1000}.{us % 1000:03d}) {text}")
+        self.pending = buf[pos:]
+        return lines
+
+
+# ============================================================
+# Main
+# ============================================================
+
+def main():
+    parser = argparse.ArgumentParser(description="Deferred trace decoder")
+    parser.add_argument("elf", help="Firmware ELF the trace was recorded with")
+    parser.add_argument("input", help="Console capture, raw trace file, or - for stdin")
+    parser.add_argument("--binary", action="store_true",
+                        help="Input is raw records, not '#T <hex>' console lines")
+    args = parser.parse_args()
+
+    try:
+        dec = Decoder(Elf(args.elf))
+    except (OSError, ValueError) as e:
+        print(f"[ERR] {e}", file=sys.stderr)
+        return 1
+
+    if args.binary:
+        src = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+        with src:
+            for line in dec.feed(src.read()):
+                print(line)
+        return 0
+
+    src = sys.stdin if args.input == "-" else open(args.input, "r", errors="replace")
+    with src:
+        for raw in src:
+            text = raw.rstrip("\r\n")
+            idx = text.find("#T ")
+            if idx < 0:
+                print(text)
+                continue
+            try:
+                data = bytes.fromhex(text[idx + 3:].strip())
+            except ValueError:
+                print(f"[bad trace line] {text}")
+                continue
+            dec.pending = b""                   # console lines hold whole records
+            for line in dec.feed(data):
+                print(line)
+            sys.stdout.flush()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
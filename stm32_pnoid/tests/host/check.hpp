@@ -0,0 +1,37 @@
+/**
+ * @file    check.hpp
+ * @brief   Minimal assertion helpers for the host tests
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+inline int g_checkFailures = 0;
+
+/** Record a failure and keep going, so one run reports every broken case */
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            g_checkFailures++;                                              \
+        }                                                                   \
+    } while (0)
+
+/** Fatal: later steps depend on it */
+#define REQUIRE(cond)                                                       \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::printf("%s:%d: REQUIRE failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+/** main() return value */
+inline int checkResult(const char *name)
+{
+    if (g_checkFailures) std::printf("%s: %d check(s) failed\n", name, g_checkFailures);
+    else                 std::printf("%s: OK\n", name);
+    return g_checkFailures ? 1 : 0;
+}
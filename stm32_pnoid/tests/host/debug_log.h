@@ -0,0 +1,13 @@
+/**
+ * @file    debug_log.h
+ * @brief   Host stand-in for Drivers/Log/debug_log.h: lines go to stdout
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#define LOGE(tag, fmt, ...)  printf("E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define LOGW(tag, fmt, ...)  printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define LOGI(tag, fmt, ...)  printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define LOGD(tag, fmt, ...)  do {} while (0)
@@ -0,0 +1,9 @@
+/**
+ * @file    fatfs.h
+ * @brief   Host stand-in for FATFS/App/fatfs.h: FatFs on ram_disk.cpp
+ */
+
+#pragma once
+
+#include "ff.h"
+#include "diskio.h"
@@ -0,0 +1,47 @@
+/**
+ * @file    hal_host.c
+ * @brief   Storage for the host HAL stand-in (stm32h7xx_hal.h)
+ */
+
+#include "stm32h7xx_hal.h"
+#include "timebase.h"
+
+DWT_Type     host_dwt;
+SysTick_Type host_systick;
+uint32_t     SystemCoreClock = 480000000u;
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(TIME_Micros() / 1000u);
+}
+
+void HAL_Delay(uint32_t ms)
+{
+    uint32_t t0 = HAL_GetTick();
+    while (HAL_GetTick() - t0 < ms) {}
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq)  { (void)irq; }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub)
+{
+    (void)irq; (void)preempt; (void)sub;
+}
+
+void HAL_MPU_ConfigRegion(const MPU_Region_InitTypeDef *r) { (void)r; }
+
+MDMA_Channel_TypeDef host_mdma_channel0;
+
+HAL_StatusTypeDef HAL_MDMA_Init(MDMA_HandleTypeDef *h)
+{
+    return h->Instance != NULL ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_MDMA_RegisterCallback(MDMA_HandleTypeDef *h, HAL_MDMA_CallbackIDTypeDef id,
+                                            void (*cb)(MDMA_HandleTypeDef *h))
+{
+    if (id == HAL_MDMA_XFER_CPLT_CB_ID)       h->XferCpltCallback  = cb;
+    else if (id == HAL_MDMA_XFER_ERROR_CB_ID) h->XferErrorCallback = cb;
+    else                                      return HAL_ERROR;
+    return HAL_OK;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file    main.h
+ * @brief   Host stand-in for Core/Inc/main.h
+ */
+
+#pragma once
+
+#include "stm32h7xx_hal.h"
+
+#define PNOID_RTOS_ENABLE  0
+#define PNOID_TCM_ENABLE   0
+#define PNOID_FAST_CODE
+#define PNOID_FAST_DATA
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Error_Handler(void);
+
+#ifdef __cplusplus
+}
+#endif
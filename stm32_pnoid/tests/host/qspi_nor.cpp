@@ -0,0 +1,277 @@
+/**
+ * @file    qspi_nor.cpp
+ * @brief   W25Q64 model behind the HAL QSPI calls — see qspi_nor.h
+ */
+
+#include "qspi_nor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sys/mman.h>
+
+QUADSPI_TypeDef host_quadspi;
+
+namespace {
+
+constexpr uintptr_t MMAP_BASE = 0x90000000u;
+
+enum class Event : uint8_t { None, Cmd, Tx, Match };
+enum class Ctrl : uint8_t { Idle, It, Mapped };
+
+uint8_t            *g_mem;
+uint64_t            g_nowUs;
+std::mt19937        g_rng(3);
+QspiNor::Stats      g_stats;
+int64_t             g_cutAt = -1;       // erase / program events left
+
+/* Chip */
+bool                g_wel;
+bool                g_suspended;
+bool                g_eraseRunning;
+uint64_t            g_busyUntil;
+uint64_t            g_suspendRemain;
+uint8_t             g_status;           // byte returned by the next Receive
+
+/* Controller */
+Ctrl                g_ctrl = Ctrl::Idle;
+Event               g_pend = Event::None;
+uint64_t            g_pendAt;
+QSPI_CommandTypeDef g_last;
+
+void advance(uint64_t us)
+{
+    g_nowUs += us;
+    host_dwt.CYCCNT = (uint32_t)(g_nowUs * (SystemCoreClock / 1000000u));
+}
+
+bool busy()    { return g_nowUs < g_busyUntil; }
+bool cutNow()  { return g_cutAt >= 0 && g_cutAt-- == 0; }
+
+void fail(const char *what)
+{
+    std::printf("QspiNor: %s (instruction 0x%02X, address 0x%06X)\n",
+                what, (unsigned)g_last.Instruction, (unsigned)g_last.Address);
+    std::exit(1);
+}
+
+/** Instruction without data phase, or the command part of a status read */
+void execute(const QSPI_CommandTypeDef &c)
+{
+    const uint32_t ins = c.Instruction;
+    if (ins == 0x06) {                                  // write enable
+        if (!busy()) g_wel = true;
+    } else if (ins == 0x20 || ins == 0xD8 || ins == 0xC7) {
+        if (!g_wel) fail("erase without WEL");
+        if (busy()) fail("erase while busy");
+        const uint32_t size = ins == 0x20 ? 4096u : ins == 0xD8 ? 65536u : QspiNor::SIZE;
+        const uint32_t a0   = c.Address & ~(size - 1);
+        if (cutNow()) {
+            for (uint32_t i = 0; i < size; i++) {
+                if (g_rng() % 2) g_mem[a0 + i] = 0xFF;
+            }
+            throw QspiNor::PowerCut{};
+        }
+        memset(&g_mem[a0], 0xFF, size);
+        for (uint32_t s = a0 / QspiNor::SECTOR; s < (a0 + size) / QspiNor::SECTOR; s++)
+            g_stats.erases[s]++;
+        g_busyUntil    = g_nowUs + (ins == 0x20 ? 45000u : ins == 0xD8 ? 150000u : 20000000u)
+                       + g_rng() % 20000u;
+        g_wel          = false;
+        g_eraseRunning = true;
+    } else if (ins == 0x75) {                           // erase suspend
+        if (busy() && g_eraseRunning && !g_suspended) {
+            g_suspendRemain = g_busyUntil - g_nowUs;
+            g_busyUntil     = g_nowUs + 20;             // tSUS
+            g_suspended     = true;
+            g_stats.suspends++;
+        }
+    } else if (ins == 0x7A) {                           // resume
+        if (g_suspended) {
+            g_busyUntil = g_nowUs + g_suspendRemain;
+            g_suspended = false;
+        }
+    } else if (ins == 0x05) {
+        g_status = (busy() ? 0x01 : 0) | (g_wel ? 0x02 : 0);
+    } else if (ins == 0x35) {
+        g_status = (g_suspended ? 0x80 : 0) | 0x02;     // SUS, QE
+    }
+}
+
+} // namespace
+
+/* ---------- Test API ------------------------------------------------------ */
+
+uint8_t *QspiNor::create(uint8_t fill)
+{
+    if (g_mem == nullptr) {
+        void *p = mmap(reinterpret_cast<void *>(MMAP_BASE), SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p != reinterpret_cast<void *>(MMAP_BASE)) {
+            std::printf("QspiNor: cannot map 0x%08X\n", (unsigned)MMAP_BASE);
+            std::exit(1);
+        }
+        g_mem = static_cast<uint8_t *>(p);
+    }
+    memset(g_mem, fill, SIZE);
+    g_stats = {};
+    g_cutAt = -1;
+    QSPI_HandleTypeDef h{};
+    powerCycle(h);
+    return g_mem;
+}
+
+void QspiNor::powerCycle(QSPI_HandleTypeDef &h)
+{
+    g_wel = g_suspended = g_eraseRunning = false;
+    g_busyUntil = 0;
+    g_ctrl      = Ctrl::Idle;
+    g_pend      = Event::None;
+    h.State     = HAL_QSPI_STATE_READY;
+    h.ErrorCode = 0;
+}
+
+void QspiNor::cutAfter(int64_t events)
+{
+    g_cutAt = events;
+}
+
+void QspiNor::run(uint64_t us)
+{
+    const uint64_t until = g_nowUs + us;
+    while (g_pend != Event::None && g_pendAt <= until) {
+        if (g_pendAt > g_nowUs) advance(g_pendAt - g_nowUs);
+        const Event e = g_pend;
+        g_pend = Event::None;
+        g_ctrl = Ctrl::Idle;
+        g_stats.irqs++;
+        QSPI_HandleTypeDef h{};
+        if (e == Event::Cmd)     HAL_QSPI_CmdCpltCallback(&h);
+        else if (e == Event::Tx) HAL_QSPI_TxCpltCallback(&h);
+        else                     HAL_QSPI_StatusMatchCallback(&h);
+    }
+    if (until > g_nowUs) advance(until - g_nowUs);
+}
+
+uint64_t QspiNor::now()
+{
+    return g_nowUs;
+}
+
+QspiNor::Stats &QspiNor::stats()
+{
+    return g_stats;
+}
+
+bool QspiNor::mapped()
+{
+    return g_ctrl == Ctrl::Mapped;
+}
+
+/* ---------- HAL QSPI ------------------------------------------------------ */
+
+extern "C" {
+
+HAL_StatusTypeDef HAL_QSPI_Command(QSPI_HandleTypeDef *, QSPI_CommandTypeDef *cmd, uint32_t)
+{
+    if (g_ctrl != Ctrl::Idle) return HAL_BUSY;
+    g_last = *cmd;
+    advance(1);
+    execute(*cmd);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Receive(QSPI_HandleTypeDef *, uint8_t *data, uint32_t)
+{
+    if (g_last.Instruction == 0x6B || g_last.Instruction == 0xEB || g_last.Instruction == 0x03) {
+        if (busy() && !g_suspended) fail("read while busy");
+        memcpy(data, &g_mem[g_last.Address], g_last.NbData);
+        advance(1 + g_last.NbData / 40);                // ~40 B/us quad
+    } else {
+        *data = g_status;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Transmit(QSPI_HandleTypeDef *, uint8_t *, uint32_t)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_AutoPolling(QSPI_HandleTypeDef *, QSPI_CommandTypeDef *,
+                                       QSPI_AutoPollingTypeDef *cfg, uint32_t)
+{
+    if (g_ctrl != Ctrl::Idle) return HAL_BUSY;
+    if (cfg->Mask == 0x01 && busy()) advance(g_busyUntil - g_nowUs);   // WIP clear
+    advance(1);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_MemoryMapped(QSPI_HandleTypeDef *h, QSPI_CommandTypeDef *cmd,
+                                        QSPI_MemoryMappedTypeDef *)
+{
+    if (g_ctrl != Ctrl::Idle) return HAL_BUSY;
+    if (busy() && !g_suspended) g_stats.unsafeMaps++;
+    g_last   = *cmd;
+    g_ctrl   = Ctrl::Mapped;
+    h->State = HAL_QSPI_STATE_BUSY_MEM_MAPPED;
+    advance(2);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Command_IT(QSPI_HandleTypeDef *, QSPI_CommandTypeDef *cmd)
+{
+    if (g_ctrl != Ctrl::Idle) return HAL_BUSY;
+    g_last = *cmd;
+    if (cmd->DataMode != QSPI_DATA_NONE) return HAL_OK;     // data phase: Transmit_IT
+    g_ctrl = Ctrl::It;
+    execute(*cmd);
+    g_pend   = Event::Cmd;
+    g_pendAt = g_nowUs + 2;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Transmit_IT(QSPI_HandleTypeDef *, uint8_t *data)
+{
+    if (g_ctrl != Ctrl::Idle) return HAL_BUSY;
+    if (g_last.Instruction != 0x32 || !g_wel) fail("program without WEL");
+    if (busy()) fail("program while busy");
+    if ((g_last.Address & 255u) + g_last.NbData > 256u) fail("program crosses a page");
+
+    uint8_t *dst = &g_mem[g_last.Address];
+    if (cutNow()) {
+        const uint32_t n = g_rng() % (g_last.NbData + 1);
+        for (uint32_t i = 0; i < n; i++) dst[i] &= data[i];
+        if (n < g_last.NbData) dst[n] &= data[n] | (uint8_t)g_rng();
+        throw QspiNor::PowerCut{};
+    }
+    for (uint32_t i = 0; i < g_last.NbData; i++) dst[i] &= data[i];
+    g_ctrl         = Ctrl::It;
+    g_wel          = false;
+    g_eraseRunning = false;
+    g_pend         = Event::Tx;
+    g_pendAt       = g_nowUs + 2 + g_last.NbData / 12;
+    g_busyUntil    = g_pendAt + 400 + g_rng() % 400;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_AutoPolling_IT(QSPI_HandleTypeDef *, QSPI_CommandTypeDef *,
+                                          QSPI_AutoPollingTypeDef *cfg)
+{
+    if (g_ctrl != Ctrl::Idle) return HAL_BUSY;
+    g_ctrl   = Ctrl::It;
+    g_pend   = Event::Match;
+    g_pendAt = (cfg->Mask == 0x01 && busy()) ? g_busyUntil : g_nowUs + 2;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Abort(QSPI_HandleTypeDef *h)
+{
+    g_ctrl   = Ctrl::Idle;
+    g_pend   = Event::None;
+    h->State = HAL_QSPI_STATE_READY;
+    advance(1);
+    return HAL_OK;
+}
+
+} // extern "C"
@@ -0,0 +1,56 @@
+/**
+ * @file    qspi_nor.h
+ * @brief   W25Q64 model behind the HAL QSPI calls, with a power-cut switch
+ * @note    The array is mapped at W25Qxx::MMAP_BASE (0x90000000), so the
+ *          driver reads the "memory-mapped" window directly. Interrupt-mode
+ *          calls complete in run(); time is the model's clock, which the
+ *          test's TIME_Micros() returns. Linux only (MAP_FIXED_NOREPLACE).
+ *
+ * Modelled: WEL, busy time of erase / program (with jitter), erase
+ * suspend / resume, SR1 / SR2, controller busy while an IT call or the
+ * mapping is active, NOR programming (bits only go 1 → 0).
+ */
+
+#pragma once
+
+#include "stm32h7xx_hal.h"
+#include <cstdint>
+
+namespace QspiNor {
+
+constexpr uint32_t SIZE   = 8u << 20;
+constexpr uint32_t SECTOR = 4096;
+
+/** Thrown from the HAL call that hits the cut (see cutAfter()) */
+struct PowerCut {};
+
+struct Stats {
+    uint32_t irqs;
+    uint32_t suspends;
+    uint32_t unsafeMaps;            // mapping entered while a write was running
+    uint32_t erases[SIZE / SECTOR]; // per 4 KB sector
+};
+
+/** Every byte `fill`, chip idle, stats and cut cleared; returns the array */
+uint8_t *create(uint8_t fill);
+
+/** Reboot: chip and controller state lost, contents kept */
+void     powerCycle(QSPI_HandleTypeDef &h);
+
+/**
+ * @brief  Power cut at the `events`-th erase / page program from now (-1 = never)
+ * @note   The erase leaves random bytes erased, the program a random prefix
+ *         and one half-programmed byte; then PowerCut is thrown
+ */
+void     cutAfter(int64_t events);
+
+/** Advance the clock by `us`, delivering the completions due on the way */
+void     run(uint64_t us);
+
+uint64_t now();
+Stats   &stats();
+
+/** The controller is in memory-mapped mode (the window reads the array) */
+bool     mapped();
+
+} // namespace QspiNor
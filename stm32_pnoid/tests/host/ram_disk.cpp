@@ -0,0 +1,73 @@
+/**
+ * @file    ram_disk.cpp
+ * @brief   FatFs block device in host RAM — see ram_disk.h
+ */
+
+#include "ram_disk.h"
+#include "fatfs.h"
+#include <cstring>
+#include <vector>
+
+static std::vector<uint8_t> g_disk;
+static RamDisk::Stats       g_stats;
+static int64_t              g_cutAt = -1;      // sectorsWritten at the cut
+
+void RamDisk::create(uint32_t sectors)
+{
+    g_disk.assign((size_t)sectors * 512u, 0);
+    g_stats = {};
+    g_cutAt = -1;
+}
+
+void RamDisk::cutAfter(int64_t sectors)
+{
+    g_cutAt = sectors < 0 ? -1 : (int64_t)g_stats.sectorsWritten + sectors;
+}
+
+RamDisk::Stats &RamDisk::stats()
+{
+    return g_stats;
+}
+
+/* ---------- diskio ------------------------------------------------------- */
+
+extern "C" {
+
+DSTATUS disk_initialize(BYTE) { return 0; }
+DSTATUS disk_status(BYTE)     { return 0; }
+DWORD   get_fattime(void)     { return 0; }
+
+DRESULT disk_read(BYTE, BYTE *buff, DWORD sector, UINT count)
+{
+    g_stats.readCalls++;
+    if (((size_t)sector + count) * 512u > g_disk.size()) return RES_PARERR;
+    memcpy(buff, &g_disk[(size_t)sector * 512u], (size_t)count * 512u);
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE, const BYTE *buff, DWORD sector, UINT count)
+{
+    g_stats.writeCalls++;
+    if (count > g_stats.maxWriteCount) g_stats.maxWriteCount = count;
+    if (((size_t)sector + count) * 512u > g_disk.size()) return RES_PARERR;
+
+    for (UINT i = 0; i < count; i++) {
+        if (g_cutAt >= 0 && (int64_t)g_stats.sectorsWritten >= g_cutAt) break;   // lost
+        memcpy(&g_disk[((size_t)sector + i) * 512u], buff + (size_t)i * 512u, 512u);
+        g_stats.sectorsWritten++;
+    }
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE, BYTE cmd, void *buff)
+{
+    switch (cmd) {
+    case CTRL_SYNC:        return RES_OK;
+    case GET_SECTOR_COUNT: *(DWORD *)buff = (DWORD)(g_disk.size() / 512u); return RES_OK;
+    case GET_SECTOR_SIZE:  *(WORD *)buff  = 512;  return RES_OK;
+    case GET_BLOCK_SIZE:   *(DWORD *)buff = 1;    return RES_OK;
+    default:               return RES_PARERR;
+    }
+}
+
+} // extern "C"
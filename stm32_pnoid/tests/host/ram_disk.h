@@ -0,0 +1,31 @@
+/**
+ * @file    ram_disk.h
+ * @brief   FatFs block device in host RAM, with a power-cut switch
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace RamDisk {
+
+struct Stats {
+    uint32_t readCalls;
+    uint32_t writeCalls;
+    uint32_t sectorsWritten;        // accepted before the cut
+    uint32_t maxWriteCount;         // largest multi-sector disk_write
+};
+
+/** Zeroed card of `sectors` 512 B sectors, stats and cut cleared */
+void   create(uint32_t sectors);
+
+/**
+ * @brief  Power cut after `sectors` more sectors are written (-1 = never)
+ * @note   Later writes report success but are lost, like a card losing
+ *         power with the command in flight
+ */
+void   cutAfter(int64_t sectors);
+
+Stats &stats();
+
+} // namespace RamDisk
@@ -0,0 +1,8 @@
+/**
+ * @file    stm32h7xx.h
+ * @brief   Host stand-in for the CMSIS device header (barriers, PRIMASK)
+ */
+
+#pragma once
+
+#include "stm32h7xx_hal.h"
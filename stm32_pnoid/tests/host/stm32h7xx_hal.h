@@ -0,0 +1,175 @@
+/**
+ * @file    stm32h7xx_hal.h
+ * @brief   Host stand-in for the HAL: only what the tested drivers touch
+ * @note    Included from C (FatFs via ffconf.h) and C++. Registers are
+ *          plain objects in hal_host.c; interrupts do not exist, so the
+ *          PRIMASK calls are no-ops. The QSPI calls are a NOR flash model
+ *          (qspi_nor.cpp) for the tests that link it; MDMA transfers are
+ *          started / aborted by the test that uses them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+
+/* ---------- Core ---------------------------------------------------------- */
+
+typedef struct { volatile uint32_t CYCCNT; } DWT_Type;
+typedef struct { volatile uint32_t VAL; }    SysTick_Type;
+
+extern DWT_Type     host_dwt;
+extern SysTick_Type host_systick;
+extern uint32_t     SystemCoreClock;
+
+#define DWT      (&host_dwt)
+#define SysTick  (&host_systick)
+
+static inline uint32_t __get_PRIMASK(void)     { return 0; }
+static inline void     __set_PRIMASK(uint32_t) {}
+static inline void     __disable_irq(void)     {}
+static inline void     __enable_irq(void)      {}
+static inline void     __DMB(void)             {}
+static inline void     __DSB(void)             {}
+static inline void     __ISB(void)             {}
+static inline void     __NOP(void)             {}
+#define __COMPILER_BARRIER()  __asm__ volatile("" ::: "memory")
+
+uint32_t HAL_GetTick(void);
+void     HAL_Delay(uint32_t ms);
+
+/* ---------- NVIC / MPU / D-cache (the QSPI driver's mapped window) ------- */
+
+typedef enum { QUADSPI_IRQn = 92, MDMA_IRQn = 122 } IRQn_Type;
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub);
+
+typedef struct {
+    uint8_t  Enable, Number;
+    uint32_t BaseAddress;
+    uint8_t  Size, SubRegionDisable, TypeExtField, AccessPermission;
+    uint8_t  DisableExec, IsShareable, IsCacheable, IsBufferable;
+} MPU_Region_InitTypeDef;
+
+enum {
+    MPU_REGION_DISABLE = 0, MPU_REGION_ENABLE = 1, MPU_REGION_NUMBER2 = 2,
+    MPU_REGION_SIZE_8MB = 0x16, MPU_TEX_LEVEL0 = 0, MPU_REGION_PRIV_RO_URO = 6,
+    MPU_INSTRUCTION_ACCESS_DISABLE = 1, MPU_ACCESS_NOT_SHAREABLE = 0,
+    MPU_ACCESS_CACHEABLE = 1, MPU_ACCESS_NOT_BUFFERABLE = 0,
+};
+
+void HAL_MPU_ConfigRegion(const MPU_Region_InitTypeDef *r);
+
+/* No cache on the host: maintenance is a no-op */
+static inline void SCB_InvalidateDCache_by_Addr(void *a, int32_t n)      { (void)a; (void)n; }
+static inline void SCB_CleanDCache_by_Addr(void *a, int32_t n)           { (void)a; (void)n; }
+static inline void SCB_CleanInvalidateDCache_by_Addr(void *a, int32_t n) { (void)a; (void)n; }
+static inline void SCB_CleanInvalidateDCache(void)                       {}
+
+/* ---------- QUADSPI (implemented by the NOR model, qspi_nor.cpp) --------- */
+
+typedef struct {
+    uint32_t Instruction, Address, AlternateBytes, AddressSize, AlternateBytesSize;
+    uint32_t DummyCycles, InstructionMode, AddressMode, AlternateByteMode, DataMode;
+    uint32_t NbData, DdrMode, DdrHoldHalfCycle, SIOOMode;
+} QSPI_CommandTypeDef;
+
+typedef struct { uint32_t Match, Mask, Interval, StatusBytesSize, MatchMode, AutomaticStop; } QSPI_AutoPollingTypeDef;
+typedef struct { uint32_t TimeOutPeriod, TimeOutActivation; } QSPI_MemoryMappedTypeDef;
+typedef struct { volatile uint32_t State; volatile uint32_t ErrorCode; } QSPI_HandleTypeDef;
+typedef struct { volatile uint32_t CR, SR, DLR, CCR, AR; } QUADSPI_TypeDef;
+
+extern QUADSPI_TypeDef host_quadspi;
+#define QUADSPI  (&host_quadspi)
+
+enum {
+    QSPI_INSTRUCTION_1_LINE = 1, QSPI_INSTRUCTION_4_LINES = 3,
+    QSPI_ADDRESS_NONE = 0, QSPI_ADDRESS_1_LINE = 1, QSPI_ADDRESS_4_LINES = 3,
+    QSPI_ADDRESS_24_BITS = 2,
+    QSPI_ALTERNATE_BYTES_NONE = 0, QSPI_ALTERNATE_BYTES_4_LINES = 3, QSPI_ALTERNATE_BYTES_8_BITS = 0,
+    QSPI_DATA_NONE = 0, QSPI_DATA_1_LINE = 1, QSPI_DATA_4_LINES = 3,
+    QSPI_DDR_MODE_DISABLE = 0, QSPI_SIOO_INST_EVERY_CMD = 0,
+    QSPI_MATCH_MODE_AND = 0, QSPI_AUTOMATIC_STOP_ENABLE = 1, QSPI_TIMEOUT_COUNTER_DISABLE = 0,
+    HAL_QSPI_STATE_READY = 1, HAL_QSPI_STATE_BUSY = 2, HAL_QSPI_STATE_BUSY_MEM_MAPPED = 0x88,
+};
+
+HAL_StatusTypeDef HAL_QSPI_Command(QSPI_HandleTypeDef *h, QSPI_CommandTypeDef *cmd, uint32_t timeout);
+HAL_StatusTypeDef HAL_QSPI_Command_IT(QSPI_HandleTypeDef *h, QSPI_CommandTypeDef *cmd);
+HAL_StatusTypeDef HAL_QSPI_Receive(QSPI_HandleTypeDef *h, uint8_t *data, uint32_t timeout);
+HAL_StatusTypeDef HAL_QSPI_Transmit(QSPI_HandleTypeDef *h, uint8_t *data, uint32_t timeout);
+HAL_StatusTypeDef HAL_QSPI_Transmit_IT(QSPI_HandleTypeDef *h, uint8_t *data);
+HAL_StatusTypeDef HAL_QSPI_AutoPolling(QSPI_HandleTypeDef *h, QSPI_CommandTypeDef *cmd,
+                                       QSPI_AutoPollingTypeDef *cfg, uint32_t timeout);
+HAL_StatusTypeDef HAL_QSPI_AutoPolling_IT(QSPI_HandleTypeDef *h, QSPI_CommandTypeDef *cmd,
+                                          QSPI_AutoPollingTypeDef *cfg);
+HAL_StatusTypeDef HAL_QSPI_MemoryMapped(QSPI_HandleTypeDef *h, QSPI_CommandTypeDef *cmd,
+                                        QSPI_MemoryMappedTypeDef *cfg);
+HAL_StatusTypeDef HAL_QSPI_Abort(QSPI_HandleTypeDef *h);
+
+/* Defined by the driver under test (w25qxx_async.cpp) */
+void HAL_QSPI_CmdCpltCallback(QSPI_HandleTypeDef *h);
+void HAL_QSPI_TxCpltCallback(QSPI_HandleTypeDef *h);
+void HAL_QSPI_StatusMatchCallback(QSPI_HandleTypeDef *h);
+void HAL_QSPI_ErrorCallback(QSPI_HandleTypeDef *h);
+
+/* ---------- MDMA (asset cache) ------------------------------------------- */
+
+typedef struct {
+    uint32_t Request, TransferTriggerMode, Priority, Endianness;
+    uint32_t SourceInc, DestinationInc, SourceDataSize, DestDataSize, DataAlignment;
+    uint32_t BufferTransferLength, SourceBurst, DestBurst;
+    int32_t  SourceBlockAddressOffset, DestBlockAddressOffset;
+} MDMA_InitTypeDef;
+
+typedef struct { volatile uint32_t CCR; } MDMA_Channel_TypeDef;
+
+extern MDMA_Channel_TypeDef host_mdma_channel0;
+#define MDMA_Channel0  (&host_mdma_channel0)
+
+typedef struct __MDMA_HandleTypeDef {
+    MDMA_Channel_TypeDef *Instance;
+    MDMA_InitTypeDef      Init;
+    void (*XferCpltCallback)(struct __MDMA_HandleTypeDef *h);
+    void (*XferErrorCallback)(struct __MDMA_HandleTypeDef *h);
+} MDMA_HandleTypeDef;
+
+typedef enum { HAL_MDMA_XFER_CPLT_CB_ID = 0, HAL_MDMA_XFER_ERROR_CB_ID = 4 } HAL_MDMA_CallbackIDTypeDef;
+
+enum {
+    MDMA_REQUEST_SW = 0x40000000, MDMA_BLOCK_TRANSFER = 1, MDMA_PRIORITY_LOW = 0,
+    MDMA_LITTLE_ENDIANNESS_PRESERVE = 0, MDMA_SRC_INC_WORD = 0x202, MDMA_DEST_INC_WORD = 0x808,
+    MDMA_SRC_DATASIZE_WORD = 0x20, MDMA_DEST_DATASIZE_WORD = 0x80, MDMA_DATAALIGN_PACKENABLE = 0x2000,
+    MDMA_SOURCE_BURST_16BEATS = 0x4000, MDMA_DEST_BURST_16BEATS = 0x200000,
+};
+
+#define __HAL_RCC_MDMA_CLK_ENABLE()  do {} while (0)
+
+HAL_StatusTypeDef HAL_MDMA_Init(MDMA_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_MDMA_RegisterCallback(MDMA_HandleTypeDef *h, HAL_MDMA_CallbackIDTypeDef id,
+                                            void (*cb)(MDMA_HandleTypeDef *h));
+
+/* Defined by the test that models the transfer */
+HAL_StatusTypeDef HAL_MDMA_Start_IT(MDMA_HandleTypeDef *h, uint32_t src, uint32_t dst,
+                                    uint32_t blockLen, uint32_t blocks);
+HAL_StatusTypeDef HAL_MDMA_Abort(MDMA_HandleTypeDef *h);
+
+/* ---------- SDMMC --------------------------------------------------------- */
+
+typedef struct { int unused; } SD_HandleTypeDef;
+typedef struct { uint32_t BlockNbr, BlockSize, LogBlockNbr, LogBlockSize; } HAL_SD_CardInfoTypeDef;
+
+/* ---------- I2C (handle type only: humanoid.hpp for the pose types) ------ */
+
+typedef struct { int unused; } I2C_HandleTypeDef;
+
+#ifdef __cplusplus
+}
+#endif
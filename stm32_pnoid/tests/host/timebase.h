@@ -0,0 +1,20 @@
+/**
+ * @file    timebase.h
+ * @brief   Host stand-in for Core/Inc/timebase.h
+ * @note    Each test defines TIME_Micros(): simulated time, or a counter
+ *          that advances on every call.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t TIME_Micros(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+Asset pack for test_asset_pack, built by scripts/asset_pack.py.
+
+    python3 tests/pack_vectors.py <outdir>
+
+Writes the source files under <outdir>/assets/, the pack as
+<outdir>/test.pak (25 % reserve, as "asset install" packs are built) and
+manifest.txt (one asset name per line). The set mixes small blobs that
+share a 4 KB sector with their neighbours, assets spanning several
+sectors, names in subdirectories and an empty file, enough of them that
+some slots are reached by probing.
+"""
+import os
+import random
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "scripts"))
+import asset_pack  # noqa: E402
+
+
+def main() -> int:
+    out_dir = sys.argv[1]
+    src_dir = os.path.join(out_dir, "assets")
+    rng = random.Random(47)
+
+    sizes = {
+        "sprites/eye_open.rgb565":   4 + 32 * 32 * 2,
+        "sprites/eye_closed.rgb565": 4 + 32 * 32 * 2,
+        "sprites/eye_left.rgb565":   4 + 32 * 32 * 2,
+        "sprites/mouth.rgb565":      4 + 48 * 16 * 2,
+        "sounds/beep.pcm":           1500,
+        "sounds/hello.wav":          23000,
+        "clips/walk.clip":           640,
+        "clips/wave.clip":           352,
+        "clips/bow.clip":            200,
+        "fonts/small.fnt":           95 * 8,
+        "fonts/large.fnt":           9000,
+        "notes.txt":                 37,
+        "empty.bin":                 0,
+    }
+    for i in range(12):
+        sizes[f"clips/idle{i:02d}.clip"] = rng.randrange(16, 400)
+
+    for name, size in sizes.items():
+        path = os.path.join(src_dir, name)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "wb") as f:
+            f.write(bytes(rng.getrandbits(8) for _ in range(size)))
+
+    files = asset_pack.collect([src_dir])
+    pack = asset_pack.build(files, 25, 6 * 1024 * 1024)
+    with open(os.path.join(out_dir, "test.pak"), "wb") as f:
+        f.write(pack)
+    with open(os.path.join(out_dir, "manifest.txt"), "w") as f:
+        for name, _ in files:
+            f.write(name + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""
+PLZ test streams for test_asset_codec, encoded by scripts/asset_codec.py.
+
+    python3 tests/plz_vectors.py <outdir>
+
+Writes <name>.raw / <name>.plz per vector and vectors.txt (one line per
+vector: name, filter, window log2, raw size). The inputs are synthetic but
+shaped like the real assets: RGB565 sprites with flat areas and repeated
+tiles, mono / stereo 16-bit PCM, incompressible data (long literal runs),
+long single-byte runs (offset 1, long match lengths), matches further
+back than 4 KB, an odd-length PCM tail and an empty asset.
+"""
+import math
+import os
+import random
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "scripts"))
+import asset_codec  # noqa: E402
+
+
+def sprite(w: int, h: int) -> bytes:
+    """Eye-like sprite: flat background, gradient iris, a repeated 8x8 tile"""
+    px = []
+    for y in range(h):
+        for x in range(w):
+            dx, dy = x - w / 2, y - h / 2
+            r = math.hypot(dx, dy)
+            if r < h / 6:
+                c = 0x0000
+            elif r < h / 3:
+                c = ((int(r * 3) & 0x1F) << 11) | ((int(dx + 32) & 0x3F) << 5) | 0x0F
+            elif (x // 8 + y // 8) % 5 == 0:
+                c = 0x07E0 if (x ^ y) & 4 else 0xF81F
+            else:
+                c = 0xFFFF
+            px.append(c)
+    return struct.pack(f"<{len(px)}H", *px)
+
+
+def pcm(n: int, channels: int, rng: random.Random) -> bytes:
+    """Beeps at 16 kHz: a noisy attack, then tones with a stepped envelope,
+    16-bit LE interleaved"""
+    out = []
+    for i in range(n):
+        for ch in range(channels):
+            period = 40 if ch == 0 else 25          # 400 / 640 Hz
+            amp = 12000 - 3000 * (i // 2000 % 4)
+            v = amp * math.sin(2 * math.pi * (i % period) / period)
+            if i < 1000:
+                v += rng.gauss(0, 200)
+            out.append(max(-32768, min(32767, int(v))))
+    return struct.pack(f"<{len(out)}h", *out)
+
+
+def main() -> int:
+    out_dir = sys.argv[1]
+    os.makedirs(out_dir, exist_ok=True)
+    rng = random.Random(48)
+
+    noise = bytes(rng.getrandbits(8) for _ in range(3000))
+    block = bytes(rng.getrandbits(8) for _ in range(9000))
+    vectors = [
+        ("sprite",     sprite(96, 64),                                     12, asset_codec.FILTER_NONE),
+        ("mixed",      noise + b"\x55" * 700 + noise[:900] + b"abc" * 400, 10, asset_codec.FILTER_NONE),
+        ("runs",       b"\x00" * 5000 + b"\xff\x00" * 1500 + b"\x07" * 70, 12, asset_codec.FILTER_NONE),
+        ("far",        block + noise[:500] + block,                        16, asset_codec.FILTER_NONE),
+        ("mono",       pcm(12000, 1, rng) + b"\x42",                       12, asset_codec.FILTER_DELTA16),
+        ("stereo",     pcm(8000, 2, rng),                                  14, asset_codec.FILTER_DELTA16_STEREO),
+        ("empty",      b"",                                                12, asset_codec.FILTER_NONE),
+    ]
+
+    with open(os.path.join(out_dir, "vectors.txt"), "w") as index:
+        for name, raw, window, filt in vectors:
+            blob = asset_codec.encode(raw, window, filt)
+            if asset_codec.decode(blob) != raw:
+                raise RuntimeError(f"{name}: round trip failed")
+            with open(os.path.join(out_dir, name + ".raw"), "wb") as f:
+                f.write(raw)
+            with open(os.path.join(out_dir, name + ".plz"), "wb") as f:
+                f.write(blob)
+            index.write(f"{name} {filt} {window} {len(raw)}\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
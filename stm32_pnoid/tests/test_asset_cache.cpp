@@ -0,0 +1,355 @@
+/**
+ * @file    test_asset_cache.cpp
+ * @brief   AssetCache on the QSPI NOR model and an MDMA model
+ *
+ * The cache runs unchanged over W25Qxx (async engine, mapped window) and
+ * qspi_nor.cpp; the MDMA model below copies a block ~140 us after the
+ * start, from the mapped window, and can fail or hang a transfer. Checked:
+ * argument limits, LRU eviction order, a write dropping the lines it
+ * covers, the fetch timeout, then a random mix of prefetches, reads and
+ * sector rewrites with injected MDMA errors: every read of a range no
+ * write covers returns what the flash holds, every request gets its ready
+ * callback, and no transfer runs outside the mapping.
+ *
+ *   test_asset_cache [ops]    default 200000 random operations
+ */
+
+#include "w25qxx.hpp"
+#include "asset_cache.hpp"
+#include "qspi_nor.h"
+#include "check.hpp"
+#include <cstring>
+#include <random>
+#include <sys/mman.h>
+
+extern "C" uint64_t TIME_Micros(void)
+{
+    return QspiNor::now();
+}
+
+namespace {
+
+constexpr uint32_t  LINES     = 16;                     // as in app.cpp
+constexpr uint32_t  LINE      = AssetCache::LINE_SIZE;
+constexpr uint32_t  REGION    = 256 * 1024;             // asset area exercised
+constexpr uintptr_t AXI_SRAM  = 0x24000000u;            // MDMA addresses are 32-bit
+
+std::mt19937 rng(11);
+
+/* ---------- MDMA model ----------------------------------------------------- */
+
+struct Mdma {
+    MDMA_HandleTypeDef *h       = nullptr;
+    bool                busy    = false;
+    uint64_t            dueUs   = 0;
+    uint32_t            src     = 0;
+    uint32_t            dst     = 0;
+    uint32_t            len     = 0;
+    uint32_t            errorPercent = 0;   // injected transfer errors
+    bool                hang    = false;    // never completes
+    uint32_t            starts  = 0;
+    uint32_t            errors  = 0;
+    uint32_t            unmapped = 0;       // started / finished outside the mapping
+} mdma;
+
+/** Complete the transfer in flight if it is due by `until` */
+void mdmaRun(uint64_t until)
+{
+    if (!mdma.busy || mdma.hang || mdma.dueUs > until) return;
+    if (mdma.dueUs > QspiNor::now()) QspiNor::run(mdma.dueUs - QspiNor::now());
+    mdma.busy = false;
+    if (!QspiNor::mapped()) mdma.unmapped++;
+    if (rng() % 100 < mdma.errorPercent) {
+        mdma.errors++;
+        mdma.h->XferErrorCallback(mdma.h);
+        return;
+    }
+    memcpy(reinterpret_cast<void *>((uintptr_t)mdma.dst),
+           reinterpret_cast<const void *>((uintptr_t)mdma.src), mdma.len);
+    mdma.h->XferCpltCallback(mdma.h);
+}
+
+} // namespace
+
+extern "C" HAL_StatusTypeDef HAL_MDMA_Start_IT(MDMA_HandleTypeDef *h, uint32_t src, uint32_t dst,
+                                               uint32_t blockLen, uint32_t blocks)
+{
+    if (mdma.busy || blocks != 1) return HAL_BUSY;
+    if (!QspiNor::mapped()) mdma.unmapped++;
+    mdma.h     = h;
+    mdma.busy  = true;
+    mdma.dueUs = QspiNor::now() + 20 + blockLen / 32;       // ~30 MB/s out of QSPI
+    mdma.src   = src;
+    mdma.dst   = dst;
+    mdma.len   = blockLen;
+    mdma.starts++;
+    return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_MDMA_Abort(MDMA_HandleTypeDef *)
+{
+    mdma.busy = false;
+    return HAL_OK;
+}
+
+namespace {
+
+/* ---------- Board ---------------------------------------------------------- */
+
+struct Board {
+    QSPI_HandleTypeDef  h{};
+    MDMA_HandleTypeDef  hmdma{};
+    uint8_t            *mem   = nullptr;
+    uint8_t            *lines = nullptr;
+    W25Qxx             *flash = nullptr;
+    AssetCache         *cache = nullptr;
+
+    Board()
+    {
+        mem = QspiNor::create(0xFF);
+        for (uint32_t i = 0; i < REGION; i++) mem[i] = (uint8_t)rng();
+
+        void *p = mmap(reinterpret_cast<void *>(AXI_SRAM), LINES * LINE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        REQUIRE(p == reinterpret_cast<void *>(AXI_SRAM));
+        lines = static_cast<uint8_t *>(p);
+
+        flash = new W25Qxx(h);
+        flash->enableMemoryMapped();
+        cache = new AssetCache(*flash, hmdma, lines, LINES * LINE);
+        REQUIRE(cache->init(MDMA_Channel0) == AssetCache::Status::OK);
+        REQUIRE(cache->isReady());
+    }
+
+    /** One pass of the flash service, 20..220 us after the last */
+    void step()
+    {
+        const uint64_t until = QspiNor::now() + 20 + rng() % 200;
+        mdmaRun(until);
+        QspiNor::run(until - QspiNor::now());
+        flash->service();
+        cache->service();
+    }
+
+    bool wait(const AssetCache::Request &r, uint32_t maxSteps = 20000)
+    {
+        for (uint32_t i = 0; i < maxSteps && r.pending; i++) step();
+        return !r.pending;
+    }
+
+    bool settle(uint32_t maxSteps = 100000)
+    {
+        for (uint32_t i = 0; i < maxSteps; i++) {
+            if (!cache->busy() && !flash->asyncBusy()) return true;
+            step();
+        }
+        return false;
+    }
+
+    /** Queue erase + program of one sector with fresh random bytes */
+    void rewrite(W25Qxx::AsyncOp &erase, W25Qxx::AsyncOp &prog, uint8_t *data, uint32_t address)
+    {
+        for (uint32_t i = 0; i < LINE; i++) data[i] = (uint8_t)rng();
+        erase.kind    = W25Qxx::AsyncOp::Kind::Erase;
+        erase.address = address;
+        erase.size    = LINE;
+        prog.kind     = W25Qxx::AsyncOp::Kind::Program;
+        prog.address  = address;
+        prog.size     = LINE;
+        prog.data     = data;
+        REQUIRE(flash->submit(erase) == W25Qxx::Status::OK);
+        REQUIRE(flash->submit(prog) == W25Qxx::Status::OK);
+    }
+};
+
+Board *board;
+
+/* ---------- Limits --------------------------------------------------------- */
+
+void testParams()
+{
+    AssetCache &c = *board->cache;
+    AssetCache::Request r;
+
+    r.address = 0;
+    r.size    = 0;
+    CHECK(c.prefetch(r) == AssetCache::Status::ErrParam);
+    r.size = LINES * LINE + 1;                      // one line more than the cache
+    CHECK(c.prefetch(r) == AssetCache::Status::ErrParam);
+    r.address = W25Qxx::CHIP_SIZE - 16;
+    r.size    = 32;
+    CHECK(c.prefetch(r) == AssetCache::Status::ErrParam);
+
+    r.address = 100;
+    r.size    = 10;
+    CHECK(c.prefetch(r) == AssetCache::Status::OK);
+    CHECK(c.prefetch(r) == AssetCache::Status::ErrBusy);
+    CHECK(board->wait(r));
+    CHECK(r.result == AssetCache::Status::OK);
+    CHECK(c.contains(0, LINE));
+}
+
+/* ---------- LRU ------------------------------------------------------------ */
+
+/** Fill every line, touch line 0: the next fetch must reuse line 1 */
+void testLru()
+{
+    AssetCache &c = *board->cache;
+    uint8_t b[4];
+
+    AssetCache::Request r;
+    r.address = 0;
+    r.size    = LINES * LINE;
+    REQUIRE(c.prefetch(r) == AssetCache::Status::OK);
+    CHECK(board->wait(r));
+    CHECK(r.result == AssetCache::Status::OK);
+    CHECK(c.contains(0, LINES * LINE));
+
+    CHECK(c.read(0, b, sizeof(b)));
+    AssetCache::Request r2;
+    r2.address = LINES * LINE;
+    r2.size    = 1;
+    REQUIRE(c.prefetch(r2) == AssetCache::Status::OK);
+    CHECK(board->wait(r2));
+
+    CHECK(c.contains(0, LINE));
+    CHECK(!c.contains(LINE, 1));
+    CHECK(c.contains(2 * LINE, (LINES - 2) * LINE));
+    CHECK(c.contains(LINES * LINE, LINE));
+    CHECK(c.stats().evictions == 1);
+}
+
+/* ---------- Writes --------------------------------------------------------- */
+
+void testWriteInvalidates()
+{
+    AssetCache &c = *board->cache;
+    static uint8_t data[LINE];
+    const uint32_t a = 3 * LINE;
+    uint8_t got[64];
+
+    AssetCache::Request r;
+    r.address = a;
+    r.size    = LINE;
+    REQUIRE(c.prefetch(r) == AssetCache::Status::OK);
+    CHECK(board->wait(r));
+    CHECK(c.contains(a, LINE));
+
+    W25Qxx::AsyncOp erase, prog;
+    board->rewrite(erase, prog, data, a);
+    CHECK(!c.contains(a, 1));                       // dropped at submit
+    CHECK(board->settle());
+
+    CHECK(c.read(a + 100, got, sizeof(got)));
+    CHECK(memcmp(got, data + 100, sizeof(got)) == 0);
+    CHECK(memcmp(board->mem + a, data, LINE) == 0);
+}
+
+/* ---------- Stuck transfer ------------------------------------------------- */
+
+void testTimeout()
+{
+    AssetCache &c = *board->cache;
+    const uint32_t errors = c.stats().errors;
+
+    mdma.hang = true;
+    AssetCache::Request r;
+    r.address = 40 * LINE;
+    r.size    = LINE;
+    REQUIRE(c.prefetch(r) == AssetCache::Status::OK);
+    CHECK(board->wait(r));
+    mdma.hang = false;
+    mdma.busy = false;
+
+    CHECK(r.result == AssetCache::Status::ErrDma);
+    CHECK(c.stats().errors == errors + 1);
+    CHECK(!c.contains(r.address, 1));
+    CHECK(board->flash->mmapAcquire());             // the mapping was handed back
+    board->flash->mmapRelease();
+}
+
+/* ---------- Random mix ----------------------------------------------------- */
+
+uint32_t readyOk, readyErr;
+
+void onReady(void *, AssetCache::Status st)
+{
+    (st == AssetCache::Status::OK ? readyOk : readyErr)++;
+}
+
+void testRandom(int ops)
+{
+    AssetCache &c = *board->cache;
+    W25Qxx &f = *board->flash;
+    c.resetStats();
+    mdma.errorPercent = 1;
+    mdma.errors = 0;
+
+    AssetCache::Request reqs[4];
+    W25Qxx::AsyncOp erase, prog;
+    static uint8_t data[LINE];
+    uint32_t checked = 0, bad = 0, retries = 0, writes = 0, queued = 0;
+
+    for (int op = 0; op < ops; op++) {
+        const uint32_t r = rng() % 1000;
+        if (r < 40) {
+            AssetCache::Request &q = reqs[rng() % 4];
+            if (!q.pending) {
+                q.address = rng() % (REGION - 16384);
+                q.size    = 1 + rng() % 16384;
+                q.ready   = onReady;
+                if (c.prefetch(q) == AssetCache::Status::OK) queued++;
+            }
+        } else if (r < 42) {
+            if (!erase.pending && !prog.pending) {
+                board->rewrite(erase, prog, data, (rng() % (REGION / LINE)) * LINE);
+                writes++;
+            }
+        } else if (r < 900) {
+            const uint32_t a = rng() % (REGION - 256);
+            const uint32_t n = 1 + rng() % 256;
+            uint8_t buf[256];
+            const bool stable = f.regionStable(a, n);
+            if (!c.read(a, buf, n)) {
+                retries++;
+            } else if (stable && f.regionStable(a, n)) {
+                checked++;
+                if (memcmp(buf, board->mem + a, n) != 0 && bad++ < 5)
+                    std::printf("op %d: stale read at 0x%06X + %u\n", op, (unsigned)a, (unsigned)n);
+            }
+        }
+        board->step();
+    }
+    CHECK(board->settle());
+
+    const AssetCache::Stats &s = c.stats();
+    CHECK(bad == 0);
+    CHECK(checked > (uint32_t)ops / 2);
+    CHECK(mdma.unmapped == 0);
+    CHECK(readyOk + readyErr == queued);
+    CHECK(s.requests == queued);
+    CHECK(readyErr <= s.errors && s.errors == mdma.errors);
+    CHECK(s.hits > 0 && s.misses > 0 && s.invalidations > 0 && s.evictions > 0);
+    std::printf("random: %u checked reads, %u busy retries, %u rewrites; %u requests "
+                "(%u failed), %u fetches, %u evictions, %u invalidations, %u MDMA errors\n",
+                (unsigned)checked, (unsigned)retries, (unsigned)writes, (unsigned)queued,
+                (unsigned)readyErr, (unsigned)s.fetches, (unsigned)s.evictions,
+                (unsigned)s.invalidations, (unsigned)s.errors);
+    std::printf("        hit %u%% (%u KB from SRAM, %u KB mapped)\n",
+                (unsigned)(100ull * s.hits / (s.hits + s.misses)),
+                (unsigned)(s.hitBytes / 1024), (unsigned)(s.missBytes / 1024));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    board = new Board;
+    testParams();
+    testLru();
+    testWriteInvalidates();
+    testTimeout();
+    testRandom(argc > 1 ? atoi(argv[1]) : 200000);
+    CHECK(mdma.unmapped == 0);
+    return checkResult("test_asset_cache");
+}
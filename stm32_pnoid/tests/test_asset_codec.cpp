@@ -0,0 +1,267 @@
+/**
+ * @file    test_asset_codec.cpp
+ * @brief   LzDecoder on streams from scripts/asset_codec.py
+ *
+ * The streams are built with the tests by plz_vectors.py (the real
+ * encoder, filters None / Delta16 / Delta16Stereo, windows 1 KB..64 KB):
+ *
+ *   splits     input fed in random pieces (down to one byte, as SD sectors
+ *              or a mapped blob would arrive), output taken in random
+ *              chunks (down to one byte: literal runs, matches and PCM
+ *              samples split across calls) — always the raw bytes back
+ *   truncated  cut at random points: a prefix of the raw data, never
+ *              done(), no error, nothing written past the chunk
+ *   corrupted  random byte flips, an over-long literal run, header
+ *              damage: never written past the chunk or past rawSize, so
+ *              a caller looping on done() terminates
+ *   throughput whole stream from memory into 480-byte chunks (an LCD
+ *              line), MB/s per vector on the host
+ *
+ *   test_asset_codec <vector dir>
+ */
+
+#include "asset_codec.hpp"
+#include "check.hpp"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Vector {
+    std::string name;
+    int      filter;
+    int      windowLog;
+    Bytes    raw;
+    Bytes    plz;
+};
+
+constexpr uint32_t RING   = 1u << 16;           // room for every window
+constexpr uint32_t GUARD  = 64;                 // canary after each out chunk
+constexpr uint8_t  CANARY = 0xA5;
+
+std::mt19937 rng(48);
+uint8_t ring[RING];
+
+Bytes readFile(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    REQUIRE(f.good());
+    return Bytes(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+std::vector<Vector> load(const std::string &dir)
+{
+    std::vector<Vector> v;
+    std::ifstream index(dir + "/vectors.txt");
+    REQUIRE(index.good());
+    std::string line;
+    while (std::getline(index, line)) {
+        std::istringstream ls(line);
+        Vector x;
+        uint32_t rawSize;
+        if (!(ls >> x.name >> x.filter >> x.windowLog >> rawSize)) continue;
+        x.raw = readFile(dir + "/" + x.name + ".raw");
+        x.plz = readFile(dir + "/" + x.name + ".plz");
+        REQUIRE(x.raw.size() == rawSize);
+        v.push_back(x);
+    }
+    return v;
+}
+
+uint32_t pick(uint32_t lo, uint32_t hi)
+{
+    return std::uniform_int_distribution<uint32_t>(lo, hi)(rng);
+}
+
+struct Run {
+    Bytes out;
+    LzDecoder::Status status = LzDecoder::Status::OK;
+    bool done    = false;
+    bool overrun = false;                       // wrote into a guard area
+    uint32_t calls = 0;
+};
+
+/**
+ * Decode `blob` feeding input in pieces of 1..maxIn bytes and asking for
+ * 1..maxOut bytes per call, like a caller looping on done(). Stops when the
+ * decoder makes no progress with all input given (starved / stuck).
+ */
+Run decode(const Bytes &blob, uint32_t maxIn, uint32_t maxOut)
+{
+    Run r;
+    LzDecoder dec(ring, RING);
+    const uint8_t *in = blob.data(), *end = blob.data() + blob.size();
+    r.status = dec.open(in, end);
+    if (r.status != LzDecoder::Status::OK) return r;
+
+    Bytes chunk(maxOut + GUARD);
+    const uint8_t *avail = in;
+    while (!dec.done()) {
+        const uint32_t left = (uint32_t)(end - avail);
+        avail += left ? pick(1, std::min(maxIn, left)) : 0;
+
+        const uint32_t want = pick(1, maxOut);
+        std::fill(chunk.begin(), chunk.end(), CANARY);
+        const uint32_t got = dec.decode(in, avail, chunk.data(), want);
+        r.calls++;
+        for (uint32_t i = want; i < want + GUARD; i++) r.overrun |= chunk[i] != CANARY;
+        if (got > want) { r.overrun = true; break; }
+        r.out.insert(r.out.end(), chunk.begin(), chunk.begin() + got);
+        if (got == 0 && avail == end) break;    // no more input, no progress
+        if (r.calls > 10000000) break;
+    }
+    r.status = dec.status();
+    r.done   = dec.done();
+    return r;
+}
+
+/* ---------- Round trip with random splits ----------------------------------- */
+
+void testSplits(const std::vector<Vector> &vs)
+{
+    static const uint32_t SPLITS[][2] = {   // max input piece, max output chunk
+        { 1u << 20, 1u << 20 }, { 512, 480 }, { 512, 1 }, { 1, 480 },
+        { 1, 1 }, { 7, 3 }, { 3, 7 }, { 4096, 64 },
+    };
+    for (const Vector &v : vs) {
+        int fails = 0;
+        for (const auto &s : SPLITS) {
+            for (int rep = 0; rep < 4; rep++) {
+                const Run r = decode(v.plz, s[0], s[1]);
+                const bool ok = r.status == LzDecoder::Status::OK && r.done && !r.overrun
+                             && r.out == v.raw;
+                fails += ok ? 0 : 1;
+            }
+        }
+        CHECK(fails == 0);
+        std::printf("split      %-7s filter %d window %5u: %zu -> %zu B, %d/%zu runs wrong\n",
+                    v.name.c_str(), v.filter, 1u << v.windowLog, v.raw.size(), v.plz.size(),
+                    fails, 4 * std::size(SPLITS));
+    }
+}
+
+/* ---------- Truncated streams ----------------------------------------------- */
+
+void testTruncated(const std::vector<Vector> &vs)
+{
+    for (const Vector &v : vs) {
+        if (v.raw.empty()) continue;
+        int bad = 0;
+        for (int rep = 0; rep < 200; rep++) {
+            const uint32_t cut = pick(LzDecoder::HEADER_SIZE, (uint32_t)v.plz.size() - 1);
+            const Bytes blob(v.plz.begin(), v.plz.begin() + cut);
+            const Run r = decode(blob, pick(1, 600), pick(1, 600));
+            const bool ok = r.status == LzDecoder::Status::OK && !r.done && !r.overrun
+                         && r.out.size() < v.raw.size()
+                         && std::equal(r.out.begin(), r.out.end(), v.raw.begin());
+            bad += ok ? 0 : 1;
+        }
+        /* Header cut short */
+        Bytes head(v.plz.begin(), v.plz.begin() + LzDecoder::HEADER_SIZE - 1);
+        CHECK(decode(head, 64, 64).status == LzDecoder::Status::ErrFormat);
+        CHECK(bad == 0);
+    }
+}
+
+/* ---------- Corrupted streams ----------------------------------------------- */
+
+void testCorrupted(const std::vector<Vector> &vs)
+{
+    int runs = 0, caught = 0, stuck = 0;
+    for (const Vector &v : vs) {
+        if (v.plz.size() <= LzDecoder::HEADER_SIZE) continue;
+        for (int rep = 0; rep < 300; rep++) {
+            Bytes blob = v.plz;
+            const int flips = (int)pick(1, 4);
+            for (int f = 0; f < flips; f++)
+                blob[pick(LzDecoder::HEADER_SIZE, (uint32_t)blob.size() - 1)] ^= (uint8_t)pick(1, 255);
+            const Run r = decode(blob, pick(1, 600), pick(1, 600));
+            runs++;
+            CHECK(!r.overrun);
+            CHECK(r.out.size() <= v.raw.size());
+            if (r.status != LzDecoder::Status::OK) caught++;
+            if (r.calls > 1000000) stuck++;
+        }
+    }
+    CHECK(stuck == 0);
+    std::printf("corrupt    %d streams with 1-4 flipped bytes: %d rejected, rest decoded to garbage within rawSize\n",
+                runs, caught);
+
+    /* Literal run longer than the rest of the asset */
+    {
+        Bytes blob = { 0x50, 0x4C, 0x5A, 0x31, 4, 0, 0, 0, 12, 0, 0, 0, 0xF0, 10 };
+        blob.resize(blob.size() + 25, 'x');
+        const Run r = decode(blob, 1u << 20, 64);
+        CHECK(r.status == LzDecoder::Status::ErrCorrupt);
+        CHECK(r.out.size() <= 4);
+    }
+
+    /* Header damage: magic, window larger than the ring, unknown filter */
+    const Vector &v = vs.front();
+    Bytes b = v.plz;
+    b[0] ^= 1;
+    CHECK(decode(b, 64, 64).status == LzDecoder::Status::ErrFormat);
+    b = v.plz;
+    b[8] = 17;
+    CHECK(decode(b, 64, 64).status == LzDecoder::Status::ErrFormat);
+    b = v.plz;
+    b[9] = 3;
+    CHECK(decode(b, 64, 64).status == LzDecoder::Status::ErrFormat);
+    {
+        uint8_t small[1u << 10];
+        LzDecoder dec(small, sizeof(small));
+        const uint8_t *in = v.plz.data();
+        CHECK(v.windowLog > 10);
+        CHECK(dec.open(in, v.plz.data() + v.plz.size()) == LzDecoder::Status::ErrFormat);
+    }
+}
+
+/* ---------- Throughput ------------------------------------------------------ */
+
+void testThroughput(const std::vector<Vector> &vs)
+{
+    static uint8_t line[480];
+    for (const Vector &v : vs) {
+        if (v.raw.empty()) continue;
+        const int reps = (int)(4000000 / v.raw.size()) + 1;
+        const auto t0 = std::chrono::steady_clock::now();
+        uint32_t check = 0;
+        for (int rep = 0; rep < reps; rep++) {
+            LzDecoder dec(ring, RING);
+            const uint8_t *in = v.plz.data(), *end = in + v.plz.size();
+            REQUIRE(dec.open(in, end) == LzDecoder::Status::OK);
+            while (!dec.done()) check += dec.decode(in, end, line, sizeof(line));
+        }
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        CHECK(check == (uint32_t)reps * v.raw.size());
+        std::printf("throughput %-7s filter %d: %7.1f MB/s out (host)\n",
+                    v.name.c_str(), v.filter, reps * v.raw.size() / s / 1e6);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    REQUIRE(argc > 1);
+    const std::vector<Vector> vs = load(argv[1]);
+    REQUIRE(!vs.empty());
+
+    bool filters[3] = {};
+    for (const Vector &v : vs) if (v.filter >= 0 && v.filter < 3) filters[v.filter] = true;
+    CHECK(filters[0] && filters[1] && filters[2]);
+
+    testSplits(vs);
+    testTruncated(vs);
+    testCorrupted(vs);
+    testThroughput(vs);
+    return checkResult("test_asset_codec");
+}
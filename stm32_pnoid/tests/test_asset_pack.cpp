@@ -0,0 +1,449 @@
+/**
+ * @file    test_asset_pack.cpp
+ * @brief   AssetPack on the QSPI NOR model: lookup, replace, power cuts
+ *
+ * The pack is built by pack_vectors.py with scripts/asset_pack.py and laid
+ * into the modelled flash at ASSET_PACK_ADDR; the reader and the writer run
+ * unchanged on W25Qxx (async engine, mapped window) over qspi_nor.cpp.
+ *
+ *   lookup     every asset found with its bytes, type and CRC, the slot
+ *              walk matches the manifest; missing names are not found
+ *   directory  any single flipped byte in [0, dirSize) fails mount()
+ *   replace    a blob sharing its sectors and one spanning several: the
+ *              other assets keep their bytes and CRCs, the pack remounts
+ *   power cut  a cut at every erase / page program of a replace(): before
+ *              the sector-0 rewrite the old directory mounts, during it
+ *              mount() sees either a whole directory or fails — never a
+ *              torn one
+ *
+ *   test_asset_pack <vector dir>
+ */
+
+#include "w25qxx.hpp"
+#include "asset_pack.hpp"
+#include "qspi_nor.h"
+#include "check.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+extern "C" uint64_t TIME_Micros(void)
+{
+    return QspiNor::now();
+}
+
+namespace {
+
+constexpr uint32_t BASE   = 0;                  // ASSET_PACK_ADDR in app.cpp
+constexpr uint32_t REGION = 6 * 1024 * 1024;    // ASSET_PACK_SIZE
+constexpr uint32_t SECTOR = QspiNor::SECTOR;
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Source {
+    std::string name;
+    Bytes       data;
+};
+
+std::mt19937 rng(47);
+Bytes pack;
+std::vector<Source> sources;
+
+Bytes readFile(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    REQUIRE(f.good());
+    return Bytes(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void load(const std::string &dir)
+{
+    pack = readFile(dir + "/test.pak");
+    std::ifstream manifest(dir + "/manifest.txt");
+    REQUIRE(manifest.good());
+    std::string name;
+    while (std::getline(manifest, name))
+        if (!name.empty()) sources.push_back({ name, readFile(dir + "/assets/" + name) });
+}
+
+AssetPack::Type typeOf(const std::string &name)
+{
+    const std::string ext = name.substr(name.rfind('.'));
+    if (ext == ".rgb565") return AssetPack::Type::Sprite;
+    if (ext == ".pcm" || ext == ".wav") return AssetPack::Type::Sound;
+    if (ext == ".fnt") return AssetPack::Type::Font;
+    if (ext == ".clip") return AssetPack::Type::Clip;
+    return AssetPack::Type::Raw;
+}
+
+/** Driver objects rebuilt at every boot, like the firmware after a reset */
+struct Board {
+    QSPI_HandleTypeDef         h{};
+    uint8_t                   *mem = nullptr;
+    std::unique_ptr<W25Qxx>    flash;
+    std::unique_ptr<AssetPack> assets;
+
+    /** Blank chip with the pack installed */
+    void install()
+    {
+        mem = QspiNor::create(0xFF);
+        memcpy(mem + BASE, pack.data(), pack.size());
+    }
+
+    void boot()
+    {
+        assets.reset();
+        flash.reset();
+        QspiNor::powerCycle(h);
+        flash.reset(new W25Qxx(h));
+        flash->enableMemoryMapped();
+        assets.reset(new AssetPack(*flash, BASE, REGION));
+    }
+
+    void step()
+    {
+        QspiNor::run(50 + rng() % 300);
+        flash->service();
+        assets->service();
+    }
+
+    /** Until the update is on flash; false if it does not get there */
+    bool pump(uint32_t maxSteps = 20000)
+    {
+        for (uint32_t i = 0; i < maxSteps; i++) {
+            if (!assets->busy() && !flash->asyncBusy()) return true;
+            step();
+        }
+        return false;
+    }
+
+    /** Holds the mapping for a reader section */
+    void map()
+    {
+        for (int i = 0; i < 1000 && !flash->mmapAcquire(); i++) step();
+    }
+};
+
+/** Assets whose bytes and CRC equal `want` (by name); `skip` not checked */
+uint32_t intact(const Board &b, const std::vector<Source> &want, const std::set<std::string> &skip)
+{
+    uint32_t n = 0;
+    for (const Source &s : want) {
+        if (skip.count(s.name)) continue;
+        AssetPack::Asset a;
+        if (b.assets->find(s.name.c_str(), a) && a.size == s.data.size()
+                && memcmp(a.data, s.data.data(), a.size) == 0
+                && a.crc == AssetPack::crc32(0, s.data.data(), (uint32_t)s.data.size())
+                && b.assets->verify(a))
+            n++;
+    }
+    return n;
+}
+
+/* ---------- Lookup --------------------------------------------------------- */
+
+void testLookup()
+{
+    Board b;
+    b.install();
+    b.boot();
+
+    AssetPack::Asset a;
+    CHECK(!b.assets->find("clips/walk.clip", a));       // not mounted yet
+    REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+    CHECK(b.assets->count() == sources.size());
+    CHECK(b.assets->size() == pack.size());
+
+    b.map();
+    uint32_t found = 0, typed = 0;
+    for (const Source &s : sources) {
+        if (!b.assets->find(s.name.c_str(), a)) continue;
+        found++;
+        typed += a.type == typeOf(s.name) && a.flags == 0 ? 1 : 0;
+    }
+    CHECK(found == sources.size());
+    CHECK(typed == sources.size());
+    CHECK(intact(b, sources, {}) == sources.size());
+
+    /* Literal name: the hash folds at compile time */
+    constexpr uint32_t WALK = AssetPack::hash("clips/walk.clip");
+    static_assert(WALK != 0, "0 marks an empty slot");
+    CHECK(b.assets->find(WALK, "clips/walk.clip", a));
+    CHECK(((uintptr_t)a.data - W25Qxx::MMAP_BASE) % AssetPack::CACHE_LINE == 0);
+
+    /* Slot walk: the manifest once each, probes included */
+    std::set<std::string> walked;
+    uint32_t probed = 0;
+    for (uint32_t slot = 0; slot < b.assets->slots(); slot++) {
+        const char *name;
+        if (!b.assets->at(slot, a, &name)) continue;
+        walked.insert(name);
+        probed += (AssetPack::hash(name) & (b.assets->slots() - 1)) != slot ? 1 : 0;
+    }
+    CHECK(walked.size() == sources.size());
+    for (const Source &s : sources) CHECK(walked.count(s.name) == 1);
+    CHECK(!b.assets->at(b.assets->slots(), a));
+
+    /* Missing names: absent, a prefix, one character off, a neighbour's hash */
+    CHECK(!b.assets->find("missing.bin", a));
+    CHECK(!b.assets->find("", a));
+    CHECK(!b.assets->find("sprites/eye", a));
+    CHECK(!b.assets->find("sprites/eye_open.rgb566", a));
+    CHECK(!b.assets->find("Clips/walk.clip", a));
+    CHECK(!b.assets->find(WALK, "clips/wave.clip", a));
+    b.flash->mmapRelease();
+
+    std::printf("lookup: %u assets in %u slots, %u reached by probing, pack %u B\n",
+                (unsigned)found, (unsigned)b.assets->slots(), (unsigned)probed,
+                (unsigned)pack.size());
+}
+
+/* ---------- Directory damage ----------------------------------------------- */
+
+void testDirectoryFlips()
+{
+    Board b;
+    b.install();
+    b.boot();
+    REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+
+    AssetPack::Header hdr;
+    memcpy(&hdr, pack.data(), sizeof(hdr));
+    uint32_t mounted = 0;
+    for (uint32_t i = 0; i < hdr.dirSize; i++) {
+        const uint8_t flip = (uint8_t)(1u << (rng() % 8));
+        b.mem[BASE + i] ^= flip;
+        if (b.assets->mount() == AssetPack::Status::OK || b.assets->isMounted()
+                || b.assets->count() != 0) {
+            if (mounted++ < 10) std::printf("flip at %u mounted\n", (unsigned)i);
+        }
+        b.mem[BASE + i] ^= flip;
+    }
+    CHECK(mounted == 0);
+
+    /* Header magic: not a pack at all */
+    b.mem[BASE] ^= 0x80;
+    CHECK(b.assets->mount() == AssetPack::Status::ErrNoPack);
+    b.mem[BASE] ^= 0x80;
+
+    /* A blob byte is not the directory's business: verify() catches it */
+    REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+    b.map();
+    AssetPack::Asset a;
+    REQUIRE(b.assets->find("fonts/large.fnt", a));
+    b.mem[BASE + (a.data - reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE)) + 100] ^= 0x10;
+    CHECK(!b.assets->verify(a));
+    CHECK(intact(b, sources, { "fonts/large.fnt" }) == sources.size() - 1);
+    b.flash->mmapRelease();
+
+    std::printf("directory: %u single-byte flips, %u mounted\n", (unsigned)hdr.dirSize,
+                (unsigned)mounted);
+}
+
+/* ---------- Replace -------------------------------------------------------- */
+
+Bytes randomBytes(uint32_t n)
+{
+    Bytes v(n);
+    for (auto &x : v) x = (uint8_t)rng();
+    return v;
+}
+
+Source *source(std::vector<Source> &v, const char *name)
+{
+    for (Source &s : v)
+        if (s.name == name) return &s;
+    REQUIRE(false);
+    return nullptr;
+}
+
+/** Capacity of `name` from the directory; caller holds the mapping */
+uint32_t capacityOf(const Board &b, const char *name)
+{
+    AssetPack::Asset a;
+    REQUIRE(b.assets->find(name, a));
+    const AssetPack::Entry *tbl = reinterpret_cast<const AssetPack::Entry *>(
+        W25Qxx::MMAP_BASE + BASE + sizeof(AssetPack::Header));
+    return tbl[a.slot].capacity;
+}
+
+void testReplace()
+{
+    Board b;
+    b.install();
+    b.boot();
+    REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+    std::vector<Source> want = sources;
+
+    /* Small blob in a sector shared with its neighbours, then one over
+     * several sectors, then the small one again, shorter */
+    const struct { const char *name; int32_t grow; } STEPS[] = {
+        { "clips/wave.clip", 40 }, { "sounds/hello.wav", 4000 }, { "clips/wave.clip", -200 },
+        { "empty.bin", 0 },
+    };
+    for (const auto &st : STEPS) {
+        b.map();
+        const uint32_t cap = capacityOf(b, st.name);
+        b.flash->mmapRelease();
+
+        Source *s = source(want, st.name);
+        const Bytes next = randomBytes((uint32_t)((int32_t)s->data.size() + st.grow));
+        REQUIRE(next.size() <= cap);
+        const AssetPack::WriteStats ws = b.assets->writeStats();
+        CHECK(b.assets->replace(st.name, next.data(), (uint32_t)next.size()) == AssetPack::Status::OK);
+        CHECK(b.assets->replace(st.name, next.data(), (uint32_t)next.size()) == AssetPack::Status::ErrBusy);
+        CHECK(!b.assets->isMounted());
+        REQUIRE(b.pump());
+        CHECK(b.assets->lastResult() == AssetPack::Status::OK);
+        CHECK(b.assets->isMounted());
+        s->data = next;
+
+        b.map();
+        CHECK(intact(b, want, {}) == want.size());
+        b.flash->mmapRelease();
+        std::printf("replace %-17s %5u B: %u sectors, %u merged, %u ms\n", st.name,
+                    (unsigned)next.size(), (unsigned)(b.assets->writeStats().sectors - ws.sectors),
+                    (unsigned)(b.assets->writeStats().rmwSectors - ws.rmwSectors),
+                    (unsigned)b.assets->writeStats().lastMs);
+    }
+
+    /* Rejected before anything is written */
+    b.map();
+    const uint32_t cap = capacityOf(b, "clips/bow.clip");
+    b.flash->mmapRelease();
+    const Bytes big = randomBytes(cap + 1);
+    const uint32_t erases = QspiNor::stats().erases[0];
+    CHECK(b.assets->replace("clips/bow.clip", big.data(), cap + 1) == AssetPack::Status::ErrTooBig);
+    CHECK(b.assets->replace("clips/run.clip", big.data(), 4) == AssetPack::Status::ErrNotFound);
+    CHECK(!b.assets->busy());
+    CHECK(b.assets->isMounted());
+    CHECK(QspiNor::stats().erases[0] == erases);
+    CHECK(b.assets->writeStats().errors == 0);
+
+    /* The same directory after a reboot */
+    b.boot();
+    REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+    b.map();
+    CHECK(intact(b, want, {}) == want.size());
+    b.flash->mmapRelease();
+}
+
+/* ---------- Power cuts ----------------------------------------------------- */
+
+/**
+ * replace() of a multi-sector asset cut at every erase / page program in
+ * turn. Sector 0 is rewritten last, so a cut that left it untouched left the
+ * old directory (the blob may be torn, and its sector neighbours with it);
+ * a cut inside that rewrite may lose the directory, but mount() must then
+ * fail rather than accept a mix of the two.
+ */
+void testPowerCuts()
+{
+    const char *target = "fonts/large.fnt";
+    std::vector<Source> after = sources;
+    Source *s = source(after, target);
+    s->data = randomBytes((uint32_t)s->data.size() + 1000);
+
+    AssetPack::Header hdr;
+    memcpy(&hdr, pack.data(), sizeof(hdr));
+
+    /* Reference: the whole replace, uncut */
+    Board b;
+    b.install();
+    b.boot();
+    REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+    REQUIRE(b.assets->replace(target, s->data.data(), (uint32_t)s->data.size()) == AssetPack::Status::OK);
+    REQUIRE(b.pump());
+    REQUIRE(b.assets->lastResult() == AssetPack::Status::OK);
+    const Bytes newDir(b.mem + BASE, b.mem + BASE + hdr.dirSize);
+
+    /* Blob sectors of the target: neighbours in them may be torn by a cut */
+    std::set<std::string> shared;
+    {
+        b.map();
+        AssetPack::Asset a;
+        REQUIRE(b.assets->find(target, a));
+        const uint32_t off = (uint32_t)(a.data - reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE)) - BASE;
+        const uint32_t lo = off / SECTOR, hi = (off + a.size - 1) / SECTOR;
+        for (const Source &o : sources) {
+            AssetPack::Asset n;
+            REQUIRE(b.assets->find(o.name.c_str(), n));
+            const uint32_t p = (uint32_t)(n.data - reinterpret_cast<const uint8_t *>(W25Qxx::MMAP_BASE)) - BASE;
+            if (n.size && p / SECTOR <= hi && (p + n.size - 1) / SECTOR >= lo) shared.insert(o.name);
+        }
+        b.flash->mmapRelease();
+    }
+
+    uint32_t cuts = 0, before = 0, during = 0, lost = 0, torn = 0, damaged = 0;
+    for (int64_t k = 0; ; k++) {
+        b.install();
+        b.boot();
+        REQUIRE(b.assets->mount() == AssetPack::Status::OK);
+        bool cut = false;
+        QspiNor::cutAfter(k);
+        try {
+            REQUIRE(b.assets->replace(target, s->data.data(), (uint32_t)s->data.size())
+                    == AssetPack::Status::OK);
+            REQUIRE(b.pump());
+        } catch (const QspiNor::PowerCut &) {
+            cut = true;
+        }
+        QspiNor::cutAfter(-1);
+        if (!cut) break;
+        cuts++;
+
+        const bool dirTouched = memcmp(b.mem + BASE, pack.data(), SECTOR) != 0;
+        b.boot();
+        const AssetPack::Status st = b.assets->mount();
+        if (!dirTouched) {
+            before++;
+            CHECK(st == AssetPack::Status::OK);
+            if (st != AssetPack::Status::OK) continue;
+            b.map();
+            if (intact(b, sources, shared) != sources.size() - shared.size()) damaged++;
+            b.flash->mmapRelease();
+            continue;
+        }
+
+        during++;
+        if (st != AssetPack::Status::OK) {
+            CHECK(st == AssetPack::Status::ErrCorrupt || st == AssetPack::Status::ErrNoPack);
+            lost++;
+            continue;
+        }
+        /* Mounted: the directory is one of the two, and says so truthfully */
+        const bool isOld = memcmp(b.mem + BASE, pack.data(), hdr.dirSize) == 0;
+        const bool isNew = memcmp(b.mem + BASE, newDir.data(), hdr.dirSize) == 0;
+        if (!isOld && !isNew) torn++;
+        b.map();
+        if (isNew && intact(b, after, {}) != after.size()) damaged++;
+        b.flash->mmapRelease();
+    }
+    CHECK(torn == 0);
+    CHECK(damaged == 0);
+    CHECK(before > 0 && during > 0);
+    CHECK(during == 1 + SECTOR / 256);              // one erase, 16 page programs
+    std::printf("power cut: %u cut points, %u before the directory (old mounts), "
+                "%u in the sector-0 rewrite (%u unmountable, 0 torn)\n",
+                (unsigned)cuts, (unsigned)before, (unsigned)during, (unsigned)lost);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    REQUIRE(argc > 1);
+    load(argv[1]);
+    REQUIRE(!sources.empty() && pack.size() > sizeof(AssetPack::Header));
+
+    testLookup();
+    testDirectoryFlips();
+    testReplace();
+    testPowerCuts();
+    return checkResult("test_asset_pack");
+}
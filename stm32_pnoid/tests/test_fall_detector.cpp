@@ -0,0 +1,347 @@
+/**
+ * @file    test_fall_detector.cpp
+ * @brief   FallDetector replayed on IMU traces: falls, stance, walking
+ *
+ * Each trace is raw ICM-20948 output (accel in g, gyro in deg/s) at the
+ * loop's ~1.1 kHz data-ready rate, fed through the same complementary
+ * filter (tau 1 s) and IMU offset as App::run() (steps 2 and 3). The traces are
+ * generated here, deterministically, from a rigid inverted pendulum
+ * tipping over the foot edge (specific force at the IMU includes the
+ * tangential and centripetal terms, so the accelerometer tilt reads low
+ * while falling), with sensor noise and servo vibration on top:
+ *
+ *   fall forward / backward / left / right / diagonal  detection tick and
+ *                    latency from the first sample where the true state
+ *                    meets a trigger, before the true tilt reaches 45°
+ *   stance, walking, recoverable push                  no trigger
+ *   one-sample glitch vs two                           2-sample debounce
+ *   upright samples after a fall                       latch until clear()
+ */
+
+#include "fall_detector.hpp"
+#include "fast_math.hpp"
+#include "check.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+extern "C" void Error_Handler(void) { std::abort(); }
+
+namespace {
+
+constexpr float DT        = 1.0f / 1100.0f;     // ICM-20948 data-ready
+constexpr float G         = 9.81f;
+constexpr float COM_M     = 0.22f;              // pivot (foot edge) → COM
+constexpr float IMU_M     = 0.20f;              // pivot → IMU (torso board)
+constexpr float ROLL_BIAS  = -7.0f;             // Tuning defaults in app.cpp
+constexpr float PITCH_BIAS = -6.0f;
+constexpr float DEG        = 57.2958f;
+constexpr float FILTER_TAU = 1.0f;              // app.cpp complementary filter
+
+std::mt19937 rng(27);
+std::normal_distribution<float> gauss(0.0f, 1.0f);
+
+struct ImuSample {
+    float ax, ay, az;       // g
+    float gx, gy;           // deg/s (roll, pitch axes)
+    float trueTilt;         // deg, |(roll, pitch)| of the body
+    float trueRate;         // deg/s, outward
+};
+
+typedef std::vector<ImuSample> Trace;
+
+/**
+ * Body tilted by (roll, pitch) rad with angular rate / acceleration along
+ * the same direction; specific force at the IMU in the body frame.
+ * Conventions as the filter in App::run(): roll = atan2(ay, az),
+ * pitch = atan2(-ax, sqrt(ay² + az²)), gyro.x / gyro.y = d(roll) / d(pitch).
+ */
+ImuSample sense(float roll, float pitch, float rollRate, float pitchRate,
+                float rollAcc, float pitchAcc, float vibration)
+{
+    ImuSample s;
+    const float cr = std::cos(roll), sr = std::sin(roll);
+    const float cp = std::cos(pitch), sp = std::sin(pitch);
+
+    /* Gravity reaction (+1 g up) in the body frame */
+    float fx = -sp;
+    float fy = sr * cp;
+    float fz = cr * cp;
+
+    /* IMU on a rod from the pivot: tangential r·α, centripetal r·ω² */
+    const float w2 = rollRate * rollRate + pitchRate * pitchRate;
+    fx += IMU_M * pitchAcc / G;
+    fy -= IMU_M * rollAcc / G;
+    fz -= IMU_M * w2 / G;
+
+    s.ax = fx + 0.004f * gauss(rng) + vibration * gauss(rng);
+    s.ay = fy + 0.004f * gauss(rng) + vibration * gauss(rng);
+    s.az = fz + 0.004f * gauss(rng) + vibration * gauss(rng);
+    s.gx = rollRate * DEG + 0.2f * gauss(rng);
+    s.gy = pitchRate * DEG + 0.2f * gauss(rng);
+
+    const float t = std::sqrt(roll * roll + pitch * pitch);
+    s.trueTilt = t * DEG;
+    s.trueRate = t > 1e-6f ? (roll * rollRate + pitch * pitchRate) / t * DEG : 0.0f;
+    return s;
+}
+
+/** Quiet stance: slow sway around upright */
+void stance(Trace &tr, float seconds, float swayDeg = 0.8f)
+{
+    const int n = (int)(seconds / DT);
+    for (int i = 0; i < n; i++) {
+        const float t  = (float)tr.size() * DT;
+        const float w  = 2.0f * (float)M_PI * 0.7f;
+        const float r  = swayDeg / DEG * std::sin(w * t);
+        const float p  = 0.6f * swayDeg / DEG * std::sin(0.8f * w * t + 1.0f);
+        const float rr = swayDeg / DEG * w * std::cos(w * t);
+        const float pr = 0.6f * swayDeg / DEG * 0.8f * w * std::cos(0.8f * w * t + 1.0f);
+        tr.push_back(sense(r, p, rr, pr, 0.0f, 0.0f, 0.01f));
+    }
+}
+
+/**
+ * Pendulum fall along direction `dirDeg` (0 = forward pitch, 90 = roll
+ * right) from `startDeg` with `startRate` deg/s, until the body hits the
+ * ground at 80°: impact spike, then lying still
+ */
+void fall(Trace &tr, float dirDeg, float startDeg, float startRate)
+{
+    const float c = std::cos(dirDeg / DEG), s = std::sin(dirDeg / DEG);
+    float th = startDeg / DEG, w = startRate / DEG;
+    while (th < 80.0f / DEG) {
+        const float a = G / COM_M * std::sin(th);
+        w  += a * DT;
+        th += w * DT;
+        tr.push_back(sense(s * th, c * th, s * w, c * w, s * a, c * a, 0.02f));
+    }
+    for (int i = 0; i < 6; i++) {               // impact: 3..5 g for ~5 ms
+        ImuSample k = sense(s * th, c * th, 0, 0, 0, 0, 1.5f);
+        k.az += 3.0f;
+        tr.push_back(k);
+    }
+    for (int i = 0; i < 300; i++) tr.push_back(sense(s * th, c * th, 0, 0, 0, 0, 0.005f));
+}
+
+/** Gait: lateral sway with the step rhythm, foot-strike shocks, pitch bob */
+void walking(Trace &tr, float seconds)
+{
+    const int n = (int)(seconds / DT);
+    const float f = 1.0f;                       // stride frequency (two steps)
+    const float rollAmp = 8.0f / DEG, pitchAmp = 4.0f / DEG;
+    for (int i = 0; i < n; i++) {
+        const float t  = (float)i * DT;
+        const float w  = 2.0f * (float)M_PI * f;
+        const float r  = rollAmp * std::sin(w * t);
+        const float p  = pitchAmp * std::sin(2.0f * w * t);
+        const float rr = rollAmp * w * std::cos(w * t);
+        const float pr = pitchAmp * 2.0f * w * std::cos(2.0f * w * t);
+        const float ra = -rollAmp * w * w * std::sin(w * t);
+        const float pa = -pitchAmp * 4.0f * w * w * std::sin(2.0f * w * t);
+        ImuSample k = sense(r, p, rr, pr, ra, pa, 0.03f);
+
+        /* Foot strike twice per stride: 30 ms of 0.7 g dip then 1.6 g */
+        const float ph = std::fmod(2.0f * f * t, 1.0f);
+        if (ph < 0.015f)      k.az -= 0.3f;
+        else if (ph < 0.03f)  k.az += 0.6f;
+        tr.push_back(k);
+    }
+}
+
+/** Shove that the stabiliser catches: up to `peakDeg` at `peakRate`, back */
+void push(Trace &tr, float dirDeg, float peakDeg, float seconds)
+{
+    const float c = std::cos(dirDeg / DEG), s = std::sin(dirDeg / DEG);
+    const int n = (int)(seconds / DT);
+    for (int i = 0; i < n; i++) {
+        const float t  = (float)i / (float)n;
+        const float w  = (float)M_PI / seconds;
+        const float th = peakDeg / DEG * std::sin((float)M_PI * t);
+        const float om = peakDeg / DEG * w * std::cos((float)M_PI * t);
+        const float al = -peakDeg / DEG * w * w * std::sin((float)M_PI * t);
+        tr.push_back(sense(s * th, c * th, s * om, c * om, s * al, c * al, 0.02f));
+    }
+}
+
+/* ---------- Replay: App::run() steps 2 and 3 -------------------------------- */
+
+struct Replay {
+    FallDetector det;
+    float estRoll  = ROLL_BIAS;                 // filter settled on the stance
+    float estPitch = PITCH_BIAS;
+    int   firstTrigger = -1;                    // first sample the true state meets a trigger
+    int   detectedAt   = -1;
+    float tiltAtDetect = 0.0f;
+
+    /** Feed one sample; the IMU is mounted with the tuning bias */
+    bool step(const ImuSample &raw, int index)
+    {
+        ImuSample s = raw;
+        const float br = ROLL_BIAS / DEG, bp = PITCH_BIAS / DEG;
+        /* Mounting bias: rotate the specific force by the fixed offset (small angles) */
+        const float ax = s.ax * std::cos(bp) - s.az * std::sin(bp);
+        const float az = s.ax * std::sin(bp) + s.az * std::cos(bp);
+        const float ay = s.ay * std::cos(br) + az * std::sin(br);
+        const float az2 = -s.ay * std::sin(br) + az * std::cos(br);
+
+        const float accelRoll  = FastMath::atan2(ay, az2) * DEG;
+        const float accelPitch = FastMath::atan2(-ax, FastMath::sqrt(ay * ay + az2 * az2)) * DEG;
+        const float alpha = FILTER_TAU / (FILTER_TAU + DT);
+        estRoll  = alpha * (estRoll  + s.gx * DT) + (1.0f - alpha) * accelRoll;
+        estPitch = alpha * (estPitch + s.gy * DT) + (1.0f - alpha) * accelPitch;
+
+        const FallDetector::Config &c = det.config();
+        if (firstTrigger < 0 && (s.trueTilt > c.tiltMaxDeg
+                || (s.trueTilt > c.tiltWarnDeg && s.trueRate > c.tiltRateMaxDps)))
+            firstTrigger = index;
+
+        const float mag = FastMath::sqrt(ax * ax + ay * ay + az2 * az2);
+        if (det.update(estRoll - ROLL_BIAS, estPitch - PITCH_BIAS, s.gx, s.gy, mag)) {
+            detectedAt   = index;
+            tiltAtDetect = s.trueTilt;
+            return true;
+        }
+        return false;
+    }
+
+    /** Every sample; number of rising edges of update() */
+    int run(const Trace &tr, size_t from = 0)
+    {
+        int edges = 0;
+        for (size_t i = from; i < tr.size(); i++) edges += step(tr[i], (int)i) ? 1 : 0;
+        return edges;
+    }
+};
+
+float ms(int samples) { return (float)samples * DT * 1000.0f; }
+
+/* ---------- Falls ------------------------------------------------------------ */
+
+void testFalls()
+{
+    static const struct { const char *name; float dir; float start; float rate; } FALLS[] = {
+        { "forward",         0.0f, 3.0f,  5.0f },
+        { "backward",      180.0f, 3.0f,  5.0f },
+        { "left",          -90.0f, 4.0f,  0.0f },
+        { "right",          90.0f, 4.0f,  0.0f },
+        { "diagonal",       45.0f, 2.0f, 20.0f },
+        { "shoved forward",  0.0f, 8.0f, 90.0f },
+    };
+    for (const auto &f : FALLS) {
+        Trace tr;
+        stance(tr, 2.0f, 0.2f);
+        const size_t onset = tr.size();
+        fall(tr, f.dir, f.start, f.rate);
+
+        Replay r;
+        const int edges = r.run(tr);
+        CHECK(edges == 1);
+        CHECK(r.detectedAt >= (int)onset);
+        CHECK(r.firstTrigger >= 0);
+        const int latency = r.detectedAt - r.firstTrigger;
+        std::printf("fall %-14s detected %s at %6.1f ms after onset, true tilt %4.1f deg, "
+                    "latency %4.1f ms (%d samples)\n",
+                    f.name, FallDetector::reasonName(r.det.reason()),
+                    ms(r.detectedAt - (int)onset), r.tiltAtDetect, ms(latency), latency);
+        CHECK(r.tiltAtDetect < 35.0f);          // long before the ground (80°)
+        CHECK(latency >= 1);                    // debounce: never on the first sample
+        CHECK(ms(latency) <= 60.0f);            // filter lag: accel is blind while falling
+    }
+}
+
+/* ---------- No false triggers ---------------------------------------------- */
+
+void testQuiet()
+{
+    Trace tr;
+    stance(tr, 20.0f);
+    Replay r;
+    CHECK(r.run(tr) == 0);
+
+    Trace wk;
+    stance(wk, 1.0f);
+    walking(wk, 20.0f);
+    stance(wk, 1.0f);
+    Replay w;
+    CHECK(w.run(wk) == 0);
+
+    /* Shoves the stabiliser catches: below the warning tilt, fast */
+    Trace sh;
+    stance(sh, 1.0f);
+    for (float dir : { 0.0f, 90.0f, 180.0f, -90.0f }) {
+        push(sh, dir, 15.0f, 0.6f);
+        stance(sh, 1.0f);
+    }
+    Replay p;
+    CHECK(p.run(sh) == 0);
+
+    std::printf("quiet: 20 s stance, 20 s walking, 4 shoves to 15 deg: %d / %d / %d triggers\n",
+                r.detectedAt >= 0, w.detectedAt >= 0, p.detectedAt >= 0);
+}
+
+/* ---------- Debounce and latch ------------------------------------------- */
+
+void testDebounceLatch()
+{
+    FallDetector d;
+
+    /* One sample under free-fall g (glitch / foot strike): nothing */
+    for (int i = 0; i < 50; i++) CHECK(!d.update(0.5f, -0.3f, 1.0f, 0.0f, 1.0f));
+    CHECK(!d.update(0.5f, -0.3f, 1.0f, 0.0f, 0.2f));
+    for (int i = 0; i < 50; i++) CHECK(!d.update(0.5f, -0.3f, 1.0f, 0.0f, 1.0f));
+    CHECK(!d.isFallen());
+
+    /* Non-consecutive over-tilt samples reset the count */
+    for (int i = 0; i < 20; i++) {
+        CHECK(!d.update(45.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+        CHECK(!d.update(1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    }
+    CHECK(!d.isFallen());
+
+    /* Two in a row: confirmed on the second, reason of the first */
+    CHECK(!d.update(0.0f, 0.0f, 0.0f, 0.0f, 0.3f));
+    CHECK(d.update(45.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    CHECK(d.isFallen());
+    CHECK(d.reason() == FallDetector::Reason::FreeFall);
+
+    /* Latched: upright samples and more falls report nothing */
+    for (int i = 0; i < 100; i++) CHECK(!d.update(0.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    CHECK(!d.update(60.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    CHECK(!d.update(60.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    CHECK(d.isFallen());
+    CHECK(d.reason() == FallDetector::Reason::FreeFall);
+
+    /* clear() re-arms, the count starts over */
+    d.clear();
+    CHECK(!d.isFallen());
+    CHECK(d.reason() == FallDetector::Reason::None);
+    CHECK(!d.update(25.0f, 0.0f, 200.0f, 0.0f, 1.0f));
+    CHECK(d.update(26.0f, 0.0f, 200.0f, 0.0f, 1.0f));
+    CHECK(d.reason() == FallDetector::Reason::TiltRate);
+
+    /* A replayed fall after clear() is detected again */
+    Trace tr;
+    stance(tr, 1.0f, 0.2f);
+    fall(tr, 0.0f, 3.0f, 5.0f);
+    Replay r;
+    CHECK(r.run(tr) == 1);
+    r.det.clear();
+    r.firstTrigger = r.detectedAt = -1;
+    const size_t again = tr.size();
+    stance(tr, 1.0f, 0.2f);
+    fall(tr, 180.0f, 3.0f, 5.0f);
+    r.estRoll  = ROLL_BIAS;                     // initFilter() after get-up
+    r.estPitch = PITCH_BIAS;
+    CHECK(r.run(tr, again) == 1);
+}
+
+} // namespace
+
+int main()
+{
+    testFalls();
+    testQuiet();
+    testDebounceLatch();
+    return checkResult("test_fall_detector");
+}
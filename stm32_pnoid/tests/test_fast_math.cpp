@@ -0,0 +1,122 @@
+/**
+ * @file    test_fast_math.cpp
+ * @brief   FastMath against double-precision libm, bounds from fast_math.hpp
+ */
+
+#include "fast_math.hpp"
+#include "check.hpp"
+#include <cmath>
+#include <initializer_list>
+
+extern "C" void Error_Handler(void) { std::abort(); }
+
+namespace {
+
+/** Max |fast(x) - ref(x)| over [lo, hi], x stepped in float */
+template <typename Fast, typename Ref>
+double maxAbsErr(double lo, double hi, double step, Fast fast, Ref ref)
+{
+    double e = 0;
+    for (double x = lo; x <= hi; x += step) {
+        float xf = (float)x;
+        e = std::fmax(e, std::fabs((double)fast(xf) - ref((double)xf)));
+    }
+    return e;
+}
+
+void testSinCos()
+{
+    /* One turn either side: table bound */
+    double es = maxAbsErr(-2 * M_PI, 2 * M_PI, 7.31e-5,
+                          [](float x) { return FastMath::sin(x); },
+                          [](double x) { return std::sin(x); });
+    double ec = maxAbsErr(-2 * M_PI, 2 * M_PI, 7.31e-5,
+                          [](float x) { return FastMath::cos(x); },
+                          [](double x) { return std::cos(x); });
+    std::printf("sin %.3g cos %.3g (|x| <= 2pi)\n", es, ec);
+    CHECK(es <= FastMath::SIN_MAX_ERR);
+    CHECK(ec <= FastMath::SIN_MAX_ERR);
+
+    /* Long phases: the float argument loses fraction bits (1e-5 row) */
+    double el = maxAbsErr(-100.0, 100.0, 7.31e-4,
+                          [](float x) { return FastMath::sin(x); },
+                          [](double x) { return std::sin(x); });
+    std::printf("sin %.3g (|x| <= 100)\n", el);
+    CHECK(el <= 1e-5);
+
+    /* sincos is the same evaluation as sin / cos */
+    for (float x = -7.0f; x <= 7.0f; x += 0.01f) {
+        float s, c;
+        FastMath::sincos(x, s, c);
+        CHECK(s == FastMath::sin(x));
+        CHECK(c == FastMath::cos(x));
+    }
+
+    CHECK(FastMath::sin(0.0f) == 0.0f);
+    CHECK(FastMath::cos(0.0f) == 1.0f);
+}
+
+void testAtan()
+{
+    double ea = maxAbsErr(-100.0, 100.0, 1e-4,
+                          [](float x) { return FastMath::atan(x); },
+                          [](double x) { return std::atan(x); });
+    std::printf("atan %.3g\n", ea);
+    CHECK(ea <= FastMath::ATAN_MAX_ERR);
+
+    /* atan2 on three radii, every quadrant */
+    double e2 = 0;
+    for (double a = -M_PI + 1e-4; a < M_PI; a += 3e-4) {
+        for (double r : {1e-3, 1.0, 1e3}) {
+            float y = (float)(r * std::sin(a)), x = (float)(r * std::cos(a));
+            e2 = std::fmax(e2, std::fabs(FastMath::atan2(y, x) - std::atan2((double)y, (double)x)));
+        }
+    }
+    std::printf("atan2 %.3g\n", e2);
+    CHECK(e2 <= FastMath::ATAN_MAX_ERR);
+
+    /* Axes */
+    CHECK(FastMath::atan2(0.0f, 1.0f) == 0.0f);
+    CHECK(std::fabs(FastMath::atan2(1.0f, 0.0f) - FastMath::HALF_PI) <= FastMath::ATAN_MAX_ERR);
+    CHECK(std::fabs(FastMath::atan2(-1.0f, 0.0f) + FastMath::HALF_PI) <= FastMath::ATAN_MAX_ERR);
+    CHECK(std::fabs(std::fabs(FastMath::atan2(0.0f, -1.0f)) - FastMath::PI) <= FastMath::ATAN_MAX_ERR);
+}
+
+void testAcosAsin()
+{
+    double ec = maxAbsErr(-1.0, 1.0, 1e-6,
+                          [](float x) { return FastMath::acos(x); },
+                          [](double x) { return std::acos(x); });
+    double es = maxAbsErr(-1.0, 1.0, 1e-6,
+                          [](float x) { return FastMath::asin(x); },
+                          [](double x) { return std::asin(x); });
+    std::printf("acos %.3g asin %.3g\n", ec, es);
+    CHECK(ec <= FastMath::ACOS_MAX_ERR);
+    CHECK(es <= FastMath::ACOS_MAX_ERR);
+}
+
+void testRsqrt()
+{
+    double er = 0;
+    for (double x = 1e-6; x < 1e6; x *= 1.0001) {
+        double ref = 1.0 / std::sqrt((double)(float)x);
+        er = std::fmax(er, std::fabs(FastMath::rsqrt((float)x) - ref) / ref);
+    }
+    std::printf("rsqrt rel %.3g\n", er);
+    CHECK(er <= FastMath::RSQRT_REL_ERR);
+
+    for (float x : {0.0f, 1.0f, 2.0f, 1e-3f, 12345.0f}) {
+        CHECK(FastMath::sqrt(x) == std::sqrt(x));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testSinCos();
+    testAtan();
+    testAcosAsin();
+    testRsqrt();
+    return checkResult("test_fast_math");
+}
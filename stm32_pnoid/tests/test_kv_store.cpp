@@ -0,0 +1,285 @@
+/**
+ * @file    test_kv_store.cpp
+ * @brief   KvStore on the QSPI NOR model: round trip, compaction, power cuts
+ *
+ * The store runs unchanged on W25Qxx (async engine, mapped reads) over
+ * qspi_nor.cpp. Region size is checked first (below MIN_SECTORS is
+ * rejected before anything is erased), then a churn of sets at the
+ * smallest region must keep compacting without stalling, and finally
+ * random power cuts mid-erase / mid-program: after every reboot each key
+ * holds its last durable value or one set after it, never anything else.
+ *
+ *   test_kv_store [cuts]      default 500 power-cut cycles
+ */
+
+#include "w25qxx.hpp"
+#include "kv_store.hpp"
+#include "qspi_nor.h"
+#include "check.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" uint64_t TIME_Micros(void)
+{
+    return QspiNor::now();
+}
+
+namespace {
+
+constexpr uint32_t BASE = 0x600000;     // KV_ADDR in app.cpp
+
+typedef std::map<std::string, std::vector<uint8_t>> Model;
+
+std::mt19937 rng(7);
+
+/** Driver objects rebuilt at every boot, like the firmware after a reset */
+struct Board {
+    QSPI_HandleTypeDef      h{};
+    std::unique_ptr<W25Qxx> flash;
+    std::unique_ptr<KvStore> kv;
+
+    void boot(uint32_t sectors)
+    {
+        kv.reset();
+        flash.reset();
+        QspiNor::powerCycle(h);
+        flash.reset(new W25Qxx(h));
+        flash->enableMemoryMapped();
+        kv.reset(new KvStore(*flash, BASE, sectors));
+    }
+
+    void step()
+    {
+        QspiNor::run(50 + rng() % 300);
+        flash->service();
+        kv->service();
+    }
+
+    /** Until everything is on flash; false if it does not get there */
+    bool pump(uint32_t maxSteps = 20000)
+    {
+        for (uint32_t i = 0; i < maxSteps; i++) {
+            if (!kv->busy() && !flash->asyncBusy()) return true;
+            step();
+        }
+        return false;
+    }
+};
+
+Model snapshot(const KvStore &kv)
+{
+    Model m;
+    for (uint32_t i = 0; i < KvStore::MAX_KEYS; i++) {
+        const char *k;
+        const uint8_t *v;
+        uint32_t n;
+        if (kv.at(i, k, v, n)) m[k] = std::vector<uint8_t>(v, v + n);
+    }
+    return m;
+}
+
+std::vector<uint8_t> randomValue(uint32_t maxLen)
+{
+    std::vector<uint8_t> v(1 + rng() % maxLen);
+    for (auto &b : v) b = (uint8_t)rng();
+    return v;
+}
+
+uint32_t regionErases(uint32_t sectors)
+{
+    uint32_t n = 0;
+    for (uint32_t s = 0; s < sectors; s++) n += QspiNor::stats().erases[BASE / QspiNor::SECTOR + s];
+    return n;
+}
+
+/* ---------- Region size ---------------------------------------------------- */
+
+void testRegionSize()
+{
+    QspiNor::create(0xFF);
+    Board b;
+    const float v = 1.5f;
+
+    b.boot(KvStore::MIN_SECTORS - 1);
+    CHECK(b.kv->load() == KvStore::Status::ErrParam);
+    CHECK(b.kv->set("imu.roll", v) == KvStore::Status::ErrParam);
+    for (int i = 0; i < 100; i++) b.step();
+    CHECK(regionErases(KvStore::MIN_SECTORS) == 0);
+
+    b.boot(KvStore::MIN_SECTORS);
+    CHECK(b.kv->load() == KvStore::Status::OK);
+    CHECK(b.kv->set("imu.roll", v) == KvStore::Status::OK);
+    CHECK(b.pump());
+    CHECK(regionErases(KvStore::MIN_SECTORS) == 1);
+}
+
+/* ---------- Round trip ----------------------------------------------------- */
+
+void testRoundTrip()
+{
+    QspiNor::create(0xA5);          // never formatted
+    Board b;
+    b.boot(16);
+    REQUIRE(b.kv->load() == KvStore::Status::OK);
+    CHECK(b.kv->count() == 0);
+
+    CHECK(b.kv->set("imu.roll", -7.0f) == KvStore::Status::OK);
+    CHECK(b.kv->set("trim.L3", (int16_t)-12) == KvStore::Status::OK);
+    CHECK(b.kv->set("gain.kp_roll", 2.5f) == KvStore::Status::OK);
+    CHECK(b.kv->remove("gain.kp_roll") == KvStore::Status::OK);
+    CHECK(b.kv->set("imu.roll", -6.5f) == KvStore::Status::OK);
+    CHECK(b.pump());
+
+    b.boot(16);
+    REQUIRE(b.kv->load() == KvStore::Status::OK);
+    CHECK(b.kv->count() == 2);
+    CHECK(b.kv->get("imu.roll", 0.0f) == -6.5f);
+    CHECK(b.kv->get("trim.L3", (int16_t)0) == -12);
+    CHECK(b.kv->get("gain.kp_roll", 9.0f) == 9.0f);
+    CHECK(b.kv->loadStats().bad == 0);
+}
+
+/* ---------- Compaction at the smallest region ------------------------------ */
+
+/** Full key table, longest records: the ring wraps many times and must not stall */
+void testChurn()
+{
+    QspiNor::create(0xFF);
+    Board b;
+    const uint32_t sectors = KvStore::MIN_SECTORS;
+    b.boot(sectors);
+    REQUIRE(b.kv->load() == KvStore::Status::OK);
+
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < KvStore::MAX_KEYS; i++) {
+        char k[KvStore::MAX_KEY + 1];
+        snprintf(k, sizeof(k), "cal.%011u", (unsigned)i);
+        keys.push_back(k);
+    }
+
+    Model want;
+    uint32_t stalls = 0;
+    for (int round = 0; round < 60; round++) {
+        for (int n = 0; n < 50; n++) {
+            const std::string &k = keys[rng() % keys.size()];
+            auto v = randomValue(KvStore::MAX_VALUE);
+            REQUIRE(b.kv->set(k.c_str(), v.data(), (uint32_t)v.size()) == KvStore::Status::OK);
+            want[k] = v;
+            for (int s = rng() % 3; s > 0; s--) b.step();
+        }
+        if (!b.pump()) stalls++;
+    }
+    const KvStore::WriteStats ws = b.kv->writeStats();
+    CHECK(stalls == 0);
+    CHECK(ws.errors == 0);
+
+    b.boot(sectors);
+    REQUIRE(b.kv->load() == KvStore::Status::OK);
+    CHECK(snapshot(*b.kv) == want);
+    CHECK(b.kv->loadStats().sectors <= KvStore::LIVE_SECTORS + 1);
+
+    uint32_t lo = ~0u, hi = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        uint32_t e = QspiNor::stats().erases[BASE / QspiNor::SECTOR + s];
+        lo = std::min(lo, e);
+        hi = std::max(hi, e);
+    }
+    CHECK(lo > 0 && hi - lo <= 1);      // the window walks the whole ring
+    std::printf("churn: %u sectors opened, %u records copied, erases %u..%u per sector\n",
+                (unsigned)ws.opened, (unsigned)ws.copied,
+                (unsigned)lo, (unsigned)hi);
+}
+
+/* ---------- Power cuts ----------------------------------------------------- */
+
+void testPowerCuts(int cycles)
+{
+    QspiNor::create(0xA5);
+    Board b;
+    const uint32_t sectors = 16;
+    b.boot(sectors);
+    b.kv->load();
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 14; i++)
+        keys.push_back(std::string("trim.") + (i < 6 ? "L" : i < 12 ? "R" : "T") + std::to_string(i % 6));
+    for (const char *k : { "imu.roll", "imu.pitch", "gain.kp_pitch", "gain.kd_pitch",
+                           "gain.kp_roll", "gain.kd_roll" })
+        keys.push_back(k);
+    for (int i = 0; keys.size() < 40; i++) keys.push_back("cal.x" + std::to_string(i));
+
+    /* Values set since the last point where busy() was false; {} = removed */
+    Model durable;
+    std::map<std::string, std::vector<std::vector<uint8_t>>> since;
+    auto allowed = [&](const std::string &k, const std::vector<uint8_t> *got) {
+        auto d = durable.find(k);
+        if (got ? (d != durable.end() && d->second == *got) : d == durable.end()) return true;
+        for (const auto &v : since[k]) {
+            if (got ? v == *got : v.empty()) return true;
+        }
+        return false;
+    };
+
+    uint32_t cuts = 0, wrong = 0, bad = 0;
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        QspiNor::cutAfter(rng() % (cycle % 4 == 0 ? 3000 : 60));   // some cycles run out
+        try {
+            for (int op = 0; op < 400; op++) {
+                const std::string &k = keys[rng() % keys.size()];
+                uint32_t r = rng() % 100;
+                if (r < 80) {
+                    auto v = randomValue(KvStore::MAX_VALUE);
+                    if (b.kv->set(k.c_str(), v.data(), (uint32_t)v.size()) == KvStore::Status::OK)
+                        since[k].push_back(v);
+                } else if (r < 90) {
+                    if (b.kv->remove(k.c_str()) == KvStore::Status::OK) since[k].push_back({});
+                } else {
+                    REQUIRE(b.pump());
+                    durable = snapshot(*b.kv);
+                    since.clear();
+                }
+                for (int s = rng() % 4; s > 0; s--) b.step();
+            }
+            REQUIRE(b.pump());
+        } catch (const QspiNor::PowerCut &) {
+            cuts++;
+        }
+        QspiNor::cutAfter(-1);
+
+        b.boot(sectors);
+        CHECK(b.kv->load() == KvStore::Status::OK);
+        bad += b.kv->loadStats().bad;
+        CHECK(b.kv->loadStats().sectors <= KvStore::LIVE_SECTORS + 2);
+
+        Model got = snapshot(*b.kv);
+        for (const auto &k : keys) {
+            auto g = got.find(k);
+            if (!allowed(k, g == got.end() ? nullptr : &g->second)) {
+                if (wrong++ < 10) std::printf("cycle %d: key %s %s\n", cycle, k.c_str(),
+                                              g == got.end() ? "missing" : "wrong value");
+            }
+        }
+        durable = got;
+        since.clear();
+    }
+    CHECK(wrong == 0);
+    CHECK(cuts > (uint32_t)cycles / 2 && cuts < (uint32_t)cycles);
+    CHECK(QspiNor::stats().unsafeMaps == 0);
+    std::printf("power cuts: %d cycles, %u cut mid-write, %u bad records skipped, %u wrong keys\n",
+                cycles, (unsigned)cuts, (unsigned)bad, (unsigned)wrong);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    testRegionSize();
+    testRoundTrip();
+    testChurn();
+    testPowerCuts(argc > 1 ? atoi(argv[1]) : 500);
+    return checkResult("test_kv_store");
+}
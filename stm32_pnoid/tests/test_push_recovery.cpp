@@ -0,0 +1,267 @@
+/**
+ * @file    test_push_recovery.cpp
+ * @brief   PushRecovery + LegIK against a LIPM plant: largest recoverable push
+ *
+ * Plant: linear inverted pendulum at the CoM height PushRecovery assumes,
+ * state (c, ċ) about the stance centre, c̈ = ω²(c − p). The centre of
+ * pressure p is the ankle strategy: it drives the capture point towards the
+ * middle of the current support polygon, saturated at its edge (double
+ * support: bounding box of both feet; swing: the support foot only). The
+ * swing foot lands where the swing joint angles put it — applySwing() on
+ * the stance pose, then LegIK::forward() — so the IK and the int16 degree
+ * rounding of the servo command are in the loop.
+ *
+ * Each direction gets impulse pushes (Δċ, mm/s) on a grid at the 1.1 kHz
+ * loop rate; the robot has fallen when the tilt passes 30° within 2 s.
+ * Reported per direction: the largest push held by the ankles alone, the
+ * largest push recovered with the reflex, the pushes beyond the ankle
+ * limit the reflex saves, the decision latency (the plant's capture point
+ * leaving the stance polygon by marginMm → StepStarted) and the landing
+ * error. Run for the default Config and for a fast swing.
+ */
+
+#include "push_recovery.hpp"
+#include "leg_ik.hpp"
+#include "check.hpp"
+#include <cmath>
+#include <initializer_list>
+
+extern "C" void Error_Handler(void) { std::abort(); }
+
+namespace {
+
+constexpr float DT       = 1.0f / 1100.0f;      // IMU data-ready loop
+constexpr float G_MM     = 9810.0f;
+constexpr float DEG      = 57.2958f;
+constexpr float FALL_DEG = 30.0f;
+constexpr float RUN_S    = 2.0f;
+constexpr float DV_STEP  = 10.0f;               // mm/s, push grid
+constexpr float DV_MAX   = 800.0f;
+
+struct V2 { float x, y; };
+
+/** Axis-aligned support polygon (PushRecovery's model of it) */
+struct Box {
+    float x0, x1, y0, y1;
+    V2 clamp(V2 p) const {
+        return { std::fmin(std::fmax(p.x, x0), x1), std::fmin(std::fmax(p.y, y0), y1) };
+    }
+    V2 centre() const { return { (x0 + x1) * 0.5f, (y0 + y1) * 0.5f }; }
+    bool contains(V2 p) const { return p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1; }
+};
+
+/** Stance pose as App::run() builds it (bent-knee base pose) */
+Pose basePose()
+{
+    Pose p;
+    for (int16_t *leg : { p.leftLeg, p.rightLeg }) {
+        leg[Leg::HipRoll]    = 5;
+        leg[Leg::HipPitch]   = 12;
+        leg[Leg::KneePitch]  = 20;
+        leg[Leg::AnklePitch] = 10;
+    }
+    return p;
+}
+
+struct Result {
+    bool  recovered;
+    bool  stepped;
+    int   decision;         // samples, ξ out of the stance polygon → StepStarted
+    float landErrMm;        // FK of the landed pose vs. the planned offset
+};
+
+class Sim {
+public:
+    explicit Sim(const PushRecovery::Config &cfg) : cfg_(cfg)
+    {
+        ik_.configure(LegIK::Geometry());
+        rec_.configure(cfg, ik_);
+        stance_ = basePose();
+        rec_.setStance(stance_);
+
+        LegIK::Vec3 l = ik_.forward(LegIK::Side::Left,  stance_.leftLeg);
+        LegIK::Vec3 r = ik_.forward(LegIK::Side::Right, stance_.rightLeg);
+        centre_  = { (l.x + r.x) * 0.5f, (l.y + r.y) * 0.5f };
+        home_[0] = { l.x - centre_.x, l.y - centre_.y };
+        home_[1] = { r.x - centre_.x, r.y - centre_.y };
+        halfX_   = cfg.footLength * 0.5f + std::fabs(home_[0].x - home_[1].x) * 0.5f;
+        halfY_   = cfg.footWidth  * 0.5f + std::fabs(home_[0].y - home_[1].y) * 0.5f;
+        omega_   = std::sqrt(G_MM / cfg.comHeightMm);
+    }
+
+    /** One push from quiet stance; `reflex` false = ankles only */
+    Result push(float dirDeg, float dv, bool reflex) const
+    {
+        PushRecovery rec = rec_;                // fresh, Idle
+        V2 feet[2] = { home_[0], home_[1] };
+        V2 c = { 0.0f, 0.0f };
+        V2 v = { dv * std::cos(dirDeg / DEG), dv * std::sin(dirDeg / DEG) };
+        Result res = { true, false, -1, 0.0f };
+        bool landed = false;
+        int  escaped = -1;
+
+        for (int i = 0; i < (int)(RUN_S / DT); i++) {
+            /* Plant integrates, then the IMU sample reaches the loop */
+            const Box poly = support(rec, feet);
+            const V2  xi   = { c.x + v.x / omega_, c.y + v.y / omega_ };
+            const V2  o    = poly.centre();
+            const V2  p    = poly.clamp({ xi.x + 0.5f * (xi.x - o.x), xi.y + 0.5f * (xi.y - o.y) });
+            v.x += omega_ * omega_ * (c.x - p.x) * DT;
+            v.y += omega_ * omega_ * (c.y - p.y) * DT;
+            c.x += v.x * DT;
+            c.y += v.y * DT;
+
+            /* Tilt about the stance centre, PushRecovery's signs */
+            const float zc    = cfg_.comHeightMm;
+            const float pitch = -std::asin(std::fmax(-1.0f, std::fmin(1.0f, c.x / zc)));
+            const float roll  = -std::asin(std::fmax(-1.0f, std::fmin(1.0f, c.y / zc)));
+            if (std::hypot(pitch, roll) * DEG > FALL_DEG) {
+                res.recovered = false;
+                break;
+            }
+            if (!reflex) continue;
+
+            const V2 xiNow = { c.x + v.x / omega_, c.y + v.y / omega_ };
+            if (escaped < 0 && (std::fabs(xiNow.x) > halfX_ + cfg_.marginMm
+                                || std::fabs(xiNow.y) > halfY_ + cfg_.marginMm))
+                escaped = i;
+
+            const float pitchRate = -v.x / (zc * std::cos(pitch)) * DEG;
+            const float rollRate  = -v.y / (zc * std::cos(roll))  * DEG;
+            if (rec.update(roll * DEG, pitch * DEG, rollRate, pitchRate, DT)
+                    == PushRecovery::Event::StepStarted && !res.stepped) {
+                res.stepped  = true;
+                res.decision = escaped >= 0 ? i - escaped + 1 : 0;
+            }
+            /* Touchdown: the swing foot joins the polygon */
+            if (rec.state() == PushRecovery::State::Settling && !landed) {
+                res.landErrMm = land(rec, feet);
+                landed = true;
+            }
+            if (rec.state() == PushRecovery::State::Stepping) landed = false;
+        }
+        /* Held: the capture point came to rest inside the final polygon */
+        if (res.recovered)
+            CHECK(support(rec, feet).contains({ c.x + v.x / omega_, c.y + v.y / omega_ }));
+        return res;
+    }
+
+private:
+    PushRecovery::Config cfg_;
+    LegIK        ik_;
+    PushRecovery rec_;
+    Pose  stance_;
+    V2    centre_;
+    V2    home_[2];
+    float halfX_, halfY_;   // stance polygon about the centre
+    float omega_;
+
+    /** Swing foot position from the commanded joints; error vs. the plan */
+    float land(const PushRecovery &rec, V2 feet[2]) const
+    {
+        Pose cmd = stance_;
+        rec.applySwing(cmd);
+        const LegIK::Side side = rec.swingSide();
+        const int k = (int)side;
+        const LegIK::Vec3 a = ik_.forward(side, side == LegIK::Side::Left ? cmd.leftLeg
+                                                                          : cmd.rightLeg);
+        feet[k] = { a.x - centre_.x, a.y - centre_.y };
+        const V2 plan = { home_[k].x + rec.stepOffset().x, home_[k].y + rec.stepOffset().y };
+        return std::hypot(feet[k].x - plan.x, feet[k].y - plan.y);
+    }
+
+    Box footBox(V2 f) const
+    {
+        return { f.x - cfg_.footLength * 0.5f, f.x + cfg_.footLength * 0.5f,
+                 f.y - cfg_.footWidth  * 0.5f, f.y + cfg_.footWidth  * 0.5f };
+    }
+
+    Box support(const PushRecovery &rec, const V2 feet[2]) const
+    {
+        if (rec.state() == PushRecovery::State::Stepping)
+            return footBox(feet[rec.swingSide() == LegIK::Side::Left ? 1 : 0]);
+        const Box a = footBox(feet[0]), b = footBox(feet[1]);
+        return { std::fmin(a.x0, b.x0), std::fmax(a.x1, b.x1),
+                 std::fmin(a.y0, b.y0), std::fmax(a.y1, b.y1) };
+    }
+};
+
+struct Sweep {
+    float ankle;            // largest push with every smaller one held, ankles only
+    float best;             // largest push recovered with the reflex
+    int   saved;            // pushes beyond `ankle` the reflex recovers
+    bool  lost;             // the reflex dropped a push the ankles hold
+    int   decision;         // worst over the pushes that step
+    float landErrMm;        // worst over recovered steps
+};
+
+Sweep sweep(const Sim &sim, float dir)
+{
+    Sweep s = { 0.0f, 0.0f, 0, false, -1, 0.0f };
+    bool ankleOk = true;
+    for (float dv = DV_STEP; dv <= DV_MAX; dv += DV_STEP) {
+        const Result a = sim.push(dir, dv, false);
+        const Result r = sim.push(dir, dv, true);
+        ankleOk = ankleOk && a.recovered;
+        if (ankleOk) s.ankle = dv;
+        if (a.recovered && !r.recovered) s.lost = true;
+        if (r.stepped && r.decision > s.decision) s.decision = r.decision;
+        if (r.recovered) {
+            s.best = dv;
+            if (!a.recovered) s.saved++;
+            if (r.stepped) s.landErrMm = std::fmax(s.landErrMm, r.landErrMm);
+        }
+    }
+    return s;
+}
+
+/* Direction (0 = forward, 90 = left) */
+const struct { const char *name; float dir; } DIRS[] = {
+    { "forward",      0.0f }, { "fwd-left",    45.0f }, { "left",        90.0f },
+    { "back-left",  135.0f }, { "back",       180.0f }, { "back-right", 225.0f },
+    { "right",      270.0f }, { "fwd-right",  315.0f },
+};
+
+/**
+ * Ankle limits are ξ at the polygon edge: ω·20 mm sagittal, ω·54 mm lateral.
+ * A capture-point or IK regression shows up as a lost push, a late step or
+ * a foot off its target.
+ */
+void run(const char *title, const PushRecovery::Config &cfg, int minSaved)
+{
+    Sim sim(cfg);
+    const Result quiet = sim.push(0.0f, 0.0f, true);
+    CHECK(quiet.recovered && !quiet.stepped);
+
+    std::printf("%s (swing %.2f s)\n", title, cfg.stepTimeS);
+    std::printf("  %-11s %6s %6s %6s %10s %9s\n", "push", "ankle", "reflex", "saved", "decision", "land err");
+    int saved = 0;
+    for (const auto &d : DIRS) {
+        const Sweep s = sweep(sim, d.dir);
+        std::printf("  %-11s %6.0f %6.0f %6d %5.2f ms %6.2f mm\n", d.name, s.ankle, s.best,
+                    s.saved, s.decision * DT * 1000.0f, s.landErrMm);
+        CHECK(s.ankle >= 190.0f);
+        CHECK(!s.lost);
+        CHECK(s.decision >= 1 && s.decision <= 2);
+        CHECK(s.landErrMm < 2.0f);
+        saved += s.saved;
+    }
+    std::printf("  pushes saved by the reflex beyond the ankle limit: %d\n", saved);
+    CHECK(saved >= minSaved);
+}
+
+} // namespace
+
+int main()
+{
+    /* The firmware's swing: lifting a foot with the CoM between the feet
+     * tips the LIPM towards the swing side within one 0.3 s step */
+    run("default", PushRecovery::Config(), 0);
+
+    /* Fast swing: the step lands before that, sagittal pushes are saved */
+    PushRecovery::Config fast;
+    fast.stepTimeS = 0.08f;
+    run("fast swing", fast, 20);
+
+    return checkResult("test_push_recovery");
+}
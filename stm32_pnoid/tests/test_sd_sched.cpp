@@ -0,0 +1,346 @@
+/**
+ * @file    test_sd_sched.cpp
+ * @brief   SDScheduler ordering, merging and deadlines against a card model
+ *
+ * disk_read / disk_write are a card with per-command and per-sector cost
+ * and occasional write busy spikes, on simulated time. Checks: class /
+ * deadline / submit ordering (and plain submit order in FIFO mode),
+ * merged commands moving the right data in and out of each request's
+ * buffer, and a minute of audio read-ahead + telemetry slots + chunked
+ * log work where priority mode must not miss more audio deadlines than
+ * FIFO — none at all with log jobs bounded to one card operation. The
+ * unbounded log job (one 20-80 ms flush + sync) is run too for contrast:
+ * there priority ordering cannot help, the job is already running.
+ */
+
+#include "sd_sched.hpp"
+#include "fatfs.h"
+#include "check.hpp"
+#include <array>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+uint64_t     simNow = 0;
+std::mt19937 rng(1);
+uint32_t     cmds   = 0;
+bool         spikes = false;
+
+/* Sector store for the data checks (sparse, only LBAs touched) */
+std::unordered_map<uint32_t, std::array<uint8_t, 512>> card;
+
+} // namespace
+
+extern "C" uint64_t TIME_Micros(void)
+{
+    return simNow;
+}
+
+/* Card model: 250 us per command, 25 us/sector read (~20 MB/s), 40 us/sector
+ * write, and with spikes on a 2% chance of a 5-40 ms busy after a write */
+DRESULT disk_read(BYTE, BYTE *buf, DWORD lba, UINT n)
+{
+    cmds++;
+    simNow += 250 + 25 * n;
+    for (UINT i = 0; i < n; i++) {
+        auto it = card.find(lba + i);
+        if (it != card.end()) memcpy(buf + i * 512, it->second.data(), 512);
+        else                  memset(buf + i * 512, 0, 512);
+    }
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE, const BYTE *buf, DWORD lba, UINT n)
+{
+    cmds++;
+    simNow += 300 + 40 * n;
+    if (spikes && rng() % 100 < 2) simNow += 5000 + rng() % 35000;
+    for (UINT i = 0; i < n; i++) memcpy(card[lba + i].data(), buf + i * 512, 512);
+    return RES_OK;
+}
+
+namespace {
+
+using Stream = SDScheduler::Stream;
+using Op     = SDScheduler::Op;
+
+/* ---------- Ordering ----------------------------------------------------- */
+
+std::vector<int> order;
+
+bool nopJob(void *) { simNow += 100; return true; }
+void record(void *ctx, bool) { order.push_back((int)(intptr_t)ctx); }
+
+void submitJob(SDScheduler &s, SDScheduler::Request &r, Stream st, uint64_t deadline, int id)
+{
+    r.op         = Op::Job;
+    r.stream     = st;
+    r.job        = nopJob;
+    r.done       = record;
+    r.ctx        = (void *)(intptr_t)id;
+    r.deadlineUs = deadline;
+    CHECK(s.submit(r));
+}
+
+void testOrdering(bool fifo)
+{
+    SDScheduler s;
+    s.setFifo(fifo);
+    SDScheduler::Request r[6];
+    order.clear();
+    simNow = 1000;
+
+    submitJob(s, r[0], Stream::Log,       0,     0);
+    submitJob(s, r[1], Stream::Telemetry, 9000,  1);
+    submitJob(s, r[2], Stream::Audio,     0,     2);   // no deadline: last of its class
+    submitJob(s, r[3], Stream::Audio,     5000,  3);
+    submitJob(s, r[4], Stream::Telemetry, 3000,  4);
+    submitJob(s, r[5], Stream::Audio,     5000,  5);   // tie: submit order
+    CHECK(!s.submit(r[3]));                             // still queued
+
+    CHECK(s.run(0) == 6);
+    CHECK(s.idle());
+    std::vector<int> want = fifo ? std::vector<int>{ 0, 1, 2, 3, 4, 5 }
+                                 : std::vector<int>{ 3, 5, 2, 4, 1, 0 };
+    CHECK(order == want);
+}
+
+/* ---------- Merging ------------------------------------------------------ */
+
+uint8_t pat(uint32_t lba, uint32_t k) { return (uint8_t)(lba * 13u + k); }
+
+void fill(uint8_t *p, uint32_t lba, uint32_t n)
+{
+    for (uint32_t s = 0; s < n; s++)
+        for (uint32_t k = 0; k < 512; k++) p[s * 512 + k] = pat(lba + s, k);
+}
+
+bool matches(const uint8_t *p, uint32_t lba, uint32_t n)
+{
+    for (uint32_t s = 0; s < n; s++)
+        for (uint32_t k = 0; k < 512; k++)
+            if (p[s * 512 + k] != pat(lba + s, k)) return false;
+    return true;
+}
+
+void testMerge(bool fifo)
+{
+    SDScheduler s;
+    s.setFifo(fifo);
+    card.clear();
+
+    /* Writes 1000..1011: 0/1 share one buffer (in place), 2/3 elsewhere (gathered) */
+    alignas(32) static uint8_t near[6 * 512];
+    alignas(32) static uint8_t farA[3 * 512], farB[3 * 512];
+    SDScheduler::Request w[4];
+    fill(near, 1000, 6);
+    fill(farA, 1006, 3);
+    fill(farB, 1009, 3);
+    uint8_t *wbuf[4] = { near, near + 3 * 512, farA, farB };
+    uint32_t order4[4] = { 0, 2, 3, 1 };                   // submitted out of order
+    for (uint32_t i : order4) {
+        w[i].op     = Op::Write;
+        w[i].stream = Stream::Telemetry;
+        w[i].lba    = 1000 + i * 3;
+        w[i].count  = 3;
+        w[i].buf    = wbuf[i];
+        s.submit(w[i]);
+    }
+    cmds = 0;
+    s.run(0);
+    uint32_t writeCmds = cmds;
+    for (uint32_t lba = 1000; lba < 1012; lba++) {
+        CHECK(card.count(lba) == 1);
+        if (card.count(lba)) CHECK(matches(card[lba].data(), lba, 1));
+    }
+
+    /* Read the same range back into four scattered buffers */
+    alignas(32) static uint8_t rb[4][3 * 512];
+    SDScheduler::Request r[4];
+    memset(rb, 0, sizeof(rb));
+    for (uint32_t i : order4) {
+        r[i].op     = Op::Read;
+        r[i].stream = Stream::Audio;
+        r[i].lba    = 1000 + i * 3;
+        r[i].count  = 3;
+        r[i].buf    = rb[i];
+        s.submit(r[i]);
+    }
+    cmds = 0;
+    s.run(0);
+    for (uint32_t i = 0; i < 4; i++) CHECK(matches(rb[i], 1000 + i * 3, 3));
+
+    const SDScheduler::StreamStats &tm = s.stats(Stream::Telemetry);
+    const SDScheduler::StreamStats &au = s.stats(Stream::Audio);
+    CHECK(tm.requests == 4 && au.requests == 4);
+    CHECK(tm.sectors == 12 && au.sectors == 12);
+    if (fifo) {
+        CHECK(writeCmds == 4 && cmds == 4);
+        CHECK(tm.merged == 0 && au.merged == 0);
+    } else {
+        CHECK(writeCmds == 1 && cmds == 1);
+        CHECK(tm.merged == 3 && au.merged == 3);
+    }
+    CHECK(tm.errors == 0 && au.errors == 0);
+}
+
+/* ---------- Deadlines under load ----------------------------------------- */
+
+/*
+ * Log work per second: 4 halves of the log buffer (8 sectors each) and an
+ * f_sync (FAT + directory sector, then the card's commit busy). Chunked,
+ * as LOG_SD_Service now runs: one of those per job, resubmitted while
+ * work is left. Whole, as it ran before: everything in one job, 20-80 ms.
+ */
+struct LogWork {
+    SDScheduler *s;
+    SDScheduler::Request req;
+    uint32_t halves;
+    bool     syncDue;
+    uint32_t lba;
+    bool     chunked;
+};
+
+alignas(32) uint8_t logBuf[8 * 512];
+
+bool logJob(void *ctx)
+{
+    LogWork &w = *static_cast<LogWork *>(ctx);
+    if (!w.chunked) {
+        simNow += 20000 + rng() % 60000;
+        w.halves  = 0;
+        w.syncDue = false;
+    } else if (w.halves) {
+        disk_write(0, logBuf, w.lba, 8);
+        w.lba += 8;
+        w.halves--;
+    } else if (w.syncDue) {
+        disk_write(0, logBuf, 32, 1);
+        disk_write(0, logBuf, 2048, 1);
+        simNow += 5000 + rng() % 15000;
+        w.syncDue = false;
+    }
+    return true;
+}
+
+void logDone(void *ctx, bool)
+{
+    LogWork &w = *static_cast<LogWork *>(ctx);
+    if (w.halves || w.syncDue) w.s->submit(w.req);
+}
+
+struct SimResult {
+    uint32_t audioMissed;
+    uint32_t telemetryMissed;
+    uint32_t merged;
+    uint32_t logServiceUs;
+};
+
+SimResult simulate(bool fifo, bool chunkedLog)
+{
+    SDScheduler s;
+    s.setFifo(fifo);
+    simNow = 0;
+    rng.seed(1);
+    card.clear();
+    spikes = true;
+
+    /* Audio: 8 KB read-ahead (4 x 4-sector requests) every 42 ms, due when
+     * the consumer gets there; telemetry: 16-sector slot every 8 ms
+     * (~1 MB/s) as 2 x 8-sector requests; log: 4 halves + sync a second */
+    alignas(32) static uint8_t mem[32 * 1024];
+    SDScheduler::Request au[4], tm[2];
+    LogWork  lg{ &s, {}, 0, false, 4096, chunkedLog };
+    uint32_t auLba = 100000, tmLba = 500000;
+    uint64_t nextAu = 0, nextTm = 0, nextLg = 500000;
+    lg.req.op     = Op::Job;
+    lg.req.stream = Stream::Log;
+    lg.req.job    = logJob;
+    lg.req.done   = logDone;
+    lg.req.ctx    = &lg;
+
+    while (simNow < 60000000ull) {
+        if (simNow >= nextAu) {
+            for (int i = 0; i < 4; i++) {
+                if (au[i].queued) continue;
+                au[i].op         = Op::Read;
+                au[i].stream     = Stream::Audio;
+                au[i].lba        = auLba;
+                au[i].count      = 4;
+                au[i].buf        = mem + i * 2048;
+                au[i].deadlineUs = nextAu + 42000;
+                auLba += 4;
+                s.submit(au[i]);
+            }
+            nextAu += 42000;
+        }
+        if (simNow >= nextTm) {
+            for (int i = 0; i < 2; i++) {
+                if (tm[i].queued) continue;
+                tm[i].op         = Op::Write;
+                tm[i].stream     = Stream::Telemetry;
+                tm[i].lba        = tmLba;
+                tm[i].count      = 8;
+                tm[i].buf        = mem + 16384 + i * 4096;
+                tm[i].deadlineUs = nextTm + 64000;
+                tmLba += 8;
+                s.submit(tm[i]);
+            }
+            nextTm += 8000;
+        }
+        if (simNow >= nextLg && !lg.req.queued) {
+            lg.halves     = 4;
+            lg.syncDue    = true;
+            lg.req.deadlineUs = simNow + 1000000;
+            s.submit(lg.req);
+            nextLg += 1000000;
+        }
+        /* One request / batch per pass, like the superloop SD step */
+        if (s.run(1) == 0) simNow += 100;
+    }
+    spikes = false;
+
+    const SDScheduler::StreamStats &a = s.stats(Stream::Audio);
+    const SDScheduler::StreamStats &t = s.stats(Stream::Telemetry);
+    const SDScheduler::StreamStats &l = s.stats(Stream::Log);
+    printf("%s, %s log: audio %u missed (max latency %u us), telemetry %u missed, "
+           "%u merged, log service max %u us\n",
+           fifo ? "FIFO" : "prio", chunkedLog ? "chunked" : "whole",
+           a.missed, a.maxLatencyUs, t.missed, a.merged + t.merged, l.maxServiceUs);
+    CHECK(a.errors == 0 && t.errors == 0 && l.errors == 0);
+    CHECK(a.requests > 5000);
+    return { a.missed, t.missed, a.merged + t.merged, l.maxServiceUs };
+}
+
+void testDeadlines()
+{
+    SimResult fifoWhole = simulate(true, false);
+    SimResult prioWhole = simulate(false, false);
+    SimResult fifoChunk = simulate(true, true);
+    SimResult prioChunk = simulate(false, true);
+
+    CHECK(fifoWhole.merged == 0 && fifoChunk.merged == 0);
+    CHECK(prioChunk.merged > 0);
+
+    /* Bounded log jobs: audio waits at most one of them */
+    CHECK(prioChunk.logServiceUs < prioWhole.logServiceUs);
+    CHECK(prioChunk.audioMissed <= fifoChunk.audioMissed);
+    CHECK(prioChunk.audioMissed <= prioWhole.audioMissed);
+    CHECK(prioChunk.audioMissed == 0);
+    CHECK(prioChunk.telemetryMissed <= fifoChunk.telemetryMissed);
+}
+
+} // namespace
+
+int main()
+{
+    testOrdering(false);
+    testOrdering(true);
+    testMerge(false);
+    testMerge(true);
+    testDeadlines();
+    return checkResult("test_sd_sched");
+}
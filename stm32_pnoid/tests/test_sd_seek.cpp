@@ -0,0 +1,199 @@
+/**
+ * @file    test_sd_seek.cpp
+ * @brief   MediaIndex fast seek on a FatFs RAM disk
+ *
+ * A contiguous and a heavily fragmented file, random 512 B reads with
+ * and without the cached cluster map: the data must match either way,
+ * and with the map a seek must cost no FAT reads (sector reads per call
+ * bounded by the sectors the range spans), also after a remount. Then
+ * ReadAhead: a file played through audio-class scheduler jobs arrives
+ * whole and in order, and stop() leaves nothing queued.
+ */
+
+#include "sdcard.hpp"
+#include "fatfs.h"
+#include "ram_disk.h"
+#include "check.hpp"
+#include <vector>
+
+extern "C" uint64_t TIME_Micros(void)
+{
+    static uint64_t us = 0;
+    return us += 3;
+}
+
+namespace {
+
+constexpr uint32_t DISK_SECTORS = 131072;          // 64 MB
+constexpr int      READS        = 2000;
+
+FATFS              fs;
+SDCard::MediaIndex idx;
+
+uint32_t rng = 5;
+uint32_t rnd()
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+uint8_t pat(uint32_t pos, int file)
+{
+    return (uint8_t)(pos * 31u + (pos >> 9) + file);
+}
+
+struct SeekCost {
+    double   avgReads;      // disk_read calls per read()
+    uint32_t maxReads;
+};
+
+/** Random reads, verify every byte, count disk_read calls */
+SeekCost randomReads(int h, bool fast, int file)
+{
+    idx.setFastSeek(h, fast);
+
+    uint8_t  buf[512];
+    uint32_t size  = idx.size(h);
+    uint32_t total = 0, worst = 0;
+
+    for (int i = 0; i < READS; i++) {
+        uint32_t off = rnd() % (size - sizeof(buf));
+        uint32_t r0  = RamDisk::stats().readCalls;
+        uint32_t br  = 0;
+        CHECK(idx.read(h, off, buf, sizeof(buf), &br) == SDCard::Status::OK);
+        CHECK(br == sizeof(buf));
+        uint32_t n = RamDisk::stats().readCalls - r0;
+        total += n;
+        if (n > worst) worst = n;
+
+        bool ok = true;
+        for (uint32_t k = 0; k < sizeof(buf); k++) ok &= buf[k] == pat(off + k, file);
+        CHECK(ok);
+    }
+    return { (double)total / READS, worst };
+}
+
+void writeFiles()
+{
+    FIL  a, b;
+    UINT bw;
+    std::vector<uint8_t> blk(4096);
+
+    /* clip.bin: written in one go, contiguous */
+    REQUIRE(f_open(&a, "clip.bin", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    for (uint32_t pos = 0; pos < (24u << 20); pos += (uint32_t)blk.size()) {
+        for (uint32_t i = 0; i < blk.size(); i++) blk[i] = pat(pos + i, 0);
+        f_write(&a, blk.data(), (UINT)blk.size(), &bw);
+    }
+    f_close(&a);
+
+    /* frag.bin: interleaved with filler.bin, synced each block */
+    REQUIRE(f_open(&a, "frag.bin", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    REQUIRE(f_open(&b, "filler.bin", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    for (uint32_t pos = 0; pos < (16u << 20); pos += (uint32_t)blk.size()) {
+        for (uint32_t i = 0; i < blk.size(); i++) blk[i] = pat(pos + i, 1);
+        f_write(&a, blk.data(), (UINT)blk.size(), &bw);
+        f_sync(&a);
+        if ((pos >> 12) % 64 == 0) {
+            f_write(&b, blk.data(), 512, &bw);
+            f_sync(&b);
+        }
+    }
+    f_close(&a);
+    f_close(&b);
+}
+
+/** Consume a file through ReadAhead, running the scheduler like the card owner */
+void testReadAhead(int h, int file)
+{
+    SDScheduler sched;
+    alignas(32) static uint8_t buf[4 * 4096];
+    SDCard::ReadAhead ra(idx, sched, buf, 4096, 4);
+    uint32_t size = idx.size(h);
+
+    REQUIRE(ra.start(h, 0, 64000) == SDCard::Status::OK);
+    CHECK(ra.start(h, 0, 64000) != SDCard::Status::OK);     // still running
+
+    uint32_t pos = 0;
+    bool     ok  = true;
+    for (;;) {
+        uint32_t       len;
+        const uint8_t *p = ra.front(len);
+        if (p == nullptr) {
+            sched.run(0);
+            continue;
+        }
+        if (len == 0) break;
+        for (uint32_t k = 0; k < len; k++) ok &= p[k] == pat(pos + k, file);
+        pos += len;
+        ra.pop();
+    }
+    CHECK(ok);
+    CHECK(pos == size);
+    CHECK(!ra.failed());
+    CHECK(ra.idle());
+    const SDScheduler::StreamStats &st = sched.stats(SDScheduler::Stream::Audio);
+    CHECK(st.requests == (size + 4095) / 4096);
+    CHECK(st.errors == 0);
+
+    /* Stop part-way: queued chunks complete without reading */
+    REQUIRE(ra.start(h, 1u << 20, 64000) == SDCard::Status::OK);
+    sched.run(0);
+    uint32_t len;
+    const uint8_t *p = ra.front(len);
+    CHECK(p != nullptr && len == 4096 && p[0] == pat(1u << 20, file));
+    ra.pop();
+    ra.stop();
+    uint32_t r0 = RamDisk::stats().readCalls;
+    sched.run(0);
+    CHECK(RamDisk::stats().readCalls == r0);
+    CHECK(ra.idle());
+}
+
+} // namespace
+
+int main()
+{
+    RamDisk::create(DISK_SECTORS);
+    static BYTE work[4096];
+    REQUIRE(f_mkfs("", FM_FAT32, 512, work, sizeof(work)) == FR_OK);
+    REQUIRE(f_mount(&fs, "", 1) == FR_OK);
+    writeFiles();
+
+    int clip = idx.add("clip.bin");
+    int frag = idx.add("frag.bin");
+    REQUIRE(clip >= 0 && frag >= 0);
+    CHECK(idx.size(clip) == (24u << 20));
+    CHECK(idx.size(frag) == (16u << 20));
+    CHECK(idx.fragments(clip) == 1);
+    CHECK(idx.fragments(frag) > 16);
+
+    SeekCost clipChain = randomReads(clip, false, 0);
+    SeekCost clipMap   = randomReads(clip, true, 0);
+    SeekCost fragChain = randomReads(frag, false, 1);
+    SeekCost fragMap   = randomReads(frag, true, 1);
+    printf("reads/seek avg (max): clip chain %.1f (%u) CLMT %.1f (%u), "
+           "frag chain %.1f (%u) CLMT %.1f (%u)\n",
+           clipChain.avgReads, clipChain.maxReads, clipMap.avgReads, clipMap.maxReads,
+           fragChain.avgReads, fragChain.maxReads, fragMap.avgReads, fragMap.maxReads);
+
+    /* 512 B at any offset spans at most two sectors: no FAT reads with the map */
+    CHECK(clipMap.maxReads <= 2);
+    CHECK(fragMap.maxReads <= 2);
+    CHECK(fragChain.avgReads > 10 * fragMap.avgReads);
+
+    /* Registrations survive a remount, maps rebuilt */
+    idx.closeAll();
+    f_mount(nullptr, "", 0);
+    REQUIRE(f_mount(&fs, "", 1) == FR_OK);
+    idx.reopenAll();
+    CHECK(idx.fragments(frag) > 16);
+    SeekCost again = randomReads(frag, true, 1);
+    CHECK(again.maxReads <= 2);
+
+    testReadAhead(frag, 1);
+
+    idx.remove(clip);
+    idx.remove(frag);
+    return checkResult("test_sd_seek");
+}
@@ -0,0 +1,204 @@
+/**
+ * @file    test_sd_stream.cpp
+ * @brief   StreamWriter / StreamReader / streamRecover on a FatFs RAM disk
+ *
+ * Record → play round trip on a fragmented FAT32 volume (slot-sized
+ * multi-sector writes, file trimmed to the data), the same through the
+ * SD scheduler, then power cuts at random sectors: recovery must return
+ * exactly a prefix of what was sent and leave no clusters behind.
+ */
+
+#include "sdcard.hpp"
+#include "fatfs.h"
+#include "ram_disk.h"
+#include "check.hpp"
+#include <algorithm>
+#include <vector>
+
+extern "C" uint64_t TIME_Micros(void)
+{
+    static uint64_t us = 0;
+    return us += 3;
+}
+
+namespace {
+
+constexpr uint32_t DISK_SECTORS = 131072;          // 64 MB
+constexpr uint32_t SLOT         = 16;
+constexpr uint32_t PAYLOAD      = SDCard::StreamSector::PAYLOAD;
+
+FATFS fs;
+alignas(32) uint8_t ring[SLOT * 512 * 2];
+alignas(32) uint8_t rbuf[8192];
+
+uint32_t rng = 1;
+uint32_t rnd()
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+std::vector<uint8_t> pattern(size_t n, uint32_t seed)
+{
+    std::vector<uint8_t> v(n);
+    for (auto &b : v) {
+        seed = seed * 1103515245u + 12345u;
+        b = (uint8_t)(seed >> 16);
+    }
+    return v;
+}
+
+/** Push `d` in random-sized writes, servicing now and then; bytes accepted */
+size_t feed(SDCard::StreamWriter &w, const std::vector<uint8_t> &d, SDScheduler *sched)
+{
+    size_t sent = 0;
+    while (sent < d.size()) {
+        uint32_t n = 1 + rnd() % 3000;
+        if (n > d.size() - sent) n = (uint32_t)(d.size() - sent);
+        uint32_t a = w.write(&d[sent], n);
+        sent += a;
+        if (a < n || rnd() % 4 == 0) {
+            w.service();
+            if (sched) sched->run(0);
+        }
+    }
+    return sent;
+}
+
+std::vector<uint8_t> play(const char *path)
+{
+    std::vector<uint8_t> out;
+    SDCard::StreamReader r(rbuf, sizeof(rbuf));
+    if (r.open(path) != SDCard::Status::OK) return out;
+    uint8_t  tmp[777];
+    uint32_t n;
+    while ((n = r.read(tmp, sizeof(tmp))) > 0) out.insert(out.end(), tmp, tmp + n);
+    r.close();
+    return out;
+}
+
+FSIZE_t fileSize(const char *path)
+{
+    FILINFO fi;
+    return f_stat(path, &fi) == FR_OK ? fi.fsize : 0;
+}
+
+DWORD freeClusters()
+{
+    DWORD   n;
+    FATFS  *p;
+    f_getfree("", &n, &p);
+    return n;
+}
+
+/** Leave free space in holes so f_expand has to look past them */
+void fragmentVolume()
+{
+    FIL  f;
+    UINT bw;
+    char name[16];
+    for (int i = 0; i < 40; i++) {
+        snprintf(name, sizeof(name), "f%d", i);
+        f_open(&f, name, FA_CREATE_ALWAYS | FA_WRITE);
+        auto v = pattern(5000 + i * 300, i);
+        f_write(&f, v.data(), (UINT)v.size(), &bw);
+        f_close(&f);
+    }
+    for (int i = 0; i < 40; i += 2) {
+        snprintf(name, sizeof(name), "f%d", i);
+        f_unlink(name);
+    }
+}
+
+void testRoundTrip()
+{
+    auto d = pattern(8 * 1024 * 1024 + 123, 7);
+    RamDisk::Stats s0 = RamDisk::stats();
+
+    SDCard::StreamWriter w(ring, sizeof(ring), SLOT);
+    REQUIRE(w.open("a.pns", 16 * 1024 * 1024) == SDCard::Status::OK);
+    CHECK(feed(w, d, nullptr) == d.size());
+    CHECK(w.close() == SDCard::Status::OK);
+    CHECK(w.stats().bytes == d.size());
+
+    /* Data goes out a slot per disk_write, not sector by sector */
+    const RamDisk::Stats &s1 = RamDisk::stats();
+    uint32_t sectors = (uint32_t)((d.size() + PAYLOAD - 1) / PAYLOAD);
+    CHECK(s1.maxWriteCount == SLOT);
+    CHECK(s1.writeCalls - s0.writeCalls < sectors / 8);     // FAT updates included
+
+    CHECK(fileSize("a.pns") == (FSIZE_t)sectors * 512);
+    CHECK(play("a.pns") == d);
+
+    uint32_t pb = 0;
+    CHECK(SDCard::streamRecover("a.pns", pb) == SDCard::Status::OK);
+    CHECK(pb == d.size());
+    f_unlink("a.pns");
+}
+
+void testScheduled()
+{
+    auto d = pattern(1024 * 1024 + 77, 9);
+    SDScheduler sched;
+
+    SDCard::StreamWriter w(ring, sizeof(ring), SLOT);
+    w.attach(sched, 50);
+    REQUIRE(w.open("s.pns", 2 * 1024 * 1024) == SDCard::Status::OK);
+    CHECK(feed(w, d, &sched) == d.size());
+    CHECK(w.close() == SDCard::Status::OK);
+    CHECK(sched.idle());
+
+    const SDScheduler::StreamStats &st = sched.stats(SDScheduler::Stream::Telemetry);
+    CHECK(st.requests > 0);
+    CHECK(st.errors == 0);
+    CHECK(play("s.pns") == d);
+    f_unlink("s.pns");
+}
+
+void testPowerCuts()
+{
+    uint32_t pb = 0;
+    for (int it = 0; it < 30; it++) {
+        f_unlink("b.pns");
+        auto d   = pattern(1 + rnd() % (3 * 1024 * 1024), 100 + it);
+        long cut = (long)(rnd() % (d.size() / PAYLOAD + 3));
+
+        SDCard::StreamWriter w(ring, sizeof(ring), SLOT);
+        REQUIRE(w.open("b.pns", 4 * 1024 * 1024) == SDCard::Status::OK);
+        RamDisk::cutAfter(cut);                 // open's metadata is already down
+        feed(w, d, nullptr);
+        if (rnd() % 2) w.service();
+        f_mount(nullptr, "", 0);                // power lost: no close
+        RamDisk::cutAfter(-1);
+
+        REQUIRE(f_mount(&fs, "", 1) == FR_OK);
+        CHECK(SDCard::streamRecover("b.pns", pb) == SDCard::Status::OK);
+        auto got = play("b.pns");
+        CHECK(got.size() == pb);
+        CHECK(got.size() <= d.size());
+        CHECK(std::equal(got.begin(), got.end(), d.begin()));
+        CHECK(pb <= (uint64_t)cut * PAYLOAD);
+        CHECK(fileSize("b.pns") == (FSIZE_t)((pb + PAYLOAD - 1) / PAYLOAD) * 512);
+    }
+    f_unlink("b.pns");
+}
+
+} // namespace
+
+int main()
+{
+    RamDisk::create(DISK_SECTORS);
+    static BYTE work[4096];
+    REQUIRE(f_mkfs("", FM_FAT32, 512, work, sizeof(work)) == FR_OK);
+    REQUIRE(f_mount(&fs, "", 1) == FR_OK);
+
+    fragmentVolume();
+    DWORD free0 = freeClusters();
+
+    testRoundTrip();
+    testScheduled();
+    testPowerCuts();
+
+    CHECK(freeClusters() == free0);
+    return checkResult("test_sd_stream");
+}
@@ -0,0 +1,328 @@
+/**
+ * @file    test_walk_controller.cpp
+ * @brief   WalkController + FootstepPlanner driven through CmdMailbox
+ *
+ * The loop of App::run() on simulated time: IMU data-ready every
+ * ~0.9 ms with EXTI stamp jitter, walkMailbox.fetch() → setCommand(),
+ * walker.update(dt) while walking or a command is pending. Commands are
+ * posted as the UART / ESP handlers would, at arbitrary points of the step.
+ *
+ * Sequence: stand → start forward → burst of posts between two ticks →
+ * turn in place → stop in mid-step → start sideways (right leg leads) →
+ * stop. Checked on every step:
+ *   period       StepStarted to StepStarted within one sample of T, and
+ *                no drift over the walk (the phase carries the remainder)
+ *   placement    LegIK::forward() of the pose on the last tick of a step:
+ *                swing foot at +step/2, support at −step/2 (x, y, yaw),
+ *                dy / dyaw only on the leading leg, feet never cross
+ *   ramp         consecutive steps within the planner's maxDelta*
+ *   stop         the step in progress finishes at its full length, closing
+ *                steps bring the feet home, Stopped lands on the stance
+ * Reported: per-tick cost of walker.update() on the host.
+ */
+
+#include "walk_controller.hpp"
+#include "cmd_mailbox.hpp"
+#include "check.hpp"
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+extern "C" void Error_Handler(void) { std::abort(); }
+
+namespace {
+
+constexpr float SAMPLE_US = 909.0f;             // ICM-20948 data-ready, ~1.1 kHz
+constexpr float JITTER_US = 30.0f;
+constexpr float POS_TOL   = 2.5f;               // mm, int16 degree rounding of 3 joints
+constexpr float YAW_TOL   = 0.6f;               // deg
+
+std::mt19937 rng(29);
+
+/** Stance pose as App::run() builds it (bent-knee base pose) */
+Pose basePose()
+{
+    Pose p;
+    for (int16_t *leg : { p.leftLeg, p.rightLeg }) {
+        leg[Leg::HipRoll]    = 5;
+        leg[Leg::HipPitch]   = 12;
+        leg[Leg::KneePitch]  = 20;
+        leg[Leg::AnklePitch] = 10;
+    }
+    return p;
+}
+
+WalkCommand command(float vx, float vy, float yaw)
+{
+    WalkCommand c;
+    c.vx = vx;
+    c.vy = vy;
+    c.yawRate = yaw;
+    return c;
+}
+
+struct StepLog {
+    uint64_t startUs;
+    Footstep step;
+    WalkController::State state;
+};
+
+class Loop {
+public:
+    CmdMailbox<WalkCommand> mailbox;
+    WalkController walker;
+    FootstepPlanner::Config plan;
+    std::vector<StepLog> steps;
+    uint64_t nowUs     = 0;
+    uint64_t stoppedUs = 0;
+    int      stopped   = 0;
+    float    posErrMax = 0.0f;
+    float    yawErrMax = 0.0f;
+
+    /* walker.update() cost */
+    double   costSumNs = 0.0;
+    double   costMaxNs = 0.0;
+    uint32_t updates   = 0;
+
+    Loop()
+    {
+        ik_.configure(LegIK::Geometry());
+        stance_ = basePose();
+        walker.configure(WalkController::Config(), plan, ik_);
+        walker.setStance(stance_);
+        stanceAnkle_[0] = ik_.forward(LegIK::Side::Left,  stance_.leftLeg);
+        stanceAnkle_[1] = ik_.forward(LegIK::Side::Right, stance_.rightLeg);
+        pose_ = prev_ = stance_;
+    }
+
+    /** One IMU sample: App::run()'s fetch + walker step */
+    void tick()
+    {
+        const uint32_t periodUs = (uint32_t)(SAMPLE_US
+                                + JITTER_US * std::uniform_real_distribution<float>(-1, 1)(rng));
+        nowUs += periodUs;
+        const float dt = (float)periodUs * 1e-6f;
+
+        WalkCommand wc;
+        if (mailbox.fetch(wc)) walker.setCommand(wc);
+
+        if (!walker.isWalking() && walker.command().isZero()) {
+            pose_ = prev_ = stance_;
+            return;
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        const WalkController::Event ev = walker.update(dt, pose_);
+        const double ns = std::chrono::duration<double, std::nano>(
+                              std::chrono::steady_clock::now() - t0).count();
+        costSumNs += ns;
+        costMaxNs  = std::fmax(costMaxNs, ns);
+        updates++;
+
+        if (ev == WalkController::Event::StepStarted) {
+            /* The previous step just touched down: prev_ is its last tick */
+            if (!steps.empty()) checkPlacement(prev_, steps.back().step);
+            steps.push_back({ nowUs, walker.currentStep(), walker.state() });
+        } else if (ev == WalkController::Event::Stopped) {
+            if (!steps.empty()) checkPlacement(prev_, steps.back().step);
+            stopped++;
+            stoppedUs = nowUs;
+            for (int j = 0; j < Pose::NUM_JOINTS; j++) CHECK(pose_[j] == stance_[j]);
+        }
+        prev_ = pose_;
+    }
+
+    void runFor(float seconds)
+    {
+        const uint64_t end = nowUs + (uint64_t)(seconds * 1e6f);
+        while (nowUs < end) tick();
+    }
+
+    /** Tick until a step reaches `phase` (0..1): this one, or the next */
+    void runToPhase(float phase)
+    {
+        const uint64_t into = (uint64_t)(phase * plan.stepTimeS * 1e6f);
+        if (nowUs >= steps.back().startUs + into) {
+            const size_t n = steps.size();
+            while (steps.size() == n) tick();
+        }
+        while (nowUs < steps.back().startUs + into) tick();
+    }
+
+    float stepUs() const { return plan.stepTimeS * 1e6f; }
+
+private:
+    LegIK       ik_;
+    Pose        stance_, pose_, prev_;
+    LegIK::Vec3 stanceAnkle_[2];
+
+    /** Feet at touchdown: swing +d/2, support −d/2 about the stance */
+    void checkPlacement(const Pose &p, const Footstep &f)
+    {
+        const int sw = (int)f.side;
+        const int16_t *legs[2] = { p.leftLeg, p.rightLeg };
+        for (int s = 0; s < 2; s++) {
+            const float k = (s == sw) ? 0.5f : -0.5f;
+            const LegIK::Vec3 a = ik_.forward((LegIK::Side)s, legs[s]);
+            const float ex  = (a.x - stanceAnkle_[s].x) - k * f.dx;
+            const float ey  = (a.y - stanceAnkle_[s].y) - k * f.dy;
+            const float yaw = legs[s][Leg::HipYaw] * (s == 0 ? 1.0f : -1.0f);
+            const float eyaw = yaw - k * f.dyaw;
+            posErrMax = std::fmax(posErrMax, std::hypot(ex, ey));
+            yawErrMax = std::fmax(yawErrMax, std::fabs(eyaw));
+            CHECK(std::hypot(ex, ey) < POS_TOL);
+            CHECK(std::fabs(eyaw) < YAW_TOL);
+        }
+        /* Feet never cross: left stays left of the right foot */
+        const LegIK::Vec3 l = ik_.forward(LegIK::Side::Left,  p.leftLeg);
+        const LegIK::Vec3 r = ik_.forward(LegIK::Side::Right, p.rightLeg);
+        CHECK(l.y - r.y > 40.0f);
+    }
+};
+
+/** Steps [from, to) of the log: period within a sample of T, no drift */
+void checkPeriods(const Loop &L, size_t from, size_t to, const char *what)
+{
+    if (to - from < 2) return;
+    double worst = 0.0;
+    for (size_t i = from + 1; i < to; i++) {
+        const double period = (double)(L.steps[i].startUs - L.steps[i - 1].startUs);
+        worst = std::fmax(worst, std::fabs(period - L.stepUs()));
+    }
+    const double mean = (double)(L.steps[to - 1].startUs - L.steps[from].startUs) / (to - from - 1);
+    std::printf("%-10s %2zu steps, period mean %.1f us (T %.0f us), worst |period - T| %.0f us\n",
+                what, to - from, mean, L.stepUs(), worst);
+    CHECK(worst <= SAMPLE_US + JITTER_US);
+    CHECK(std::fabs(mean - L.stepUs()) <= (SAMPLE_US + JITTER_US) / (to - from - 1) + 1.0);
+}
+
+/** Consecutive steps stay within the planner's rate limits */
+void checkRamp(const Loop &L, size_t from, size_t to)
+{
+    const FootstepPlanner::Config &c = L.plan;
+    for (size_t i = from + 1; i < to; i++) {
+        const Footstep &a = L.steps[i - 1].step, &b = L.steps[i].step;
+        CHECK(a.side != b.side);
+        CHECK(std::fabs(b.dx) <= c.maxStepX + 1e-3f);
+        CHECK(std::fabs(b.dx - a.dx) <= c.maxDeltaX + 1e-3f);
+        CHECK(std::fabs(b.dy) <= c.maxStepY + 1e-3f);
+        CHECK(std::fabs(b.dyaw) <= c.maxStepYaw + 1e-3f);
+        /* Sideways / turning motion only on the leg leading that way */
+        if (b.dy > 0.0f || b.dyaw > 0.0f)   CHECK(b.side == LegIK::Side::Left);
+        if (b.dy < 0.0f || b.dyaw < 0.0f)   CHECK(b.side == LegIK::Side::Right);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    Loop L;
+    const float T = L.plan.stepTimeS;
+
+    /* Standing, nothing posted: the walker is never run */
+    L.runFor(0.5f);
+    CHECK(!L.walker.isWalking());
+    CHECK(L.updates == 0);
+
+    /* Start forward: an in-place step, then dx ramps to vx·T */
+    L.mailbox.post(command(50.0f, 0.0f, 0.0f));
+    const uint64_t postedUs = L.nowUs;
+    L.tick();
+    REQUIRE(L.walker.state() == WalkController::State::Start);
+    CHECK(L.steps.size() == 1 && L.steps[0].startUs - postedUs <= SAMPLE_US + JITTER_US);
+    CHECK(L.steps[0].step.isZero());
+    L.runFor(4.0f);
+    const size_t walkEnd = L.steps.size();
+    CHECK(L.steps[1].state == WalkController::State::Walk);
+    CHECK(std::fabs(L.steps[1].step.dx - L.plan.maxDeltaX) < 1e-3f);
+    CHECK(std::fabs(L.steps.back().step.dx - 50.0f * T) < 1e-3f);
+
+    /* Two posts between ticks: only the newer one is seen */
+    const uint32_t posts = L.mailbox.count();
+    L.mailbox.post(command(60.0f, 0.0f, 0.0f));
+    L.mailbox.post(command(40.0f, 0.0f, 0.0f));
+    L.tick();
+    CHECK(L.mailbox.count() == posts + 2);
+    CHECK(L.walker.command().vx == 40.0f);
+
+    /* Turn in place, CCW: the left leg carries the yaw, dx ramps to zero */
+    L.runToPhase(0.3f);
+    L.mailbox.post(command(0.0f, 0.0f, 20.0f));
+    L.runFor(5.0f);
+    const size_t turnEnd = L.steps.size();
+    CHECK(L.steps.back().state == WalkController::State::Turn);
+    bool sawYaw = false;
+    for (size_t i = walkEnd; i < turnEnd; i++) {
+        const Footstep &f = L.steps[i].step;
+        if (L.steps[i].state != WalkController::State::Turn) continue;
+        CHECK(f.dx == 0.0f || std::fabs(f.dx) <= L.plan.maxDeltaX + 1e-3f);
+        if (f.side == LegIK::Side::Right) CHECK(f.dyaw == 0.0f);
+        else if (f.dx == 0.0f) { CHECK(std::fabs(f.dyaw - 20.0f * T) < 1e-3f); sawYaw = true; }
+    }
+    CHECK(sawYaw);
+
+    /* Stop in mid-step of a yawing (left) step: it runs to its full
+     * length, then closing steps bring the feet home */
+    L.runToPhase(0.5f);
+    if (L.steps.back().step.side != LegIK::Side::Left) {
+        L.runToPhase(0.0f);
+        L.runToPhase(0.5f);
+    }
+    const size_t stopFrom   = L.steps.size();
+    const uint64_t stopAtUs = L.nowUs;
+    const uint64_t dueUs    = L.steps.back().startUs + (uint64_t)L.stepUs();
+    CHECK(L.steps.back().step.dyaw != 0.0f);
+    L.mailbox.post(command(0.0f, 0.0f, 0.0f));
+    L.runFor(4.0f * T);
+    REQUIRE(L.stopped == 1);
+    CHECK(!L.walker.isWalking());
+    REQUIRE(L.steps.size() > stopFrom);
+    CHECK(std::fabs((double)L.steps[stopFrom].startUs - (double)dueUs) <= SAMPLE_US + JITTER_US);
+    for (size_t i = stopFrom; i < L.steps.size(); i++) {
+        CHECK(L.steps[i].state == WalkController::State::Stop);
+        CHECK(L.steps[i].step.isZero());
+    }
+    const size_t closing = L.steps.size() - stopFrom;
+    CHECK(closing <= 2);
+    CHECK(L.stoppedUs - L.steps.back().startUs <= (uint64_t)(L.stepUs() + SAMPLE_US + JITTER_US));
+    std::printf("stop       posted at 0.5 of a step, %zu closing step(s), stand after %.0f ms\n",
+                closing, (L.stoppedUs - stopAtUs) / 1000.0);
+    const size_t stopEnd = L.steps.size();
+
+    /* Stand again: nothing runs until the next command */
+    const uint32_t updates = L.updates;
+    L.runFor(0.5f);
+    CHECK(L.updates == updates);
+
+    /* Sideways to the right: the right leg leads, the left one closes */
+    L.mailbox.post(command(0.0f, -30.0f, 0.0f));
+    L.runFor(3.0f);
+    const size_t sideEnd = L.steps.size();
+    CHECK(L.steps[stopEnd].step.side == LegIK::Side::Left);        // in place
+    CHECK(L.steps[stopEnd + 1].step.side == LegIK::Side::Right);
+    for (size_t i = sideEnd - 2; i < sideEnd; i++) {
+        const Footstep &f = L.steps[i].step;
+        if (f.side == LegIK::Side::Right) CHECK(std::fabs(f.dy + 30.0f * T) < 1e-3f);
+        else                              CHECK(f.dy == 0.0f);
+    }
+    L.runToPhase(0.8f);
+    L.mailbox.post(command(0.0f, 0.0f, 0.0f));
+    L.runFor(4.0f * T);
+    CHECK(L.stopped == 2);
+
+    checkRamp(L, 0, walkEnd);
+    checkRamp(L, walkEnd, stopEnd);
+    checkRamp(L, stopEnd, L.steps.size());
+    checkPeriods(L, 0, stopEnd, "walk+turn");
+    checkPeriods(L, stopEnd, L.steps.size(), "sideways");
+
+    std::printf("placement  worst %.2f mm, %.2f deg over %zu steps\n",
+                L.posErrMax, L.yawErrMax, L.steps.size());
+    std::printf("update()   %u ticks, %.0f ns mean, %.0f ns max (host)\n",
+                L.updates, L.costSumNs / L.updates, L.costMaxNs);
+
+    return checkResult("test_walk_controller");
+}